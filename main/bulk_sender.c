@@ -0,0 +1,270 @@
+#include "bulk_sender.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "metrics.h"
+#include "trace.h"
+
+static const char *TAG = "BULK_SENDER";
+
+typedef struct {
+    int idx;
+    size_t len;
+} bulk_block_t;
+
+typedef struct {
+    bulk_read_fn_t read;
+    void *ctx;
+    size_t limit;
+    char *bufs[2];
+    volatile bool abort;
+} bulk_job_t;
+
+static QueueHandle_t job_q;          // Transferência para a tarefa leitora
+static QueueHandle_t free_q;         // Índices de buffers livres
+static QueueHandle_t filled_q;       // Blocos lidos, prontos para envio
+static SemaphoreHandle_t reader_mutex;
+static SemaphoreHandle_t stats_mutex;
+static bulk_sender_stats_t stats;
+
+// Tarefa leitora: enche um buffer do SD enquanto o outro está sendo enviado
+static void bulk_reader_task(void *arg) {
+    while (1) {
+        bulk_job_t *job;
+        xQueueReceive(job_q, &job, portMAX_DELAY);
+
+        size_t remaining = job->limit;
+        while (1) {
+            bulk_block_t blk = { .len = 0 };
+            xQueueReceive(free_q, &blk.idx, portMAX_DELAY);
+            if (!job->abort && remaining > 0) {
+                TRACE_BEGIN("sd_read");
+                blk.len = job->read(job->ctx, job->bufs[blk.idx], remaining < BULK_BLOCK_SIZE ? remaining : BULK_BLOCK_SIZE);
+                TRACE_END("sd_read");
+                remaining -= blk.len;
+            }
+            xQueueSend(filled_q, &blk, portMAX_DELAY);
+            if (blk.len == 0) {
+                break; // Fim (ou abortado): o remetente para ao receber len 0
+            }
+        }
+    }
+}
+
+esp_err_t bulk_sender_init(void) {
+    if (job_q != NULL) {
+        return ESP_OK;
+    }
+    job_q = xQueueCreate(1, sizeof(bulk_job_t *));
+    free_q = xQueueCreate(2, sizeof(int));
+    filled_q = xQueueCreate(2, sizeof(bulk_block_t));
+    reader_mutex = xSemaphoreCreateMutex();
+    stats_mutex = xSemaphoreCreateMutex();
+    if (!job_q || !free_q || !filled_q || !reader_mutex || !stats_mutex) {
+        ESP_LOGE(TAG, "Failed to create bulk sender queues");
+        return ESP_ERR_NO_MEM;
+    }
+    TaskHandle_t handle = NULL;
+    if (xTaskCreate(bulk_reader_task, "BulkReader", 4096, NULL, tskIDLE_PRIORITY + 5, &handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create bulk reader task");
+        return ESP_ERR_NO_MEM;
+    }
+    metrics_register_task(handle);
+    return ESP_OK;
+}
+
+esp_err_t bulk_send_raw(int sockfd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        int n = send(sockfd, p, len, MSG_DONTWAIT);
+        if (n > 0) {
+            p += n;
+            len -= n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Janela TCP cheia (o antigo "erro 11"): espera o socket
+            // voltar a aceitar dados em vez de dormir um tempo fixo.
+            fd_set wfds;
+            FD_ZERO(&wfds);
+            FD_SET(sockfd, &wfds);
+            struct timeval tv = { .tv_sec = BULK_SEND_TIMEOUT_S };
+            __atomic_fetch_add(&stats.stalls, 1, __ATOMIC_RELAXED);
+            int r = select(sockfd + 1, NULL, &wfds, NULL, &tv);
+            if (r > 0) {
+                continue;
+            }
+            ESP_LOGW(TAG, "Socket %d not writable for %d s", sockfd, BULK_SEND_TIMEOUT_S);
+            return ESP_ERR_TIMEOUT;
+        }
+        ESP_LOGW(TAG, "send() failed on socket %d (errno %d)", sockfd, errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void record_transfer(size_t bytes, int64_t elapsed_us, bool ok, bool sync) {
+    uint32_t kbps = elapsed_us > 0 ? (uint32_t)((uint64_t)bytes * 1000000 / 1024 / elapsed_us) : 0;
+
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    stats.transfers++;
+    stats.bytes += bytes;
+    if (!ok) stats.aborted++;
+    if (sync) stats.sync_fallbacks++;
+    stats.last_kbps = kbps;
+    if (kbps > stats.max_kbps) stats.max_kbps = kbps;
+    xSemaphoreGive(stats_mutex);
+
+    ESP_LOGI(TAG, "%s %u bytes in %lld ms (%lu KB/s%s)", ok ? "Sent" : "Aborted after",
+             (unsigned)bytes, (long long)(elapsed_us / 1000), (unsigned long)kbps, sync ? ", single buffer" : "");
+}
+
+// Caminho sem buffer duplo: outra transferência já usa a tarefa leitora
+// ou não há memória para dois blocos.
+static esp_err_t send_stream_sync(int sockfd, bulk_read_fn_t read, void *ctx, size_t limit, size_t *sent, char *buf, size_t buf_len) {
+    esp_err_t err = ESP_OK;
+    while (err == ESP_OK && *sent < limit) {
+        size_t want = limit - *sent < buf_len ? limit - *sent : buf_len;
+        size_t n = read(ctx, buf, want);
+        if (n == 0) break;
+        err = bulk_send_raw(sockfd, buf, n);
+        if (err == ESP_OK) *sent += n;
+    }
+    return err;
+}
+
+esp_err_t bulk_send_stream(int sockfd, bulk_read_fn_t read, void *ctx, size_t limit, size_t *sent) {
+    *sent = 0;
+    int64_t start_us = esp_timer_get_time();
+
+    bulk_job_t job = { .read = read, .ctx = ctx, .limit = limit, .abort = false };
+    job.bufs[0] = heap_caps_malloc(BULK_BLOCK_SIZE, MALLOC_CAP_DMA);
+    job.bufs[1] = heap_caps_malloc(BULK_BLOCK_SIZE, MALLOC_CAP_DMA);
+
+    esp_err_t err;
+    if (job.bufs[0] == NULL) {
+        // Sem memória DMA: usa um bloco menor da heap comum
+        heap_caps_free(job.bufs[1]);
+        char small[1024];
+        err = send_stream_sync(sockfd, read, ctx, limit, sent, small, sizeof(small));
+        record_transfer(*sent, esp_timer_get_time() - start_us, err == ESP_OK, true);
+        return err;
+    }
+    if (job.bufs[1] == NULL || xSemaphoreTake(reader_mutex, 0) != pdTRUE) {
+        err = send_stream_sync(sockfd, read, ctx, limit, sent, job.bufs[0], BULK_BLOCK_SIZE);
+        heap_caps_free(job.bufs[0]);
+        heap_caps_free(job.bufs[1]);
+        record_transfer(*sent, esp_timer_get_time() - start_us, err == ESP_OK, true);
+        return err;
+    }
+
+    // 1. Entrega os dois buffers à tarefa leitora
+    xQueueReset(free_q);
+    xQueueReset(filled_q);
+    for (int i = 0; i < 2; i++) {
+        xQueueSend(free_q, &i, 0);
+    }
+    bulk_job_t *job_ptr = &job;
+    xQueueSend(job_q, &job_ptr, portMAX_DELAY);
+
+    // 2. Envia cada bloco lido e devolve o buffer para a próxima leitura.
+    //    Em erro, sinaliza 'abort' e continua drenando até a leitora parar.
+    err = ESP_OK;
+    while (1) {
+        bulk_block_t blk;
+        xQueueReceive(filled_q, &blk, portMAX_DELAY);
+        if (blk.len == 0) {
+            break;
+        }
+        if (err == ESP_OK) {
+            TRACE_BEGIN("tcp_send");
+            err = bulk_send_raw(sockfd, job.bufs[blk.idx], blk.len);
+            TRACE_END("tcp_send");
+            if (err == ESP_OK) {
+                *sent += blk.len;
+            } else {
+                job.abort = true;
+            }
+        }
+        xQueueSend(free_q, &blk.idx, portMAX_DELAY);
+    }
+
+    xSemaphoreGive(reader_mutex);
+    heap_caps_free(job.bufs[0]);
+    heap_caps_free(job.bufs[1]);
+    record_transfer(*sent, esp_timer_get_time() - start_us, err == ESP_OK, false);
+    return err;
+}
+
+// --- Chunked ---
+
+static esp_err_t chunked_flush(bulk_chunked_t *ch) {
+    if (ch->failed || ch->len == 0) {
+        return ch->failed ? ESP_FAIL : ESP_OK;
+    }
+    char size_line[12];
+    int n = snprintf(size_line, sizeof(size_line), "%X\r\n", (unsigned)ch->len);
+    esp_err_t err = bulk_send_raw(ch->sockfd, size_line, n);
+    if (err == ESP_OK) err = bulk_send_raw(ch->sockfd, ch->buf, ch->len);
+    if (err == ESP_OK) err = bulk_send_raw(ch->sockfd, "\r\n", 2);
+    ch->total += ch->len;
+    ch->len = 0;
+    ch->failed = (err != ESP_OK);
+    return err;
+}
+
+esp_err_t bulk_chunked_begin(bulk_chunked_t *ch, int sockfd) {
+    memset(ch, 0, sizeof(*ch));
+    ch->sockfd = sockfd;
+    ch->start_us = esp_timer_get_time();
+    ch->buf = heap_caps_malloc(BULK_BLOCK_SIZE, MALLOC_CAP_DMA);
+    return ch->buf ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t bulk_chunked_write(bulk_chunked_t *ch, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0 && !ch->failed) {
+        size_t n = BULK_BLOCK_SIZE - ch->len;
+        if (n > len) n = len;
+        memcpy(ch->buf + ch->len, p, n);
+        ch->len += n;
+        p += n;
+        len -= n;
+        if (ch->len == BULK_BLOCK_SIZE) {
+            chunked_flush(ch);
+        }
+    }
+    return ch->failed ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t bulk_chunked_end(bulk_chunked_t *ch, bool ok) {
+    esp_err_t err = ESP_FAIL;
+    if (ok && chunked_flush(ch) == ESP_OK) {
+        err = bulk_send_raw(ch->sockfd, "0\r\n\r\n", 5);
+    }
+    heap_caps_free(ch->buf);
+    ch->buf = NULL;
+    record_transfer(ch->total, esp_timer_get_time() - ch->start_us, err == ESP_OK, false);
+    return err;
+}
+
+void bulk_sender_get_stats(bulk_sender_stats_t *out) {
+    if (stats_mutex == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(stats_mutex);
+}
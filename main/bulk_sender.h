@@ -0,0 +1,57 @@
+#ifndef BULK_SENDER_H
+#define BULK_SENDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Envio em massa para o servidor HTTP. Lê o SD em blocos grandes (memória
+// com DMA) numa tarefa própria enquanto o bloco anterior está sendo enviado
+// (buffer duplo), e trata EAGAIN/envios parciais esperando o socket ficar
+// gravável (select) em vez de dormir um tempo fixo a cada bloco.
+
+#define BULK_BLOCK_SIZE         8192
+#define BULK_SEND_TIMEOUT_S     20      // Mesmo valor de send_wait_timeout do httpd
+
+// Lê até 'len' bytes da origem; 0 indica fim.
+typedef size_t (*bulk_read_fn_t)(void *ctx, char *buf, size_t len);
+
+typedef struct {
+    uint32_t transfers;
+    uint32_t aborted;
+    uint32_t sync_fallbacks;     // Transferências sem buffer duplo (leitor ocupado)
+    uint32_t stalls;             // Vezes que o envio esperou a janela TCP
+    uint64_t bytes;
+    uint32_t last_kbps;
+    uint32_t max_kbps;
+} bulk_sender_stats_t;
+
+esp_err_t bulk_sender_init(void);
+
+// Envia todo o buffer pelo socket, respeitando o controle de fluxo do TCP.
+esp_err_t bulk_send_raw(int sockfd, const void *data, size_t len);
+
+// Envia até 'limit' bytes lidos de 'read' (buffer duplo quando possível).
+// '*sent' recebe o total enviado.
+esp_err_t bulk_send_stream(int sockfd, bulk_read_fn_t read, void *ctx, size_t limit, size_t *sent);
+
+// Escritor com "Transfer-Encoding: chunked" que agrupa escritas pequenas
+// em chunks de até BULK_BLOCK_SIZE bytes.
+typedef struct {
+    int sockfd;
+    char *buf;
+    size_t len;
+    size_t total;
+    int64_t start_us;
+    bool failed;
+} bulk_chunked_t;
+
+esp_err_t bulk_chunked_begin(bulk_chunked_t *ch, int sockfd);
+esp_err_t bulk_chunked_write(bulk_chunked_t *ch, const void *data, size_t len);
+// Envia o último chunk (e o terminador, se 'ok'); libera o buffer.
+esp_err_t bulk_chunked_end(bulk_chunked_t *ch, bool ok);
+
+void bulk_sender_get_stats(bulk_sender_stats_t *out);
+
+#endif // BULK_SENDER_H
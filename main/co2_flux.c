@@ -0,0 +1,63 @@
+#include "co2_flux.h"
+
+#define GAS_CONSTANT    8.314462618     // J mol⁻¹ K⁻¹
+#define KELVIN_OFFSET   273.15
+
+void co2_flux_init(co2_flux_acc_t *acc) {
+    acc->count = 0;
+    acc->t_mean = 0.0;
+    acc->c_mean = 0.0;
+    acc->s_tt = 0.0;
+    acc->s_cc = 0.0;
+    acc->s_tc = 0.0;
+}
+
+void co2_flux_add(co2_flux_acc_t *acc, double t_s, double ppm) {
+    // Welford bivariado: os desvios antes (dt, dc) e depois da atualização
+    // das médias dão as somas exatas sem guardar as amostras
+    acc->count++;
+    double dt = t_s - acc->t_mean;
+    double dc = ppm - acc->c_mean;
+    acc->t_mean += dt / acc->count;
+    acc->c_mean += dc / acc->count;
+    acc->s_tt += dt * (t_s - acc->t_mean);
+    acc->s_cc += dc * (ppm - acc->c_mean);
+    acc->s_tc += dt * (ppm - acc->c_mean);
+}
+
+bool co2_flux_finalize(const co2_flux_acc_t *acc, const co2_flux_chamber_t *chamber,
+                       bool temp_valid, float temp_c, co2_flux_t *out) {
+    out->slope_ppm_s = 0.0f;
+    out->intercept_ppm = (float)acc->c_mean;
+    out->r2 = 0.0f;
+    out->flux = 0.0f;
+    out->flags = 0;
+    if (acc->count < 2 || acc->s_tt <= 0.0) {
+        return false;
+    }
+
+    double slope = acc->s_tc / acc->s_tt;
+    // Série constante: não há variância a explicar e o R² é indefinido.
+    // Fica 0 com CO2_FLUX_FLAT, para não passar por um ajuste perfeito.
+    bool flat = acc->s_cc <= 0.0;
+    double r2 = flat ? 0.0 : (acc->s_tc * acc->s_tc) / (acc->s_tt * acc->s_cc);
+
+    if (!temp_valid) {
+        temp_c = CO2_FLUX_DEFAULT_TEMP_C;
+        out->flags |= CO2_FLUX_NO_TEMP;
+    }
+    double moles = chamber->pressure_pa * chamber->volume_m3 / (GAS_CONSTANT * (temp_c + KELVIN_OFFSET));
+
+    out->slope_ppm_s = (float)slope;
+    out->intercept_ppm = (float)(acc->c_mean - slope * acc->t_mean);
+    out->r2 = (float)r2;
+    out->flux = (float)(slope * moles / chamber->area_m2);
+    out->flags |= CO2_FLUX_COMPUTED;
+    if (acc->count < CO2_FLUX_MIN_SAMPLES) out->flags |= CO2_FLUX_FEW_SAMPLES;
+    if (flat) {
+        out->flags |= CO2_FLUX_FLAT;
+    } else if (r2 < CO2_FLUX_MIN_R2) {
+        out->flags |= CO2_FLUX_LOW_R2;
+    }
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef CO2_FLUX_H
+#define CO2_FLUX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Fluxo de CO2 da câmara a partir da série de amostras de um ciclo.
+// A reta ppm × tempo é ajustada por mínimos quadrados incrementais
+// (Welford bivariado): cada amostra atualiza médias e somas de produtos
+// dos desvios, em memória constante qualquer que seja o número de amostras.
+// A inclinação (ppm/s = µmol mol⁻¹ s⁻¹) vira fluxo pela lei dos gases
+// ideais com a temperatura do DHT:
+//
+//   F [µmol m⁻² s⁻¹] = (dC/dt) · P · V / (R · T · A)
+//
+// Este módulo não depende do ESP-IDF.
+
+#define CO2_FLUX_MIN_SAMPLES    5       // Menos que isso: fluxo não confiável
+#define CO2_FLUX_MIN_R2         0.80f   // Abaixo: ajuste ruim (sinalizado, não descartado)
+#define CO2_FLUX_DEFAULT_TEMP_C 25.0f   // Usada quando o DHT falha
+
+// Bits de qualidade (gravados no registro)
+#define CO2_FLUX_COMPUTED       0x01    // Há fluxo (registros antigos têm 0)
+#define CO2_FLUX_FEW_SAMPLES    0x02
+#define CO2_FLUX_LOW_R2         0x04
+#define CO2_FLUX_NO_TEMP        0x08    // Temperatura padrão no lugar do DHT
+#define CO2_FLUX_FLAT           0x10    // Série constante: inclinação 0, R² indefinido (0)
+
+typedef struct {
+    float volume_m3;
+    float area_m2;
+    float pressure_pa;
+} co2_flux_chamber_t;
+
+typedef struct {
+    int count;
+    double t_mean;           // s
+    double c_mean;           // ppm
+    double s_tt;             // Somas de produtos dos desvios
+    double s_cc;
+    double s_tc;
+} co2_flux_acc_t;
+
+typedef struct {
+    float slope_ppm_s;
+    float intercept_ppm;     // Concentração ajustada em t = 0
+    float r2;
+    float flux;              // µmol m⁻² s⁻¹
+    uint8_t flags;
+} co2_flux_t;
+
+void co2_flux_init(co2_flux_acc_t *acc);
+
+// Acumula uma amostra válida: 't_s' em segundos desde o início do ciclo.
+void co2_flux_add(co2_flux_acc_t *acc, double t_s, double ppm);
+
+// Ajuste final. Sem temperatura válida usa CO2_FLUX_DEFAULT_TEMP_C.
+// Retorna false (flags sem CO2_FLUX_COMPUTED) com menos de duas amostras
+// em instantes distintos.
+bool co2_flux_finalize(const co2_flux_acc_t *acc, const co2_flux_chamber_t *chamber,
+                       bool temp_valid, float temp_c, co2_flux_t *out);
+
+#endif // CO2_FLUX_H
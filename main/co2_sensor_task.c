@@ -1,37 +1,210 @@
 #include "co2_sensor_task.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "driver/uart.h"
-#include "driver/gpio.h"
+#include "freertos/semphr.h"
+#include "hal.h"
 #include "esp_log.h"
-#include "sd_card.h"
-#include "rtc.h"
-#include "dht.h"
+#include "esp_timer.h"
+#include "mhz14a.h"
+#include "co2_stats.h"
+#include "co2_flux.h"
+#include "sample_clock.h"
+#include "sensor_power.h"
+#include "metrics.h"
+#include "trace.h"
+#include "record_store.h"
+#include "sensor_snapshot.h"
+#include "measurement_pipeline.h"
+#include "nvs.h"
 #include <stdlib.h>
-#include "esp_sleep.h"
+#include <string.h>
+#include <math.h>
 
-#define ESTRATO "Medio"        // Defina o estrato como "Superior", "Médio" ou "Superior"
+// Fases do ciclo antes das amostras (chaves u32 "purge_s" e "settle_s" do
+// namespace NVS "config", 0 pula a fase). O agendador começa o ciclo essa
+// soma de segundos antes do horário: a primeira amostra sai no horário.
+#define PURGA_S 30                     // Fan ligado renovando o ar da câmara
+#define ASSENTAMENTO_S 10              // Fan desligado, ar parado antes da primeira amostra
+#define INTERVALO_AMOSTRAS_MS 2000     // Período entre o início de amostras consecutivas (relógio fixo, sample_clock.h)
+#define FRACAO_APARADA 0.1f            // Fração descartada em cada extremidade na média aparada.
 
-// #define FAN_PURGE_DURATION_S 0        // Duração que o fan fica ligado para limpeza, em segundos. 
-#define NUM_AMOSTRAS 31                // Número de amostras a serem coletadas para a mediana. Use um número ímpar. (alterar para 61 pelo menos na prática)
-#define INTERVALO_AMOSTRAS_MS 2000     // Intervalo entre cada amostra rápida em milissegundos.
+// Amostragem adaptativa: depois de AMOSTRAS_MIN a coleta para assim que o
+// intervalo de 95% da mediana de todos os canais fica dentro de
+// ±TOLERANCIA_MEDIANA_PPM; com ar turbulento ela segue até AMOSTRAS_MAX.
+// AMOSTRAS_MIN = AMOSTRAS_MAX volta ao número fixo de amostras. Chaves u32
+// do namespace NVS "config": "samples_min", "samples_max" e "median_ci_c10"
+// (tolerância em décimos de ppm).
+#define AMOSTRAS_MIN 15
+#define AMOSTRAS_MAX PIPELINE_MAX_SAMPLES // Tamanho dos vetores de amostras (máximo configurável)
+#define TOLERANCIA_MEDIANA_PPM 2.0f
+
+// Câmara fechada para o fluxo (co2_flux.h). Podem ser ajustados sem
+// recompilar pelas chaves u32 "chamber_cm3", "chamber_cm2" e "pressure_pa"
+// do namespace NVS "config".
+#define CAMARA_VOLUME_CM3 8000         // Volume interno da câmara (cm³)
+#define CAMARA_AREA_CM2 400            // Área de solo coberta (cm²)
+#define PRESSAO_PA 101325              // Sem barômetro: pressão local fixa (ajuste pela altitude)
 
 // NOVO: Pino para controle de energia do sensor MH-Z14A
-#define CO2_POWER_PIN GPIO_NUM_23      // Pino conectado à base do transistor 2N2222A
-#define CO2_WARMUP_TIME_S 180           // Tempo de aquecimento do sensor em segundos (alterar para pelo menos 3 minutos na prática)
+#define CO2_POWER_PIN 23               // Pino conectado à base do transistor 2N2222A (alimenta todos os sensores)
 
-#define UART_PORT UART_NUM_1
-#define TX_PIN 17
-#define RX_PIN 16
-#define DHT_PIN 4 
 #define FAN_PIN 13 
-#define UART_BUF_SIZE 1024
+#define CO2_READ_TIMEOUT_MS 1000       // Prazo para a resposta de cada amostra
+#define CO2_QUICK_TIMEOUT_MS 2000      // Prazo da leitura rápida do serviço de snapshot
+#define SENSOR_SERVICE_PERIOD_MS 30000 // Intervalo de atualização do snapshot fora das medições
+
+// #define MULTI_ESTRATO // Descomente para medir os três estratos com um único aparelho
+
+// Um canal por estrato: um MH-Z14A e um DHT22. Os canais são amostrados
+// juntos, na mesma janela de tempo, e cada um grava no arquivo diário do
+// seu estrato. Sensores além das duas UARTs livres dividem uma UART com
+// RX em pinos diferentes (o TX pode ser o mesmo fio).
+typedef struct {
+    const char *estrato;
+    mhz14a_config_t uart;
+    int dht_pin;
+} channel_config_t;
+
+static const channel_config_t CHANNELS[] = {
+#ifdef MULTI_ESTRATO
+    { "Superior", { .uart_port = 2, .tx_pin = 33, .rx_pin = 32 }, 22 },
+    { "Medio",    { .uart_port = 1, .tx_pin = 17, .rx_pin = 16 }, 4 },
+    { "Inferior", { .uart_port = 2, .tx_pin = 33, .rx_pin = 35 }, 15 },  // Divide a UART2 com o Superior
+#else
+    { "Medio",    { .uart_port = 1, .tx_pin = 17, .rx_pin = 16 }, 4 },   // Defina o estrato como "Superior", "Medio" ou "Inferior"
+#endif
+};
+
+#define NUM_CANAIS ((int)(sizeof(CHANNELS) / sizeof(CHANNELS[0])))
 
 static const char *TAG = "CO2_SENSOR_TASK";
+extern SemaphoreHandle_t xSensorMutex; // Pega o Mutex criado no main.c
+
+// Driver de cada canal (UART instalada durante toda a execução), usado só
+// com xSensorMutex. As séries do ciclo ficam na mensagem do pipeline.
+typedef struct {
+    mhz14a_t co2;
+} channel_t;
+
+static channel_t channels[NUM_CANAIS];
+
+_Static_assert(NUM_CANAIS <= SENSOR_SNAPSHOT_CHANNELS, "um snapshot por canal");
+_Static_assert(NUM_CANAIS <= PIPELINE_MAX_CHANNELS, "um estrato por canal da mensagem do pipeline");
+
+// xSensorMutex só durante o I/O dos sensores e as trocas de energia: a
+// purga, o assentamento e os intervalos entre amostras deixam o sensor
+// livre para o serviço de snapshot.
+void sensor_lock(void) {
+    int64_t wait_start = metrics_start();
+    TRACE_BEGIN("sensor_mutex_wait");
+    xSemaphoreTake(xSensorMutex, portMAX_DELAY);
+    TRACE_END("sensor_mutex_wait");
+    metrics_stop(METRIC_SCHED_MUTEX_WAIT, wait_start);
+    TRACE_BEGIN("sensor_mutex");
+}
+
+void sensor_unlock(void) {
+    TRACE_END("sensor_mutex");
+    xSemaphoreGive(xSensorMutex);
+}
+
+int co2_sensor_channel_count(void) {
+    return NUM_CANAIS;
+}
+
+const char *co2_sensor_channel_estrato(int channel) {
+    return (channel >= 0 && channel < NUM_CANAIS) ? CHANNELS[channel].estrato : NULL;
+}
+
+// Atualiza o snapshot do canal mantendo o valor do sensor que não foi lido
+// agora. Só é chamada com xSensorMutex, o que garante um único escritor.
+static void publish_reading(int channel, bool co2_ok, int co2, bool dht_ok, float temp, float hum) {
+    sensor_reading_t reading;
+    if (!sensor_snapshot_read(channel, &reading)) {
+        memset(&reading, 0, sizeof(reading));
+        reading.co2_ppm = -1;
+    }
 
-// Função auxiliar para ordenar o array de amostras para o cálculo da mediana.
-int comparar_inteiros(const void * a, const void * b) {
-   return ( *(int*)a - *(int*)b );
+    int64_t now_us = esp_timer_get_time();
+    if (co2_ok) {
+        reading.co2_ppm = co2;
+        reading.co2_valid = true;
+        reading.co2_time_us = now_us;
+    }
+    if (dht_ok) {
+        reading.temperature = temp;
+        reading.humidity = hum;
+        reading.dht_valid = true;
+        reading.dht_time_us = now_us;
+    }
+    sensor_snapshot_publish(channel, &reading);
+}
+
+// Parâmetros de um ciclo: os valores de compilação, sobrescritos pelo NVS
+typedef struct {
+    co2_flux_chamber_t chamber;
+    uint32_t purge_s;
+    uint32_t settle_s;
+    int samples_min;
+    int samples_max;
+    float median_ci_ppm;
+} cycle_config_t;
+
+static void load_cycle_config(cycle_config_t *cfg) {
+    uint32_t volume_cm3 = CAMARA_VOLUME_CM3;
+    uint32_t area_cm2 = CAMARA_AREA_CM2;
+    uint32_t pressure_pa = PRESSAO_PA;
+    uint32_t samples_min = AMOSTRAS_MIN;
+    uint32_t samples_max = AMOSTRAS_MAX;
+    uint32_t median_ci_c10 = (uint32_t)lroundf(TOLERANCIA_MEDIANA_PPM * 10);
+    cfg->purge_s = PURGA_S;
+    cfg->settle_s = ASSENTAMENTO_S;
+    nvs_handle_t nvs;
+    if (nvs_open("config", NVS_READONLY, &nvs) == ESP_OK) {
+        uint32_t value;
+        // Zero é válido aqui: desliga a fase
+        nvs_get_u32(nvs, "purge_s", &cfg->purge_s);
+        nvs_get_u32(nvs, "settle_s", &cfg->settle_s);
+        if (nvs_get_u32(nvs, "samples_min", &value) == ESP_OK && value > 0) {
+            samples_min = value;
+        }
+        if (nvs_get_u32(nvs, "samples_max", &value) == ESP_OK && value > 0) {
+            samples_max = value;
+        }
+        if (nvs_get_u32(nvs, "median_ci_c10", &value) == ESP_OK && value > 0) {
+            median_ci_c10 = value;
+        }
+        if (nvs_get_u32(nvs, "chamber_cm3", &value) == ESP_OK && value > 0) {
+            volume_cm3 = value;
+        }
+        if (nvs_get_u32(nvs, "chamber_cm2", &value) == ESP_OK && value > 0) {
+            area_cm2 = value;
+        }
+        if (nvs_get_u32(nvs, "pressure_pa", &value) == ESP_OK && value > 0) {
+            pressure_pa = value;
+        }
+        nvs_close(nvs);
+    }
+    cfg->chamber.volume_m3 = volume_cm3 * 1e-6f;
+    cfg->chamber.area_m2 = area_cm2 * 1e-4f;
+    cfg->chamber.pressure_pa = (float)pressure_pa;
+
+    // O máximo é limitado pelos vetores de amostras; o mínimo, pelo máximo
+    cfg->samples_max = samples_max > AMOSTRAS_MAX ? AMOSTRAS_MAX : (int)samples_max;
+    cfg->samples_min = samples_min > (uint32_t)cfg->samples_max ? cfg->samples_max : (int)samples_min;
+    cfg->median_ci_ppm = median_ci_c10 / 10.0f;
+}
+
+// Todos os canais que já responderam têm a mediana dentro da tolerância?
+// Um canal mudo não prende os outros: ele só entraria na conta com amostras.
+static bool channels_converged(const pipeline_cycle_t *data, float half_width_ppm) {
+    for (int c = 0; c < NUM_CANAIS; c++) {
+        const co2_stats_acc_t *acc = &data->channels[c].acumulador;
+        if (acc->count > 0 && !co2_stats_converged(acc, half_width_ppm)) {
+            return false;
+        }
+    }
+    return true;
 }
 
 // NOVA FUNÇÃO: Controla a energia do sensor MH-Z14A
@@ -40,171 +213,519 @@ void co2_sensor_power_control(bool enable) {
     
     // Inicializar o pino apenas uma vez
     if (!power_pin_initialized) {
-        gpio_reset_pin(CO2_POWER_PIN);
-        gpio_set_direction(CO2_POWER_PIN, GPIO_MODE_OUTPUT);
-        gpio_set_level(CO2_POWER_PIN, 1); // Começa ligado
+        hal_gpio_output(CO2_POWER_PIN, 1); // Começa ligado
         power_pin_initialized = true;
         ESP_LOGI(TAG, "CO2 sensor power control pin (GPIO%d) initialized", CO2_POWER_PIN);
     }
     
     if (enable) {
         ESP_LOGI(TAG, "Turning ON CO2 sensor power...");
-        gpio_set_level(CO2_POWER_PIN, 1); // Liga o transistor (sensor recebe energia)
-        // ESP_LOGI(TAG, "CO2 sensor warming up for %d seconds...", CO2_WARMUP_TIME_S);
-        // vTaskDelay(pdMS_TO_TICKS(CO2_WARMUP_TIME_S * 1000)); // Aguarda aquecimento
-        ESP_LOGI(TAG, "CO2 sensor ready for measurements");
+        hal_gpio_set(CO2_POWER_PIN, 1); // Liga o transistor (sensor recebe energia)
+        // O aquecimento é controlado por sensor_power.h
     } else {
         ESP_LOGI(TAG, "Turning OFF CO2 sensor power...");
-        gpio_set_level(CO2_POWER_PIN, 0); // Desliga o transistor (sensor sem energia)
+        hal_gpio_set(CO2_POWER_PIN, 0); // Desliga o transistor (sensor sem energia)
     }
 }
 
-void perform_single_measurement(void) {
-    ESP_LOGI(TAG, "Performing scheduled measurement...");
-    
+// Instala as UARTs de todos os canais (idempotente). ESP_OK se ao menos
+// um canal está pronto: um sensor com defeito não para os outros estratos.
+esp_err_t co2_sensor_init(void) {
+    esp_err_t result = ESP_FAIL;
+    for (int i = 0; i < NUM_CANAIS; i++) {
+        esp_err_t err = mhz14a_init(&channels[i].co2, &CHANNELS[i].uart);
+        if (err == ESP_OK) {
+            result = ESP_OK;
+        } else {
+            ESP_LOGE(TAG, "CO2 sensor for %s unavailable: %s", CHANNELS[i].estrato, esp_err_to_name(err));
+        }
+    }
+    return result;
+}
 
-    
-    // 2. Configuração dos Pinos e Periféricos (enquanto o sensor aquece)
-    uart_config_t uart_config = {
-        .baud_rate = 9600,
-        .data_bits = UART_DATA_8_BITS,
-        .parity    = UART_PARITY_DISABLE,
-        .stop_bits = UART_STOP_BITS_1,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE
-    };
-    uart_param_config(UART_PORT, &uart_config);
-    uart_set_pin(UART_PORT, TX_PIN, RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    uart_driver_install(UART_PORT, UART_BUF_SIZE, 0, 0, NULL, 0);
-
-    gpio_reset_pin(FAN_PIN);
-    gpio_set_direction(FAN_PIN, GPIO_MODE_OUTPUT);
-    gpio_set_level(FAN_PIN, 0); // Garante que comece desligado
-    
-    // // 3. Liga o Fan para renovar o ar (sensor já está aquecendo)
-    // ESP_LOGI(TAG, "Activating fan for %d seconds to purge air...", FAN_PURGE_DURATION_S);
-    // gpio_set_level(FAN_PIN, 1);
-    // vTaskDelay(pdMS_TO_TICKS(FAN_PURGE_DURATION_S * 1000));
+// Uma amostra de cada canal na mesma janela: as requisições saem juntas e
+// as respostas são consumidas à medida que chegam. Canais que dividem uma
+// UART entram um depois do outro (cada resposta leva ~30 ms).
+// result[i]: ESP_OK (ppm[i] válido), ESP_ERR_TIMEOUT ou o erro do driver.
+// t_us[i] (opcional): envio do comando do canal, o instante da amostra.
+static void sample_channels(int ppm[], esp_err_t result[], int64_t t_us[], uint32_t timeout_ms) {
+    int left = 0;
+    for (int i = 0; i < NUM_CANAIS; i++) {
+        result[i] = channels[i].co2.installed ? ESP_ERR_NOT_FINISHED : ESP_ERR_INVALID_STATE;
+        left += (result[i] == ESP_ERR_NOT_FINISHED);
+    }
 
-    // // 4. Desliga o fan ANTES de iniciar as medições
-    // gpio_set_level(FAN_PIN, 0);
-    // ESP_LOGI(TAG, "Fan deactivated. Starting measurements in static air.");
-    // vTaskDelay(pdMS_TO_TICKS(1000)); // Pequena pausa para o ar assentar
+    while (left > 0) {
+        // 1. Requisição em cada canal cuja UART está livre
+        int pending = 0;
+        for (int i = 0; i < NUM_CANAIS; i++) {
+            mhz14a_t *dev = &channels[i].co2;
+            if (result[i] != ESP_ERR_NOT_FINISHED || dev->pending || mhz14a_port_busy(dev)) {
+                pending += (result[i] == ESP_ERR_NOT_FINISHED && dev->pending);
+                continue;
+            }
+            esp_err_t err = mhz14a_request(dev, timeout_ms);
+            if (err == ESP_OK) {
+                pending++;
+            } else {
+                result[i] = err;
+                left--;
+            }
+        }
 
-    // 5. Leitura do DHT (já com o ar renovado e parado)
-    float temperature = 0.0, humidity = 0.0;
-    if (dht_read_float_data(DHT_TYPE_AM2301, DHT_PIN, &humidity, &temperature) != ESP_OK) {
-        ESP_LOGE(TAG, "Could not read data from DHT22");
+        // 2. Consome o que chegou. Com um único canal pendente a leitura
+        //    espera por ele e retorna assim que o quadro fecha.
+        for (int i = 0; i < NUM_CANAIS; i++) {
+            mhz14a_t *dev = &channels[i].co2;
+            if (result[i] != ESP_ERR_NOT_FINISHED || !dev->pending) {
+                continue;
+            }
+            TickType_t wait = 0;
+            if (pending == 1) {
+                int64_t remaining_us = dev->deadline_us - esp_timer_get_time();
+                wait = remaining_us > 0 ? pdMS_TO_TICKS(remaining_us / 1000) + 1 : 0;
+            }
+            esp_err_t err = mhz14a_poll(dev, &ppm[i], wait);
+            if (err != ESP_ERR_NOT_FINISHED) {
+                result[i] = err;
+                left--;
+                if (t_us != NULL) {
+                    t_us[i] = dev->request_us;
+                }
+            }
+        }
+        if (left > 0 && pending != 1) {
+            vTaskDelay(1);
+        }
     }
-    
-    // 6. --- INÍCIO DA COLETA RÁPIDA DE AMOSTRAS ---
-    ESP_LOGI(TAG, "Collecting %d CO2 samples...", NUM_AMOSTRAS);
-    int co2_amostras[NUM_AMOSTRAS];
-    int amostras_validas = 0;
-    uint8_t read_cmd[9] = { 0xFF, 0x01, 0x86, 0x00, 0x00, 0x00, 0x00, 0x00, 0x79 };
-    
-    for (int i = 0; i < NUM_AMOSTRAS; i++) {
-        uart_write_bytes(UART_PORT, (const char *)read_cmd, sizeof(read_cmd));
-        uint8_t data[9];
-        int len = uart_read_bytes(UART_PORT, data, sizeof(data), pdMS_TO_TICKS(1000));
-
-        if (len == 9) { // Checagem básica de recebimento
-            co2_amostras[i] = (data[2] << 8) | data[3];
-            amostras_validas++;
-        } else {
-            co2_amostras[i] = -1; // Marca como leitura inválida
-        }
-        vTaskDelay(pdMS_TO_TICKS(INTERVALO_AMOSTRAS_MS));
-    }
-    ESP_LOGI(TAG, "Sample collection finished. Valid samples: %d/%d", amostras_validas, NUM_AMOSTRAS);
-    // --- FIM DA COLETA RÁPIDA DE AMOSTRAS ---
-
-    // 7. Definir turno de medição (se for de 7 as 9 = manha, 11 as 13 = zênite, 16 as 18 = entardecer)
-    time_t now;
-    struct tm timeinfo;
-    time(&now);
-    localtime_r(&now, &timeinfo);
-    const char *turno_medicao = "Desconhecido";
-    if (timeinfo.tm_hour >= 7 && timeinfo.tm_hour <= 9) {
-        turno_medicao = "Manha";
-    } else if (timeinfo.tm_hour >= 11 && timeinfo.tm_hour <= 13) {
-        turno_medicao = "Zenite";
-    } else if (timeinfo.tm_hour >= 16 && timeinfo.tm_hour <= 18) {
-        turno_medicao = "Entardecer";
+}
+
+// --- CICLO DE MEDIÇÃO (AQUISIÇÃO) ---
+// Máquina de estados: purga -> assentamento -> (aquecimento) -> amostragem.
+// Cada fase tem um prazo absoluto (esp_timer); cycle_step() faz só o
+// trabalho que já venceu e devolve o instante do próximo evento. Quem roda
+// o ciclo é a tarefa do sensor (sensor_service_task), que dorme numa
+// notificação até esse instante: o agendador só pede o ciclo e segue livre.
+// Os DHTs são lidos nos intervalos entre as amostras de CO2. Ao fim da
+// amostragem as séries seguem para o pipeline (measurement_pipeline.h):
+// mediana, fluxo e gravação rodam no outro núcleo, e o próximo ciclo não
+// espera por elas.
+
+typedef struct {
+    cycle_phase_t phase;
+    int64_t phase_end_us;    // Prazo da fase (purga, assentamento, aquecimento)
+    cycle_config_t cfg;
+    sample_clock_t clock;
+    int64_t series_start;
+    int dht_next;            // Próximo canal cujo DHT será lido
+    int64_t cycle_start;     // Para METRIC_CYCLE
+    TaskHandle_t notify;     // Avisada quando as séries forem entregues (ou NULL)
+    pipeline_cycle_t data;   // Séries sendo montadas (turno, amostras, DHTs)
+} cycle_t;
+
+static cycle_t cycle;        // Só a tarefa do sensor usa
+
+// Cópia publicada para o agendador e a página, e o pedido de um novo ciclo
+static cycle_status_t cycle_status;
+static bool cycle_requested;
+static turno_id_t request_turno;
+static TaskHandle_t request_notify;
+static portMUX_TYPE status_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t sensor_task_handle;
+
+static const char *const PHASE_NAMES[] = {
+    [CYCLE_IDLE] = "idle",
+    [CYCLE_PURGE] = "purge",
+    [CYCLE_SETTLE] = "settle",
+    [CYCLE_WARMUP] = "warmup",
+    [CYCLE_SAMPLE] = "sample",
+};
+
+const char *co2_sensor_phase_name(cycle_phase_t phase) {
+    return (phase >= CYCLE_IDLE && phase <= CYCLE_SAMPLE) ? PHASE_NAMES[phase] : "?";
+}
+
+void co2_sensor_cycle_status(cycle_status_t *out) {
+    portENTER_CRITICAL(&status_lock);
+    *out = cycle_status;
+    portEXIT_CRITICAL(&status_lock);
+}
+
+bool co2_sensor_cycle_busy(void) {
+    portENTER_CRITICAL(&status_lock);
+    bool busy = cycle_requested || cycle_status.phase != CYCLE_IDLE;
+    portEXIT_CRITICAL(&status_lock);
+    return busy;
+}
+
+uint32_t co2_sensor_cycle_lead_s(void) {
+    cycle_config_t cfg;
+    load_cycle_config(&cfg);
+    return cfg.purge_s + cfg.settle_s;
+}
+
+// Publica a fase; na amostragem o fim previsto é o da última amostra possível
+static void publish_status(const cycle_t *cy, int64_t phase_end_us) {
+    portENTER_CRITICAL(&status_lock);
+    cycle_status.phase = cy->phase;
+    cycle_status.phase_end_us = phase_end_us;
+    cycle_status.samples_taken = cy->data.tomadas;
+    cycle_status.samples_max = cy->cfg.samples_max;
+    portEXIT_CRITICAL(&status_lock);
+}
+
+static void enter_phase(cycle_t *cy, cycle_phase_t phase, int64_t phase_end_us) {
+    cy->phase = phase;
+    cy->phase_end_us = phase_end_us;
+    TRACE_INSTANT(co2_sensor_phase_name(phase));
+    publish_status(cy, phase_end_us);
+}
+
+static void read_dht(cycle_t *cy, int c) {
+    pipeline_channel_t *ch = &cy->data.channels[c];
+    ch->temperature = 0.0f;
+    ch->humidity = 0.0f;
+    sensor_lock();
+    int64_t probe = metrics_start();
+    TRACE_BEGIN("dht_read");
+    esp_err_t dht_err = hal_dht_read(CHANNELS[c].dht_pin, &ch->humidity, &ch->temperature);
+    TRACE_END("dht_read");
+    metrics_stop(METRIC_DHT_READ, probe);
+    ch->dht_ok = (dht_err == ESP_OK);
+    if (ch->dht_ok) {
+        publish_reading(c, false, 0, true, ch->temperature, ch->humidity);
     }
-    
+    sensor_unlock();
+    if (!ch->dht_ok) {
+        ESP_LOGE(TAG, "Could not read data from DHT22 (%s)", CHANNELS[c].estrato);
+    }
+}
 
-    // 8. --- CÁLCULO DA MEDIANA ---
-    int co2_mediana = -1;
-    if (amostras_validas > 0) {
-        // Ordena o array de amostras do menor para o maior
-        qsort(co2_amostras, NUM_AMOSTRAS, sizeof(int), comparar_inteiros);
-        // O valor da mediana é o elemento do meio do array ordenado
-        co2_mediana = co2_amostras[NUM_AMOSTRAS / 2];
+static void start_sampling(cycle_t *cy, int64_t now_us) {
+    ESP_LOGI(TAG, "Collecting %d-%d CO2 samples (median 95%% CI target: +/-%.1f ppm)...",
+             cy->cfg.samples_min, cy->cfg.samples_max, cy->cfg.median_ci_ppm);
+    // Apenas leituras válidas entram no vetor de cada canal; as estatísticas
+    // de fluxo (min/max/média/desvio) e a reta do fluxo da câmara são
+    // atualizadas à medida que chegam.
+    for (int c = 0; c < NUM_CANAIS; c++) {
+        pipeline_channel_t *ch = &cy->data.channels[c];
+        ch->estrato = CHANNELS[c].estrato;
+        ch->validas = 0;
+        co2_stats_init(&ch->acumulador);
+        co2_flux_init(&ch->fluxo);
     }
-    // --- FIM DO CÁLCULO DA MEDIANA ---
-    
-    // 10. Processa e salva o valor final (a mediana)
-    char date_str[11], time_str[9];
-    const char *estrato = ESTRATO;
-    get_current_date_time(date_str, sizeof(date_str), time_str, sizeof(time_str));
+    // Relógio de período fixo: a duração de cada leitura não se acumula
+    // no intervalo entre amostras
+    sample_clock_start(&cy->clock, INTERVALO_AMOSTRAS_MS, now_us);
+    cy->series_start = cy->clock.next_us;
+    cy->data.tomadas = 0;
+    cy->dht_next = 0;
+    enter_phase(cy, CYCLE_SAMPLE, now_us + (int64_t)(cy->cfg.samples_max - 1) * cy->clock.period_us);
+}
 
-    ESP_LOGI(TAG, "FINAL VALUE: %s %s | CO2 (Median): %d ppm | Temp: %.1fC | Hum: %.1f%% | Estrato: %s | Turno_Medicao: %s", 
-                date_str, time_str, co2_mediana, temperature, humidity, estrato, turno_medicao);
+// Uma amostra de todos os canais. Retorna true quando a coleta acabou.
+static bool take_sample(cycle_t *cy, int64_t now_us) {
+    int ppm[NUM_CANAIS];
+    esp_err_t co2_err[NUM_CANAIS];
+    int64_t t_us[NUM_CANAIS];
+    // Só quadros com cabeçalho e checksum válidos chegam à mediana
+    metrics_record(METRIC_SAMPLE_LATENESS, sample_clock_mark(&cy->clock, now_us));
+    sensor_lock();
+    int64_t probe = metrics_start();
+    TRACE_BEGIN("co2_sample");
+    sample_channels(ppm, co2_err, t_us, CO2_READ_TIMEOUT_MS);
+    TRACE_END("co2_sample");
+    metrics_stop(METRIC_CO2_ROUNDTRIP, probe);
+    for (int c = 0; c < NUM_CANAIS; c++) {
+        if (co2_err[c] == ESP_OK) {
+            publish_reading(c, true, ppm[c], false, 0, 0); // A página acompanha a medição ao vivo
+        }
+    }
+    sensor_unlock();
 
-    char csv_line[128];
-    snprintf(csv_line, sizeof(csv_line), "%s;%s;%d;%.1f;%.1f;%s;%s\n", 
-                date_str, time_str, co2_mediana, temperature, humidity, estrato, turno_medicao);
-    
-    write_data_to_csv(csv_line, estrato);
+    pipeline_cycle_t *data = &cy->data;
+    for (int c = 0; c < NUM_CANAIS; c++) {
+        pipeline_channel_t *ch = &data->channels[c];
+        if (co2_err[c] == ESP_OK) {
+            ESP_LOGD(TAG, "Sample %d (%s): %d ppm at +%lld us", data->tomadas, CHANNELS[c].estrato,
+                     ppm[c], (long long)(t_us[c] - cy->series_start));
+            ch->amostras[ch->validas++] = ppm[c];
+            co2_stats_add(&ch->acumulador, ppm[c]);
+            // A reta usa o instante real de cada amostra, não o índice
+            co2_flux_add(&ch->fluxo, (t_us[c] - cy->series_start) / 1e6, ppm[c]);
+        }
+    }
+    data->tomadas++;
+    // Ar calmo: encerra cedo e economiza sensor e UART
+    return data->tomadas >= cy->cfg.samples_max ||
+           (data->tomadas >= cy->cfg.samples_min && channels_converged(data, cy->cfg.median_ci_ppm));
+}
 
-    // Desinstala o driver da UART para economizar energia
-    uart_driver_delete(UART_PORT);
-    
-    ESP_LOGI(TAG, "Measurement completed.");
-}
-
-bool get_quick_sensor_data(int *co2, float *temp, float *hum) {
-    ESP_LOGI(TAG, "Performing QUICK sensor reading for Web...");
-
-    // 1. Configura UART (Necessário pois é desligada após medição principal)
-    uart_config_t uart_config = {
-        .baud_rate = 9600,
-        .data_bits = UART_DATA_8_BITS,
-        .parity    = UART_PARITY_DISABLE,
-        .stop_bits = UART_STOP_BITS_1,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE
-    };
-    uart_param_config(UART_PORT, &uart_config);
-    uart_set_pin(UART_PORT, TX_PIN, RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    uart_driver_install(UART_PORT, 1024, 0, 0, NULL, 0);
-
-    // 2. Leitura DHT (Rápida)
-    // Tenta ler. Se falhar, zera os valores.
-    if (dht_read_float_data(DHT_TYPE_AM2301, DHT_PIN, hum, temp) != ESP_OK) {
-        ESP_LOGW(TAG, "DHT Quick Read failed");
-        *temp = 0.0;
-        *hum = 0.0;
-    }
-
-    // 3. Leitura CO2 (1 amostra apenas)
-    uint8_t read_cmd[9] = { 0xFF, 0x01, 0x86, 0x00, 0x00, 0x00, 0x00, 0x00, 0x79 };
-    uart_write_bytes(UART_PORT, (const char *)read_cmd, sizeof(read_cmd));
-    
-    uint8_t data[9];
-    // Timeout curto (2s)
-    int len = uart_read_bytes(UART_PORT, data, sizeof(data), pdMS_TO_TICKS(2000));
-    
-    bool success = false;
-    if (len == 9) {
-        *co2 = (data[2] << 8) | data[3];
-        success = true;
+static void finish_sampling(cycle_t *cy) {
+    sample_clock_stats_t timing;
+    sample_clock_stats(&cy->clock, &timing);
+    ESP_LOGI(TAG, "Sample clock: %d samples, period %.1f ms (target %d) | lateness mean %.0f us, rms %.0f us, max %lu us | overruns %lu",
+             timing.count, timing.period_ms, INTERVALO_AMOSTRAS_MS, timing.lateness_mean_us, timing.lateness_rms_us,
+             (unsigned long)timing.lateness_max_us, (unsigned long)timing.overruns);
+    for (int c = 0; c < NUM_CANAIS; c++) {
+        ESP_LOGI(TAG, "Sample collection finished (%s). Valid samples: %d/%d (checksum errors: %lu, timeouts: %lu)",
+                 CHANNELS[c].estrato, cy->data.channels[c].validas, cy->data.tomadas,
+                 (unsigned long)channels[c].co2.parser.checksum_errors, (unsigned long)channels[c].co2.timeouts);
+    }
+}
+
+// Entrega as séries ao processamento. Não espera: se o outro núcleo ainda
+// está com ciclos anteriores, este é descartado (e contado) em vez de
+// atrasar o próximo horário.
+static void submit_cycle(cycle_t *cy) {
+    // O turno vem da janela da agenda (schedule.h) que disparou a medição.
+    // Todos os estratos recebem o mesmo horário (dados alinhados).
+    time(&cy->data.timestamp);
+    cy->data.n_channels = NUM_CANAIS;
+    cy->data.trim_fraction = FRACAO_APARADA;
+    cy->data.chamber = cy->cfg.chamber;
+    if (pipeline_submit(&cy->data) != ESP_OK) {
+        ESP_LOGE(TAG, "Measurement cycle not recorded: processing pipeline unavailable or full");
+    }
+}
+
+static void cycle_begin(cycle_t *cy, turno_id_t turno, TaskHandle_t notify, int64_t now_us) {
+    memset(cy, 0, sizeof(*cy));
+    cy->data.turno_id = turno;
+    cy->notify = notify;
+    load_cycle_config(&cy->cfg);
+    hal_gpio_output(FAN_PIN, 0); // Garante que comece desligado
+    if (cy->cfg.purge_s > 0) {
+        // Renova o ar da câmara (o sensor pode estar aquecendo ao mesmo tempo)
+        ESP_LOGI(TAG, "Activating fan for %lu s to purge air...", (unsigned long)cy->cfg.purge_s);
+        hal_gpio_set(FAN_PIN, 1);
+        enter_phase(cy, CYCLE_PURGE, now_us + (int64_t)cy->cfg.purge_s * 1000000);
     } else {
-        ESP_LOGW(TAG, "CO2 Quick Read failed or timed out");
-        *co2 = -1;
+        enter_phase(cy, CYCLE_SETTLE, now_us + (int64_t)cy->cfg.settle_s * 1000000);
     }
+}
 
-    // 4. Limpeza
-    uart_driver_delete(UART_PORT); // Libera recursos
-    
+// Executa o que venceu na fase atual. Retorna o instante (esp_timer) do
+// próximo evento; 0 quando o ciclo terminou.
+static int64_t cycle_step(cycle_t *cy) {
+    int64_t now_us = esp_timer_get_time();
+
+    switch (cy->phase) {
+        case CYCLE_PURGE:
+            if (now_us < cy->phase_end_us) {
+                return cy->phase_end_us;
+            }
+            hal_gpio_set(FAN_PIN, 0);
+            ESP_LOGI(TAG, "Fan deactivated. Air settling for %lu s.", (unsigned long)cy->cfg.settle_s);
+            enter_phase(cy, CYCLE_SETTLE, now_us + (int64_t)cy->cfg.settle_s * 1000000);
+            return now_us;
+
+        case CYCLE_SETTLE:
+        case CYCLE_WARMUP: {
+            if (now_us < cy->phase_end_us) {
+                return cy->phase_end_us;
+            }
+            // Sensor frio (partida em cima do horário): espera o aquecimento
+            sensor_power_on();
+            uint32_t left_s = sensor_power_warmup_left_s();
+            if (left_s > 0) {
+                if (cy->phase == CYCLE_SETTLE) {
+                    ESP_LOGW(TAG, "Waiting %lu s for sensor warm-up", (unsigned long)left_s);
+                }
+                enter_phase(cy, CYCLE_WARMUP, now_us + (int64_t)left_s * 1000000);
+                return cy->phase_end_us;
+            }
+            start_sampling(cy, now_us);
+            return now_us;
+        }
+
+        case CYCLE_SAMPLE:
+            if (now_us >= cy->clock.next_us) {
+                if (take_sample(cy, now_us)) {
+                    finish_sampling(cy);
+                    // DHTs que o intervalo não comportou (ex.: uma única amostra)
+                    while (cy->dht_next < NUM_CANAIS) {
+                        read_dht(cy, cy->dht_next++);
+                    }
+                    submit_cycle(cy);
+                    enter_phase(cy, CYCLE_IDLE, 0);
+                    return 0;
+                }
+                sample_clock_advance(&cy->clock, esp_timer_get_time());
+                publish_status(cy, cy->clock.next_us + (int64_t)(cy->cfg.samples_max - cy->data.tomadas - 1) * cy->clock.period_us);
+            }
+            // Intervalo entre amostras: lê um DHT por vez (~25 ms cada)
+            if (cy->dht_next < NUM_CANAIS) {
+                read_dht(cy, cy->dht_next++);
+                return esp_timer_get_time();
+            }
+            return cy->clock.next_us;
+
+        default:
+            return 0;
+    }
+}
+
+esp_err_t co2_sensor_cycle_start(turno_id_t turno, TaskHandle_t notify) {
+    if (sensor_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    portENTER_CRITICAL(&status_lock);
+    bool busy = cycle_requested || cycle_status.phase != CYCLE_IDLE;
+    if (!busy) {
+        cycle_requested = true;
+        request_turno = turno;
+        request_notify = notify;
+    }
+    portEXIT_CRITICAL(&status_lock);
+    if (busy) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xTaskNotifyGive(sensor_task_handle);
+    return ESP_OK;
+}
+
+void perform_single_measurement(turno_id_t turno_medicao) {
+    if (co2_sensor_cycle_start(turno_medicao, xTaskGetCurrentTaskHandle()) != ESP_OK) {
+        ESP_LOGE(TAG, "Measurement not started: sensor task not running or cycle already in progress.");
+        return;
+    }
+    while (co2_sensor_cycle_busy()) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+// Começa o ciclo pedido por co2_sensor_cycle_start(). O pedido só é
+// retirado depois que a fase foi publicada: co2_sensor_cycle_busy() não
+// vê um instante ocioso no meio.
+static void cycle_accept_request(cycle_t *cy) {
+    portENTER_CRITICAL(&status_lock);
+    turno_id_t turno = request_turno;
+    TaskHandle_t notify = request_notify;
+    portEXIT_CRITICAL(&status_lock);
+
+    ESP_LOGI(TAG, "Performing scheduled measurement on %d channel(s)...", NUM_CANAIS);
+    int64_t cycle_start = metrics_start();
+
+    // Configuração dos Pinos e Periféricos (as UARTs já estão instaladas)
+    sensor_lock();
+    int64_t probe = metrics_start();
+    esp_err_t err = co2_sensor_init();
+    metrics_stop(METRIC_UART_INSTALL, probe);
+    sensor_unlock();
+    if (err == ESP_OK) {
+        TRACE_BEGIN("measurement");
+        cycle_begin(cy, turno, notify, esp_timer_get_time());
+        cy->cycle_start = cycle_start;
+    } else {
+        ESP_LOGE(TAG, "CO2 sensor driver unavailable. Skipping measurement.");
+    }
+
+    portENTER_CRITICAL(&status_lock);
+    cycle_requested = false;
+    portEXIT_CRITICAL(&status_lock);
+    if (err != ESP_OK && notify != NULL) {
+        xTaskNotifyGive(notify);
+    }
+}
+
+// Séries entregues ao pipeline (a fase já voltou a ociosa)
+static void cycle_finish(cycle_t *cy) {
+    metrics_stop(METRIC_CYCLE, cy->cycle_start);
+    TRACE_END("measurement");
+    ESP_LOGI(TAG, "Measurement acquired; processing and storage continue on core 1.");
+    if (cy->notify != NULL) {
+        xTaskNotifyGive(cy->notify);
+    }
+}
+
+bool get_quick_sensor_data(void) {
+    // Sensor desligado ou aquecendo: a leitura não vale, o snapshot fica como está
+    if (!sensor_power_ready()) {
+        ESP_LOGD(TAG, "Sensor not warmed up (%lu s left); skipping quick reading",
+                 (unsigned long)sensor_power_warmup_left_s());
+        return false;
+    }
+    ESP_LOGI(TAG, "Performing QUICK sensor reading for snapshot...");
+
+    // 1. Garante os drivers das UARTs (instalados uma única vez)
+    if (co2_sensor_init() != ESP_OK) {
+        return false;
+    }
+
+    // 2. Leitura CO2 (1 amostra por canal, juntas, timeout curto)
+    int co2[NUM_CANAIS];
+    esp_err_t co2_err[NUM_CANAIS];
+    sample_channels(co2, co2_err, NULL, CO2_QUICK_TIMEOUT_MS);
+
+    bool success = false;
+    for (int c = 0; c < NUM_CANAIS; c++) {
+        // 3. Leitura DHT (Rápida)
+        // Tenta ler. Se falhar, o snapshot mantém a última leitura válida.
+        float temp = 0.0f, hum = 0.0f;
+        bool dht_ok = hal_dht_read(CHANNELS[c].dht_pin, &hum, &temp) == ESP_OK;
+        if (!dht_ok) {
+            ESP_LOGW(TAG, "DHT Quick Read failed (%s)", CHANNELS[c].estrato);
+        }
+        bool co2_ok = co2_err[c] == ESP_OK;
+        if (!co2_ok) {
+            ESP_LOGW(TAG, "CO2 Quick Read failed or timed out (%s)", CHANNELS[c].estrato);
+        }
+
+        // 4. Apenas valores validados vão para o snapshot
+        publish_reading(c, co2_ok, co2[c], dht_ok, temp, hum);
+        success |= co2_ok;
+    }
     return success;
-}
\ No newline at end of file
+}
+
+// Tarefa do sensor: roda o ciclo de medição quando pedido e, fora dele,
+// mantém o snapshot atualizado. Dorme numa notificação até o próximo prazo
+// do ciclo ou da leitura rápida; um pedido novo a acorda na hora. Nunca
+// espera pelo sensor: a leitura rápida seguraria o sensor até
+// CO2_QUICK_TIMEOUT_MS.
+static void sensor_service_task(void *arg) {
+    int64_t next_quick_us = esp_timer_get_time() + (int64_t)SENSOR_SERVICE_PERIOD_MS * 1000;
+    while (1) {
+        int64_t wake_us;
+        if (cycle.phase != CYCLE_IDLE) {
+            wake_us = cycle_step(&cycle);
+            if (wake_us == 0) {
+                cycle_finish(&cycle);
+                // A medição acabou de publicar leituras ao vivo
+                next_quick_us = esp_timer_get_time() + (int64_t)SENSOR_SERVICE_PERIOD_MS * 1000;
+                continue;
+            }
+        } else if (co2_sensor_cycle_busy()) {
+            cycle_accept_request(&cycle);
+            continue;
+        } else if (esp_timer_get_time() >= next_quick_us) {
+            if (xSemaphoreTake(xSensorMutex, 0) == pdTRUE) {
+                TRACE_BEGIN("sensor_mutex");
+                get_quick_sensor_data();
+                TRACE_END("sensor_mutex");
+                xSemaphoreGive(xSensorMutex);
+            } else {
+                TRACE_INSTANT("sensor_mutex_busy");
+            }
+            next_quick_us = esp_timer_get_time() + (int64_t)SENSOR_SERVICE_PERIOD_MS * 1000;
+            continue;
+        } else {
+            wake_us = next_quick_us;
+        }
+
+        int64_t wait_us = wake_us - esp_timer_get_time();
+        if (wait_us > 0) {
+            ulTaskNotifyTake(pdTRUE, (TickType_t)((wait_us * configTICK_RATE_HZ + 999999) / 1000000));
+        }
+    }
+}
+
+void co2_sensor_service_start(void) {
+    if (sensor_task_handle != NULL) {
+        return;
+    }
+    // Prioridade do agendador: é ela que segura o relógio das amostras
+    xTaskCreatePinnedToCore(sensor_service_task, "SensorService", 8192, NULL, 5, &sensor_task_handle, 0);
+    metrics_register_task(sensor_task_handle);
+}
@@ -2,9 +2,67 @@
 #define CO2_SENSOR_TASK_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "record_store.h"
 
+#define CO2_WARMUP_TIME_S 180           // Tempo de aquecimento do sensor em segundos (alterar para pelo menos 3 minutos na prática)
+
+// Instala as UARTs de todos os canais; ESP_OK se ao menos um está pronto.
+esp_err_t co2_sensor_init(void);
 void co2_sensor_power_control(bool enable);
-void perform_single_measurement(void);
-bool get_quick_sensor_data(int *co2, float *temp, float *hum);
+// Pede um ciclo de medição à tarefa do sensor (co2_sensor_service_start)
+// e retorna em seguida. O ciclo mede todos os canais (estratos) na mesma
+// janela e entrega as séries ao pipeline (measurement_pipeline.h), que
+// grava um registro por estrato; xSensorMutex é tomado só durante cada
+// leitura dos sensores. 'notify' (ou NULL) recebe xTaskNotifyGive quando
+// o ciclo termina. ESP_ERR_INVALID_STATE sem a tarefa do sensor ou com
+// outro ciclo pedido ou em andamento.
+esp_err_t co2_sensor_cycle_start(turno_id_t turno, TaskHandle_t notify);
+// true do pedido até a entrega das séries
+bool co2_sensor_cycle_busy(void);
+// Pede o ciclo e dorme até o fim dele (modo de teste e baixo consumo)
+void perform_single_measurement(turno_id_t turno);
+
+// Fases do ciclo de medição, na ordem (o aquecimento só aparece se o
+// sensor ainda estiver frio ao fim do assentamento)
+typedef enum {
+    CYCLE_IDLE = 0,
+    CYCLE_PURGE,             // Fan ligado renovando o ar da câmara
+    CYCLE_SETTLE,            // Fan desligado, ar assentando
+    CYCLE_WARMUP,            // Esperando o aquecimento do sensor
+    CYCLE_SAMPLE,            // Ao fim, as séries seguem para o processamento
+} cycle_phase_t;
+
+typedef struct {
+    cycle_phase_t phase;
+    int64_t phase_end_us;    // Fim previsto (esp_timer); na amostragem, com todas as amostras. 0 = sem prazo
+    int samples_taken;
+    int samples_max;
+} cycle_status_t;
+
+// Fase atual, para o agendador e a página (cópia consistente, sem trava longa)
+void co2_sensor_cycle_status(cycle_status_t *out);
+const char *co2_sensor_phase_name(cycle_phase_t phase);
+
+// Segundos de purga + assentamento: o ciclo começa isso antes do horário
+uint32_t co2_sensor_cycle_lead_s(void);
+// Uma leitura rápida de cada canal para o snapshot; true se algum CO2 foi válido.
+bool get_quick_sensor_data(void);
+// Tarefa do sensor: roda os ciclos pedidos e, entre eles, a leitura rápida
+// do snapshot a cada 30 s (idempotente)
+void co2_sensor_service_start(void);
+
+// xSensorMutex (com métrica e trace da espera): tomado a cada leitura dos
+// sensores e por sensor_power_on/off, para a energia não mudar no meio de
+// uma leitura
+void sensor_lock(void);
+void sensor_unlock(void);
+
+// Canais de medição configurados (um por estrato)
+int co2_sensor_channel_count(void);
+const char *co2_sensor_channel_estrato(int channel);   // NULL fora do intervalo
 
 #endif // CO2_SENSOR_TASK_H
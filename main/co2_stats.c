@@ -0,0 +1,140 @@
+#include "co2_stats.h"
+#include <math.h>
+#include <stdlib.h>
+
+static inline void swap_int(int *a, int *b) {
+    int t = *a;
+    *a = *b;
+    *b = t;
+}
+
+void co2_stats_init(co2_stats_acc_t *acc) {
+    acc->count = 0;
+    acc->min = 0;
+    acc->max = 0;
+    acc->mean = 0.0;
+    acc->m2 = 0.0;
+}
+
+void co2_stats_add(co2_stats_acc_t *acc, int sample) {
+    if (acc->count == 0) {
+        acc->min = sample;
+        acc->max = sample;
+    } else {
+        if (sample < acc->min) acc->min = sample;
+        if (sample > acc->max) acc->max = sample;
+    }
+
+    // Atualização de Welford: estável numericamente e sem guardar histórico
+    acc->count++;
+    double delta = sample - acc->mean;
+    acc->mean += delta / acc->count;
+    acc->m2 += delta * (sample - acc->mean);
+}
+
+bool co2_stats_converged(const co2_stats_acc_t *acc, float half_width_ppm) {
+    if (acc->count < 2) {
+        return false;
+    }
+    // 1,96 · 1,2533 · s / √n ≤ h, comparado ao quadrado para evitar raízes
+    double variance = acc->m2 / (acc->count - 1);
+    double k = 1.96 * 1.2533;
+    return k * k * variance / acc->count <= (double)half_width_ppm * half_width_ppm;
+}
+
+int co2_stats_select(int *a, int n, int k) {
+    int left = 0, right = n - 1;
+
+    while (left < right) {
+        // Pivô pela mediana de três: evita o pior caso com séries já ordenadas
+        int mid = left + (right - left) / 2;
+        if (a[mid] < a[left]) swap_int(&a[mid], &a[left]);
+        if (a[right] < a[left]) swap_int(&a[right], &a[left]);
+        if (a[right] < a[mid]) swap_int(&a[right], &a[mid]);
+        int pivot = a[mid];
+
+        int i = left, j = right;
+        while (i <= j) {
+            while (a[i] < pivot) i++;
+            while (a[j] > pivot) j--;
+            if (i <= j) {
+                swap_int(&a[i], &a[j]);
+                i++;
+                j--;
+            }
+        }
+
+        if (k <= j) {
+            right = j;
+        } else if (k >= i) {
+            left = i;
+        } else {
+            break; // a[k] já é igual ao pivô
+        }
+    }
+    return a[k];
+}
+
+// Maior valor de a[0..k-1] (após seleção de k, é o (k-1)-ésimo menor)
+static int max_below(const int *a, int k) {
+    int m = a[0];
+    for (int i = 1; i < k; i++) {
+        if (a[i] > m) m = a[i];
+    }
+    return m;
+}
+
+static float median_of(int *a, int n) {
+    int upper = co2_stats_select(a, n, n / 2);
+    if (n % 2 == 1) {
+        return (float)upper;
+    }
+    return (upper + max_below(a, n / 2)) / 2.0f;
+}
+
+bool co2_stats_finalize(const co2_stats_acc_t *acc, int *samples, int n, float trim_fraction, co2_stats_t *out) {
+    out->n_valid = n;
+    if (n <= 0) {
+        out->median = -1;
+        out->mad = 0.0f;
+        out->trimmed_mean = 0.0f;
+        out->min = -1;
+        out->max = -1;
+        out->stddev = 0.0f;
+        return false;
+    }
+
+    out->min = acc->min;
+    out->max = acc->max;
+    out->stddev = acc->count > 1 ? (float)sqrt(acc->m2 / (acc->count - 1)) : 0.0f;
+
+    // 1. Mediana
+    float median = median_of(samples, n);
+    out->median = (int)lroundf(median);
+
+    // 2. Média aparada: separa as 'g' menores e as 'g' maiores amostras
+    //    com duas seleções e soma apenas o miolo.
+    int g = (int)(trim_fraction * n);
+    if (2 * g >= n) {
+        g = (n - 1) / 2;
+    }
+    int hi = n - 1 - g;
+    if (g > 0) {
+        co2_stats_select(samples, n, g);
+        co2_stats_select(samples + g, n - g, hi - g);
+    }
+    long sum = 0;
+    for (int i = g; i <= hi; i++) {
+        sum += samples[i];
+    }
+    out->trimmed_mean = (float)sum / (hi - g + 1);
+
+    // 3. MAD: mediana dos desvios absolutos, calculada no mesmo vetor.
+    //    Desvios são arredondados para inteiro (resolução do sensor é 1 ppm).
+    for (int i = 0; i < n; i++) {
+        samples[i] = abs(samples[i] - out->median);
+    }
+    out->mad = median_of(samples, n);
+
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef CO2_STATS_H
+#define CO2_STATS_H
+
+#include <stdbool.h>
+
+// Estatística robusta das amostras de CO2 de um ciclo de medição.
+// Mínimo, máximo, média e desvio padrão são acumulados a cada amostra
+// (Welford); mediana, MAD e média aparada usam seleção O(n) feita no
+// próprio vetor de amostras, sem buffers extras.
+
+typedef struct {
+    int count;
+    int min;
+    int max;
+    double mean;
+    double m2;       // Soma dos quadrados dos desvios (Welford)
+} co2_stats_acc_t;
+
+typedef struct {
+    int n_valid;
+    int median;
+    float mad;           // Desvio absoluto mediano
+    float trimmed_mean;
+    int min;
+    int max;
+    float stddev;        // Desvio padrão amostral
+} co2_stats_t;
+
+void co2_stats_init(co2_stats_acc_t *acc);
+
+// Acumula uma amostra válida (leituras com falha não devem ser passadas).
+void co2_stats_add(co2_stats_acc_t *acc, int sample);
+
+// Critério de parada da amostragem adaptativa: true quando a meia-largura
+// do intervalo de 95% da mediana, estimada pelo erro padrão da média
+// (× 1,2533, eficiência da mediana sob ruído normal), é no máximo
+// 'half_width_ppm'. Precisa de ao menos duas amostras.
+bool co2_stats_converged(const co2_stats_acc_t *acc, float half_width_ppm);
+
+// Calcula o resultado final. 'samples' deve conter apenas as 'n' amostras
+// válidas e é reordenado (e depois sobrescrito pelo cálculo do MAD).
+// 'trim_fraction' é a fração descartada em cada extremidade (ex.: 0.1).
+// Retorna false se não há amostras.
+bool co2_stats_finalize(const co2_stats_acc_t *acc, int *samples, int n, float trim_fraction, co2_stats_t *out);
+
+// Seleção de Hoare: coloca em samples[k] o k-ésimo menor valor, com os
+// menores à esquerda e os maiores à direita. O(n) em média.
+int co2_stats_select(int *samples, int n, int k);
+
+#endif // CO2_STATS_H
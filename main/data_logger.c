@@ -0,0 +1,372 @@
+#include "data_logger.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "metrics.h"
+#include "trace.h"
+
+static const char *TAG = "DATA_LOGGER";
+
+#define DATA_LOGGER_MAGIC   0x4C4F4732  // "LOG2": fila com record_size e state_size
+#define DATA_LOGGER_MAGIC_ANY(m)  (((m) & 0xFFFFFF00) == 0x4C4F4700)
+#define HEADER_BUF_SIZE     256
+
+typedef struct {
+    char filepath[DATA_LOGGER_PATH_MAX];
+    time_t enqueued[DATA_LOGGER_MAX_RECORDS]; // Hora em que cada registro pendente entrou na fila
+    uint16_t len;
+    uint16_t records;             // Registros pendentes
+    uint8_t data[DATA_LOGGER_BUF_SIZE]; // Só registros inteiros: nada da fila está no cartão
+
+} logger_stream_t;
+
+// Quanto de um fluxo gravar
+typedef enum {
+    FLUSH_NONE,
+    FLUSH_SECTORS,                // Registros inteiros até o último setor inteiro do arquivo; o resto fica
+    FLUSH_ALL,
+} flush_mode_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t record_size;         // Formato dos registros de quem gravou a fila
+    uint16_t state_size;          // sizeof(logger_state_t) de quem gravou a fila
+    logger_stream_t streams[DATA_LOGGER_MAX_STREAMS];
+    uint32_t crc;
+} logger_state_t;
+
+// A fila fica na memória RTC lenta (não é zerada em resets nem no deep
+// sleep); o CRC distingue uma fila válida de lixo após ligar a placa.
+#if DATA_LOGGER_USE_RTC_MEM
+static RTC_NOINIT_ATTR logger_state_t state;
+#else
+static logger_state_t state;
+#endif
+
+static SemaphoreHandle_t state_mutex;   // Protege 'state' e 'stats'
+static SemaphoreHandle_t flush_mutex;   // Serializa as gravações no SD
+static TaskHandle_t logger_task_handle = NULL;
+static data_logger_header_fn_t header_fn = NULL;
+static uint16_t record_size;
+static data_logger_stats_t stats;
+
+// Cópia do lote sendo gravado: a fila continua aceitando registros
+// enquanto o SD escreve, e só descarta os bytes após a gravação.
+static uint8_t flush_buf[DATA_LOGGER_BUF_SIZE];
+
+static uint32_t state_crc(void) {
+    return esp_rom_crc32_le(0, (const uint8_t *)&state, offsetof(logger_state_t, crc));
+}
+
+static void state_seal(void) {
+    state.crc = state_crc();
+}
+
+static bool state_is_valid(void) {
+    // Um firmware com outro record_t ou outro layout desta estrutura deixa
+    // uma fila que não pode ser lida (nem gravada) como se fosse desta versão
+    if (state.magic != DATA_LOGGER_MAGIC || state.record_size != record_size ||
+        state.state_size != sizeof(logger_state_t) || state.crc != state_crc()) {
+        return false;
+    }
+    for (int i = 0; i < DATA_LOGGER_MAX_STREAMS; i++) {
+        const logger_stream_t *s = &state.streams[i];
+        if (s->len > DATA_LOGGER_BUF_SIZE || s->records > DATA_LOGGER_MAX_RECORDS ||
+            s->len != s->records * record_size ||
+            memchr(s->filepath, '\0', DATA_LOGGER_PATH_MAX) == NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Grava o conteúdo pendente de um fluxo, todo ou só os registros inteiros
+// até o fim do último setor inteiro do arquivo. Deve ser chamada com flush_mutex.
+static esp_err_t flush_stream(int idx, flush_mode_t mode) {
+    logger_stream_t *s = &state.streams[idx];
+    char path[DATA_LOGGER_PATH_MAX];
+
+    // 1. Copia o lote sob o mutex e libera a fila
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    size_t len = s->len;
+    memcpy(path, s->filepath, sizeof(path));
+    memcpy(flush_buf, s->data, len);
+    xSemaphoreGive(state_mutex);
+
+    if (len == 0) {
+        return ESP_OK;
+    }
+
+    // 2. Uma única abertura por lote. A posição após o fseek diz se o
+    //    arquivo é novo, dispensando o stat() separado.
+    int64_t start_us = esp_timer_get_time();
+    TRACE_BEGIN("sd_flush");
+    FILE *f = fopen(path, "a");
+    if (f == NULL) {
+        TRACE_END("sd_flush");
+        ESP_LOGE(TAG, "Failed to open %s for appending", path);
+        xSemaphoreTake(state_mutex, portMAX_DELAY);
+        stats.flush_errors++;
+        xSemaphoreGive(state_mutex);
+        return ESP_FAIL;
+    }
+
+    bool ok = true;
+    fseek(f, 0, SEEK_END);
+    long pos = ftell(f);
+    if (pos == 0 && header_fn != NULL) {
+        char header[HEADER_BUF_SIZE];
+        size_t header_len = header_fn(path, header, sizeof(header));
+        ok = fwrite(header, 1, header_len, f) == header_len;
+        pos += (long)header_len;
+    }
+    // Lote por tamanho: para no último registro inteiro antes do fim do
+    // último setor inteiro, e o cartão quase nunca reescreve o mesmo setor
+    // parcial. Nunca corta um registro: a fila pode se perder (queda de
+    // energia) e o arquivo ficaria desalinhado dali em diante. Sem um
+    // registro inteiro antes do limite, grava tudo.
+    if (mode == FLUSH_SECTORS && pos >= 0) {
+        size_t end = (size_t)(pos + (long)len) / DATA_LOGGER_SECTOR_SIZE * DATA_LOGGER_SECTOR_SIZE;
+        size_t whole = end > (size_t)pos ? (end - (size_t)pos) / record_size * record_size : 0;
+        if (whole > 0) {
+            len = whole;
+        }
+    }
+    ok = ok && fwrite(flush_buf, 1, len, f) == len;
+    ok = (fclose(f) == 0) && ok;
+    TRACE_END("sd_flush");
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+    metrics_record(METRIC_SD_FLUSH, elapsed_us);
+
+    // 3. Remove da fila apenas o que foi gravado; o resto continua com a
+    //    hora em que entrou nela.
+    uint16_t records = (uint16_t)(len / record_size);
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if (ok) {
+        memmove(s->data, s->data + len, s->len - len);
+        s->len -= len;
+        s->records -= records;
+        memmove(s->enqueued, s->enqueued + records, s->records * sizeof(s->enqueued[0]));
+        state_seal();
+
+        stats.flushes++;
+        stats.records_flushed += records;
+        stats.bytes_flushed += len;
+        stats.last_batch_records = records;
+        stats.last_batch_bytes = len;
+        if (records > stats.max_batch_records) stats.max_batch_records = records;
+        stats.last_flush_us = elapsed_us;
+        if (elapsed_us > stats.max_flush_us) stats.max_flush_us = elapsed_us;
+        stats.total_flush_us += elapsed_us;
+    } else {
+        stats.flush_errors++;
+    }
+    xSemaphoreGive(state_mutex);
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Write error on %s; %u records kept in queue", path, records);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Flushed %u records (%u bytes) to %s in %lu us",
+             records, (unsigned)len, path, (unsigned long)elapsed_us);
+    return ESP_OK;
+}
+
+// O registro mais antigo venceu: grava tudo. Só o tamanho: setores inteiros.
+static flush_mode_t stream_due(const logger_stream_t *s, time_t now) {
+    if (s->len == 0) {
+        return FLUSH_NONE;
+    }
+    if (now - s->enqueued[0] >= DATA_LOGGER_MAX_AGE_S) {
+        return FLUSH_ALL;
+    }
+    return s->len >= DATA_LOGGER_FLUSH_BYTES ? FLUSH_SECTORS : FLUSH_NONE;
+}
+
+// Ticks até o próximo lote vencer por idade (portMAX_DELAY se a fila está vazia)
+static TickType_t ticks_to_next_deadline(void) {
+    time_t now = time(NULL);
+    long min_wait = -1;
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    for (int i = 0; i < DATA_LOGGER_MAX_STREAMS; i++) {
+        const logger_stream_t *s = &state.streams[i];
+        if (s->len == 0) continue;
+        long wait = (long)(s->enqueued[0] + DATA_LOGGER_MAX_AGE_S - now);
+        if (wait < 0) wait = 0;
+        if (min_wait < 0 || wait < min_wait) min_wait = wait;
+    }
+    xSemaphoreGive(state_mutex);
+
+    return (min_wait < 0) ? portMAX_DELAY : pdMS_TO_TICKS(min_wait * 1000);
+}
+
+static void data_logger_task(void *arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, ticks_to_next_deadline());
+
+        time_t now = time(NULL);
+        xSemaphoreTake(flush_mutex, portMAX_DELAY);
+        for (int i = 0; i < DATA_LOGGER_MAX_STREAMS; i++) {
+            xSemaphoreTake(state_mutex, portMAX_DELAY);
+            flush_mode_t mode = stream_due(&state.streams[i], now);
+            xSemaphoreGive(state_mutex);
+            if (mode != FLUSH_NONE) {
+                flush_stream(i, mode);
+            }
+        }
+        xSemaphoreGive(flush_mutex);
+    }
+}
+
+esp_err_t data_logger_init(data_logger_header_fn_t header_writer, uint16_t size,
+                           data_logger_record_fn_t recovered_fn) {
+    if (logger_task_handle != NULL) {
+        return ESP_OK;
+    }
+
+    header_fn = header_writer;
+    record_size = size;
+    state_mutex = xSemaphoreCreateMutex();
+    flush_mutex = xSemaphoreCreateMutex();
+    if (state_mutex == NULL || flush_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create logger mutexes");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Registros que sobreviveram a um reset/deep sleep voltam para a fila
+    uint32_t pending = 0;
+    if (state_is_valid()) {
+        for (int i = 0; i < DATA_LOGGER_MAX_STREAMS; i++) {
+            const logger_stream_t *s = &state.streams[i];
+            pending += s->records;
+            // Quem indexa os arquivos não viu esses registros neste boot
+            for (int r = 0; recovered_fn != NULL && r < s->records; r++) {
+                recovered_fn(s->filepath, s->data + r * record_size, record_size);
+            }
+        }
+        stats.records_recovered = pending;
+        ESP_LOGI(TAG, "Recovered %lu pending records from RTC memory", (unsigned long)pending);
+    } else {
+        if (DATA_LOGGER_MAGIC_ANY(state.magic)) {
+            ESP_LOGW(TAG, "Discarding RTC queue left by another firmware format");
+        }
+        memset(&state, 0, sizeof(state));
+        state.magic = DATA_LOGGER_MAGIC;
+        state.record_size = record_size;
+        state.state_size = sizeof(logger_state_t);
+        state_seal();
+    }
+
+    if (xTaskCreatePinnedToCore(data_logger_task, "LoggerTask", 4096, NULL, 4, &logger_task_handle, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create logger task");
+        return ESP_ERR_NO_MEM;
+    }
+    metrics_register_task(logger_task_handle);
+
+    // A tarefa decide se os recuperados já vencem (tamanho/idade): após um
+    // deep sleep a fila pode continuar acumulando sem gravar a cada despertar.
+    if (pending > 0) {
+        xTaskNotifyGive(logger_task_handle);
+    }
+    return ESP_OK;
+}
+
+esp_err_t data_logger_append(int stream, const char *filepath, const void *data, size_t len) {
+    if (stream < 0 || stream >= DATA_LOGGER_MAX_STREAMS || len != record_size ||
+        strlen(filepath) >= DATA_LOGGER_PATH_MAX || logger_task_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    logger_stream_t *s = &state.streams[stream];
+
+    // 1. Virada do dia (arquivo diferente): grava o lote atual inteiro antes,
+    //    no contexto de quem chamou. Fila cheia: só os setores inteiros.
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    bool path_changed = s->len > 0 && strcmp(s->filepath, filepath) != 0;
+    bool full = s->len + len > DATA_LOGGER_BUF_SIZE || s->records >= DATA_LOGGER_MAX_RECORDS;
+    xSemaphoreGive(state_mutex);
+
+    if (path_changed || full) {
+        xSemaphoreTake(flush_mutex, portMAX_DELAY);
+        flush_stream(stream, path_changed ? FLUSH_ALL : FLUSH_SECTORS);
+        xSemaphoreGive(flush_mutex);
+    }
+
+    // 2. Enfileira o registro
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if ((s->len > 0 && strcmp(s->filepath, filepath) != 0) || s->len + len > DATA_LOGGER_BUF_SIZE ||
+        s->records >= DATA_LOGGER_MAX_RECORDS) {
+        xSemaphoreGive(state_mutex);
+        ESP_LOGE(TAG, "Queue for stream %d is blocked (SD unavailable?). Record dropped.", stream);
+        return ESP_ERR_NO_MEM;
+    }
+    if (s->len == 0) {
+        strcpy(s->filepath, filepath);
+    }
+    s->enqueued[s->records] = time(NULL);
+    memcpy(s->data + s->len, data, len);
+    s->len += len;
+    s->records++;
+    state_seal();
+    xSemaphoreGive(state_mutex);
+
+    // 3. Acorda a tarefa para reavaliar o tamanho do lote e o prazo
+    xTaskNotifyGive(logger_task_handle);
+    return ESP_OK;
+}
+
+esp_err_t data_logger_flush(void) {
+    if (logger_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t result = ESP_OK;
+    xSemaphoreTake(flush_mutex, portMAX_DELAY);
+    for (int i = 0; i < DATA_LOGGER_MAX_STREAMS; i++) {
+        if (flush_stream(i, FLUSH_ALL) != ESP_OK) {
+            result = ESP_FAIL;
+        }
+    }
+    xSemaphoreGive(flush_mutex);
+    return result;
+}
+
+esp_err_t data_logger_prepare_sleep(uint32_t sleep_s) {
+    if (logger_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Grava o que passaria de DATA_LOGGER_MAX_AGE_S durante o sono (e os
+    // setores inteiros de um lote grande) e não devolve o flush_mutex:
+    // nenhuma gravação começa depois daqui.
+    time_t wake = time(NULL) + sleep_s;
+    esp_err_t result = ESP_OK;
+    xSemaphoreTake(flush_mutex, portMAX_DELAY);
+    for (int i = 0; i < DATA_LOGGER_MAX_STREAMS; i++) {
+        xSemaphoreTake(state_mutex, portMAX_DELAY);
+        flush_mode_t mode = stream_due(&state.streams[i], wake);
+        xSemaphoreGive(state_mutex);
+        if (mode != FLUSH_NONE && flush_stream(i, mode) != ESP_OK) {
+            result = ESP_FAIL;
+        }
+    }
+    return result;
+}
+
+void data_logger_get_stats(data_logger_stats_t *out) {
+    if (state_mutex == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(state_mutex);
+}
@@ -0,0 +1,76 @@
+#ifndef DATA_LOGGER_H
+#define DATA_LOGGER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Logger com escrita atrasada (write-behind) para o cartão SD.
+// Os registros ficam numa fila em RAM (espelhada na memória RTC lenta, que
+// sobrevive a resets e ao deep sleep) e são gravados em lote, com um único
+// fopen/fwrite/fclose, quando:
+//   - o lote atinge DATA_LOGGER_FLUSH_BYTES: grava os registros inteiros
+//     até o fim do último setor de 512 B inteiro do arquivo e o resto fica
+//     na fila (um registro nunca fica metade no cartão, metade na fila);
+//   - o registro mais antigo atinge DATA_LOGGER_MAX_AGE_S;
+//   - o arquivo de destino muda (virada do dia);
+//   - data_logger_flush() é chamado.
+// Nos três últimos casos a fila inteira é gravada.
+
+#define DATA_LOGGER_MAX_STREAMS     3        // Um fluxo por estrato
+#define DATA_LOGGER_SECTOR_SIZE     512
+#define DATA_LOGGER_BUF_SIZE        (2 * DATA_LOGGER_SECTOR_SIZE)
+#define DATA_LOGGER_FLUSH_BYTES     DATA_LOGGER_SECTOR_SIZE
+#define DATA_LOGGER_PATH_MAX        64
+#define DATA_LOGGER_MAX_RECORDS     (DATA_LOGGER_BUF_SIZE / 32)  // Registros de ao menos 32 B enchem o buffer antes
+
+// Limite de exposição a perda de dados: nenhum registro fica mais que
+// isso apenas em memória. Com DATA_LOGGER_USE_RTC_MEM, resets e deep sleep
+// não perdem a fila; apenas uma queda total de energia perde até esse tempo.
+#define DATA_LOGGER_MAX_AGE_S       3600
+#define DATA_LOGGER_USE_RTC_MEM     1
+
+typedef struct {
+    uint32_t flushes;
+    uint32_t flush_errors;
+    uint32_t records_flushed;
+    uint32_t bytes_flushed;
+    uint32_t records_recovered;    // Recuperados da memória RTC no boot
+    uint32_t last_batch_records;
+    uint32_t max_batch_records;
+    uint32_t last_batch_bytes;
+    uint32_t last_flush_us;
+    uint32_t max_flush_us;
+    uint64_t total_flush_us;
+} data_logger_stats_t;
+
+// Escreve o cabeçalho de um arquivo novo em 'buf'; retorna o tamanho.
+typedef size_t (*data_logger_header_fn_t)(const char *filepath, char *buf, size_t len);
+
+// Um registro pendente para 'filepath'.
+typedef void (*data_logger_record_fn_t)(const char *filepath, const void *data, size_t len);
+
+// Recupera registros pendentes da memória RTC e inicia a tarefa de gravação.
+// 'record_size' identifica o formato dos registros: uma fila deixada por um
+// firmware com registros de outro tamanho é descartada, não gravada num
+// arquivo do formato novo. Todo registro enfileirado tem esse tamanho.
+// 'recovered_fn' (ou NULL) é chamada, antes de a tarefa começar, para cada
+// registro recuperado: eles ainda não estão no cartão e quem os enfileirou
+// antes do reset já não está aqui para contabilizá-los.
+esp_err_t data_logger_init(data_logger_header_fn_t header_fn, uint16_t record_size,
+                           data_logger_record_fn_t recovered_fn);
+
+// Enfileira um registro (de 'record_size' bytes) para 'filepath' no fluxo 'stream'.
+esp_err_t data_logger_append(int stream, const char *filepath, const void *data, size_t len);
+
+// Grava imediatamente tudo que está pendente (ex.: antes de um download).
+esp_err_t data_logger_flush(void);
+
+// Antes do deep sleep: grava os lotes que venceriam durante 'sleep_s' e
+// bloqueia novas gravações. O restante da fila atravessa o sono na memória RTC.
+esp_err_t data_logger_prepare_sleep(uint32_t sleep_s);
+
+void data_logger_get_stats(data_logger_stats_t *out);
+
+#endif // DATA_LOGGER_H
@@ -0,0 +1,248 @@
+#include "file_catalog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/dirent.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "metrics.h"
+#include "trace.h"
+
+static const char *TAG = "FILE_CATALOG";
+
+static SemaphoreHandle_t catalog_mutex;
+static file_catalog_entry_t *entries;
+static size_t count;
+static size_t capacity;
+
+// Busca binária pelo nome; retorna a posição de inserção se não encontrar
+static size_t find_pos(const char *name, bool *found) {
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int cmp = strcmp(entries[mid].name, name);
+        if (cmp == 0) {
+            *found = true;
+            return mid;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *found = false;
+    return lo;
+}
+
+// Insere uma entrada vazia em ordem. Deve ser chamada com catalog_mutex.
+static file_catalog_entry_t *insert_entry(const char *name) {
+    if (strlen(name) >= FILE_CATALOG_NAME_MAX) {
+        ESP_LOGW(TAG, "Name too long, not indexed: %s", name);
+        return NULL;
+    }
+    bool found;
+    size_t pos = find_pos(name, &found);
+    if (found) {
+        return &entries[pos];
+    }
+
+    if (count == capacity) {
+        size_t cap = capacity ? capacity * 2 : 32;
+        file_catalog_entry_t *grown = realloc(entries, cap * sizeof(file_catalog_entry_t));
+        if (grown == NULL) {
+            ESP_LOGE(TAG, "Out of memory indexing %s", name);
+            return NULL;
+        }
+        entries = grown;
+        capacity = cap;
+    }
+    memmove(&entries[pos + 1], &entries[pos], (count - pos) * sizeof(file_catalog_entry_t));
+    count++;
+
+    file_catalog_entry_t *e = &entries[pos];
+    memset(e, 0, sizeof(*e));
+    strcpy(e->name, name);
+    e->binary = record_store_is_binary(name);
+    return e;
+}
+
+static void account_record(file_catalog_entry_t *e, const record_t *rec) {
+    e->records++;
+    if (e->first_ts == 0 || rec->timestamp < e->first_ts) e->first_ts = rec->timestamp;
+    if (rec->timestamp > e->last_ts) e->last_ts = rec->timestamp;
+
+    if (rec->co2_ppm >= 0) {
+        if (e->co2_count == 0 || rec->co2_ppm < e->co2_min) e->co2_min = rec->co2_ppm;
+        if (e->co2_count == 0 || rec->co2_ppm > e->co2_max) e->co2_max = rec->co2_ppm;
+        e->co2_sum += rec->co2_ppm;
+        e->co2_count++;
+    }
+}
+
+// Resumo de um arquivo existente (feito fora do mutex)
+static void scan_file(const char *path, file_catalog_entry_t *e) {
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        e->size = st.st_size;
+    }
+
+    if (e->binary) {
+        record_reader_t rd;
+        if (!record_reader_open(&rd, path)) {
+            ESP_LOGW(TAG, "Unreadable data file: %s", path);
+            return;
+        }
+        // Um registro cortado no fim (lote de setores inteiros) ainda está
+        // na fila do data_logger e entra no índice por ela
+        e->size = rd.header.header_size + rd.count * rd.header.record_size;
+        record_t rec;
+        int r;
+        while ((r = record_reader_next(&rd, &rec)) != 0) {
+            if (r > 0) {
+                account_record(e, &rec);
+            }
+        }
+        record_reader_close(&rd);
+        return;
+    }
+
+    // CSV antigo: registros = linhas menos o cabeçalho
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return;
+    }
+    char buf[256];
+    size_t n, lines = 0;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') lines++;
+        }
+    }
+    fclose(f);
+    e->records = lines > 0 ? lines - 1 : 0;
+}
+
+esp_err_t file_catalog_build(const char *dir_path) {
+    if (catalog_mutex == NULL) {
+        catalog_mutex = xSemaphoreCreateMutex();
+        if (catalog_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s", dir_path);
+        return ESP_FAIL;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    TRACE_BEGIN("sd_scan");
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_type != DT_REG) {
+            continue;
+        }
+        char path[128];
+        snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+
+        file_catalog_entry_t scanned;
+        memset(&scanned, 0, sizeof(scanned));
+        scanned.binary = record_store_is_binary(entry->d_name);
+        scan_file(path, &scanned);
+
+        xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+        file_catalog_entry_t *e = insert_entry(entry->d_name);
+        if (e != NULL) {
+            memcpy(scanned.name, e->name, sizeof(scanned.name));
+            *e = scanned;
+        }
+        xSemaphoreGive(catalog_mutex);
+    }
+    closedir(dir);
+    TRACE_END("sd_scan");
+    metrics_stop(METRIC_SD_SCAN, start_us);
+
+    ESP_LOGI(TAG, "Indexed %u files in %lld ms", (unsigned)count,
+             (long long)((esp_timer_get_time() - start_us) / 1000));
+    return ESP_OK;
+}
+
+void file_catalog_add_record(const char *filename, const record_t *rec) {
+    if (catalog_mutex == NULL) {
+        return; // SD não montado
+    }
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    file_catalog_entry_t *e = insert_entry(filename);
+    if (e != NULL) {
+        if (e->size == 0) {
+            e->size = sizeof(record_file_header_t);
+        }
+        e->size += sizeof(record_t);
+        account_record(e, rec);
+    }
+    xSemaphoreGive(catalog_mutex);
+}
+
+bool file_catalog_remove(const char *filename) {
+    if (catalog_mutex == NULL) {
+        return false;
+    }
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    bool found;
+    size_t pos = find_pos(filename, &found);
+    if (found) {
+        memmove(&entries[pos], &entries[pos + 1], (count - pos - 1) * sizeof(file_catalog_entry_t));
+        count--;
+    }
+    xSemaphoreGive(catalog_mutex);
+    return found;
+}
+
+bool file_catalog_rename(const char *from, const char *to) {
+    if (catalog_mutex == NULL) {
+        return false;
+    }
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    bool found;
+    size_t pos = find_pos(from, &found);
+    if (found) {
+        file_catalog_entry_t moved = entries[pos];
+        memmove(&entries[pos], &entries[pos + 1], (count - pos - 1) * sizeof(file_catalog_entry_t));
+        count--;
+        file_catalog_entry_t *e = insert_entry(to);
+        if (e != NULL) {
+            memcpy(moved.name, e->name, sizeof(moved.name));
+            *e = moved;
+        }
+    }
+    xSemaphoreGive(catalog_mutex);
+    return found;
+}
+
+size_t file_catalog_count(void) {
+    if (catalog_mutex == NULL) {
+        return 0;
+    }
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    size_t n = count;
+    xSemaphoreGive(catalog_mutex);
+    return n;
+}
+
+bool file_catalog_get(size_t index, file_catalog_entry_t *out) {
+    if (catalog_mutex == NULL) {
+        return false;
+    }
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    bool ok = index < count;
+    if (ok) {
+        *out = entries[index];
+    }
+    xSemaphoreGive(catalog_mutex);
+    return ok;
+}
@@ -0,0 +1,56 @@
+#ifndef FILE_CATALOG_H
+#define FILE_CATALOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "record_store.h"
+
+// Índice em RAM dos arquivos de dados do SD, com um resumo de cada um.
+// É montado uma única vez após montar o cartão e depois mantido a cada
+// registro enfileirado (write_data_record) e a cada exclusão, de modo que a
+// página e o /files.json não precisam varrer o diretório FAT.
+//
+// O tamanho inclui os registros ainda na fila do data_logger, também os
+// recuperados da memória RTC no boot (catalog_queued_record em sd_card.h):
+// é o tamanho que o arquivo terá após o próximo flush.
+
+#define FILE_CATALOG_NAME_MAX   40
+
+typedef struct {
+    char name[FILE_CATALOG_NAME_MAX];
+    bool binary;             // .dat (resumo completo) ou CSV antigo (só tamanho/linhas)
+    uint32_t size;
+    uint32_t records;
+    uint32_t first_ts;       // Epoch do primeiro/último registro (0 = desconhecido)
+    uint32_t last_ts;
+    // Resumo da mediana de CO2 de cada registro com leitura válida
+    uint32_t co2_count;
+    int16_t co2_min;
+    int16_t co2_max;
+    int64_t co2_sum;
+} file_catalog_entry_t;
+
+// Varre 'dir' (uma vez) e monta o índice. Arquivos .dat são lidos por
+// inteiro para o resumo; CSVs antigos têm apenas as linhas contadas.
+esp_err_t file_catalog_build(const char *dir);
+
+// Contabiliza um registro enfileirado para 'filename' (nome sem diretório).
+void file_catalog_add_record(const char *filename, const record_t *rec);
+
+bool file_catalog_remove(const char *filename);
+
+// Mantém o resumo de um arquivo renomeado no SD sob o novo nome.
+bool file_catalog_rename(const char *from, const char *to);
+
+// Acesso por índice, em ordem de nome (ou seja, de data). Cada chamada
+// copia uma entrada sob o mutex; o índice pode mudar entre chamadas.
+size_t file_catalog_count(void);
+bool file_catalog_get(size_t index, file_catalog_entry_t *out);
+
+static inline float file_catalog_co2_mean(const file_catalog_entry_t *e) {
+    return e->co2_count > 0 ? (float)e->co2_sum / e->co2_count : -1.0f;
+}
+
+#endif // FILE_CATALOG_H
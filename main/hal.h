@@ -0,0 +1,71 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// Camada fina entre o firmware e os periféricos da placa: UART do MH-Z14A,
+// DHT22, barramento de 3 fios do DS1302, GPIOs de saída e o cartão SD.
+// Na placa a implementação é hal_esp32.c (drivers do ESP-IDF); no PC é o
+// simulador de sim/ (build com HAL_SIM), que liga as mesmas chamadas a
+// modelos dos dispositivos. O resto do ESP-IDF usado pelo firmware
+// (FreeRTOS, NVS, esp_timer, esp_http_server) é emulado pelo próprio sim/.
+
+// --- Cartão SD ---
+#ifdef HAL_SIM
+#define HAL_SD_MOUNT_POINT  "sdcard"     // Diretório dentro do estado do simulador
+#else
+#define HAL_SD_MOUNT_POINT  "/sdcard"
+#endif
+
+// SPI + FATFS montados em HAL_SD_MOUNT_POINT.
+esp_err_t hal_sd_mount(void);
+
+// --- GPIO de saída (energia do sensor, fan) ---
+void hal_gpio_output(int pin, int level);   // Configura como saída já no nível dado
+void hal_gpio_set(int pin, int level);
+
+// --- UART (MH-Z14A, 9600 8N1) ---
+esp_err_t hal_uart_open(int port, int tx_pin, int rx_pin, size_t rx_buf_size);
+void hal_uart_close(int port);
+// Troca os pinos de uma UART já aberta (sensores multiplexados numa UART)
+esp_err_t hal_uart_set_pins(int port, int tx_pin, int rx_pin);
+int hal_uart_write(int port, const uint8_t *data, size_t len);
+// Até 'len' bytes, esperando no máximo 'wait' ticks. Retorna os bytes lidos ou -1.
+int hal_uart_read(int port, uint8_t *buf, size_t len, TickType_t wait);
+void hal_uart_flush_input(int port);
+
+// --- DHT22 (AM2301) ---
+esp_err_t hal_dht_read(int pin, float *humidity, float *temperature);
+
+// --- Barramento bit-bang (DS1302) ---
+// CLK e CE como saídas; IO com a entrada sempre habilitada, o transporte
+// só liga e desliga a saída.
+void hal_bitbang_init(int clk_pin, int ce_pin, int io_pin);
+
+#ifdef HAL_SIM
+void hal_delay_us(uint32_t us);
+void hal_pin_high(int pin);
+void hal_pin_low(int pin);
+void hal_pin_output_enable(int pin);
+void hal_pin_output_disable(int pin);
+uint32_t hal_pin_read(int pin);
+#else
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
+#include "esp_rom_sys.h"
+static inline void hal_delay_us(uint32_t us) { esp_rom_delay_us(us); }
+// Escrita direta nos registradores W1TS/W1TC (um store por borda) em vez
+// de gpio_set_level()/gpio_set_direction(), que validam argumentos e
+// passam pela HAL do IDF a cada bit. Válido para pinos < 32.
+static inline void hal_pin_high(int pin) { REG_WRITE(GPIO_OUT_W1TS_REG, BIT(pin)); }
+static inline void hal_pin_low(int pin)  { REG_WRITE(GPIO_OUT_W1TC_REG, BIT(pin)); }
+static inline void hal_pin_output_enable(int pin)  { REG_WRITE(GPIO_ENABLE_W1TS_REG, BIT(pin)); }
+static inline void hal_pin_output_disable(int pin) { REG_WRITE(GPIO_ENABLE_W1TC_REG, BIT(pin)); }
+static inline uint32_t hal_pin_read(int pin) { return (REG_READ(GPIO_IN_REG) >> pin) & 1; }
+#endif
+
+#endif // HAL_H
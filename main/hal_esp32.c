@@ -0,0 +1,130 @@
+#include "hal.h"
+#include "driver/gpio.h"
+#include "driver/uart.h"
+#include "driver/sdspi_host.h"
+#include "driver/spi_common.h"
+#include "sdmmc_cmd.h"
+#include "esp_vfs_fat.h"
+#include "esp_log.h"
+#include "dht.h"
+
+static const char *TAG = "HAL";
+
+// Pinos do cartão SD (SPI)
+#define PIN_NUM_MISO    GPIO_NUM_19
+#define PIN_NUM_MOSI    GPIO_NUM_21
+#define PIN_NUM_CLK     GPIO_NUM_18
+#define PIN_NUM_CS      GPIO_NUM_5
+
+static sdmmc_card_t *card;
+
+esp_err_t hal_sd_mount(void) {
+    esp_err_t ret;
+
+    // Configuração do host SPI
+    sdmmc_host_t host = SDSPI_HOST_DEFAULT();
+    //host.slot = SPI2_HOST; // ou SPI3_HOST dependendo do seu hardware
+
+    // Configuração do barramento SPI
+    spi_bus_config_t bus_cfg = {
+        .mosi_io_num = PIN_NUM_MOSI,
+        .miso_io_num = PIN_NUM_MISO,
+        .sclk_io_num = PIN_NUM_CLK,
+        .quadwp_io_num = -1, // Não utilizado
+        .quadhd_io_num = -1, // Não utilizado
+        .max_transfer_sz = 4000,
+    };
+
+    ret = spi_bus_initialize(host.slot, &bus_cfg, SDSPI_DEFAULT_DMA);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize SPI bus: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Configuração do dispositivo SD SPI
+    sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
+    slot_config.gpio_cs = PIN_NUM_CS;
+    slot_config.host_id = host.slot;
+
+    // Opções do sistema de arquivos FAT
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+        .format_if_mount_failed = false,
+        .max_files = 5,
+        .allocation_unit_size = 16 * 1024
+    };
+
+    // Monta o sistema de arquivos FAT no cartão SD
+    ret = esp_vfs_fat_sdspi_mount(HAL_SD_MOUNT_POINT, &host, &slot_config, &mount_config, &card);
+    if (ret != ESP_OK) {
+        spi_bus_free(host.slot);
+        return ret;
+    }
+    sdmmc_card_print_info(stdout, card);
+    return ESP_OK;
+}
+
+void hal_gpio_output(int pin, int level) {
+    gpio_reset_pin(pin);
+    gpio_set_direction(pin, GPIO_MODE_OUTPUT);
+    gpio_set_level(pin, level);
+}
+
+void hal_gpio_set(int pin, int level) {
+    gpio_set_level(pin, level);
+}
+
+esp_err_t hal_uart_open(int port, int tx_pin, int rx_pin, size_t rx_buf_size) {
+    uart_config_t uart_config = {
+        .baud_rate = 9600,
+        .data_bits = UART_DATA_8_BITS,
+        .parity    = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE
+    };
+
+    esp_err_t err = uart_param_config(port, &uart_config);
+    if (err == ESP_OK) {
+        err = uart_set_pin(port, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    }
+    if (err == ESP_OK) {
+        err = uart_driver_install(port, rx_buf_size, 0, 0, NULL, 0);
+    }
+    return err;
+}
+
+void hal_uart_close(int port) {
+    uart_driver_delete(port);
+}
+
+esp_err_t hal_uart_set_pins(int port, int tx_pin, int rx_pin) {
+    return uart_set_pin(port, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+}
+
+int hal_uart_write(int port, const uint8_t *data, size_t len) {
+    return uart_write_bytes(port, (const char *)data, len);
+}
+
+int hal_uart_read(int port, uint8_t *buf, size_t len, TickType_t wait) {
+    return uart_read_bytes(port, buf, len, wait);
+}
+
+void hal_uart_flush_input(int port) {
+    uart_flush_input(port);
+}
+
+esp_err_t hal_dht_read(int pin, float *humidity, float *temperature) {
+    return dht_read_float_data(DHT_TYPE_AM2301, pin, humidity, temperature);
+}
+
+void hal_bitbang_init(int clk_pin, int ce_pin, int io_pin) {
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << clk_pin) | (1ULL << ce_pin),
+        .mode = GPIO_MODE_OUTPUT,
+    };
+    gpio_config(&io_conf);
+    io_conf.pin_bit_mask = 1ULL << io_pin;
+    io_conf.mode = GPIO_MODE_INPUT_OUTPUT;
+    gpio_config(&io_conf);
+    gpio_set_level(clk_pin, 0);
+    gpio_set_level(ce_pin, 0);
+}
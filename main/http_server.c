@@ -1,88 +1,441 @@
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <sys/dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "http_server.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_vfs.h"
 #include "sd_card.h"
+#include "data_logger.h"
+#include "record_store.h"
+#include "zip_stream.h"
 #include "rtc.h"
-#include "freertos/semphr.h" 
-#include "co2_sensor_task.h"  
+#include "hal.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sensor_snapshot.h"
+#include "co2_sensor_task.h"
+#include "bulk_sender.h"
+#include "file_catalog.h"
+#include "wifi_ap.h"
+#include "timekeeping.h"
+#include "metrics.h"
+#include "trace.h"
+#include "lwip/sockets.h"
 
 static const char *TAG = "HTTP_SERVER";
-extern SemaphoreHandle_t xSensorMutex; // Pega o Mutex criado no main.c
 
-#define MOUNT_POINT "/sdcard"
+#define MOUNT_POINT HAL_SD_MOUNT_POINT
 #define FILE_PATH_MAX (ESP_VFS_PATH_MAX + CONFIG_HTTPD_MAX_URI_LEN)
 #define MAX_FILENAME_LEN 128
 
-// --- MANIPULADOR DE DOWNLOAD DE ARQUIVOS (CORRIGIDO) ---
+#define DOWNLOAD_CHUNK_SIZE 1024
+#define METRICS_CHUNK_SIZE 1024
+#define TRACE_CHUNK_SIZE   1024
+
+// --- FONTE DE DADOS DO DOWNLOAD ---
+// Arquivos binários (.dat) são convertidos para CSV durante o envio;
+// CSVs antigos continuam sendo enviados como estão.
+typedef struct {
+    bool render_csv;
+    FILE *file;
+    record_reader_t reader;
+} download_src_t;
+
+static bool download_src_open(download_src_t *src, const char *filepath) {
+    src->render_csv = record_store_is_binary(filepath);
+    if (src->render_csv) {
+        src->file = record_reader_open(&src->reader, filepath) ? src->reader.file : NULL;
+    } else {
+        src->file = fopen(filepath, "r");
+        // O envio lê blocos de BULK_BLOCK_SIZE direto no buffer DMA;
+        // o buffer do stdio só acrescentaria uma cópia.
+        if (src->file) {
+            setvbuf(src->file, NULL, _IONBF, 0);
+        }
+    }
+    return src->file != NULL;
+}
+
+static size_t download_src_read(download_src_t *src, char *buf, size_t len) {
+    return src->render_csv ? record_csv_render(&src->reader, buf, len)
+                           : fread(buf, 1, len, src->file);
+}
+
+// Adaptador para bulk_send_stream
+static size_t download_src_bulk_read(void *ctx, char *buf, size_t len) {
+    return download_src_read((download_src_t *)ctx, buf, len);
+}
+
+static void download_src_close(download_src_t *src) {
+    if (src->file) {
+        fclose(src->file);
+        src->file = NULL;
+    }
+}
+
+// Tamanho do conteúdo entregue. Para o CSV gerado, faz uma passada de
+// renderização sem enviar nada (os arquivos diários têm poucos registros).
+static long download_src_size(download_src_t *src, long file_size, char *scratch, size_t len) {
+    if (!src->render_csv) {
+        return file_size;
+    }
+    long total = 0;
+    size_t n;
+    while ((n = download_src_read(src, scratch, len)) > 0) {
+        total += n;
+    }
+    record_csv_rewind(&src->reader);
+    return total;
+}
+
+// Posiciona a fonte no byte 'offset' do conteúdo entregue
+static bool download_src_skip(download_src_t *src, long offset, char *scratch, size_t len) {
+    if (!src->render_csv) {
+        return fseek(src->file, offset, SEEK_SET) == 0;
+    }
+    while (offset > 0) {
+        size_t n = download_src_read(src, scratch, offset < (long)len ? (size_t)offset : len);
+        if (n == 0) return false;
+        offset -= n;
+    }
+    return true;
+}
+
+// Nome entregue ao cliente: arquivos convertidos ganham a extensão .csv
+static void download_name(const char *filename, bool render_csv, char *out, size_t len) {
+    snprintf(out, len, "%s", filename);
+    if (render_csv) {
+        char *ext = strrchr(out, '.');
+        if (ext != NULL && (size_t)(ext - out) + sizeof(".csv") <= len) {
+            strcpy(ext, ".csv");
+        }
+    }
+}
+
+// Interpreta "bytes=a-b", "bytes=a-" e "bytes=-n" (apenas um intervalo).
+// Retorna 1 se válido, 0 se ausente/ignorado e -1 se não satisfazível.
+static int parse_range(const char *value, long total, long *start, long *end) {
+    if (strncmp(value, "bytes=", 6) != 0 || strchr(value, ',') != NULL) {
+        return 0;
+    }
+    const char *spec = value + 6;
+    char *dash = strchr(spec, '-');
+    if (dash == NULL) {
+        return 0;
+    }
+
+    char *endp;
+    if (dash == spec) {
+        long suffix = strtol(dash + 1, &endp, 10);
+        if (endp == dash + 1 || suffix <= 0) return -1;
+        *start = suffix >= total ? 0 : total - suffix;
+        *end = total - 1;
+    } else {
+        *start = strtol(spec, &endp, 10);
+        if (endp != dash || *start < 0) return 0;
+        if (dash[1] == '\0') {
+            *end = total - 1;
+        } else {
+            *end = strtol(dash + 1, &endp, 10);
+            if (*endp != '\0' || *end < *start) return 0;
+            if (*end >= total) *end = total - 1;
+        }
+    }
+    return (*start < total) ? 1 : -1;
+}
+
+static bool header_value(httpd_req_t *req, const char *field, char *buf, size_t len) {
+    size_t n = httpd_req_get_hdr_value_len(req, field);
+    return n > 0 && n < len && httpd_req_get_hdr_value_str(req, field, buf, len) == ESP_OK;
+}
+
+// --- MANIPULADOR DE DOWNLOAD DE ARQUIVOS ---
+// Suporta Range/206 (retomar downloads), Content-Length e validação
+// condicional por ETag/Last-Modified (If-None-Match -> 304).
 static esp_err_t file_get_handler(httpd_req_t *req) {
     ESP_LOGI(TAG, "Download request: %s", req->uri);
 
-    // 1. FORÇAR O FECHAMENTO DA CONEXÃO AO FINAL
-    // Isso impede que o socket fique preso (Keep-Alive) após o download
-    httpd_resp_set_hdr(req, "Connection", "close");
+    // Registros ainda na fila do logger precisam estar no arquivo baixado
+    data_logger_flush();
 
     char filepath[FILE_PATH_MAX];
     snprintf(filepath, sizeof(filepath), MOUNT_POINT"%s", req->uri);
+    char *query = strchr(filepath, '?');
+    if (query != NULL) {
+        *query = '\0';
+    }
+    if (strstr(filepath, "..")) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid filename");
+        return ESP_FAIL;
+    }
 
-    FILE *file = fopen(filepath, "r");
-    if (!file) {
+    struct stat st;
+    download_src_t src = {0};
+    if (stat(filepath, &st) != 0 || !download_src_open(&src, filepath)) {
         ESP_LOGE(TAG, "Failed to open file: %s", filepath);
         httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "File not found");
         return ESP_FAIL;
     }
 
-    httpd_resp_set_type(req, "application/octet-stream");
-
-    // Extrai nome do arquivo
-    const char *filename = strrchr(req->uri, '/');
-    if (filename == NULL) filename = req->uri;
-    else filename++;
-
-    static char filename_buf[MAX_FILENAME_LEN];
-    strncpy(filename_buf, filename, MAX_FILENAME_LEN - 1);
-    filename_buf[MAX_FILENAME_LEN - 1] = '\0';
-
-    char disposition[256];
-    snprintf(disposition, sizeof(disposition), "attachment; filename=\"%s\"", filename_buf);
-    httpd_resp_set_hdr(req, "Content-Disposition", disposition);
+    // 1. Validadores: tamanho + data de modificação do arquivo no SD
+    char etag[48], last_modified[40];
+    snprintf(etag, sizeof(etag), "\"%s%lx-%llx\"", src.render_csv ? "c" : "",
+             (unsigned long)st.st_size, (unsigned long long)st.st_mtime);
+    struct tm mtime;
+    gmtime_r(&st.st_mtime, &mtime);
+    strftime(last_modified, sizeof(last_modified), "%a, %d %b %Y %H:%M:%S GMT", &mtime);
+
+    char hdr_value[128];
+    if (header_value(req, "If-None-Match", hdr_value, sizeof(hdr_value)) &&
+        (strstr(hdr_value, etag) != NULL || strcmp(hdr_value, "*") == 0)) {
+        download_src_close(&src);
+        ESP_LOGI(TAG, "Not modified: %s", filepath);
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_set_hdr(req, "ETag", etag);
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
 
     // Buffer de 1024 bytes (Equilíbrio entre velocidade e memória)
-    char *chunk = malloc(1024);
+    char *chunk = malloc(DOWNLOAD_CHUNK_SIZE);
     if (chunk == NULL) {
         ESP_LOGE(TAG, "Memory allocation failed");
-        fclose(file);
+        download_src_close(&src);
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory error");
         return ESP_FAIL;
     }
 
-    size_t chunksize;
-    do {
-        chunksize = fread(chunk, 1, 1024, file);
-        if (chunksize > 0) {
-            // Tenta enviar. Se der erro (como socket fechado), sai do loop.
-            esp_err_t err = httpd_resp_send_chunk(req, chunk, chunksize);
-            if (err != ESP_OK) {
-                ESP_LOGW(TAG, "Send failed/aborted (%d). Closing file.", err);
-                fclose(file);
-                free(chunk);
-                return ESP_FAIL; // Retorna erro para fechar o socket imediatamente
+    // 2. Intervalo pedido (ignorado se If-Range não bate com o ETag atual)
+    long total = download_src_size(&src, st.st_size, chunk, DOWNLOAD_CHUNK_SIZE);
+    long start = 0, end = total - 1;
+    int range = 0;
+    if (header_value(req, "Range", hdr_value, sizeof(hdr_value))) {
+        char if_range[64];
+        if (!header_value(req, "If-Range", if_range, sizeof(if_range)) || strcmp(if_range, etag) == 0) {
+            range = parse_range(hdr_value, total, &start, &end);
+        }
+    }
+    if (range < 0) {
+        download_src_close(&src);
+        free(chunk);
+        snprintf(hdr_value, sizeof(hdr_value), "bytes */%ld", total);
+        httpd_resp_set_status(req, "416 Range Not Satisfiable");
+        httpd_resp_set_hdr(req, "Content-Range", hdr_value);
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+    if (range == 0) {
+        start = 0;
+        end = total - 1;
+    }
+
+    // Extrai nome do arquivo
+    static char filename_buf[MAX_FILENAME_LEN];
+    download_name(strrchr(filepath, '/') + 1, src.render_csv, filename_buf, sizeof(filename_buf));
+
+    // 3. Cabeçalhos montados aqui: httpd_resp_send_chunk usaria chunked
+    //    encoding, sem Content-Length, e o cliente não conseguiria retomar.
+    //    A conexão é fechada ao final para não prender sockets (Keep-Alive).
+    char content_range[64] = "";
+    if (range > 0) {
+        snprintf(content_range, sizeof(content_range), "Content-Range: bytes %ld-%ld/%ld\r\n", start, end, total);
+    }
+    char headers[512];
+    int hlen = snprintf(headers, sizeof(headers),
+        "HTTP/1.1 %s\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %ld\r\n"
+        "%s"
+        "Accept-Ranges: bytes\r\n"
+        "ETag: %s\r\n"
+        "Last-Modified: %s\r\n"
+        "Content-Disposition: attachment; filename=\"%s\"\r\n"
+        "Connection: close\r\n\r\n",
+        range > 0 ? "206 Partial Content" : "200 OK",
+        src.render_csv ? "text/csv" : "application/octet-stream",
+        total > 0 ? end - start + 1 : 0, content_range, etag, last_modified, filename_buf);
+
+    int sockfd = httpd_req_to_sockfd(req);
+    esp_err_t err = (hlen > 0 && hlen < (int)sizeof(headers)) ? bulk_send_raw(sockfd, headers, hlen) : ESP_FAIL;
+    if (err == ESP_OK && start > 0 && !download_src_skip(&src, start, chunk, DOWNLOAD_CHUNK_SIZE)) {
+        err = ESP_FAIL;
+    }
+
+    // 4. Corpo: a leitura do SD e o envio se sobrepõem (bulk_sender).
+    //    Quando a janela TCP enche, o envio espera o socket ficar
+    //    gravável em vez de dormir um tempo fixo por bloco.
+    size_t limit = total > 0 ? (size_t)(end - start + 1) : 0;
+    size_t sent = 0;
+    if (err == ESP_OK && limit > 0) {
+        err = bulk_send_stream(sockfd, download_src_bulk_read, &src, limit, &sent);
+        if (err == ESP_OK && sent < limit) {
+            ESP_LOGW(TAG, "File shrank during download (%u of %u bytes)", (unsigned)sent, (unsigned)limit);
+            err = ESP_FAIL;
+        }
+    }
+
+    download_src_close(&src);
+    free(chunk);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Send failed/aborted. Closing file.");
+        return ESP_FAIL; // Retorna erro para fechar o socket imediatamente
+    }
+    ESP_LOGI(TAG, "Sent %ld bytes of %s (%s)", end - start + 1, filename_buf, range > 0 ? "range" : "full");
+    httpd_sess_trigger_close(req->handle, sockfd);
+    return ESP_OK;
+}
+
+// --- DOWNLOAD EM MASSA (/archive) ---
+// Um único .zip (sem compressão) transmitido em chunked encoding, gerado
+// arquivo a arquivo a partir do SD: sem arquivo temporário e sem uma
+// conexão por arquivo. Parâmetros opcionais:
+//   from=AAAA-MM-DD, to=AAAA-MM-DD  (filtro pela data no nome do arquivo)
+//   files=a.dat,b.dat               (seleção explícita)
+
+static int archive_write(void *ctx, const void *data, size_t len) {
+    return bulk_chunked_write((bulk_chunked_t *)ctx, data, len) == ESP_OK ? 0 : -1;
+}
+
+// Decodifica %XX e '+' no próprio buffer
+static void url_decode(char *s) {
+    char *out = s;
+    for (; *s; s++) {
+        if (*s == '%' && s[1] && s[2]) {
+            char hex[3] = { s[1], s[2], '\0' };
+            *out++ = (char)strtol(hex, NULL, 16);
+            s += 2;
+        } else {
+            *out++ = (*s == '+') ? ' ' : *s;
+        }
+    }
+    *out = '\0';
+}
+
+static bool archive_selected(const char *name, const char *from, const char *to, const char *files) {
+    if (files[0] != '\0') {
+        size_t n = strlen(name);
+        for (const char *p = files; *p; ) {
+            size_t tok = strcspn(p, ",");
+            if (tok == n && strncmp(p, name, n) == 0) {
+                return true;
             }
+            p += tok;
+            if (*p == ',') p++;
         }
-        
-        // Delay crítico para evitar o Erro 11 (Buffer Full)
-        // Dá tempo para o ESP32 esvaziar o buffer TCP antes de ler mais do SD
-        vTaskDelay(pdMS_TO_TICKS(20)); 
+        return false;
+    }
+    // Nomes começam com AAAA-MM-DD, então a comparação de strings ordena por data
+    if (from[0] != '\0' && strncmp(name, from, 10) < 0) return false;
+    if (to[0] != '\0' && strncmp(name, to, 10) > 0) return false;
+    return true;
+}
+
+static esp_err_t archive_get_handler(httpd_req_t *req) {
+    ESP_LOGI(TAG, "Archive request: %s", req->uri);
+    data_logger_flush();
+
+    char from[11] = "", to[11] = "";
+    char *files = calloc(1, CONFIG_HTTPD_MAX_URI_LEN);
+    char *chunk = malloc(DOWNLOAD_CHUNK_SIZE);
+    if (files == NULL || chunk == NULL) {
+        free(files);
+        free(chunk);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory error");
+        return ESP_FAIL;
+    }
+
+    size_t query_len = httpd_req_get_url_query_len(req);
+    if (query_len > 0 && query_len < DOWNLOAD_CHUNK_SIZE &&
+        httpd_req_get_url_query_str(req, chunk, DOWNLOAD_CHUNK_SIZE) == ESP_OK) {
+        httpd_query_key_value(chunk, "from", from, sizeof(from));
+        httpd_query_key_value(chunk, "to", to, sizeof(to));
+        httpd_query_key_value(chunk, "files", files, CONFIG_HTTPD_MAX_URI_LEN);
+        url_decode(files);
+    }
 
-    } while (chunksize > 0);
+    DIR *dir = opendir(MOUNT_POINT);
+    if (dir == NULL) {
+        free(files);
+        free(chunk);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Erro ao ler cartão SD");
+        return ESP_FAIL;
+    }
 
-    fclose(file);
+    // Cabeçalhos enviados direto no socket, como no download simples;
+    // o corpo segue em chunked encoding pelo bulk_sender.
+    int sockfd = httpd_req_to_sockfd(req);
+    bulk_chunked_t ch;
+    char headers[256];
+    int hlen = snprintf(headers, sizeof(headers),
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/zip\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Content-Disposition: attachment; filename=\"co2-%s-%s.zip\"\r\n"
+        "Connection: close\r\n\r\n",
+        from[0] ? from : "inicio", to[0] ? to : "fim");
+    if (bulk_chunked_begin(&ch, sockfd) != ESP_OK) {
+        closedir(dir);
+        free(files);
+        free(chunk);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory error");
+        return ESP_FAIL;
+    }
+    if (bulk_send_raw(sockfd, headers, hlen) != ESP_OK) {
+        ch.failed = true;
+    }
+
+    zip_stream_t zs;
+    zip_stream_init(&zs, archive_write, &ch);
+    if (ch.failed) {
+        zs.failed = true;
+    }
+    int64_t start_us = esp_timer_get_time();
+    struct dirent *entry;
+
+    while (!zs.failed && (entry = readdir(dir)) != NULL) {
+        if (entry->d_type != DT_REG || !archive_selected(entry->d_name, from, to, files)) {
+            continue;
+        }
+
+        char filepath[FILE_PATH_MAX];
+        snprintf(filepath, sizeof(filepath), MOUNT_POINT"/%s", entry->d_name);
+        struct stat st;
+        download_src_t src = {0};
+        if (stat(filepath, &st) != 0 || !download_src_open(&src, filepath)) {
+            ESP_LOGW(TAG, "Skipping unreadable file: %s", filepath);
+            continue;
+        }
+
+        char name[MAX_FILENAME_LEN];
+        download_name(entry->d_name, src.render_csv, name, sizeof(name));
+        if (zip_stream_begin_file(&zs, name, st.st_mtime)) {
+            size_t n;
+            while ((n = download_src_read(&src, chunk, DOWNLOAD_CHUNK_SIZE)) > 0 &&
+                   zip_stream_write(&zs, chunk, n)) {
+            }
+            zip_stream_end_file(&zs);
+        }
+        download_src_close(&src);
+    }
+    closedir(dir);
+    free(files);
     free(chunk);
-    
-    // Finaliza envio
-    httpd_resp_send_chunk(req, NULL, 0);
+
+    uint16_t count = zs.count;
+    bool ok = zip_stream_finish(&zs);
+    if (bulk_chunked_end(&ch, ok) != ESP_OK) {
+        ESP_LOGW(TAG, "Archive transfer aborted.");
+        return ESP_FAIL;
+    }
+    httpd_sess_trigger_close(req->handle, sockfd);
+    ESP_LOGI(TAG, "Archive sent: %u files, %lu bytes in %lld ms", count,
+             (unsigned long)zs.offset, (long long)((esp_timer_get_time() - start_us) / 1000));
     return ESP_OK;
 }
 
@@ -128,6 +481,7 @@ static esp_err_t file_delete_handler(httpd_req_t *req) {
     // Tenta excluir o arquivo
     if (remove(filepath) == 0) {
         ESP_LOGI(TAG, "Deleted file: %s", filepath);
+        file_catalog_remove(filename_clean);
         // Redireciona de volta para a lista de arquivos
         httpd_resp_set_status(req, "303 See Other");
         httpd_resp_set_hdr(req, "Location", "/");
@@ -160,47 +514,43 @@ static const char *HTML_HEADER = "<!DOCTYPE html>"
 ".btn-all { background-color: #2196F3; color: white; width: 100%; padding: 12px; font-size: 1.1em; margin-bottom: 15px; }"
 ".btn:hover { opacity: 0.9; }"
 ".status-busy { color: #F44336; font-style: italic; }"
+".archive-form { margin-bottom: 15px; }"
+".archive-form input { margin: 0 5px 10px; }"
 "</style>"
-"<script>"
-"function downloadAll() {"
-"  var links = document.querySelectorAll('.dl-link');"
-"  if(links.length == 0) { alert('Nenhum arquivo para baixar!'); return; }"
-"  if(!confirm('Isso iniciará o download de ' + links.length + ' arquivos. Continuar?')) return;"
-"  var delay = 0;"
-"  links.forEach(function(link) {"
-"    setTimeout(function() { window.open(link.href, '_blank'); }, delay);"
-"    delay += 1500;" // 1.5s de intervalo para proteger o servidor
-"  });"
-"}"
-"</script>"
-"</head><body><header><h1>Monitor CO₂ Medio</h1></header><main>";
-
-static const char *HTML_FOOTER = "</main></body></html>";
+"</head><body><header><h1>Monitor CO₂";   // O título termina com os estratos medidos
+
+// A cada acesso o celular envia a própria hora (local, como o DS1302) para
+// acertar o relógio e medir a deriva do DS1302 (ver timekeeping.h)
+static const char *HTML_FOOTER =
+"</main><script>"
+"fetch('/time',{method:'POST',body:String(Date.now()-new Date().getTimezoneOffset()*60000)});"
+"</script></body></html>";
+
+// Horário do primeiro e do último registro de um arquivo ("08:00-17:30")
+static void catalog_period(const file_catalog_entry_t *e, char *buf, size_t len) {
+    if (e->first_ts == 0) {
+        buf[0] = '\0';
+        return;
+    }
+    time_t first = e->first_ts, last = e->last_ts;
+    struct tm t1, t2;
+    localtime_r(&first, &t1);
+    localtime_r(&last, &t2);
+    snprintf(buf, len, "%02d:%02d-%02d:%02d", t1.tm_hour, t1.tm_min, t2.tm_hour, t2.tm_min);
+}
 
 static esp_err_t file_list_handler(httpd_req_t *req) {
     httpd_resp_set_hdr(req, "Connection", "close");
 
-    // --- 1. TENTATIVA DE LEITURA (BAIXA PRIORIDADE) ---
-    int co2_now = 0;
-    float temp_now = 0, hum_now = 0;
-    bool read_success = false;
-    bool sensor_busy = false;
-
-    // Tenta pegar o Mutex SEM ESPERAR (xBlockTime = 0)
-    // Se o agendador estiver medindo (mutex preso), isso falha imediatamente (pdFALSE)
-    if (xSemaphoreTake(xSensorMutex, 0) == pdTRUE) {
-        // Conseguiu o sensor! Faz a leitura rápida
-        read_success = get_quick_sensor_data(&co2_now, &temp_now, &hum_now);
-        xSemaphoreGive(xSensorMutex); // Devolve rápido
-    } else {
-        // Falhou (Sensor ocupado pela medição principal)
-        sensor_busy = true;
-        ESP_LOGW(TAG, "Ignorando leitura web: Sensor em uso pela medição principal.");
-    }
-
-    // --- 2. MONTAGEM DA PÁGINA ---
+    // --- 1. MONTAGEM DA PÁGINA ---
     httpd_resp_set_type(req, "text/html");
     httpd_resp_sendstr_chunk(req, HTML_HEADER);
+    int channels = co2_sensor_channel_count();
+    for (int c = 0; c < channels; c++) {
+        httpd_resp_sendstr_chunk(req, c == 0 ? " " : " / ");
+        httpd_resp_sendstr_chunk(req, co2_sensor_channel_estrato(c));
+    }
+    httpd_resp_sendstr_chunk(req, "</h1></header><main>");
 
     // DATA E HORA ATUAIS
     char date_str[11], time_str[9];
@@ -210,62 +560,127 @@ static esp_err_t file_list_handler(httpd_req_t *req) {
     httpd_resp_sendstr_chunk(req, datetime_html);
     // -------------------------------------
 
-    // CARD DE DADOS TEMPO REAL
-    char sensor_html[512];
-    if (read_success) {
-        snprintf(sensor_html, sizeof(sensor_html), 
-            "<div class='card'><h2>Leitura Instantânea</h2>"
-            "<div class='data-box'>"
-            "<div class='metric'><h3>CO₂</h3><p>%d ppm</p></div>"
-            "<div class='metric'><h3>Temp</h3><p>%.1f °C</p></div>"
-            "<div class='metric'><h3>Umid</h3><p>%.1f %%</p></div>"
-            "</div></div>", 
-            co2_now, temp_now, hum_now);
-    } else if (sensor_busy) {
-        snprintf(sensor_html, sizeof(sensor_html), 
-            "<div class='card'><h2>Leitura Instantânea</h2>"
-            "<p class='status-busy'>⚠️ Medição Oficial em andamento. Visualização ignorada.</p></div>");
+    // CARD DE DADOS TEMPO REAL: uma linha por estrato
+    // A página nunca acessa o sensor: lê o snapshot de cada canal (sem trava
+    // e sem I/O) mantido pelo serviço de sensores e pela medição agendada.
+    int64_t now_us = esp_timer_get_time();
+    httpd_resp_sendstr_chunk(req, "<div class='card'><h2>Leitura Instantânea</h2>");
+
+    // Medição em andamento: fase do ciclo e tempo restante
+    cycle_status_t cycle;
+    co2_sensor_cycle_status(&cycle);
+    if (cycle.phase != CYCLE_IDLE) {
+        static const char *const PHASE_LABELS[] = {
+            [CYCLE_PURGE] = "purga da câmara",
+            [CYCLE_SETTLE] = "assentamento do ar",
+            [CYCLE_WARMUP] = "aquecimento do sensor",
+            [CYCLE_SAMPLE] = "amostragem",
+        };
+        char cycle_html[160];
+        int n = snprintf(cycle_html, sizeof(cycle_html), "<p class='status-busy'>Medição em andamento: %s",
+                         PHASE_LABELS[cycle.phase]);
+        if (cycle.phase == CYCLE_SAMPLE) {
+            n += snprintf(cycle_html + n, sizeof(cycle_html) - n, " (%d de até %d amostras)",
+                          cycle.samples_taken, cycle.samples_max);
+        }
+        if (cycle.phase_end_us > now_us) {
+            n += snprintf(cycle_html + n, sizeof(cycle_html) - n, ", %s %lld s",
+                          cycle.phase == CYCLE_SAMPLE ? "no máximo" : "restam",
+                          (long long)((cycle.phase_end_us - now_us + 999999) / 1000000));
+        }
+        snprintf(cycle_html + n, sizeof(cycle_html) - n, "</p>");
+        httpd_resp_sendstr_chunk(req, cycle_html);
+    }
+    for (int c = 0; c < channels; c++) {
+        sensor_reading_t reading;
+        bool has_reading = sensor_snapshot_read(c, &reading);
+        char title[48] = "";
+        if (channels > 1) {
+            snprintf(title, sizeof(title), "<h3>%s</h3>", co2_sensor_channel_estrato(c));
+        }
+        char sensor_html[512];
+        if (has_reading && (reading.co2_valid || reading.dht_valid)) {
+            char co2_txt[16] = "--", temp_txt[16] = "--", hum_txt[16] = "--";
+            if (reading.co2_valid) {
+                snprintf(co2_txt, sizeof(co2_txt), "%d ppm", reading.co2_ppm);
+            }
+            if (reading.dht_valid) {
+                snprintf(temp_txt, sizeof(temp_txt), "%.1f °C", reading.temperature);
+                snprintf(hum_txt, sizeof(hum_txt), "%.1f %%", reading.humidity);
+            }
+            int64_t newest_us = reading.co2_time_us > reading.dht_time_us ? reading.co2_time_us : reading.dht_time_us;
+            snprintf(sensor_html, sizeof(sensor_html), 
+                "%s<div class='data-box'>"
+                "<div class='metric'><h3>CO₂</h3><p>%s</p></div>"
+                "<div class='metric'><h3>Temp</h3><p>%s</p></div>"
+                "<div class='metric'><h3>Umid</h3><p>%s</p></div>"
+                "</div><p>Atualizado há %lld s</p>", 
+                title, co2_txt, temp_txt, hum_txt, (long long)((now_us - newest_us) / 1000000));
+        } else {
+            snprintf(sensor_html, sizeof(sensor_html), 
+                "%s<p class='status-busy'>Aguardando a primeira leitura válida (erro ou aquecimento do sensor).</p>",
+                title);
+        }
+        httpd_resp_sendstr_chunk(req, sensor_html);
+    }
+    httpd_resp_sendstr_chunk(req, "</div>");
+
+    // Tempo de rádio ligado (o AP é o maior consumo do aparelho)
+    wifi_ap_stats_t radio;
+    wifi_ap_get_stats(&radio);
+    char radio_html[160];
+    snprintf(radio_html, sizeof(radio_html), "<p>Wi-Fi ligado hoje: %lu min (ontem: %lu min)</p>",
+             (unsigned long)(radio.on_today_s / 60), (unsigned long)(radio.on_yesterday_s / 60));
+    httpd_resp_sendstr_chunk(req, radio_html);
+
+    // Estado do relógio: de onde veio a hora e a deriva corrigida
+    timekeeping_status_t clock;
+    timekeeping_get_status(&clock);
+    char clock_html[192];
+    if (clock.source == TIMEKEEPING_SOURCE_NONE) {
+        snprintf(clock_html, sizeof(clock_html),
+                 "<p class='status-busy'>Relógio ainda não acertado: mantenha esta página aberta por alguns segundos.</p>");
     } else {
-        snprintf(sensor_html, sizeof(sensor_html), 
-            "<div class='card'><h2>Leitura Instantânea</h2>"
-            "<p class='status-busy'>Erro ou Aquecimento do Sensor.</p></div>");
+        snprintf(clock_html, sizeof(clock_html), "<p>Relógio: %s, deriva %+.1f ppm (%.1f dias de calibração)</p>",
+                 timekeeping_source_name(clock.source), clock.drift_ppm, clock.calibration_s / 86400.0f);
     }
-    httpd_resp_sendstr_chunk(req, sensor_html);
+    httpd_resp_sendstr_chunk(req, clock_html);
 
     // CARD DE ARQUIVOS
     httpd_resp_sendstr_chunk(req, "<div class='card'><h2>Histórico Diário</h2>");
     
-    // Botão de Download em Massa
-    httpd_resp_sendstr_chunk(req, "<button class='btn btn-all' onclick='downloadAll()'>📥 Baixar Todos os Arquivos</button>");
+    // Download em massa: um único .zip em uma única requisição (/archive),
+    // com filtro opcional por período
+    httpd_resp_sendstr_chunk(req,
+        "<form class='archive-form' method='GET' action='/archive'>"
+        "De<input type='date' name='from'>até<input type='date' name='to'>"
+        "<button type='submit' class='btn btn-all'>📥 Baixar Todos os Arquivos (.zip)</button></form>");
     
-    httpd_resp_sendstr_chunk(req, "<table><tr><th>Data</th><th>Ações</th></tr>");
+    httpd_resp_sendstr_chunk(req, "<table><tr><th>Arquivo</th><th>Registros</th><th>CO₂ mín/méd/máx</th><th>Ações</th></tr>");
 
-    // Lista arquivos do SD
-    struct dirent *entry;
-    DIR *dir = opendir(MOUNT_POINT);
-    if (dir) {
-        static char line[512];
-        while ((entry = readdir(dir)) != NULL) {
-            if (entry->d_type == DT_REG) {
-                char filename[128];
-                strncpy(filename, entry->d_name, 127);
-                filename[127] = '\0';
-                
-                // Adicionamos a classe 'dl-link' para o JS encontrar
-                snprintf(line, sizeof(line),
-                    "<tr><td>%s</td>"
-                    "<td>"
-                    "<a href=\"/%s\" target=\"_blank\" class=\"dl-link\"><button class=\"btn btn-dl\">Baixar</button></a> "
-                    "<form method=\"GET\" action=\"/delete/%s\" onsubmit=\"return confirm('Excluir %s?');\" style=\"display:inline;\">"
-                    "<button type=\"submit\" class=\"btn btn-del\">Excluir</button></form>"
-                    "</td></tr>",
-                    filename, filename, filename, filename);
-                httpd_resp_sendstr_chunk(req, line);
-            }
+    // Lista vinda do índice em RAM (file_catalog): sem varrer o diretório do SD
+    size_t n_files = file_catalog_count();
+    if (n_files == 0) {
+        httpd_resp_sendstr_chunk(req, "<tr><td colspan='4'>Nenhum arquivo no cartão SD</td></tr>");
+    }
+    static char line[768];
+    file_catalog_entry_t e;
+    for (size_t i = 0; file_catalog_get(i, &e); i++) {
+        char period[24] = "", co2[32] = "--";
+        catalog_period(&e, period, sizeof(period));
+        if (e.co2_count > 0) {
+            snprintf(co2, sizeof(co2), "%d / %.0f / %d", e.co2_min, file_catalog_co2_mean(&e), e.co2_max);
         }
-        closedir(dir);
-    } else {
-        httpd_resp_sendstr_chunk(req, "<tr><td colspan='2'>Erro ao ler cartão SD</td></tr>");
+        snprintf(line, sizeof(line),
+            "<tr><td>%s<br><small>%.1f KB %s</small></td>"
+            "<td>%lu</td><td>%s</td>"
+            "<td>"
+            "<a href=\"/%s\" target=\"_blank\" ><button class=\"btn btn-dl\">Baixar</button></a> "
+            "<form method=\"GET\" action=\"/delete/%s\" onsubmit=\"return confirm('Excluir %s?');\" style=\"display:inline;\">"
+            "<button type=\"submit\" class=\"btn btn-del\">Excluir</button></form>"
+            "</td></tr>",
+            e.name, e.size / 1024.0f, period, (unsigned long)e.records, co2, e.name, e.name, e.name);
+        httpd_resp_sendstr_chunk(req, line);
     }
     
     httpd_resp_sendstr_chunk(req, "</table></div>");
@@ -274,6 +689,74 @@ static esp_err_t file_list_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
+// --- ÍNDICE EM JSON (/files.json) ---
+// Mesmo conteúdo da tabela da página, para scripts e apps de coleta.
+static esp_err_t files_json_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Connection", "close");
+    httpd_resp_sendstr_chunk(req, "{\"files\":[");
+
+    char line[384];
+    file_catalog_entry_t e;
+    for (size_t i = 0; file_catalog_get(i, &e); i++) {
+        int n = snprintf(line, sizeof(line),
+            "%s{\"name\":\"%s\",\"format\":\"%s\",\"size\":%lu,\"records\":%lu,",
+            i > 0 ? "," : "", e.name, e.binary ? "dat" : "csv",
+            (unsigned long)e.size, (unsigned long)e.records);
+        if (e.first_ts != 0) {
+            n += snprintf(line + n, sizeof(line) - n, "\"first\":%lu,\"last\":%lu,",
+                          (unsigned long)e.first_ts, (unsigned long)e.last_ts);
+        } else {
+            n += snprintf(line + n, sizeof(line) - n, "\"first\":null,\"last\":null,");
+        }
+        if (e.co2_count > 0) {
+            snprintf(line + n, sizeof(line) - n, "\"co2_min\":%d,\"co2_mean\":%.1f,\"co2_max\":%d}",
+                     e.co2_min, file_catalog_co2_mean(&e), e.co2_max);
+        } else {
+            snprintf(line + n, sizeof(line) - n, "\"co2_min\":null,\"co2_mean\":null,\"co2_max\":null}");
+        }
+        httpd_resp_sendstr_chunk(req, line);
+    }
+
+    httpd_resp_sendstr_chunk(req, "]}");
+    httpd_resp_sendstr_chunk(req, NULL);
+    return ESP_OK;
+}
+
+// --- REFERÊNCIA DE HORA (POST /time) ---
+// Corpo: epoch em ms enviado pela página. Responde com o ajuste aplicado.
+static esp_err_t time_post_handler(httpd_req_t *req) {
+    int64_t received_us = esp_timer_get_time();
+    char body[24];
+    int len = (req->content_len < sizeof(body)) ? httpd_req_recv(req, body, req->content_len) : -1;
+    if (len <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected epoch in ms");
+        return ESP_FAIL;
+    }
+    body[len] = '\0';
+
+    char *end;
+    long long true_ms = strtoll(body, &end, 10);
+    if (end == body || true_ms < 1577836800000LL) { // Antes de 2020: relógio do celular inválido
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid time");
+        return ESP_FAIL;
+    }
+    if (timekeeping_set_reference(true_ms, received_us) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "RTC unavailable");
+        return ESP_FAIL;
+    }
+
+    timekeeping_status_t clock;
+    timekeeping_get_status(&clock);
+    char json[128];
+    snprintf(json, sizeof(json), "{\"offset_ms\":%ld,\"drift_ppm\":%.2f,\"source\":%d}",
+             (long)clock.last_offset_ms, clock.drift_ppm, (int)clock.source);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Connection", "close");
+    httpd_resp_sendstr(req, json);
+    return ESP_OK;
+}
+
 // Manipulador para favicon.ico
 static esp_err_t favicon_get_handler(httpd_req_t *req) {
     httpd_resp_send(req, NULL, 0); // Retorna 0 bytes, indicando que não há conteúdo
@@ -281,6 +764,104 @@ static esp_err_t favicon_get_handler(httpd_req_t *req) {
 }
 
 
+// --- ATIVIDADE (para o desligamento do AP por ociosidade) ---
+// Cada requisição abre uma conexão (Connection: close), então abrir e
+// fechar sockets marca a atividade; as duas callbacks rodam na tarefa do httpd.
+static volatile int open_sockets = 0;
+static volatile int64_t last_activity_us = 0;
+
+static esp_err_t session_open(httpd_handle_t hd, int sockfd) {
+    open_sockets++;
+    last_activity_us = esp_timer_get_time();
+    return ESP_OK;
+}
+
+static void session_close(httpd_handle_t hd, int sockfd) {
+    if (open_sockets > 0) open_sockets--;
+    last_activity_us = esp_timer_get_time();
+    close(sockfd); // Com close_fn definido, fechar o socket é responsabilidade nossa
+}
+
+void http_server_get_activity(int *sockets, int64_t *last_us) {
+    *sockets = open_sockets;
+    *last_us = last_activity_us;
+}
+
+// --- MÉTRICAS (texto Prometheus) ---
+static esp_err_t metrics_get_handler(httpd_req_t *req) {
+    char *buf = malloc(METRICS_CHUNK_SIZE);
+    if (buf == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory error");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    metrics_cursor_t cur;
+    metrics_render_begin(&cur);
+    esp_err_t err = ESP_OK;
+    size_t n;
+    while (err == ESP_OK && (n = metrics_render(&cur, buf, METRICS_CHUNK_SIZE)) > 0) {
+        err = httpd_resp_send_chunk(req, buf, n);
+    }
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    free(buf);
+    return err;
+}
+
+#if TRACE_ENABLED
+// --- RASTRO DE EVENTOS (JSON do Chrome, abre no Perfetto) ---
+static esp_err_t trace_get_handler(httpd_req_t *req) {
+    char *buf = malloc(TRACE_CHUNK_SIZE);
+    if (buf == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory error");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"co2meter-trace.json\"");
+    trace_cursor_t cur;
+    trace_render_begin(&cur);
+    esp_err_t err = ESP_OK;
+    size_t n;
+    while (err == ESP_OK && (n = trace_render(&cur, buf, TRACE_CHUNK_SIZE)) > 0) {
+        err = httpd_resp_send_chunk(req, buf, n);
+    }
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    free(buf);
+    return err;
+}
+#endif
+
+// Cada rota passa por aqui para alimentar o histograma do seu handler
+// (e o rastro de eventos, com o nome da métrica)
+typedef struct {
+    esp_err_t (*handler)(httpd_req_t *req);
+    metric_id_t metric;
+} timed_route_t;
+
+static esp_err_t timed_handler(httpd_req_t *req) {
+    const timed_route_t *route = req->user_ctx;
+    int64_t start = metrics_start();
+    TRACE_BEGIN(metrics_name(route->metric));
+    esp_err_t err = route->handler(req);
+    TRACE_END(metrics_name(route->metric));
+    metrics_stop(route->metric, start);
+    return err;
+}
+
+static const timed_route_t list_route = { file_list_handler, METRIC_HTTP_LIST };
+static const timed_route_t delete_route = { file_delete_handler, METRIC_HTTP_DELETE };
+static const timed_route_t files_json_route = { files_json_handler, METRIC_HTTP_FILES_JSON };
+static const timed_route_t time_route = { time_post_handler, METRIC_HTTP_TIME };
+static const timed_route_t archive_route = { archive_get_handler, METRIC_HTTP_ARCHIVE };
+static const timed_route_t metrics_route = { metrics_get_handler, METRIC_HTTP_METRICS };
+#if TRACE_ENABLED
+static const timed_route_t trace_route = { trace_get_handler, METRIC_HTTP_TRACE };
+#endif
+static const timed_route_t download_route = { file_get_handler, METRIC_HTTP_DOWNLOAD };
+
 // Função para iniciar o servidor HTTP
 void start_http_server(httpd_handle_t *server_handle_ptr) {
     httpd_handle_t server = NULL;
@@ -297,15 +878,22 @@ void start_http_server(httpd_handle_t *server_handle_ptr) {
     config.lru_purge_enable = true; 
     
     // 4. TIMEOUTS MAIORES
-    // O erro 11 significa "ocupado". Aumentamos o timeout para o servidor
-    // ter paciência de esperar o buffer esvaziar antes de derrubar a conexão.
+    // Downloads usam o bulk_sender (espera o socket com select(), limite
+    // BULK_SEND_TIMEOUT_S); as demais respostas usam este timeout.
     config.send_wait_timeout = 20; // Padrão é 5s. Aumentado para 20s.
     config.recv_wait_timeout = 20; 
 
     config.max_open_sockets = 4;
+    config.max_uri_handlers = 12;  // Padrão é 8; já são 9 rotas
     config.uri_match_fn = httpd_uri_match_wildcard;
+    config.open_fn = session_open;
+    config.close_fn = session_close;
+
+    ESP_LOGI(TAG, "Starting HTTP Server (Stack: %u, LRU: On)", (unsigned)config.stack_size);
 
-    ESP_LOGI(TAG, "Starting HTTP Server (Stack: %d, LRU: On)", config.stack_size);
+    if (bulk_sender_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Bulk sender unavailable; downloads will fail");
+    }
 
     if (httpd_start(&server, &config) == ESP_OK) {
         *server_handle_ptr = server;
@@ -313,13 +901,30 @@ void start_http_server(httpd_handle_t *server_handle_ptr) {
         httpd_uri_t favicon = { .uri = "/favicon.ico", .method = HTTP_GET, .handler = favicon_get_handler };
         httpd_register_uri_handler(server, &favicon);
 
-        httpd_uri_t file_list = { .uri = "/", .method = HTTP_GET, .handler = file_list_handler };
+        httpd_uri_t file_list = { .uri = "/", .method = HTTP_GET, .handler = timed_handler, .user_ctx = (void *)&list_route };
         httpd_register_uri_handler(server, &file_list);
 
-        httpd_uri_t file_del = { .uri = "/delete/*", .method = HTTP_GET, .handler = file_delete_handler };
+        httpd_uri_t file_del = { .uri = "/delete/*", .method = HTTP_GET, .handler = timed_handler, .user_ctx = (void *)&delete_route };
         httpd_register_uri_handler(server, &file_del);
 
-        httpd_uri_t file_dl = { .uri = "/*", .method = HTTP_GET, .handler = file_get_handler };
+        httpd_uri_t files_json = { .uri = "/files.json", .method = HTTP_GET, .handler = timed_handler, .user_ctx = (void *)&files_json_route };
+        httpd_register_uri_handler(server, &files_json);
+
+        httpd_uri_t time_post = { .uri = "/time", .method = HTTP_POST, .handler = timed_handler, .user_ctx = (void *)&time_route };
+        httpd_register_uri_handler(server, &time_post);
+
+        httpd_uri_t archive = { .uri = "/archive", .method = HTTP_GET, .handler = timed_handler, .user_ctx = (void *)&archive_route };
+        httpd_register_uri_handler(server, &archive);
+
+        httpd_uri_t metrics = { .uri = "/metrics", .method = HTTP_GET, .handler = timed_handler, .user_ctx = (void *)&metrics_route };
+        httpd_register_uri_handler(server, &metrics);
+
+#if TRACE_ENABLED
+        httpd_uri_t trace = { .uri = "/trace", .method = HTTP_GET, .handler = timed_handler, .user_ctx = (void *)&trace_route };
+        httpd_register_uri_handler(server, &trace);
+#endif
+
+        httpd_uri_t file_dl = { .uri = "/*", .method = HTTP_GET, .handler = timed_handler, .user_ctx = (void *)&download_route };
         httpd_register_uri_handler(server, &file_dl);
 
         ESP_LOGI(TAG, "HTTP server started");
@@ -328,3 +933,11 @@ void start_http_server(httpd_handle_t *server_handle_ptr) {
         *server_handle_ptr = NULL;
     }
 }
+
+void stop_http_server(httpd_handle_t server) {
+    if (server != NULL) {
+        httpd_stop(server);
+        open_sockets = 0;
+        ESP_LOGI(TAG, "HTTP server stopped");
+    }
+}
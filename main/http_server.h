@@ -4,5 +4,10 @@
 #include "esp_http_server.h"
 
 void start_http_server(httpd_handle_t *server_handle);
+void stop_http_server(httpd_handle_t server_handle);
+
+// Conexões abertas e instante (esp_timer) da última abertura/fechamento,
+// usados para decidir quando o AP está ocioso.
+void http_server_get_activity(int *open_sockets, int64_t *last_activity_us);
 
 #endif // HTTP_SERVER_H
@@ -4,82 +4,74 @@
 #include <string.h>
 #include "esp_system.h"
 #include "esp_log.h"
-#include "dht.h"
 #include "co2_sensor_task.h"
+#include "sensor_power.h"
 #include "sd_card.h"
+#include "data_logger.h"
+#include "measurement_pipeline.h"
 #include "http_server.h"
 #include "rtc.h"
-#include "esp_wifi.h"
+#include "wifi_ap.h"
+#include "timekeeping.h"
+#include "driver/rtc_io.h"
 #include "nvs_flash.h"
-// esp_sleep.h não é necessário pois não usaremos modos de suspensão
+#include "nvs.h"
+#include "schedule.h"
+#include "power_model.h"
+#include "esp_sleep.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "metrics.h"
+#include "trace.h"
 
-//  #define BUTTON_PIN GPIO_NUM_14
 #define DHT_PIN 4 
 
 // #define MODO_DE_TESTE // Descomente para testes rápidos (medições a cada 30s)
+// #define MODO_BAIXO_CONSUMO // Descomente para operar com baterias: deep sleep entre as medições
+// #define MODO_WIFI_SOB_DEMANDA // Descomente para ligar o Wi-Fi só pelo botão (GPIO14) ou janela, desligando se ocioso
+
+#define SCHEDULE_NVS_NAMESPACE "config"
+#define SCHEDULE_NVS_KEY "schedule"     // Texto no formato de schedule_parse()
+#define SCHEDULE_MAX_LATE_S 120         // Acordou depois disso: o horário é considerado perdido
+
+#define LOWPOWER_BOOT_S 2               // Margem para boot + montagem do SD antes do aquecimento
+#define LOWPOWER_STATE_MAGIC 0x4C505731 // "LPW1"
 
 static const char *TAG = "MAIN_APP";
-static httpd_handle_t server_handle = NULL;
 
 // --- SEMÁFORO GLOBAL (MUTEX) ---
-// Usado para garantir que apenas uma tarefa acesse o sensor por vez.
+// Usado para garantir que apenas uma tarefa acesse o sensor por vez. A
+// medição o toma a cada leitura (co2_sensor_task.c), não pelo ciclo todo.
 SemaphoreHandle_t xSensorMutex = NULL;
 
-// --- FUNÇÃO DE INICIALIZAÇÃO DO WIFI ---
-void wifi_init_softap(void)
-{
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_t *netif = esp_netif_create_default_wifi_ap();
-    (void)netif;
-
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-
-    wifi_config_t wifi_config = {
-        .ap = {
-            .ssid = "ESP32_CO2_MEDIO",
-            .ssid_len = strlen("ESP32_CO2_MEDIO"),
-            .password = "12345678",
-            .max_connection = 4,
-            .authmode = WIFI_AUTH_WPA_WPA2_PSK},
-    };
-
-    if (strlen((const char *)wifi_config.ap.password) == 0)
-    {
-        wifi_config.ap.authmode = WIFI_AUTH_OPEN;
-    }
-
-    //sleep 2 segundos para garantir estabilidade
-    vTaskDelay(pdMS_TO_TICKS(2000));
-
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
-
-    //sleep 1 segundo para garantir estabilidade
-    vTaskDelay(pdMS_TO_TICKS(1000));
-
-    // Configurações para estabilidade e para MANTER O POWERBANK LIGADO
-    esp_wifi_set_ps(WIFI_PS_NONE); // Desativa economia de energia
-    esp_wifi_set_max_tx_power(78); // Potência máxima (19.5dBm)
-
-    ESP_LOGI(TAG, "WiFi initialized. Power Save: OFF, TX Power: MAX.");
-}
-
 // --- TAREFA DE REDE (CORE 1) ---
 static void network_task(void *arg)
 {
     ESP_LOGI(TAG, "Starting Network Task on Core %d", xPortGetCoreID());
 
-    wifi_init_softap();
-    start_http_server(&server_handle);
+    // AP + servidor HTTP: sempre ligados, ou só pelo botão/janela (wifi_ap.h)
+#ifdef MODO_WIFI_SOB_DEMANDA
+    wifi_ap_manager(true);
+#else
+    wifi_ap_manager(false);
+#endif
+}
 
-    ESP_LOGI(TAG, "HTTP Server started.");
+// Agenda da NVS (namespace "config", chave "schedule"); padrão se ausente ou inválida
+static void load_schedule(schedule_t *sched)
+{
+    schedule_default(sched);
 
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(100000)); 
+    nvs_handle_t nvs;
+    if (nvs_open(SCHEDULE_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    char text[256];
+    size_t len = sizeof(text);
+    if (nvs_get_str(nvs, SCHEDULE_NVS_KEY, text, &len) == ESP_OK && !schedule_parse(text, sched)) {
+        ESP_LOGE(TAG, "Invalid schedule in NVS, using default: %s", text);
     }
+    nvs_close(nvs);
 }
 
 // --- TAREFA DE MEDIÇÃO (CORE 0) ---
@@ -87,103 +79,260 @@ static void measurement_scheduler_task(void *arg)
 {
     ESP_LOGI(TAG, "Starting Scheduler Task on Core %d", xPortGetCoreID());
 
-    // Variáveis para rastrear a ÚLTIMA vez que mediu
-    // Inicializam com -1 para garantir que a primeira medição sempre ocorra
-    static int last_meas_hour = -1;
-    static int last_meas_min = -1;
+#ifdef MODO_DE_TESTE
+    while (1)
+    {
+        ESP_LOGI(TAG, "TEST MODE: Forcing measurement.");
+        perform_single_measurement(TURNO_DESCONHECIDO);
+        vTaskDelay(pdMS_TO_TICKS(30000));
+    }
+#else
+    schedule_t sched;
+    load_schedule(&sched);
+    char sched_text[256];
+    schedule_format(&sched, sched_text, sizeof(sched_text));
+    ESP_LOGI(TAG, "Schedule: %s", sched_text);
+
+    // Horário da última medição: o próximo é sempre posterior a ele
+    time_t last_slot = 0;
 
     while (1)
     {
-        time_t now;
-        struct tm timeinfo;
-        time(&now);
-        localtime_r(&now, &timeinfo);
+        // 0. Ciclo em andamento (roda na tarefa do sensor): o sensor fica
+        //    ligado e o próximo horário é calculado quando ele terminar
+        if (co2_sensor_cycle_busy()) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
 
-        ESP_LOGI(TAG, "Current Time: %02d:%02d:%02d (Core %d)", 
-                 timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, xPortGetCoreID());
+        // 1. Próximo horário da agenda, calculado direto da tabela
+        time_t now = time(NULL);
+        time_t from = (now > last_slot) ? now : last_slot + 1;
+        time_t slot;
+        uint8_t turno;
+        if (!schedule_next_slot(&sched, from, &slot, &turno)) {
+            ESP_LOGE(TAG, "Schedule has no measurement slots. Scheduler idle.");
+            vTaskSuspend(NULL);
+        }
 
-#ifdef MODO_DE_TESTE
-        bool should_measure = true;
-        ESP_LOGI(TAG, "TEST MODE: Forcing measurement.");
-#else
-        // 1. Janela de operação (Dia/Noite)
-        bool is_day_time =
-            (timeinfo.tm_hour > 6 || (timeinfo.tm_hour == 6 && timeinfo.tm_min >= 30)) &&
-            (timeinfo.tm_hour < 22 || (timeinfo.tm_hour == 22 && timeinfo.tm_min < 30));
-
-        // 2. Janelas específicas
-        bool is_in_measurement_window =
-            (timeinfo.tm_hour >= 7 && timeinfo.tm_hour < 9) ||
-            (timeinfo.tm_hour >= 11 && timeinfo.tm_hour < 13) ||
-            (timeinfo.tm_hour >= 16 && timeinfo.tm_hour < 18) ||
-            (timeinfo.tm_hour == 9 && timeinfo.tm_min == 0) ||
-            (timeinfo.tm_hour == 13 && timeinfo.tm_min == 0) ||
-            (timeinfo.tm_hour == 18 && timeinfo.tm_min == 0);
-
-        // 3. Minuto exato
-        bool is_on_minute_schedule = (timeinfo.tm_min == 0 || timeinfo.tm_min == 30);
-        
-        // 4. CORREÇÃO: Verifica se o horário atual é DIFERENTE do último medido
-        bool is_new_time_slot = (timeinfo.tm_hour != last_meas_hour) || (timeinfo.tm_min != last_meas_min);
-
-        // Só mede se todas as condições forem verdadeiras
-        bool should_measure = is_day_time && is_in_measurement_window && is_on_minute_schedule && is_new_time_slot;
+        // 2. Energia do sensor: entre horários da mesma janela ele continua
+        //    ligado; fora delas fica desligado até 'warmup' segundos antes
+        //    do próximo horário (ou do início do ciclo, se a purga for mais
+        //    longa). Uma notificação interrompe qualquer espera e o cálculo
+        //    é refeito (ex.: relógio ajustado).
+        struct tm slot_tm;
+        localtime_r(&slot, &slot_tm);
+        time_t lead = (time_t)co2_sensor_cycle_lead_s();
+        time_t warmup = (time_t)sensor_power_warmup_s();
+        time_t cycle_at = slot - lead;
+        time_t power_at = slot - (warmup > lead ? warmup : lead);
+        bool keep_on = last_slot != 0 && schedule_same_window(&sched, last_slot, slot);
+        if (now < power_at && !keep_on) {
+            sensor_power_off();
+            ESP_LOGI(TAG, "Next measurement at %02d:%02d (%s); sensor power-up in %ld s.",
+                     slot_tm.tm_hour, slot_tm.tm_min, record_turno_name(turno), (long)(power_at - now));
+            ulTaskNotifyTake(pdTRUE, (TickType_t)((power_at - now) * configTICK_RATE_HZ));
+            continue;
+        }
+        sensor_power_on();
+
+        // 3. Dorme até o início do ciclo (o sensor aquece enquanto isso).
+        //    Purga e assentamento vêm antes: a primeira amostra sai no horário.
+        if (cycle_at > now) {
+            ESP_LOGI(TAG, "Next measurement at %02d:%02d (%s), cycle starts in %ld s.",
+                     slot_tm.tm_hour, slot_tm.tm_min, record_turno_name(turno), (long)(cycle_at - now));
+            // Em segundos * tick rate: pdMS_TO_TICKS estouraria 32 bits com esperas de uma noite inteira
+            ulTaskNotifyTake(pdTRUE, (TickType_t)((cycle_at - now) * configTICK_RATE_HZ));
+            now = time(NULL);
+            if (now < cycle_at) {
+                continue;
+            }
+        }
+        if (now - slot > SCHEDULE_MAX_LATE_S) {
+            ESP_LOGW(TAG, "Missed slot %02d:%02d by %ld s.", slot_tm.tm_hour, slot_tm.tm_min, (long)(now - slot));
+            last_slot = slot;
+            continue;
+        }
+
+        // 4. Medição (aquisição) na tarefa do sensor, que avisa ao terminar.
+        //    O sensor é travado só a cada leitura, e o cálculo e a gravação
+        //    seguem no núcleo 1 pelo pipeline: um SD lento não atrasa o
+        //    próximo horário.
+        ESP_LOGI(TAG, "Starting measurement cycle for slot %02d:%02d...", slot_tm.tm_hour, slot_tm.tm_min);
+        if (co2_sensor_cycle_start(turno, xTaskGetCurrentTaskHandle()) != ESP_OK) {
+            ESP_LOGE(TAG, "Could not start measurement cycle for slot %02d:%02d", slot_tm.tm_hour, slot_tm.tm_min);
+        }
+        last_slot = slot;
+    }
 #endif
+}
 
-        if (should_measure)
-        {
-            ESP_LOGI(TAG, "Starting measurement cycle...");
-            // --- PROTEÇÃO COM MUTEX (PRIORIDADE ALTA) ---
-            // portMAX_DELAY faz o sistema ESPERAR infinitamente até o webserver soltar o sensor.
-            // Como o webserver é rápido (2s), isso não atrasa a medição.
-            // Uma vez pego, o Agendador segura o sensor por 3 minutos.
-            if (xSemaphoreTake(xSensorMutex, portMAX_DELAY) == pdTRUE) {
-                
-                perform_single_measurement();
-                // O arquivo já é fechado dentro da função de escrita no sd_card.c novo
-                
-                xSemaphoreGive(xSensorMutex); // Libera para o Webserver usar se quiser
-
-            // ATUALIZA O REGISTRO DA ÚLTIMA MEDIÇÃO
-            last_meas_hour = timeinfo.tm_hour;
-            last_meas_min = timeinfo.tm_min;
-            
-            ESP_LOGI(TAG, "Measurement recorded for slot %02d:%02d", last_meas_hour, last_meas_min);
-
-            } else {
-                ESP_LOGE(TAG, "Error: Could not take Mutex for measurement!");
-            }
+#ifdef MODO_BAIXO_CONSUMO
+// --- MODO DE BAIXO CONSUMO (DEEP SLEEP) ---
+// Estado que atravessa o deep sleep (a RAM comum é perdida a cada despertar)
+typedef struct {
+    uint32_t magic;
+    time_t last_slot;        // Último horário medido (não mede o mesmo duas vezes)
+    uint32_t wakes;
+    uint32_t measurements;
+    uint32_t missed;         // Horários perdidos (acordou ou saiu da sessão de Wi-Fi tarde demais)
+    uint64_t awake_ms;       // Tempo acordado acumulado desde a partida a frio
+    time_t since;            // Início da contabilização
+    bool ap_pending;         // Sessão de Wi-Fi cortada por um horário: continua depois dele
+} lowpower_state_t;
+
+static RTC_DATA_ATTR lowpower_state_t lp_state;
+
+// Antecedência do despertar em relação ao horário: boot + aquecimento do sensor
+#define LOWPOWER_LEAD_S (LOWPOWER_BOOT_S + (time_t)sensor_power_warmup_s())
+#define LOWPOWER_DRAIN_MS 5000          // Prazo para o pipeline entregar o último ciclo ao logger
+
+static void lowpower_sleep_until(time_t wake_at)
+{
+    time_t now = time(NULL);
+    uint32_t sleep_s = wake_at > now ? (uint32_t)(wake_at - now) : 1;
+
+    // 1. Pipeline vazio (registros na fila do logger); depois a fila do
+    //    logger grava só o que venceria durante o sono
+    pipeline_drain(LOWPOWER_DRAIN_MS);
+    data_logger_prepare_sleep(sleep_s);
+    sensor_power_off();
+
+    // 2. Contabiliza o tempo acordado deste ciclo
+    lp_state.awake_ms += esp_timer_get_time() / 1000;
+    time_t elapsed = now - lp_state.since;
+    if (elapsed > 0) {
+        ESP_LOGI(TAG, "Wakes: %lu, measurements: %lu, missed: %lu, duty cycle: %.2f %%",
+                 (unsigned long)lp_state.wakes, (unsigned long)lp_state.measurements,
+                 (unsigned long)lp_state.missed, lp_state.awake_ms / 10.0 / elapsed);
+    }
+
+    ESP_LOGI(TAG, "Deep sleep for %lu s.", (unsigned long)sleep_s);
+    esp_sleep_enable_timer_wakeup((uint64_t)sleep_s * 1000000ULL);
+    // O botão do Wi-Fi também acorda (nível baixo), para a coleta dos dados em campo
+    rtc_gpio_pullup_en(WIFI_AP_BUTTON_PIN);
+    esp_sleep_enable_ext0_wakeup(WIFI_AP_BUTTON_PIN, 0);
+    esp_deep_sleep_start();
+}
+
+// Um ciclo completo: acorda, mede se o horário chegou e volta a dormir.
+static void lowpower_cycle(void)
+{
+    // 1. Relógio. Ao acordar pelo timer ou pelo botão basta reler o DS1302.
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    bool warm = (cause == ESP_SLEEP_WAKEUP_TIMER || cause == ESP_SLEEP_WAKEUP_EXT0) &&
+                lp_state.magic == LOWPOWER_STATE_MAGIC;
+    if (!warm || !timekeeping_resync_fast()) {
+        initialize_rtc();
+        timekeeping_init();
+    }
+    if (!warm) {
+        memset(&lp_state, 0, sizeof(lp_state));
+        lp_state.magic = LOWPOWER_STATE_MAGIC;
+        lp_state.since = time(NULL);
+    }
+    lp_state.wakes++;
+    sensor_power_init();
+    if (pipeline_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start measurement pipeline!");
+    }
+
+    // 2. Próximo horário da agenda
+    schedule_t sched;
+    load_schedule(&sched);
+    time_t now = time(NULL);
+    time_t slot;
+    uint8_t turno;
+    if (!schedule_next_slot(&sched, now > lp_state.last_slot ? now : lp_state.last_slot + 1, &slot, &turno)) {
+        ESP_LOGE(TAG, "Schedule has no measurement slots.");
+        lowpower_sleep_until(now + 24 * 3600);
+    }
+
+    // 3. Botão (ou partida a frio): sessão de Wi-Fi até ficar ocioso, mas
+    //    só até a hora de aquecer o sensor; o resto fica para depois da medição
+    bool sd_ready = false;
+    if (!warm || cause == ESP_SLEEP_WAKEUP_EXT0 || lp_state.ap_pending) {
+        sd_ready = init_sd_card();
+        if (data_logger_init(record_store_file_header, sizeof(record_t), catalog_queued_record) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start data logger!");
         }
-        
-        // --- CÁLCULO DE ESPERA (DELAY) ---
-#ifndef MODO_DE_TESTE
-        // Atualiza a hora POIS a medição demorou
-        time_t now_after;
-        struct tm time_after;
-        time(&now_after);
-        localtime_r(&now_after, &time_after);
-
-        int next_target_min = (time_after.tm_min < 30) ? 30 : 60;
-        struct tm next_time_struct = time_after;
-        next_time_struct.tm_min = (next_target_min == 60) ? 0 : 30;
-        next_time_struct.tm_sec = 0;
-        if (next_target_min == 60) {
-            next_time_struct.tm_hour += 1;
+        const char *reason = !warm ? "boot" : cause == ESP_SLEEP_WAKEUP_EXT0 ? "button" : "resumed";
+        lp_state.ap_pending = !wifi_ap_session(reason, slot - LOWPOWER_LEAD_S);
+        now = time(NULL);
+
+        // O prazo só é conferido a cada WIFI_AP_CHECK_MS e o SD e o rádio
+        // demoram a subir: um horário que ficou para trás é medido com
+        // atraso, ou registrado como perdido além de SCHEDULE_MAX_LATE_S
+        struct tm slot_tm;
+        localtime_r(&slot, &slot_tm);
+        if (now - slot > SCHEDULE_MAX_LATE_S) {
+            ESP_LOGW(TAG, "Missed slot %02d:%02d by %ld s (Wi-Fi session).",
+                     slot_tm.tm_hour, slot_tm.tm_min, (long)(now - slot));
+            lp_state.missed++;
+            lp_state.last_slot = slot;
+            if (!schedule_next_slot(&sched, slot + 1, &slot, &turno)) {
+                lowpower_sleep_until(now + 24 * 3600);
+            }
+        } else if (now > slot - (time_t)co2_sensor_cycle_lead_s()) {
+            ESP_LOGW(TAG, "Slot %02d:%02d starts %ld s late (Wi-Fi session).",
+                     slot_tm.tm_hour, slot_tm.tm_min, (long)(now - slot + (time_t)co2_sensor_cycle_lead_s()));
         }
+    }
 
-        time_t next_timestamp = mktime(&next_time_struct);
-        long seconds_to_wait = (long)difftime(next_timestamp, now_after);
+    if (!warm) {
+        power_profile_t profile;
+        power_projection_t proj;
+        struct tm midnight;
+        localtime_r(&now, &midnight);
+        midnight.tm_hour = midnight.tm_min = midnight.tm_sec = 0;
+        power_profile_default(&profile);
+        power_model_project(&sched, &profile, mktime(&midnight), &proj);
+        ESP_LOGI(TAG, "Projection: %u slots/day, duty cycle %.2f %%, %.1f mAh/day, ~%.0f days on battery.",
+                 (unsigned)proj.slots_per_day, proj.duty_cycle * 100.0f, proj.mah_per_day, proj.battery_days);
+    }
 
-        // Proteção para não esperar tempo negativo ou muito curto
-        if (seconds_to_wait < 5) seconds_to_wait = 60;
+    // 4. Cedo demais (ex.: partida a frio): dorme até a hora de aquecer
+    if (slot - now > LOWPOWER_LEAD_S + 30) {
+        lowpower_sleep_until(slot - LOWPOWER_LEAD_S);
+    }
 
-        ESP_LOGI(TAG, "Waiting %ld seconds for next slot.", seconds_to_wait);
-        vTaskDelay(pdMS_TO_TICKS(seconds_to_wait * 1000));
-#else
-        vTaskDelay(pdMS_TO_TICKS(30000));
-#endif
+    // 5. Medição: o sensor aquece enquanto espera o horário
+    if (!sd_ready && !mount_sd_card()) {
+        ESP_LOGE(TAG, "SD card unavailable; records stay queued in RTC memory.");
+    }
+    if (data_logger_init(record_store_file_header, sizeof(record_t), catalog_queued_record) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start data logger!");
+    }
+    sensor_power_on();
+    if (co2_sensor_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize CO2 sensor driver!");
+    }
+    co2_sensor_service_start();
+    now = time(NULL);
+    if (slot - now < (time_t)sensor_power_warmup_s()) {
+        ESP_LOGW(TAG, "Only %ld s of sensor warm-up before the slot; measurement waits for it.", (long)(slot - now));
+    }
+    time_t cycle_at = slot - (time_t)co2_sensor_cycle_lead_s();
+    if (cycle_at > now) {
+        vTaskDelay((TickType_t)((cycle_at - now) * configTICK_RATE_HZ));
+    }
+    perform_single_measurement(turno);
+    lp_state.last_slot = slot;
+    lp_state.measurements++;
+
+    // 6. Sessão cortada: continua com o sensor desligado, de novo só até a
+    //    hora de aquecer para o próximo horário. Depois dorme até ela.
+    bool has_next = schedule_next_slot(&sched, slot + 1, &slot, &turno);
+    if (lp_state.ap_pending) {
+        sensor_power_off();
+        lp_state.ap_pending = !wifi_ap_session("resumed", has_next ? slot - LOWPOWER_LEAD_S : 0);
+    }
+    if (has_next) {
+        lowpower_sleep_until(slot - LOWPOWER_LEAD_S);
     }
+    lowpower_sleep_until(time(NULL) + 24 * 3600);
 }
+#endif
 
 void app_main(void)
 {
@@ -202,8 +351,14 @@ void app_main(void)
         ESP_LOGE(TAG, "Failed to create Mutex!");
     }
 
+#ifdef MODO_BAIXO_CONSUMO
+    // Sem Wi-Fi nem servidor: cada despertar mede e volta a dormir
+    lowpower_cycle();
+#endif
+
     // 2. INICIALIZAÇÃO DE HARDWARE
     initialize_rtc();
+    timekeeping_init();   // Relógio do sistema = DS1302 com a deriva corrigida
     
     if (!init_sd_card()) {
         ESP_LOGE(TAG, "CRITICAL: Failed to initialize SD card in app_main!");
@@ -211,12 +366,37 @@ void app_main(void)
         ESP_LOGI(TAG, "SD Card initialized successfully.");
     }
 
-    // Liga energia do sensor (ajuda o powerbank)
-    co2_sensor_power_control(true); 
+    // Fila de gravação em lote (recupera registros pendentes da memória RTC)
+    if (data_logger_init(record_store_file_header, sizeof(record_t), catalog_queued_record) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start data logger!");
+    }
+
+    // Processamento e gravação das medições no núcleo 1
+    if (pipeline_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start measurement pipeline!");
+    }
+
+    // Energia do sensor: ligada pelo agendador antes de cada horário
+    // (ou sempre, com SENSOR_SEMPRE_LIGADO para ajudar o powerbank)
+    sensor_power_init();
+
+    // Instala a UART do MH-Z14A uma única vez (não é mais reinstalada a cada leitura)
+    if (co2_sensor_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize CO2 sensor driver!");
+    }
 
     // 3. Criação das Tarefas
-    xTaskCreatePinnedToCore(network_task, "NetworkTask", 8192, NULL, 5, NULL, 1);
-    xTaskCreatePinnedToCore(measurement_scheduler_task, "SchedulerTask", 8192, NULL, 5, NULL, 0);
+    // Tarefa do sensor: roda os ciclos pedidos pelo agendador e publica a
+    // última leitura validada para a página web entre eles
+    co2_sensor_service_start();
+    TaskHandle_t network_handle = NULL;
+    xTaskCreatePinnedToCore(network_task, "NetworkTask", 8192, NULL, 5, &network_handle, 1);
+    TaskHandle_t scheduler_handle = NULL;
+    xTaskCreatePinnedToCore(measurement_scheduler_task, "SchedulerTask", 8192, NULL, 5, &scheduler_handle, 0);
+    metrics_register_task(network_handle);
+    metrics_register_task(scheduler_handle);
+    // Saltos do relógio (acerto pelo celular) acordam o agendador para refazer a espera
+    timekeeping_start(scheduler_handle);
 
     ESP_LOGI(TAG, "System started. Power Save OFF.");
 }
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "measurement_pipeline.h"
+#include <math.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "metrics.h"
+#include "trace.h"
+#include "data_logger.h"
+#include "record_store.h"
+#include "sd_card.h"
+
+static const char *TAG = "PIPELINE";
+
+typedef struct {
+    record_t rec;
+    const char *estrato;
+    int channel;             // Fluxo do data_logger (um por estrato)
+} pipeline_record_t;
+
+_Static_assert(PIPELINE_MAX_CHANNELS <= DATA_LOGGER_MAX_STREAMS, "um fluxo do data_logger por canal");
+
+static QueueHandle_t queues[PIPELINE_QUEUE_COUNT];
+static pipeline_queue_stats_t queue_stats[PIPELINE_QUEUE_COUNT];
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Mensagens ainda não gravadas (ciclos na fila ou em processamento e
+// registros na fila ou em gravação); zero quando tudo chegou ao logger
+static uint32_t in_flight;
+
+// O processamento recebe aqui (o ciclo tem ~1 KB: fora da pilha)
+static pipeline_cycle_t processing_buf;
+
+static const char *const queue_names[PIPELINE_QUEUE_COUNT] = {
+    [PIPELINE_QUEUE_SAMPLES] = "samples",
+    [PIPELINE_QUEUE_RECORDS] = "records",
+};
+
+const char *pipeline_queue_name(pipeline_queue_t queue) {
+    return (queue >= 0 && queue < PIPELINE_QUEUE_COUNT) ? queue_names[queue] : "?";
+}
+
+// Profundidade no instante da inserção (o consumidor pode retirar a
+// mensagem antes de o envio retornar)
+static void note_sent(pipeline_queue_t q, uint32_t depth) {
+    portENTER_CRITICAL(&stats_lock);
+    if (depth > queue_stats[q].max_depth) queue_stats[q].max_depth = depth;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+static void note_full(pipeline_queue_t q, bool dropped) {
+    portENTER_CRITICAL(&stats_lock);
+    queue_stats[q].stalls++;
+    if (dropped) queue_stats[q].dropped++;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+// Mediana, estatísticas e fluxo de um canal, prontos para gravar
+static void build_record(const pipeline_cycle_t *cy, pipeline_channel_t *ch, record_t *rec) {
+    // Seleção O(n) sobre as amostras válidas (leituras com falha não puxam a mediana)
+    co2_stats_t stats;
+    co2_stats_finalize(&ch->acumulador, ch->amostras, ch->validas, cy->trim_fraction, &stats);
+    // Fluxo: inclinação da série corrigida pela temperatura da câmara
+    co2_flux_t flux;
+    co2_flux_finalize(&ch->fluxo, &cy->chamber, ch->dht_ok, ch->temperature, &flux);
+
+    struct tm tm;
+    localtime_r(&cy->timestamp, &tm);
+    char when[20];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+    ESP_LOGI(TAG, "FINAL VALUE: %s | CO2 (Median): %d ppm | MAD: %.1f | Temp: %.1fC | Hum: %.1f%% | Estrato: %s | Turno_Medicao: %s",
+             when, stats.median, stats.mad, ch->temperature, ch->humidity, ch->estrato, record_turno_name(cy->turno_id));
+    ESP_LOGI(TAG, "FLUX (%s): %.3f umol/m2/s | slope %.4f ppm/s | R2 %.3f | flags 0x%02x",
+             ch->estrato, flux.flux, flux.slope_ppm_s, flux.r2, flux.flags);
+
+    // Registro binário de tamanho fixo: a conversão para texto só acontece no download
+    *rec = (record_t){
+        .estrato_id = record_estrato_id(ch->estrato),
+        .turno_id = cy->turno_id,
+        .timestamp = (uint32_t)cy->timestamp,
+        .co2_ppm = stats.median,
+        .temperature_c10 = (int16_t)lroundf(ch->temperature * 10),
+        .humidity_c10 = (uint16_t)lroundf(ch->humidity * 10),
+        .co2_mad_c10 = (uint16_t)lroundf(stats.mad * 10),
+        .co2_trimmed_c10 = lroundf(stats.trimmed_mean * 10),
+        .co2_min = stats.min,
+        .co2_max = stats.max,
+        .co2_stddev_c10 = (uint16_t)lroundf(stats.stddev * 10),
+        .n_valid = stats.n_valid,
+        .n_taken = cy->tomadas,
+        .co2_flux_nmol = lroundf(flux.flux * 1000),
+        .flux_r2_e4 = (uint16_t)lroundf(flux.r2 * 10000),
+        .flux_flags = flux.flags,
+    };
+}
+
+static void processing_task(void *arg) {
+    while (1) {
+        xQueueReceive(queues[PIPELINE_QUEUE_SAMPLES], &processing_buf, portMAX_DELAY);
+        pipeline_cycle_t *cy = &processing_buf;
+        for (int c = 0; c < cy->n_channels; c++) {
+            pipeline_record_t out = { .estrato = cy->channels[c].estrato, .channel = c };
+            int64_t probe = metrics_start();
+            TRACE_BEGIN("process");
+            build_record(cy, &cy->channels[c], &out.rec);
+            TRACE_END("process");
+            metrics_stop(METRIC_STATS, probe);
+
+            // A gravação atrasada segura só este estágio, nunca a aquisição
+            __atomic_add_fetch(&in_flight, 1, __ATOMIC_ACQ_REL);
+            uint32_t depth = (uint32_t)uxQueueMessagesWaiting(queues[PIPELINE_QUEUE_RECORDS]) + 1;
+            if (xQueueSend(queues[PIPELINE_QUEUE_RECORDS], &out, 0) != pdTRUE) {
+                note_full(PIPELINE_QUEUE_RECORDS, false);
+                TRACE_BEGIN("records_stall");
+                xQueueSend(queues[PIPELINE_QUEUE_RECORDS], &out, portMAX_DELAY);
+                TRACE_END("records_stall");
+                depth = PIPELINE_RECORDS_DEPTH;
+            }
+            note_sent(PIPELINE_QUEUE_RECORDS, depth);
+        }
+        __atomic_sub_fetch(&in_flight, 1, __ATOMIC_ACQ_REL);
+    }
+}
+
+static void storage_task(void *arg) {
+    pipeline_record_t item;
+    while (1) {
+        xQueueReceive(queues[PIPELINE_QUEUE_RECORDS], &item, portMAX_DELAY);
+        int64_t probe = metrics_start();
+        TRACE_BEGIN("record_write");
+        write_data_record(&item.rec, item.estrato, item.channel);
+        TRACE_END("record_write");
+        metrics_stop(METRIC_RECORD_WRITE, probe);
+        __atomic_sub_fetch(&in_flight, 1, __ATOMIC_ACQ_REL);
+    }
+}
+
+esp_err_t pipeline_start(void) {
+    if (queues[PIPELINE_QUEUE_SAMPLES] != NULL) {
+        return ESP_OK;
+    }
+    queues[PIPELINE_QUEUE_SAMPLES] = xQueueCreate(PIPELINE_SAMPLES_DEPTH, sizeof(pipeline_cycle_t));
+    queues[PIPELINE_QUEUE_RECORDS] = xQueueCreate(PIPELINE_RECORDS_DEPTH, sizeof(pipeline_record_t));
+    if (queues[PIPELINE_QUEUE_SAMPLES] == NULL || queues[PIPELINE_QUEUE_RECORDS] == NULL) {
+        ESP_LOGE(TAG, "Failed to create pipeline queues");
+        return ESP_ERR_NO_MEM;
+    }
+    queue_stats[PIPELINE_QUEUE_SAMPLES].capacity = PIPELINE_SAMPLES_DEPTH;
+    queue_stats[PIPELINE_QUEUE_RECORDS].capacity = PIPELINE_RECORDS_DEPTH;
+
+    // Processamento e gravação no núcleo 1; a aquisição fica no núcleo 0
+    TaskHandle_t processing = NULL, storage = NULL;
+    if (xTaskCreatePinnedToCore(processing_task, "Processing", 4096, NULL, 4, &processing, 1) != pdPASS ||
+        xTaskCreatePinnedToCore(storage_task, "Storage", 4096, NULL, 3, &storage, 1) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create pipeline tasks");
+        return ESP_FAIL;
+    }
+    metrics_register_task(processing);
+    metrics_register_task(storage);
+    return ESP_OK;
+}
+
+esp_err_t pipeline_submit(const pipeline_cycle_t *cycle) {
+    if (queues[PIPELINE_QUEUE_SAMPLES] == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    __atomic_add_fetch(&in_flight, 1, __ATOMIC_ACQ_REL);
+    uint32_t depth = (uint32_t)uxQueueMessagesWaiting(queues[PIPELINE_QUEUE_SAMPLES]) + 1;
+    if (xQueueSend(queues[PIPELINE_QUEUE_SAMPLES], cycle, 0) != pdTRUE) {
+        __atomic_sub_fetch(&in_flight, 1, __ATOMIC_ACQ_REL);
+        note_full(PIPELINE_QUEUE_SAMPLES, true);
+        ESP_LOGE(TAG, "Processing queue full: cycle dropped");
+        return ESP_ERR_NO_MEM;
+    }
+    note_sent(PIPELINE_QUEUE_SAMPLES, depth);
+    return ESP_OK;
+}
+
+bool pipeline_drain(uint32_t timeout_ms) {
+    TickType_t start = xTaskGetTickCount();
+    while (__atomic_load_n(&in_flight, __ATOMIC_ACQUIRE) > 0) {
+        if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(timeout_ms)) {
+            ESP_LOGW(TAG, "Pipeline not drained after %lu ms", (unsigned long)timeout_ms);
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return true;
+}
+
+void pipeline_get_stats(pipeline_queue_t queue, pipeline_queue_stats_t *out) {
+    if (queue < 0 || queue >= PIPELINE_QUEUE_COUNT) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    portENTER_CRITICAL(&stats_lock);
+    *out = queue_stats[queue];
+    portEXIT_CRITICAL(&stats_lock);
+    out->depth = queues[queue] != NULL ? (uint32_t)uxQueueMessagesWaiting(queues[queue]) : 0;
+}
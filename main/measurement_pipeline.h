@@ -0,0 +1,79 @@
+#ifndef MEASUREMENT_PIPELINE_H
+#define MEASUREMENT_PIPELINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "esp_err.h"
+#include "co2_stats.h"
+#include "co2_flux.h"
+
+// Medição em três estágios ligados por filas FreeRTOS limitadas, com
+// mensagens de tamanho fixo:
+//
+//   aquisição (tarefa do sensor, núcleo 0): purga, amostras de CO2, DHTs;
+//     o agendador só pede o ciclo (co2_sensor_cycle_start)
+//     -> fila "samples" (um ciclo com as séries de todos os canais)
+//   processamento (núcleo 1): mediana, estatísticas e fluxo
+//     -> fila "records" (um record_t por estrato)
+//   gravação (núcleo 1): write_data_record() (catálogo + data_logger)
+//
+// A aquisição nunca espera por um estágio seguinte: com a fila cheia o
+// ciclo é descartado e contado. O processamento espera pela gravação
+// (conta uma parada), então um SD lento nunca atrasa uma amostra.
+
+#define PIPELINE_MAX_CHANNELS   3
+#define PIPELINE_MAX_SAMPLES    61
+#define PIPELINE_SAMPLES_DEPTH  2       // Ciclos aguardando processamento
+#define PIPELINE_RECORDS_DEPTH  6       // Registros aguardando gravação (dois ciclos de três estratos)
+
+// Série de um canal, montada pela aquisição
+typedef struct {
+    const char *estrato;                 // String estática (tabela de canais)
+    int amostras[PIPELINE_MAX_SAMPLES];  // Só as válidas, em ordem de chegada
+    int validas;
+    co2_stats_acc_t acumulador;
+    co2_flux_acc_t fluxo;
+    float temperature;
+    float humidity;
+    bool dht_ok;
+} pipeline_channel_t;
+
+typedef struct {
+    uint8_t turno_id;
+    time_t timestamp;                    // Horário gravado em todos os estratos
+    int tomadas;                         // Amostras pedidas
+    float trim_fraction;                 // Da média aparada
+    co2_flux_chamber_t chamber;
+    int n_channels;
+    pipeline_channel_t channels[PIPELINE_MAX_CHANNELS];
+} pipeline_cycle_t;
+
+typedef enum {
+    PIPELINE_QUEUE_SAMPLES = 0,
+    PIPELINE_QUEUE_RECORDS,
+    PIPELINE_QUEUE_COUNT
+} pipeline_queue_t;
+
+typedef struct {
+    uint32_t depth;          // Mensagens na fila agora
+    uint32_t capacity;
+    uint32_t max_depth;      // Maior profundidade desde o boot
+    uint32_t stalls;         // Envios que encontraram a fila cheia
+    uint32_t dropped;        // Desses, os descartados (só a aquisição descarta)
+} pipeline_queue_stats_t;
+
+// Cria as filas e as tarefas de processamento e gravação (idempotente).
+esp_err_t pipeline_start(void);
+
+// Entrega um ciclo sem bloquear. ESP_ERR_NO_MEM: fila cheia, ciclo descartado.
+esp_err_t pipeline_submit(const pipeline_cycle_t *cycle);
+
+// Espera os dois estágios esvaziarem (ex.: antes do deep sleep).
+// Retorna false se o prazo acabou antes.
+bool pipeline_drain(uint32_t timeout_ms);
+
+void pipeline_get_stats(pipeline_queue_t queue, pipeline_queue_stats_t *out);
+const char *pipeline_queue_name(pipeline_queue_t queue);
+
+#endif // MEASUREMENT_PIPELINE_H
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <string.h>
+#include "metrics.h"
+#include "esp_system.h"
+#include "measurement_pipeline.h"
+
+// Bucket 0: < 1 µs. Bucket 1 + 2k + h: [2^k, 2^k * 1.5) com h = 0 e
+// [2^k * 1.5, 2^(k+1)) com h = 1. Acima do último, tudo cai nele.
+
+static metric_hist_t hists[METRIC_COUNT];
+static portMUX_TYPE metrics_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t tasks[METRICS_MAX_TASKS];
+static int task_count;
+
+static const char *const names[METRIC_COUNT] = {
+    [METRIC_CYCLE] = "cycle",
+    [METRIC_UART_INSTALL] = "uart_install",
+    [METRIC_DHT_READ] = "dht_read",
+    [METRIC_CO2_ROUNDTRIP] = "co2_roundtrip",
+    [METRIC_SAMPLE_LATENESS] = "sample_lateness",
+    [METRIC_STATS] = "stats",
+    [METRIC_RECORD_WRITE] = "record_write",
+    [METRIC_SCHED_MUTEX_WAIT] = "sched_mutex_wait",
+    [METRIC_SD_FLUSH] = "sd_flush",
+    [METRIC_SD_SCAN] = "sd_scan",
+    [METRIC_HTTP_LIST] = "http_list",
+    [METRIC_HTTP_FILES_JSON] = "http_files_json",
+    [METRIC_HTTP_DOWNLOAD] = "http_download",
+    [METRIC_HTTP_ARCHIVE] = "http_archive",
+    [METRIC_HTTP_DELETE] = "http_delete",
+    [METRIC_HTTP_TIME] = "http_time",
+    [METRIC_HTTP_METRICS] = "http_metrics",
+    [METRIC_HTTP_TRACE] = "http_trace",
+};
+
+const char *metrics_name(metric_id_t id) {
+    return (id >= 0 && id < METRIC_COUNT) ? names[id] : "?";
+}
+
+static int bucket_index(uint32_t us) {
+    if (us == 0) {
+        return 0;
+    }
+    int k = 31 - __builtin_clz(us);
+    int h = (k > 0) ? (int)((us >> (k - 1)) & 1) : 0;
+    int idx = 1 + 2 * k + h;
+    return (idx < METRICS_BUCKETS) ? idx : METRICS_BUCKETS - 1;
+}
+
+static uint64_t bucket_lower(int idx) {
+    if (idx == 0) {
+        return 0;
+    }
+    int k = (idx - 1) / 2;
+    uint64_t base = 1ULL << k;
+    return ((idx - 1) % 2) ? base + base / 2 : base;
+}
+
+void metrics_record(metric_id_t id, int64_t elapsed_us) {
+    if (id < 0 || id >= METRIC_COUNT) {
+        return;
+    }
+    uint32_t us = (elapsed_us <= 0) ? 0 : (elapsed_us > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed_us);
+    int idx = bucket_index(us);
+
+    portENTER_CRITICAL(&metrics_lock);
+    metric_hist_t *h = &hists[id];
+    h->count++;
+    h->sum_us += us;
+    if (us > h->max_us) h->max_us = us;
+    h->buckets[idx]++;
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+void metrics_get(metric_id_t id, metric_hist_t *out) {
+    portENTER_CRITICAL(&metrics_lock);
+    *out = hists[id];
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+uint32_t metrics_quantile_us(const metric_hist_t *h, float q) {
+    if (h->count == 0) {
+        return 0;
+    }
+    uint32_t rank = (uint32_t)(q * h->count + 0.5f);
+    if (rank < 1) rank = 1;
+    if (rank > h->count) rank = h->count;
+
+    uint32_t seen = 0;
+    for (int i = 0; i < METRICS_BUCKETS; i++) {
+        uint32_t c = h->buckets[i];
+        if (c == 0 || seen + c < rank) {
+            seen += c;
+            continue;
+        }
+        // Interpolação linear dentro do bucket, limitada ao máximo observado
+        uint64_t lo = bucket_lower(i);
+        uint64_t hi = (i + 1 < METRICS_BUCKETS) ? bucket_lower(i + 1) : (uint64_t)h->max_us + 1;
+        uint64_t v = lo + (hi - lo) * (rank - seen) / c;
+        return (v > h->max_us) ? h->max_us : (uint32_t)v;
+    }
+    return h->max_us;
+}
+
+void metrics_register_task(TaskHandle_t task) {
+    if (task == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&metrics_lock);
+    bool known = false;
+    for (int i = 0; i < task_count; i++) {
+        known |= (tasks[i] == task);
+    }
+    if (!known && task_count < METRICS_MAX_TASKS) {
+        tasks[task_count++] = task;
+    }
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+// --- Texto Prometheus ---
+
+enum {
+    FAMILY_HEAP_FREE = 0,
+    FAMILY_HEAP_MIN_FREE,
+    FAMILY_UPTIME,
+    FAMILY_STAGE_SUMMARY,
+    FAMILY_STAGE_MAX,
+    FAMILY_TASK_STACK,
+    FAMILY_QUEUE_DEPTH,
+    FAMILY_QUEUE_MAX_DEPTH,
+    FAMILY_QUEUE_STALLS,
+    FAMILY_QUEUE_DROPPED,
+    FAMILY_COUNT
+};
+
+#define STAGE_SUMMARY_LINES 4   // p50, p95, _sum, _count
+
+void metrics_render_begin(metrics_cursor_t *cur) {
+    cur->family = 0;
+    cur->line = 0;
+    cur->caller = xTaskGetCurrentTaskHandle();
+}
+
+// Tarefas listadas: as registradas e, se não estiver entre elas, a que renderiza
+static TaskHandle_t task_at(const metrics_cursor_t *cur, int i) {
+    int n = task_count;
+    bool caller_known = false;
+    for (int j = 0; j < n; j++) {
+        caller_known |= (tasks[j] == cur->caller);
+    }
+    if (i < n) return tasks[i];
+    if (i == n && !caller_known) return cur->caller;
+    return NULL;
+}
+
+static int header(char *buf, size_t len, int line, const char *name, const char *type, const char *help) {
+    if (line == 0) return snprintf(buf, len, "# HELP %s %s\n", name, help);
+    return snprintf(buf, len, "# TYPE %s %s\n", name, type);
+}
+
+// Escreve a linha 'cur->line' da família atual. Retorna -1 se a família acabou.
+static int render_line(const metrics_cursor_t *cur, char *buf, size_t len) {
+    int line = cur->line;
+    switch (cur->family) {
+        case FAMILY_HEAP_FREE:
+            if (line < 2) return header(buf, len, line, "co2meter_heap_free_bytes", "gauge", "Free heap.");
+            if (line == 2) return snprintf(buf, len, "co2meter_heap_free_bytes %lu\n",
+                                           (unsigned long)esp_get_free_heap_size());
+            return -1;
+
+        case FAMILY_HEAP_MIN_FREE:
+            if (line < 2) return header(buf, len, line, "co2meter_heap_min_free_bytes", "gauge",
+                                        "Minimum free heap since boot.");
+            if (line == 2) return snprintf(buf, len, "co2meter_heap_min_free_bytes %lu\n",
+                                           (unsigned long)esp_get_minimum_free_heap_size());
+            return -1;
+
+        case FAMILY_UPTIME:
+            if (line < 2) return header(buf, len, line, "co2meter_uptime_seconds", "gauge", "Time since boot.");
+            if (line == 2) return snprintf(buf, len, "co2meter_uptime_seconds %.3f\n", esp_timer_get_time() / 1e6);
+            return -1;
+
+        case FAMILY_STAGE_SUMMARY: {
+            if (line < 2) return header(buf, len, line, "co2meter_stage_duration_seconds", "summary",
+                                        "Duration of instrumented stages.");
+            int stage = (line - 2) / STAGE_SUMMARY_LINES;
+            if (stage >= METRIC_COUNT) return -1;
+            metric_hist_t h;
+            metrics_get(stage, &h);
+            const char *name = names[stage];
+            switch ((line - 2) % STAGE_SUMMARY_LINES) {
+                case 0:
+                    return snprintf(buf, len, "co2meter_stage_duration_seconds{stage=\"%s\",quantile=\"0.5\"} %.6f\n",
+                                    name, metrics_quantile_us(&h, 0.5f) / 1e6);
+                case 1:
+                    return snprintf(buf, len, "co2meter_stage_duration_seconds{stage=\"%s\",quantile=\"0.95\"} %.6f\n",
+                                    name, metrics_quantile_us(&h, 0.95f) / 1e6);
+                case 2:
+                    return snprintf(buf, len, "co2meter_stage_duration_seconds_sum{stage=\"%s\"} %.6f\n",
+                                    name, h.sum_us / 1e6);
+                default:
+                    return snprintf(buf, len, "co2meter_stage_duration_seconds_count{stage=\"%s\"} %lu\n",
+                                    name, (unsigned long)h.count);
+            }
+        }
+
+        case FAMILY_STAGE_MAX: {
+            if (line < 2) return header(buf, len, line, "co2meter_stage_duration_max_seconds", "gauge",
+                                        "Longest duration of each stage since boot.");
+            int stage = line - 2;
+            if (stage >= METRIC_COUNT) return -1;
+            metric_hist_t h;
+            metrics_get(stage, &h);
+            return snprintf(buf, len, "co2meter_stage_duration_max_seconds{stage=\"%s\"} %.6f\n",
+                            names[stage], h.max_us / 1e6);
+        }
+
+        case FAMILY_TASK_STACK: {
+            if (line < 2) return header(buf, len, line, "co2meter_task_stack_free_min_bytes", "gauge",
+                                        "Stack high-water mark (minimum free stack) per task.");
+            TaskHandle_t task = task_at(cur, line - 2);
+            if (task == NULL) return -1;
+            return snprintf(buf, len, "co2meter_task_stack_free_min_bytes{task=\"%s\"} %u\n",
+                            pcTaskGetName(task), (unsigned)uxTaskGetStackHighWaterMark(task));
+        }
+
+        // Filas da medição (aquisição -> processamento -> gravação)
+        case FAMILY_QUEUE_DEPTH:
+        case FAMILY_QUEUE_MAX_DEPTH:
+        case FAMILY_QUEUE_STALLS:
+        case FAMILY_QUEUE_DROPPED: {
+            static const struct { const char *name, *type, *help; } fam[] = {
+                { "co2meter_pipeline_queue_depth", "gauge", "Messages waiting in each measurement pipeline queue." },
+                { "co2meter_pipeline_queue_max_depth", "gauge", "Deepest each pipeline queue has been since boot." },
+                { "co2meter_pipeline_queue_full_total", "counter", "Sends that found the pipeline queue full (stalls)." },
+                { "co2meter_pipeline_queue_dropped_total", "counter", "Messages dropped because the pipeline queue was full." },
+            };
+            int f = cur->family - FAMILY_QUEUE_DEPTH;
+            if (line < 2) return header(buf, len, line, fam[f].name, fam[f].type, fam[f].help);
+            int q = line - 2;
+            if (q >= PIPELINE_QUEUE_COUNT) return -1;
+            pipeline_queue_stats_t st;
+            pipeline_get_stats(q, &st);
+            uint32_t v = (f == 0) ? st.depth : (f == 1) ? st.max_depth : (f == 2) ? st.stalls : st.dropped;
+            if (f < 2) {
+                return snprintf(buf, len, "%s{queue=\"%s\",capacity=\"%lu\"} %lu\n", fam[f].name,
+                                pipeline_queue_name(q), (unsigned long)st.capacity, (unsigned long)v);
+            }
+            return snprintf(buf, len, "%s{queue=\"%s\"} %lu\n", fam[f].name, pipeline_queue_name(q), (unsigned long)v);
+        }
+
+        default:
+            return -1;
+    }
+}
+
+size_t metrics_render(metrics_cursor_t *cur, char *buf, size_t len) {
+    size_t used = 0;
+    while (cur->family < FAMILY_COUNT) {
+        int n = render_line(cur, buf + used, len - used);
+        if (n < 0) {
+            cur->family++;
+            cur->line = 0;
+            continue;
+        }
+        if ((size_t)n >= len - used) {
+            break;   // Não coube: fica para a próxima chamada
+        }
+        used += n;
+        cur->line++;
+    }
+    buf[used] = '\0';
+    return used;
+}
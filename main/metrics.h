@@ -0,0 +1,85 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Instrumentação leve por etapa: cada sonda mede um trecho com
+// esp_timer_get_time() e acumula num histograma de memória fixa (buckets
+// logarítmicos, dois por oitava, de 1 µs a ~36 min). Nada é alocado e o
+// custo de uma amostra é um índice por CLZ dentro de uma seção crítica.
+// O endpoint /metrics publica contagem, p50/p95, soma e máximo de cada
+// etapa em texto Prometheus, com o heap livre, o mínimo de pilha das tarefas
+// e a profundidade/paradas das filas da medição (measurement_pipeline.h).
+
+typedef enum {
+    METRIC_CYCLE = 0,            // perform_single_measurement() inteiro
+    METRIC_UART_INSTALL,         // co2_sensor_init() no início do ciclo
+    METRIC_DHT_READ,
+    METRIC_CO2_ROUNDTRIP,        // Uma amostra de todos os canais (pedidos + respostas)
+    METRIC_SAMPLE_LATENESS,      // Atraso de cada amostra em relação ao instante programado
+    METRIC_STATS,                // Mediana, estatísticas e fluxo de um estrato (processamento)
+    METRIC_RECORD_WRITE,         // write_data_record() na tarefa de gravação
+    METRIC_SCHED_MUTEX_WAIT,     // Espera por xSensorMutex a cada leitura da aquisição
+    METRIC_SD_FLUSH,             // Lote do data_logger (fopen/fwrite/fclose)
+    METRIC_SD_SCAN,              // file_catalog_build()
+    METRIC_HTTP_LIST,
+    METRIC_HTTP_FILES_JSON,
+    METRIC_HTTP_DOWNLOAD,
+    METRIC_HTTP_ARCHIVE,
+    METRIC_HTTP_DELETE,
+    METRIC_HTTP_TIME,
+    METRIC_HTTP_METRICS,
+    METRIC_HTTP_TRACE,
+    METRIC_COUNT
+} metric_id_t;
+
+#define METRICS_BUCKETS     64
+#define METRICS_MAX_TASKS   10
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[METRICS_BUCKETS];
+} metric_hist_t;
+
+static inline int64_t metrics_start(void) {
+    return esp_timer_get_time();
+}
+
+void metrics_record(metric_id_t id, int64_t elapsed_us);
+
+static inline void metrics_stop(metric_id_t id, int64_t start_us) {
+    metrics_record(id, esp_timer_get_time() - start_us);
+}
+
+// Cópia consistente de um histograma
+void metrics_get(metric_id_t id, metric_hist_t *out);
+
+// Quantil (0..1) interpolado dentro do bucket; 0 sem amostras.
+uint32_t metrics_quantile_us(const metric_hist_t *h, float q);
+
+const char *metrics_name(metric_id_t id);
+
+// Tarefas cuja pilha mínima aparece em /metrics (a que renderiza também)
+void metrics_register_task(TaskHandle_t task);
+
+// --- Texto Prometheus ---
+typedef struct {
+    int family;
+    int line;
+    TaskHandle_t caller;     // Tarefa que renderiza (o servidor HTTP)
+} metrics_cursor_t;
+
+void metrics_render_begin(metrics_cursor_t *cur);
+
+// Preenche 'buf' com quantas linhas inteiras couberem. Retorna o número
+// de bytes escritos; 0 indica o fim (mesmo contrato de record_csv_render).
+size_t metrics_render(metrics_cursor_t *cur, char *buf, size_t len);
+
+#endif // METRICS_H
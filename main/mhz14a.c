@@ -0,0 +1,141 @@
+#include "mhz14a.h"
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "hal.h"
+
+static const char *TAG = "MHZ14A";
+
+// O RX precisa ser maior que a FIFO de hardware (128 bytes); as respostas
+// têm 9 bytes, então não há motivo para o buffer de 1 KB usado antes.
+#define MHZ14A_RX_BUF_SIZE 256
+
+// Uso de cada UART pelos sensores. Chamadas sempre pela tarefa que detém
+// xSensorMutex, então não há disputa por esta tabela.
+static struct {
+    int users;
+    const mhz14a_t *routed;     // Sensor cujos pinos estão ligados à UART
+    const mhz14a_t *busy;       // Sensor com requisição pendente
+} ports[MHZ14A_MAX_PORTS];
+
+esp_err_t mhz14a_init(mhz14a_t *dev, const mhz14a_config_t *cfg) {
+    if (dev->installed) {
+        return ESP_OK;
+    }
+    if (cfg->uart_port < 0 || cfg->uart_port >= MHZ14A_MAX_PORTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(dev, 0, sizeof(*dev));
+    dev->cfg = *cfg;
+    mhz14a_parser_init(&dev->parser);
+
+    if (ports[cfg->uart_port].users == 0) {
+        esp_err_t err = hal_uart_open(cfg->uart_port, cfg->tx_pin, cfg->rx_pin, MHZ14A_RX_BUF_SIZE);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "UART%d setup failed: %s", cfg->uart_port, esp_err_to_name(err));
+            return err;
+        }
+        ports[cfg->uart_port].routed = dev;
+    }
+    ports[cfg->uart_port].users++;
+
+    dev->installed = true;
+    ESP_LOGI(TAG, "MH-Z14A driver ready on UART%d (TX=%d, RX=%d%s)", cfg->uart_port, cfg->tx_pin, cfg->rx_pin,
+             ports[cfg->uart_port].users > 1 ? ", shared" : "");
+    return ESP_OK;
+}
+
+void mhz14a_deinit(mhz14a_t *dev) {
+    if (!dev->installed) {
+        return;
+    }
+    int port = dev->cfg.uart_port;
+    if (ports[port].routed == dev) ports[port].routed = NULL;
+    if (ports[port].busy == dev) ports[port].busy = NULL;
+    if (--ports[port].users == 0) {
+        hal_uart_close(port);
+    }
+    dev->installed = false;
+    dev->pending = false;
+}
+
+bool mhz14a_port_busy(const mhz14a_t *dev) {
+    const mhz14a_t *busy = ports[dev->cfg.uart_port].busy;
+    return busy != NULL && busy != dev;
+}
+
+esp_err_t mhz14a_request(mhz14a_t *dev, uint32_t timeout_ms) {
+    if (!dev->installed || mhz14a_port_busy(dev)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int port = dev->cfg.uart_port;
+    if (ports[port].routed != dev) {
+        esp_err_t err = hal_uart_set_pins(port, dev->cfg.tx_pin, dev->cfg.rx_pin);
+        if (err != ESP_OK) {
+            return err;
+        }
+        ports[port].routed = dev;
+    }
+
+    // Respostas atrasadas de requisições anteriores não podem ser
+    // confundidas com a resposta deste comando.
+    hal_uart_flush_input(dev->cfg.uart_port);
+    mhz14a_parser_reset(&dev->parser);
+
+    uint8_t cmd[MHZ14A_FRAME_LEN];
+    mhz14a_build_read_cmd(cmd);
+    if (hal_uart_write(dev->cfg.uart_port, cmd, sizeof(cmd)) != sizeof(cmd)) {
+        return ESP_FAIL;
+    }
+
+    dev->pending = true;
+    dev->request_us = esp_timer_get_time();
+    dev->deadline_us = dev->request_us + (int64_t)timeout_ms * 1000;
+    ports[port].busy = dev;
+    return ESP_OK;
+}
+
+esp_err_t mhz14a_poll(mhz14a_t *dev, int *ppm, TickType_t wait) {
+    if (!dev->pending) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Pede apenas os bytes que faltam para fechar um quadro, assim a
+    // leitura retorna assim que a resposta chega.
+    uint8_t buf[MHZ14A_FRAME_LEN];
+    size_t wanted = MHZ14A_FRAME_LEN - dev->parser.len;
+    int len = hal_uart_read(dev->cfg.uart_port, buf, wanted, wait);
+
+    for (int i = 0; i < len; i++) {
+        if (mhz14a_parser_push(&dev->parser, buf[i], ppm)) {
+            dev->pending = false;
+            ports[dev->cfg.uart_port].busy = NULL;
+            return ESP_OK;
+        }
+    }
+
+    if (esp_timer_get_time() >= dev->deadline_us) {
+        dev->pending = false;
+        ports[dev->cfg.uart_port].busy = NULL;
+        dev->timeouts++;
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_ERR_NOT_FINISHED;
+}
+
+esp_err_t mhz14a_read_ppm(mhz14a_t *dev, int *ppm, uint32_t timeout_ms) {
+    esp_err_t err = mhz14a_request(dev, timeout_ms);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    do {
+        int64_t remaining_us = dev->deadline_us - esp_timer_get_time();
+        TickType_t wait = remaining_us > 0 ? pdMS_TO_TICKS(remaining_us / 1000) + 1 : 0;
+        err = mhz14a_poll(dev, ppm, wait);
+    } while (err == ESP_ERR_NOT_FINISHED);
+
+    return err;
+}
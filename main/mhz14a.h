@@ -0,0 +1,55 @@
+#ifndef MHZ14A_H
+#define MHZ14A_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "mhz14a_protocol.h"
+
+// Driver de longa duração do MH-Z14A: a UART é configurada uma única vez
+// e as leituras usam uma API de requisição/resposta não bloqueante.
+// Vários sensores podem dividir uma UART com pinos diferentes (a matriz de
+// GPIO reencaminha a UART a cada requisição); só um deles pode ter uma
+// requisição pendente por vez. Cada dispositivo tem seu próprio parser.
+
+#define MHZ14A_MAX_PORTS 3
+
+typedef struct {
+    int uart_port;
+    int tx_pin;
+    int rx_pin;
+} mhz14a_config_t;
+
+typedef struct {
+    mhz14a_config_t cfg;
+    mhz14a_parser_t parser;
+    bool installed;
+    bool pending;            // Há um comando aguardando resposta
+    int64_t request_us;      // Envio do último comando (instante da amostra)
+    int64_t deadline_us;     // Prazo da requisição pendente (esp_timer)
+    uint32_t timeouts;
+} mhz14a_t;
+
+// Configura e instala o driver da UART (idempotente). Se outro sensor já
+// abriu a mesma UART, apenas passa a compartilhá-la.
+esp_err_t mhz14a_init(mhz14a_t *dev, const mhz14a_config_t *cfg);
+void mhz14a_deinit(mhz14a_t *dev);
+
+// A UART do dispositivo está ocupada por uma requisição de outro sensor
+bool mhz14a_port_busy(const mhz14a_t *dev);
+
+// Liga os pinos do dispositivo à UART, se preciso, descarta bytes antigos
+// do RX e envia o comando de leitura. ESP_ERR_INVALID_STATE se a UART
+// estiver ocupada (mhz14a_port_busy) ou o driver não estiver instalado.
+esp_err_t mhz14a_request(mhz14a_t *dev, uint32_t timeout_ms);
+
+// Consome os bytes disponíveis, esperando no máximo 'wait' ticks.
+// ESP_OK: resposta válida em *ppm | ESP_ERR_NOT_FINISHED: ainda aguardando
+// ESP_ERR_TIMEOUT: prazo da requisição esgotado | ESP_ERR_INVALID_STATE: sem requisição
+esp_err_t mhz14a_poll(mhz14a_t *dev, int *ppm, TickType_t wait);
+
+// Atalho bloqueante: requisição + espera pela resposta.
+esp_err_t mhz14a_read_ppm(mhz14a_t *dev, int *ppm, uint32_t timeout_ms);
+
+#endif // MHZ14A_H
@@ -0,0 +1,77 @@
+#include "mhz14a_protocol.h"
+#include <string.h>
+
+uint8_t mhz14a_checksum(const uint8_t *frame) {
+    uint8_t sum = 0;
+    for (int i = 1; i < MHZ14A_FRAME_LEN - 1; i++) {
+        sum += frame[i];
+    }
+    return (uint8_t)(~sum + 1);
+}
+
+void mhz14a_build_read_cmd(uint8_t cmd[MHZ14A_FRAME_LEN]) {
+    memset(cmd, 0, MHZ14A_FRAME_LEN);
+    cmd[0] = MHZ14A_START_BYTE;
+    cmd[1] = 0x01; // Endereço do sensor
+    cmd[2] = MHZ14A_CMD_READ_CO2;
+    cmd[MHZ14A_FRAME_LEN - 1] = mhz14a_checksum(cmd);
+}
+
+void mhz14a_parser_init(mhz14a_parser_t *p) {
+    memset(p, 0, sizeof(*p));
+}
+
+void mhz14a_parser_reset(mhz14a_parser_t *p) {
+    p->bytes_discarded += p->len;
+    p->len = 0;
+}
+
+bool mhz14a_parser_push(mhz14a_parser_t *p, uint8_t byte, int *ppm) {
+    // 1. Procura o início do quadro
+    if (p->len == 0) {
+        if (byte != MHZ14A_START_BYTE) {
+            p->bytes_discarded++;
+            return false;
+        }
+        p->frame[p->len++] = byte;
+        return false;
+    }
+
+    // 2. O segundo byte precisa ser o eco do comando
+    if (p->len == 1 && byte != MHZ14A_CMD_READ_CO2) {
+        p->bytes_discarded++;
+        // Um novo 0xFF pode ser o início verdadeiro do quadro
+        if (byte != MHZ14A_START_BYTE) {
+            p->len = 0;
+        }
+        return false;
+    }
+
+    p->frame[p->len++] = byte;
+    if (p->len < MHZ14A_FRAME_LEN) {
+        return false;
+    }
+
+    // 3. Quadro completo: valida o checksum
+    if (mhz14a_checksum(p->frame) == p->frame[MHZ14A_FRAME_LEN - 1]) {
+        if (ppm) {
+            *ppm = (p->frame[2] << 8) | p->frame[3];
+        }
+        p->frames_ok++;
+        p->len = 0;
+        return true;
+    }
+
+    // 4. Checksum inválido: descarta o 0xFF inicial e reprocessa o resto,
+    //    pois o início real do quadro pode estar no meio do lixo recebido.
+    //    Oito bytes nunca completam um quadro, então não há recursão profunda.
+    p->checksum_errors++;
+    p->bytes_discarded++;
+    uint8_t tail[MHZ14A_FRAME_LEN - 1];
+    memcpy(tail, &p->frame[1], sizeof(tail));
+    p->len = 0;
+    for (size_t i = 0; i < sizeof(tail); i++) {
+        mhz14a_parser_push(p, tail[i], NULL);
+    }
+    return false;
+}
@@ -0,0 +1,42 @@
+#ifndef MHZ14A_PROTOCOL_H
+#define MHZ14A_PROTOCOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Protocolo serial do MH-Z14A (datasheet, seção "Communication protocol").
+// Este módulo não depende do ESP-IDF: apenas monta comandos e
+// enquadra/valida as respostas a partir de um fluxo de bytes.
+
+#define MHZ14A_FRAME_LEN     9
+#define MHZ14A_START_BYTE    0xFF
+#define MHZ14A_CMD_READ_CO2  0x86
+
+typedef struct {
+    uint8_t frame[MHZ14A_FRAME_LEN];
+    uint8_t len;                 // Bytes já acumulados do quadro atual
+
+    // Contadores de diagnóstico (não são zerados por mhz14a_parser_reset)
+    uint32_t frames_ok;
+    uint32_t checksum_errors;
+    uint32_t bytes_discarded;
+} mhz14a_parser_t;
+
+// Checksum do datasheet: (~(byte1 + ... + byte7)) + 1
+uint8_t mhz14a_checksum(const uint8_t *frame);
+
+// Monta o comando "Read CO2 concentration" (FF 01 86 00 00 00 00 00 79).
+void mhz14a_build_read_cmd(uint8_t cmd[MHZ14A_FRAME_LEN]);
+
+void mhz14a_parser_init(mhz14a_parser_t *p);
+
+// Descarta um quadro parcial (ex.: antes de enviar um novo comando).
+void mhz14a_parser_reset(mhz14a_parser_t *p);
+
+// Alimenta um byte. Retorna true quando um quadro 0xFF 0x86 com checksum
+// válido foi completado; nesse caso *ppm recebe a concentração.
+// Bytes fora de quadro e quadros corrompidos são descartados e o parser
+// se ressincroniza no próximo 0xFF.
+bool mhz14a_parser_push(mhz14a_parser_t *p, uint8_t byte, int *ppm);
+
+#endif // MHZ14A_PROTOCOL_H
@@ -0,0 +1,49 @@
+#include "power_model.h"
+
+#define SECONDS_PER_DAY 86400.0f
+
+void power_profile_default(power_profile_t *p) {
+    p->sleep_ma = 0.15f;         // Módulo ESP32 (a DevKitC com LED/USB-serial gasta bem mais)
+    p->regulator_ma = 5.0f;      // LM2596 sem carga
+    p->active_ma = 45.0f;
+    p->sensor_ma = 85.0f;        // MH-Z14A, corrente média
+    p->boot_s = 1.5f;
+    p->warmup_s = 180.0f;
+    p->measure_s = 65.0f;        // 31 amostras a cada 2 s + DHT + gravação
+    p->battery_mah = 2600.0f;    // 2x 18650 em série
+    p->usable_fraction = 0.8f;
+}
+
+void power_model_project(const schedule_t *s, const power_profile_t *p, time_t day_start, power_projection_t *out) {
+    float cycle_s = p->boot_s + p->warmup_s + p->measure_s;
+    float awake_s = 0.0f, sensor_s = 0.0f;
+    uint32_t slots = 0;
+
+    // Percorre os horários do dia; se dois horários estão mais próximos
+    // que um ciclo, o aparelho nem chega a dormir entre eles.
+    time_t end = day_start + (time_t)SECONDS_PER_DAY;
+    time_t from = day_start, prev = 0, slot;
+    uint8_t turno;
+    while (schedule_next_slot(s, from, &slot, &turno) && slot < end) {
+        float span = cycle_s;
+        if (prev != 0 && (float)(slot - prev) < span) {
+            span = (float)(slot - prev);
+        }
+        awake_s += span;
+        sensor_s += span - p->boot_s > 0 ? span - p->boot_s : 0;
+        slots++;
+        prev = slot;
+        from = slot + 1;
+    }
+
+    float sleep_s = SECONDS_PER_DAY - awake_s;
+    float mas = sleep_s * p->sleep_ma + awake_s * p->active_ma + sensor_s * p->sensor_ma +
+                SECONDS_PER_DAY * p->regulator_ma;
+
+    out->slots_per_day = slots;
+    out->awake_s_per_day = awake_s;
+    out->duty_cycle = awake_s / SECONDS_PER_DAY;
+    out->avg_ma = mas / SECONDS_PER_DAY;
+    out->mah_per_day = mas / 3600.0f;
+    out->battery_days = out->mah_per_day > 0 ? p->battery_mah * p->usable_fraction / out->mah_per_day : 0;
+}
@@ -0,0 +1,42 @@
+#ifndef POWER_MODEL_H
+#define POWER_MODEL_H
+
+#include <stdint.h>
+#include <time.h>
+#include "schedule.h"
+
+// Projeção de consumo do modo de baixo consumo (deep sleep entre medições)
+// para uma agenda. Cada medição custa: boot + aquecimento do MH-Z14A +
+// coleta; o resto do dia o ESP32 dorme. Este módulo não depende do ESP-IDF
+// e também roda no PC (tools/power_sim.c).
+//
+// Correntes referidas à bateria. Os valores padrão são de referência
+// (datasheets); meça a placa real para uma projeção confiável.
+
+typedef struct {
+    float sleep_ma;          // ESP32 em deep sleep + periféricos em repouso
+    float regulator_ma;      // Corrente quiescente do regulador (sempre presente)
+    float active_ma;         // CPU acordada, rádio desligado, SD montado
+    float sensor_ma;         // MH-Z14A ligado (aquecimento e coleta)
+    float boot_s;            // Do despertar até a agenda ser avaliada
+    float warmup_s;          // Aquecimento do sensor antes do horário
+    float measure_s;         // Coleta + estatística + gravação
+    float battery_mah;
+    float usable_fraction;   // Fração aproveitável da capacidade nominal
+} power_profile_t;
+
+typedef struct {
+    uint32_t slots_per_day;
+    float awake_s_per_day;
+    float duty_cycle;        // Fração do dia acordado
+    float avg_ma;
+    float mah_per_day;
+    float battery_days;
+} power_projection_t;
+
+void power_profile_default(power_profile_t *p);
+
+// Simula o dia que começa em 'day_start' (meia-noite local).
+void power_model_project(const schedule_t *s, const power_profile_t *p, time_t day_start, power_projection_t *out);
+
+#endif // POWER_MODEL_H
@@ -0,0 +1,321 @@
+#include "record_store.h"
+#include "co2_flux.h"
+#include <string.h>
+
+static const char *ESTRATO_NAMES[ESTRATO_COUNT] = { "Superior", "Medio", "Inferior" };
+static const char *TURNO_NAMES[TURNO_COUNT] = { "Desconhecido", "Manha", "Zenite", "Entardecer" };
+
+// Tabela do CRC-32 (polinômio 0xEDB88320, o mesmo do zlib/zip)
+static const uint32_t CRC32_TABLE[256] = {
+    0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F,
+    0xE963A535, 0x9E6495A3, 0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
+    0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91, 0x1DB71064, 0x6AB020F2,
+    0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+    0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9,
+    0xFA0F3D63, 0x8D080DF5, 0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
+    0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 0x35B5A8FA, 0x42B2986C,
+    0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+    0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423,
+    0xCFBA9599, 0xB8BDA50F, 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
+    0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D, 0x76DC4190, 0x01DB7106,
+    0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+    0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D,
+    0x91646C97, 0xE6635C01, 0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
+    0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 0x65B0D9C6, 0x12B7E950,
+    0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+    0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7,
+    0xA4D1C46D, 0xD3D6F4FB, 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
+    0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9, 0x5005713C, 0x270241AA,
+    0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+    0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81,
+    0xB7BD5C3B, 0xC0BA6CAD, 0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
+    0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683, 0xE3630B12, 0x94643B84,
+    0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+    0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB,
+    0x196C3671, 0x6E6B06E7, 0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
+    0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5, 0xD6D6A3E8, 0xA1D1937E,
+    0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+    0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55,
+    0x316E8EEF, 0x4669BE79, 0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
+    0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 0xC5BA3BBE, 0xB2BD0B28,
+    0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+    0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F,
+    0x72076785, 0x05005713, 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
+    0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21, 0x86D3D2D4, 0xF1D4E242,
+    0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+    0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69,
+    0x616BFFD3, 0x166CCF45, 0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
+    0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 0xAED16A4A, 0xD9D65ADC,
+    0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+    0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693,
+    0x54DE5729, 0x23D967BF, 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
+    0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
+};
+
+const char *record_estrato_name(uint8_t id) {
+    return id < ESTRATO_COUNT ? ESTRATO_NAMES[id] : "Desconhecido";
+}
+
+uint8_t record_estrato_id(const char *name) {
+    for (uint8_t i = 0; i < ESTRATO_COUNT; i++) {
+        if (strcmp(name, ESTRATO_NAMES[i]) == 0) return i;
+    }
+    return ESTRATO_COUNT;
+}
+
+const char *record_turno_name(uint8_t id) {
+    return id < TURNO_COUNT ? TURNO_NAMES[id] : TURNO_NAMES[TURNO_DESCONHECIDO];
+}
+
+uint8_t record_turno_id(const char *name) {
+    for (uint8_t i = 0; i < TURNO_COUNT; i++) {
+        if (strcmp(name, TURNO_NAMES[i]) == 0) return i;
+    }
+    return TURNO_DESCONHECIDO;
+}
+
+uint16_t record_crc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+uint32_t record_crc32(uint32_t crc, const uint8_t *data, size_t len) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = CRC32_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void record_seal(record_t *rec) {
+    rec->crc = record_crc16((const uint8_t *)rec + sizeof(rec->crc), sizeof(*rec) - sizeof(rec->crc));
+}
+
+void record_file_header_init(record_file_header_t *hdr, uint8_t estrato_id, time_t created) {
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = RECORD_STORE_MAGIC;
+    hdr->version = RECORD_STORE_VERSION;
+    hdr->header_size = sizeof(record_file_header_t);
+    hdr->record_size = sizeof(record_t);
+    hdr->estrato_id = estrato_id;
+    hdr->created = (uint32_t)created;
+    hdr->crc = record_crc32(0, (const uint8_t *)hdr, offsetof(record_file_header_t, crc));
+}
+
+bool record_file_header_valid(const record_file_header_t *hdr) {
+    return hdr->magic == RECORD_STORE_MAGIC &&
+           hdr->header_size >= sizeof(record_file_header_t) &&
+           hdr->record_size > sizeof(uint16_t) &&
+           hdr->crc == record_crc32(0, (const uint8_t *)hdr, offsetof(record_file_header_t, crc));
+}
+
+size_t record_store_file_header(const char *filepath, char *buf, size_t len) {
+    if (len < sizeof(record_file_header_t)) {
+        return 0;
+    }
+
+    // Nome no formato .../AAAA-MM-DD-Estrato.dat
+    uint8_t estrato = ESTRATO_COUNT;
+    const char *name = strrchr(filepath, '/');
+    name = name ? name + 1 : filepath;
+    if (strlen(name) > 11) {
+        char estrato_str[16];
+        size_t n = strcspn(name + 11, ".");
+        if (n < sizeof(estrato_str)) {
+            memcpy(estrato_str, name + 11, n);
+            estrato_str[n] = '\0';
+            estrato = record_estrato_id(estrato_str);
+        }
+    }
+
+    record_file_header_t hdr;
+    record_file_header_init(&hdr, estrato, time(NULL));
+    memcpy(buf, &hdr, sizeof(hdr));
+    return sizeof(hdr);
+}
+
+int record_store_file_record_size(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return 0;
+    }
+    record_file_header_t hdr;
+    size_t n = fread(&hdr, 1, sizeof(hdr), f);
+    fclose(f);
+    if (n == 0) {
+        return 0;
+    }
+    return (n == sizeof(hdr) && record_file_header_valid(&hdr)) ? hdr.record_size : -1;
+}
+
+bool record_store_retire_path(const char *path, int record_size, char *out, size_t len) {
+    size_t n = strlen(path);
+    size_t ext = strlen(RECORD_STORE_EXT);
+    if (n <= ext || strcmp(path + n - ext, RECORD_STORE_EXT) != 0) {
+        return false;
+    }
+    int written = snprintf(out, len, "%.*s.r%d"RECORD_STORE_EXT, (int)(n - ext), path, record_size);
+    return written > 0 && (size_t)written < len;
+}
+
+bool record_store_is_binary(const char *filename) {
+    size_t n = strlen(filename);
+    size_t ext = strlen(RECORD_STORE_EXT);
+    return n > ext && strcmp(filename + n - ext, RECORD_STORE_EXT) == 0;
+}
+
+// --- Leitura ---
+
+bool record_reader_open(record_reader_t *rd, const char *path) {
+    memset(rd, 0, sizeof(*rd));
+    rd->file = fopen(path, "rb");
+    if (rd->file == NULL) {
+        return false;
+    }
+
+    if (fread(&rd->header, 1, sizeof(rd->header), rd->file) != sizeof(rd->header) ||
+        !record_file_header_valid(&rd->header)) {
+        record_reader_close(rd);
+        return false;
+    }
+
+    // Um registro incompleto no fim (queda de energia no meio da gravação) é ignorado
+    fseek(rd->file, 0, SEEK_END);
+    long size = ftell(rd->file);
+    rd->count = size > rd->header.header_size ? (uint32_t)(size - rd->header.header_size) / rd->header.record_size : 0;
+    return record_reader_seek(rd, 0);
+}
+
+void record_reader_close(record_reader_t *rd) {
+    if (rd->file) {
+        fclose(rd->file);
+        rd->file = NULL;
+    }
+}
+
+bool record_reader_seek(record_reader_t *rd, uint32_t index) {
+    if (index > rd->count) {
+        return false;
+    }
+    long offset = rd->header.header_size + (long)index * rd->header.record_size;
+    if (fseek(rd->file, offset, SEEK_SET) != 0) {
+        return false;
+    }
+    rd->next = index;
+    return true;
+}
+
+int record_reader_next(record_reader_t *rd, record_t *out) {
+    if (rd->next >= rd->count) {
+        return 0;
+    }
+
+    // Registros de versões anteriores podem ser menores: os campos
+    // ausentes ficam zerados; campos extras de versões futuras são ignorados.
+    uint8_t raw[256];
+    size_t size = rd->header.record_size;
+    if (size > sizeof(raw) || fread(raw, 1, size, rd->file) != size) {
+        rd->next = rd->count;
+        return 0;
+    }
+    rd->next++;
+
+    uint16_t crc;
+    memcpy(&crc, raw, sizeof(crc));
+    if (crc != record_crc16(raw + sizeof(crc), size - sizeof(crc))) {
+        rd->crc_errors++;
+        return -1;
+    }
+
+    memset(out, 0, sizeof(*out));
+    memcpy(out, raw, size < sizeof(*out) ? size : sizeof(*out));
+    return 1;
+}
+
+// --- Renderização CSV ---
+
+int record_csv_header(char *buf, size_t len) {
+    return snprintf(buf, len, "Date;Time;CO2_PPM;Temperatura;Umidade;Estrato;Turno_Medicao;"
+                              "CO2_MAD;CO2_Media_Aparada;CO2_Min;CO2_Max;CO2_DesvPad;Amostras_Validas;"
+                              "Amostras_Coletadas;Fluxo_CO2;Fluxo_R2;Fluxo_Qualidade\n");
+}
+
+int record_csv_line(const record_t *rec, char *buf, size_t len) {
+    time_t ts = rec->timestamp;
+    struct tm timeinfo;
+    localtime_r(&ts, &timeinfo);
+
+    // Campos que registros de versões anteriores não têm ficam vazios
+    char taken[4] = "";
+    if (rec->n_taken > 0) {
+        snprintf(taken, sizeof(taken), "%u", (unsigned)rec->n_taken);
+    }
+
+    int n = snprintf(buf, len, "%04d-%02d-%02d;%02d:%02d:%02d;%d;%.1f;%.1f;%s;%s;%.1f;%.1f;%d;%d;%.1f;%d;%s;",
+                     timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
+                     timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec,
+                     rec->co2_ppm, rec->temperature_c10 / 10.0, rec->humidity_c10 / 10.0,
+                     record_estrato_name(rec->estrato_id), record_turno_name(rec->turno_id),
+                     rec->co2_mad_c10 / 10.0, rec->co2_trimmed_c10 / 10.0,
+                     rec->co2_min, rec->co2_max, rec->co2_stddev_c10 / 10.0, rec->n_valid, taken);
+    if (n < 0 || (size_t)n >= len) {
+        return n;
+    }
+    // Sem fluxo: colunas vazias
+    if (!(rec->flux_flags & CO2_FLUX_COMPUTED)) {
+        return n + snprintf(buf + n, len - n, ";;\n");
+    }
+    return n + snprintf(buf + n, len - n, "%.3f;%.4f;%u\n",
+                        rec->co2_flux_nmol / 1000.0, rec->flux_r2_e4 / 10000.0, (unsigned)rec->flux_flags);
+}
+
+size_t record_csv_render(record_reader_t *rd, char *buf, size_t len) {
+    size_t used = 0;
+
+    while (used < len) {
+        // 1. Termina de copiar a linha que ficou pela metade
+        if (rd->pending_pos < rd->pending_len) {
+            size_t n = rd->pending_len - rd->pending_pos;
+            if (n > len - used) n = len - used;
+            memcpy(buf + used, rd->pending + rd->pending_pos, n);
+            rd->pending_pos += n;
+            used += n;
+            continue;
+        }
+
+        // 2. Gera a próxima linha (cabeçalho primeiro)
+        int n;
+        if (!rd->csv_header_done) {
+            n = record_csv_header(rd->pending, sizeof(rd->pending));
+            rd->csv_header_done = true;
+        } else {
+            record_t rec;
+            int r;
+            while ((r = record_reader_next(rd, &rec)) < 0) {
+                // Registro corrompido: pula
+            }
+            if (r == 0) {
+                break;
+            }
+            n = record_csv_line(&rec, rd->pending, sizeof(rd->pending));
+        }
+        if (n < 0) n = 0;
+        if ((size_t)n >= sizeof(rd->pending)) n = sizeof(rd->pending) - 1;
+        rd->pending_len = n;
+        rd->pending_pos = 0;
+    }
+    return used;
+}
+
+void record_csv_rewind(record_reader_t *rd) {
+    record_reader_seek(rd, 0);
+    rd->csv_header_done = false;
+    rd->pending_len = 0;
+    rd->pending_pos = 0;
+}
@@ -0,0 +1,129 @@
+#ifndef RECORD_STORE_H
+#define RECORD_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Formato binário dos arquivos diários (.dat): um cabeçalho pequeno seguido
+// de registros de tamanho fixo, apenas com append. O CSV só é gerado na hora
+// do download (record_csv_render), tirando a formatação de floats do ciclo
+// de medição. Este módulo não depende do ESP-IDF.
+//
+// Compatibilidade: novos campos são sempre acrescentados ao FIM de record_t.
+// O leitor usa o record_size do cabeçalho e zera os campos que o arquivo não tem.
+// Um arquivo só recebe registros do tamanho do seu cabeçalho: o do dia em que
+// o firmware muda de formato é renomeado (record_store_retire_path).
+
+#define RECORD_STORE_MAGIC      0x42324F43  // "CO2B"
+#define RECORD_STORE_VERSION    1
+#define RECORD_STORE_EXT        ".dat"
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint16_t record_size;
+    uint8_t estrato_id;
+    uint8_t reserved;
+    uint32_t created;        // Hora de criação do arquivo (epoch)
+    uint32_t crc;            // CRC-32 dos campos anteriores
+} record_file_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t crc;            // CRC-16/CCITT dos bytes seguintes do registro
+    uint8_t estrato_id;
+    uint8_t turno_id;
+    uint32_t timestamp;      // Epoch, mesma base de time()
+    int16_t co2_ppm;         // Mediana; -1 = sem leitura válida
+    int16_t temperature_c10; // Décimos de °C
+    uint16_t humidity_c10;   // Décimos de %
+    uint16_t co2_mad_c10;
+    int32_t co2_trimmed_c10;
+    int16_t co2_min;
+    int16_t co2_max;
+    uint16_t co2_stddev_c10;
+    uint8_t n_valid;
+    uint8_t n_taken;         // Amostras pedidas no ciclo (0 = antes da amostragem adaptativa)
+    // Fluxo da câmara (co2_flux.h); zerados em arquivos anteriores
+    int32_t co2_flux_nmol;   // nmol m⁻² s⁻¹ (µmol × 1000)
+    uint16_t flux_r2_e4;     // R² × 10000
+    uint8_t flux_flags;      // CO2_FLUX_*; 0 = sem fluxo
+    uint8_t reserved2;
+} record_t;
+
+typedef enum {
+    ESTRATO_SUPERIOR = 0,
+    ESTRATO_MEDIO,
+    ESTRATO_INFERIOR,
+    ESTRATO_COUNT
+} estrato_id_t;
+
+typedef enum {
+    TURNO_DESCONHECIDO = 0,
+    TURNO_MANHA,
+    TURNO_ZENITE,
+    TURNO_ENTARDECER,
+    TURNO_COUNT
+} turno_id_t;
+
+const char *record_estrato_name(uint8_t id);
+uint8_t record_estrato_id(const char *name);   // ESTRATO_COUNT se desconhecido
+const char *record_turno_name(uint8_t id);
+uint8_t record_turno_id(const char *name);
+
+uint16_t record_crc16(const uint8_t *data, size_t len);
+uint32_t record_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+void record_seal(record_t *rec);
+
+void record_file_header_init(record_file_header_t *hdr, uint8_t estrato_id, time_t created);
+bool record_file_header_valid(const record_file_header_t *hdr);
+
+// Tamanho de registro do arquivo: 0 se ele não existe (ou está vazio),
+// -1 se o cabeçalho é inválido.
+int record_store_file_record_size(const char *path);
+
+// Nome para guardar um arquivo de outro formato: "AAAA-MM-DD-Estrato.dat"
+// vira "AAAA-MM-DD-Estrato.r<tamanho>.dat" (o estrato continua legível).
+bool record_store_retire_path(const char *path, int record_size, char *out, size_t len);
+
+// Header writer para o data_logger: deduz o estrato do nome do arquivo.
+size_t record_store_file_header(const char *filepath, char *buf, size_t len);
+
+// --- Leitura ---
+typedef struct {
+    FILE *file;
+    record_file_header_t header;
+    uint32_t count;          // Registros completos no arquivo
+    uint32_t next;           // Índice do próximo registro a ler
+    uint32_t crc_errors;
+    bool csv_header_done;
+    char pending[192];       // Linha CSV que não coube no último buffer
+    uint16_t pending_len;
+    uint16_t pending_pos;
+} record_reader_t;
+
+bool record_reader_open(record_reader_t *rd, const char *path);
+void record_reader_close(record_reader_t *rd);
+bool record_reader_seek(record_reader_t *rd, uint32_t index);
+
+// 1: registro lido | 0: fim do arquivo | -1: registro corrompido (pulado)
+int record_reader_next(record_reader_t *rd, record_t *out);
+
+// --- Renderização CSV ---
+int record_csv_header(char *buf, size_t len);
+int record_csv_line(const record_t *rec, char *buf, size_t len);
+
+// Preenche 'buf' com o cabeçalho CSV (na primeira chamada) e quantas linhas
+// inteiras couberem. Retorna o número de bytes escritos; 0 indica o fim.
+size_t record_csv_render(record_reader_t *rd, char *buf, size_t len);
+
+// Volta a renderização para o início (cabeçalho CSV incluído).
+void record_csv_rewind(record_reader_t *rd);
+
+bool record_store_is_binary(const char *filename);
+
+#endif // RECORD_STORE_H
@@ -4,6 +4,8 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_sleep.h"
+#include "esp_timer.h"
+#include "hal.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include <string.h>
@@ -19,78 +21,130 @@ static const char *TAG = "DS1302_RTC";
 // Registradores do DS1302
 #define DS1302_SECONDS_REG      0x80
 #define DS1302_WRITE_PROTECT    0x8E
+#define DS1302_CLOCK_BURST      0xBE    // Leitura: 0xBF
+#define DS1302_BURST_LEN        8       // seg, min, hora, dia, mês, dia da semana, ano, WP
 
-#define DS1302_DELAY_US 10
+// Temporização do datasheet para VCC = 2 V (pior caso; a 3,3 V sobra margem):
+// tCC (CE -> primeiro clock) 4 us, tCL/tCH 1000 ns, tCDD (dado válido) 800 ns,
+// tCWH (CE inativo entre transações) 4 us.
+#define DS1302_T_CC_US      4
+#define DS1302_T_CLK_US     1
+#define DS1302_T_CWH_US     4
 
 // Chave NVS para verificar se já foi inicializado
 #define NVS_NAMESPACE "rtc_config"
 #define NVS_KEY_INITIALIZED "rtc_init"
 
+static bool rtc_reseeded = false;   // Hora de compilação gravada nesta partida
+
 static uint8_t bcd_to_dec(uint8_t val) { return (val / 16 * 10) + (val % 16); }
 static uint8_t dec_to_bcd(uint8_t val) { return (val / 10 * 16) + (val % 10); }
 
+// --- TRANSPORTE BIT-BANG ---
+// Um store de registrador por borda (ver hal.h); os três pinos são < 32.
+static inline void io_output(void) { hal_pin_output_enable(DS1302_IO_PIN); }
+static inline void io_input(void)  { hal_pin_output_disable(DS1302_IO_PIN); }
+static inline uint32_t io_read(void) { return hal_pin_read(DS1302_IO_PIN); }
+
+// LSB primeiro; o DS1302 amostra na borda de subida do clock
 static void ds1302_write_byte(uint8_t value) {
-    gpio_set_direction(DS1302_IO_PIN, GPIO_MODE_OUTPUT);
+    io_output();
     for (int i = 0; i < 8; i++) {
-        gpio_set_level(DS1302_IO_PIN, (value >> i) & 1);
-        gpio_set_level(DS1302_CLK_PIN, 1);
-        esp_rom_delay_us(DS1302_DELAY_US);
-        gpio_set_level(DS1302_CLK_PIN, 0);
-        esp_rom_delay_us(DS1302_DELAY_US);
+        if ((value >> i) & 1) hal_pin_high(DS1302_IO_PIN); else hal_pin_low(DS1302_IO_PIN);
+        hal_delay_us(DS1302_T_CLK_US);
+        hal_pin_high(DS1302_CLK_PIN);
+        hal_delay_us(DS1302_T_CLK_US);
+        hal_pin_low(DS1302_CLK_PIN);
     }
 }
 
+// O bit seguinte aparece após cada borda de descida (tCDD)
 static uint8_t ds1302_read_byte(void) {
     uint8_t value = 0;
-    gpio_set_direction(DS1302_IO_PIN, GPIO_MODE_INPUT);
+    io_input();
     for (int i = 0; i < 8; i++) {
-        value |= (gpio_get_level(DS1302_IO_PIN) << i);
-        gpio_set_level(DS1302_CLK_PIN, 1);
-        esp_rom_delay_us(DS1302_DELAY_US);
-        gpio_set_level(DS1302_CLK_PIN, 0);
-        esp_rom_delay_us(DS1302_DELAY_US);
+        hal_delay_us(DS1302_T_CLK_US);
+        value |= io_read() << i;
+        hal_pin_high(DS1302_CLK_PIN);
+        hal_delay_us(DS1302_T_CLK_US);
+        hal_pin_low(DS1302_CLK_PIN);
     }
     return value;
 }
 
+static void ds1302_begin(uint8_t command) {
+    hal_pin_low(DS1302_CLK_PIN);
+    hal_pin_high(DS1302_RST_PIN);
+    hal_delay_us(DS1302_T_CC_US);
+    ds1302_write_byte(command);
+}
+
+static void ds1302_end(void) {
+    hal_pin_low(DS1302_RST_PIN);
+    io_input();
+    hal_delay_us(DS1302_T_CWH_US);
+}
+
 static void ds1302_write_reg(uint8_t reg, uint8_t value) {
-    gpio_set_level(DS1302_RST_PIN, 1);
-    esp_rom_delay_us(DS1302_DELAY_US);
-    ds1302_write_byte(reg & 0xFE); 
+    ds1302_begin(reg & 0xFE);
     ds1302_write_byte(value);
-    esp_rom_delay_us(DS1302_DELAY_US);
-    gpio_set_level(DS1302_RST_PIN, 0);
+    ds1302_end();
 }
 
 static uint8_t ds1302_read_reg(uint8_t reg) {
-    uint8_t value;
-    gpio_set_level(DS1302_RST_PIN, 1);
-    esp_rom_delay_us(DS1302_DELAY_US);
-    ds1302_write_byte(reg | 1); 
-    value = ds1302_read_byte();
-    esp_rom_delay_us(DS1302_DELAY_US);
-    gpio_set_level(DS1302_RST_PIN, 0);
+    ds1302_begin(reg | 1);
+    uint8_t value = ds1302_read_byte();
+    ds1302_end();
     return value;
 }
 
+// Modo burst: os 8 registradores do relógio numa única transação. O
+// DS1302 congela uma cópia da hora ao iniciar a leitura, então não há
+// "rasgo" entre segundos e minutos numa virada.
+static void ds1302_burst_read(uint8_t regs[DS1302_BURST_LEN]) {
+    ds1302_begin(DS1302_CLOCK_BURST | 1);
+    for (int i = 0; i < DS1302_BURST_LEN; i++) {
+        regs[i] = ds1302_read_byte();
+    }
+    ds1302_end();
+}
+
+// O burst de escrita precisa dos 8 bytes, inclusive o de proteção (WP)
+static void ds1302_burst_write(const uint8_t regs[DS1302_BURST_LEN]) {
+    ds1302_begin(DS1302_CLOCK_BURST);
+    for (int i = 0; i < DS1302_BURST_LEN; i++) {
+        ds1302_write_byte(regs[i]);
+    }
+    ds1302_end();
+}
+
 bool read_time_from_ds1302(struct tm *timeinfo) {
     if (!timeinfo) return false;
 
-    uint8_t sec_reg = ds1302_read_reg(0x81);
-    if (sec_reg & 0x80) {
+    uint8_t regs[DS1302_BURST_LEN];
+    ds1302_burst_read(regs);
+    if (regs[0] & 0x80) {
         ESP_LOGE(TAG, "Clock Halt bit is set. RTC time is not reliable.");
         return false;
     }
 
-    timeinfo->tm_sec  = bcd_to_dec(sec_reg & 0x7F); //adiciona 20 segundos para compensar o delay entre a compilacao e o log
-    timeinfo->tm_min  = bcd_to_dec(ds1302_read_reg(0x83) & 0x7F) + 2 ; //remoção de 3 minutos de correção
-    timeinfo->tm_hour = bcd_to_dec(ds1302_read_reg(0x85) & 0x3F);
-    timeinfo->tm_mday = bcd_to_dec(ds1302_read_reg(0x87) & 0x3F);
-    timeinfo->tm_mon  = bcd_to_dec(ds1302_read_reg(0x89) & 0x1F) - 1; 
-    timeinfo->tm_wday = bcd_to_dec(ds1302_read_reg(0x8B) & 0x07) - 1; 
-    timeinfo->tm_year = bcd_to_dec(ds1302_read_reg(0x8D)) + 100; 
+    // Sem offsets fixos: a deriva do cristal é corrigida pelo timekeeping.c
+    timeinfo->tm_sec  = bcd_to_dec(regs[0] & 0x7F);
+    timeinfo->tm_min  = bcd_to_dec(regs[1] & 0x7F);
+    timeinfo->tm_hour = bcd_to_dec(regs[2] & 0x3F);
+    timeinfo->tm_mday = bcd_to_dec(regs[3] & 0x3F);
+    timeinfo->tm_mon  = bcd_to_dec(regs[4] & 0x1F) - 1; 
+    timeinfo->tm_wday = bcd_to_dec(regs[5] & 0x07) - 1; 
+    timeinfo->tm_year = bcd_to_dec(regs[6]) + 100; 
     timeinfo->tm_isdst = -1;
-    
+
+    // Registradores fora da faixa (barramento com ruído, chip sem bateria)
+    if (timeinfo->tm_sec > 59 || timeinfo->tm_min > 59 || timeinfo->tm_hour > 23 ||
+        timeinfo->tm_mday < 1 || timeinfo->tm_mday > 31 || timeinfo->tm_mon < 0 || timeinfo->tm_mon > 11) {
+        ESP_LOGE(TAG, "RTC registers out of range (%02x %02x %02x %02x %02x).",
+                 regs[0], regs[1], regs[2], regs[3], regs[4]);
+        return false;
+    }
     return true;
 }
 
@@ -99,21 +153,84 @@ void set_time_on_ds1302(const struct tm *timeinfo) {
              timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday,
              timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec);
     
+    // Libera a escrita e grava tudo num único burst, que volta a proteger (WP = 0x80)
     ds1302_write_reg(DS1302_WRITE_PROTECT, 0x00);
-    vTaskDelay(pdMS_TO_TICKS(10));
 
-    ds1302_write_reg(0x8C, dec_to_bcd(timeinfo->tm_year - 100));
-    ds1302_write_reg(0x8A, dec_to_bcd(timeinfo->tm_wday + 1));
-    ds1302_write_reg(0x88, dec_to_bcd(timeinfo->tm_mon + 1));
-    ds1302_write_reg(0x86, dec_to_bcd(timeinfo->tm_mday));
-    ds1302_write_reg(0x84, dec_to_bcd(timeinfo->tm_hour));
-    ds1302_write_reg(0x82, dec_to_bcd(timeinfo->tm_min));
-    ds1302_write_reg(0x80, dec_to_bcd(timeinfo->tm_sec) & 0x7F);
-
-    ds1302_write_reg(DS1302_WRITE_PROTECT, 0x80);
+    uint8_t regs[DS1302_BURST_LEN] = {
+        dec_to_bcd(timeinfo->tm_sec) & 0x7F,   // CH = 0: relógio rodando
+        dec_to_bcd(timeinfo->tm_min),
+        dec_to_bcd(timeinfo->tm_hour),         // Modo 24 h
+        dec_to_bcd(timeinfo->tm_mday),
+        dec_to_bcd(timeinfo->tm_mon + 1),
+        dec_to_bcd(timeinfo->tm_wday + 1),
+        dec_to_bcd(timeinfo->tm_year - 100),
+        0x80,
+    };
+    ds1302_burst_write(regs);
     ESP_LOGI(TAG, "RTC time set successfully.");
 }
 
+#ifdef RTC_BENCHMARK
+// --- MICROBENCHMARK ---
+// Compara a leitura antiga (7 transações com gpio_set_level/gpio_get_level
+// e 10 us por meio ciclo) com o burst por registrador. Só compilado com
+// RTC_BENCHMARK; chame rtc_benchmark() após rtc_bus_init(). O co2bench o
+// roda sobre o DS1302 simulado.
+#define LEGACY_DELAY_US 10
+
+static uint8_t legacy_read_reg(uint8_t reg) {
+    uint8_t value = 0;
+    gpio_set_level(DS1302_RST_PIN, 1);
+    esp_rom_delay_us(LEGACY_DELAY_US);
+    gpio_set_direction(DS1302_IO_PIN, GPIO_MODE_OUTPUT);
+    for (int i = 0; i < 8; i++) {
+        gpio_set_level(DS1302_IO_PIN, ((reg | 1) >> i) & 1);
+        gpio_set_level(DS1302_CLK_PIN, 1);
+        esp_rom_delay_us(LEGACY_DELAY_US);
+        gpio_set_level(DS1302_CLK_PIN, 0);
+        esp_rom_delay_us(LEGACY_DELAY_US);
+    }
+    gpio_set_direction(DS1302_IO_PIN, GPIO_MODE_INPUT);
+    for (int i = 0; i < 8; i++) {
+        value |= (gpio_get_level(DS1302_IO_PIN) << i);
+        gpio_set_level(DS1302_CLK_PIN, 1);
+        esp_rom_delay_us(LEGACY_DELAY_US);
+        gpio_set_level(DS1302_CLK_PIN, 0);
+        esp_rom_delay_us(LEGACY_DELAY_US);
+    }
+    esp_rom_delay_us(LEGACY_DELAY_US);
+    gpio_set_level(DS1302_RST_PIN, 0);
+    return value;
+}
+
+void rtc_benchmark(int iterations, int64_t *legacy_us, int64_t *burst_us) {
+    static const uint8_t regs[7] = { 0x81, 0x83, 0x85, 0x87, 0x89, 0x8B, 0x8D };
+    uint8_t burst[DS1302_BURST_LEN];
+    volatile uint8_t sink = 0;
+
+    int64_t t0 = esp_timer_get_time();
+    for (int n = 0; n < iterations; n++) {
+        for (int i = 0; i < 7; i++) sink ^= legacy_read_reg(regs[i]);
+    }
+    // gpio_set_direction() do caminho antigo desabilita a entrada do pino de I/O
+    gpio_set_direction(DS1302_IO_PIN, GPIO_MODE_INPUT_OUTPUT);
+    io_input();
+
+    int64_t t1 = esp_timer_get_time();
+    for (int n = 0; n < iterations; n++) {
+        ds1302_burst_read(burst);
+        sink ^= burst[0];
+    }
+    int64_t t2 = esp_timer_get_time();
+
+    *legacy_us = (t1 - t0) / iterations;
+    *burst_us = (t2 - t1) / iterations;
+    ESP_LOGI(TAG, "Full-time read: legacy %lld us, burst %lld us (%d iterations)",
+             (long long)*legacy_us, (long long)*burst_us, iterations);
+    (void)sink;
+}
+#endif
+
 // Função para verificar se é a primeira inicialização
 bool is_first_boot(void) {
     // Verificar se acordou do deep sleep
@@ -200,6 +317,44 @@ void set_manual_time_rtc(int year, int month, int day, int hour, int minute, int
     set_time_on_ds1302(&manual_time);
 }
 
+void rtc_bus_init(void) {
+    // I/O com entrada sempre habilitada: o transporte só liga/desliga a saída
+    hal_bitbang_init(DS1302_CLK_PIN, DS1302_RST_PIN, DS1302_IO_PIN);
+}
+
+bool rtc_read_epoch(time_t *out) {
+    struct tm timeinfo = {0};
+    if (!read_time_from_ds1302(&timeinfo) || timeinfo.tm_year <= 100) {
+        return false;
+    }
+    // mktime normaliza e converte da hora local gravada no chip
+    *out = mktime(&timeinfo);
+    return *out != (time_t)-1;
+}
+
+bool rtc_read_epoch_aligned(time_t *out) {
+    // O DS1302 só tem resolução de 1 s: espera a troca do registrador de
+    // segundos para saber o instante exato (resolução de um tick)
+    uint8_t first = ds1302_read_reg(0x81);
+    for (int i = 0; i < 120; i++) {
+        vTaskDelay(1);
+        if (ds1302_read_reg(0x81) != first) {
+            return rtc_read_epoch(out);
+        }
+    }
+    return false; // Relógio parado
+}
+
+void rtc_write_epoch(time_t t) {
+    struct tm timeinfo;
+    localtime_r(&t, &timeinfo);
+    set_time_on_ds1302(&timeinfo);
+}
+
+bool rtc_was_reseeded(void) {
+    return rtc_reseeded;
+}
+
 void initialize_rtc(void) {
     // Inicializar NVS se necessário
     esp_err_t ret = nvs_flash_init();
@@ -209,13 +364,7 @@ void initialize_rtc(void) {
     }
     ESP_ERROR_CHECK(ret);
     
-    gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << DS1302_CLK_PIN) | (1ULL << DS1302_RST_PIN),
-        .mode = GPIO_MODE_OUTPUT,
-    };
-    gpio_config(&io_conf);
-    gpio_set_level(DS1302_CLK_PIN, 0);
-    gpio_set_level(DS1302_RST_PIN, 0);
+    rtc_bus_init();
     
     vTaskDelay(pdMS_TO_TICKS(100));
 
@@ -234,31 +383,15 @@ void initialize_rtc(void) {
             ESP_LOGI(TAG, "Primeira inicialização - usando hora de compilação.");
         }
         
-        // Usar hora de compilação
+        // Usar hora de compilação (só para o relógio andar; a hora certa
+        // vem do celular, ver timekeeping.h)
         set_compile_time_to_rtc();
+        rtc_reseeded = true;
     } else {
         ESP_LOGI(TAG, "RTC já inicializado - mantendo hora atual.");
     }
 
-    // Sincronizar sistema com RTC
-    ESP_LOGI(TAG, "Synchronizing system time with RTC...");
-    struct tm timeinfo_from_rtc = {0};
-
-    if (read_time_from_ds1302(&timeinfo_from_rtc)) {
-        if (timeinfo_from_rtc.tm_year > 100) { 
-            time_t t = mktime(&timeinfo_from_rtc);
-            struct timeval now = { .tv_sec = t };
-            settimeofday(&now, NULL);
-            ESP_LOGI(TAG, "System time synchronized with RTC.");
-            char buffer[30];
-            strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo_from_rtc);
-            ESP_LOGI(TAG, "Current RTC time: %s", buffer);
-        } else {
-            ESP_LOGW(TAG, "RTC returned invalid year. System time NOT synchronized.");
-        }
-    } else {
-        ESP_LOGE(TAG, "Failed to read valid time from RTC. System time NOT synchronized.");
-    }
+    // O relógio do sistema é acertado por timekeeping_init(), com a correção de deriva
     // set_manual_time_rtc(2025, 12, 17, 6, 55, 0); // Definir hora manualmente para teste
 }
 
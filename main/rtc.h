@@ -4,15 +4,30 @@
 #include <time.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 // Declaração das funções para que outros arquivos possam usá-las.
 
 void initialize_rtc(void);
+
+// Acesso direto ao DS1302 (hora local gravada no chip, em epoch).
+// A hora "verdadeira", com a deriva corrigida, vem de timekeeping.h.
+void rtc_bus_init(void);
+bool rtc_read_epoch(time_t *out);
+// Espera a virada do segundo (até ~1,2 s) e lê: o retorno vale no instante da virada.
+bool rtc_read_epoch_aligned(time_t *out);
+void rtc_write_epoch(time_t t);
+// true se initialize_rtc() regravou a hora de compilação (relógio parado ou primeira partida)
+bool rtc_was_reseeded(void);
 bool read_time_from_ds1302(struct tm *timeinfo);
 void set_time_on_ds1302(const struct tm *timeinfo);
 void set_compile_time_to_rtc(void);
 void set_manual_time_rtc(int year, int month, int day, int hour, int minute, int second);
 bool is_first_boot(void);
+#ifdef RTC_BENCHMARK
+// Microsegundos por leitura da hora: caminho antigo (7 transações) e burst
+void rtc_benchmark(int iterations, int64_t *legacy_us, int64_t *burst_us);
+#endif
 void get_current_date_time(char *date_str, size_t date_len, char *time_str, size_t time_len);
 void get_current_date_time_filename(char *date_time_str, size_t len);
 
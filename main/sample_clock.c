@@ -0,0 +1,51 @@
+#include "sample_clock.h"
+#include <math.h>
+
+void sample_clock_start(sample_clock_t *clk, uint32_t period_ms, int64_t now_us) {
+    clk->period_us = (int64_t)period_ms * 1000;
+    clk->next_us = now_us;
+    clk->first_us = 0;
+    clk->last_us = 0;
+    clk->count = 0;
+    clk->overruns = 0;
+    clk->lateness_max_us = 0;
+    clk->lateness_sum_us = 0.0;
+    clk->lateness_sq_sum = 0.0;
+}
+
+int64_t sample_clock_mark(sample_clock_t *clk, int64_t t_us) {
+    // Adiantamento (não deveria ocorrer) conta como atraso zero
+    int64_t lateness = t_us - clk->next_us;
+    if (lateness < 0) {
+        lateness = 0;
+    }
+    if (clk->count == 0) {
+        clk->first_us = t_us;
+    }
+    clk->last_us = t_us;
+    clk->count++;
+    if (lateness > clk->lateness_max_us) {
+        clk->lateness_max_us = lateness;
+    }
+    clk->lateness_sum_us += lateness;
+    clk->lateness_sq_sum += (double)lateness * lateness;
+    return lateness;
+}
+
+void sample_clock_advance(sample_clock_t *clk, int64_t now_us) {
+    clk->next_us += clk->period_us;
+    if (clk->next_us <= now_us) {
+        // Perdeu o instante: a grade recomeça agora
+        clk->overruns++;
+        clk->next_us = now_us;
+    }
+}
+
+void sample_clock_stats(const sample_clock_t *clk, sample_clock_stats_t *out) {
+    out->count = clk->count;
+    out->overruns = clk->overruns;
+    out->lateness_max_us = (uint32_t)clk->lateness_max_us;
+    out->period_ms = clk->count > 1 ? (clk->last_us - clk->first_us) / 1000.0f / (clk->count - 1) : 0.0f;
+    out->lateness_mean_us = clk->count > 0 ? (float)(clk->lateness_sum_us / clk->count) : 0.0f;
+    out->lateness_rms_us = clk->count > 0 ? (float)sqrt(clk->lateness_sq_sum / clk->count) : 0.0f;
+}
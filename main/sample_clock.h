@@ -0,0 +1,52 @@
+#ifndef SAMPLE_CLOCK_H
+#define SAMPLE_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Relógio de período fixo para as amostras de um ciclo. Os instantes são
+// absolutos (esp_timer): o instante programado da amostra k é o início mais
+// k períodos, então a latência da UART de uma amostra não empurra as
+// seguintes. O relógio não bloqueia; quem roda o ciclo dorme até next_us.
+// Este módulo não depende do ESP-IDF.
+// Cada amostra marcada acumula o atraso em relação ao seu instante
+// programado; o resumo do ciclo traz o período real e o jitter.
+//
+// Se uma amostra passa do período (timeouts em sequência numa UART
+// compartilhada), o relógio conta um atraso e recomeça a grade no instante
+// atual em vez de disparar amostras em rajada para recuperar o tempo.
+
+typedef struct {
+    int64_t period_us;
+    int64_t next_us;         // Instante programado da próxima amostra
+    int64_t first_us;        // Instantes reais da primeira e da última
+    int64_t last_us;
+    int count;
+    uint32_t overruns;
+    int64_t lateness_max_us;
+    double lateness_sum_us;
+    double lateness_sq_sum;  // Para o RMS
+} sample_clock_t;
+
+typedef struct {
+    int count;
+    float period_ms;         // Média entre a primeira e a última amostra
+    float lateness_mean_us;
+    float lateness_rms_us;
+    uint32_t lateness_max_us;
+    uint32_t overruns;
+} sample_clock_stats_t;
+
+// Primeira amostra programada para 'now_us'
+void sample_clock_start(sample_clock_t *clk, uint32_t period_ms, int64_t now_us);
+
+// Registra que a amostra atual começou em 't_us' (esp_timer_get_time()).
+// Retorna o atraso em relação ao instante programado.
+int64_t sample_clock_mark(sample_clock_t *clk, int64_t t_us);
+
+// Programa a próxima amostra (next_us) depois de uma concluída em 'now_us'.
+void sample_clock_advance(sample_clock_t *clk, int64_t now_us);
+
+void sample_clock_stats(const sample_clock_t *clk, sample_clock_stats_t *out);
+
+#endif // SAMPLE_CLOCK_H
@@ -0,0 +1,163 @@
+#include "schedule.h"
+#include <stdio.h>
+#include <string.h>
+#include "record_store.h"
+
+#define MINUTES_PER_DAY 1440
+
+void schedule_default(schedule_t *s) {
+    schedule_parse(SCHEDULE_DEFAULT_TEXT, s);
+}
+
+static bool parse_span(const char *tok, uint16_t *start, uint16_t *end, int *consumed) {
+    int h1, m1, h2, m2;
+    if (sscanf(tok, "%d:%d-%d:%d%n", &h1, &m1, &h2, &m2, consumed) != 4 ||
+        h1 < 0 || h1 > 24 || m1 < 0 || m1 > 59 || h2 < 0 || h2 > 24 || m2 < 0 || m2 > 59) {
+        return false;
+    }
+    *start = h1 * 60 + m1;
+    *end = h2 * 60 + m2;
+    return *start <= *end && *end <= MINUTES_PER_DAY;
+}
+
+bool schedule_parse(const char *text, schedule_t *out) {
+    schedule_t s;
+    memset(&s, 0, sizeof(s));
+    char buf[256];
+    if (strlen(text) >= sizeof(buf)) {
+        return false;
+    }
+    strcpy(buf, text);
+
+    int field = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(buf, " ", &save); tok != NULL; tok = strtok_r(NULL, " ", &save), field++) {
+        int n = 0;
+        if (field == 0) {
+            // 1. Grade: "período" ou "período+deslocamento"
+            unsigned period, offset = 0;
+            if (sscanf(tok, "%u+%u", &period, &offset) < 1 || period == 0 ||
+                period > MINUTES_PER_DAY || offset >= period) {
+                return false;
+            }
+            s.period_min = period;
+            s.offset_min = offset;
+        } else if (field == 1) {
+            // 2. Período do dia
+            if (!parse_span(tok, &s.day_start_min, &s.day_end_min, &n) || tok[n] != '\0') {
+                return false;
+            }
+        } else {
+            // 3. Janelas, em ordem e sem sobreposição
+            if (s.n_windows == SCHEDULE_MAX_WINDOWS) {
+                return false;
+            }
+            schedule_window_t *w = &s.windows[s.n_windows];
+            if (!parse_span(tok, &w->start_min, &w->end_min, &n)) {
+                return false;
+            }
+            w->turno_id = TURNO_DESCONHECIDO;
+            if (tok[n] == '=') {
+                w->turno_id = record_turno_id(tok + n + 1);
+            } else if (tok[n] != '\0') {
+                return false;
+            }
+            if (s.n_windows > 0 && w->start_min <= s.windows[s.n_windows - 1].end_min) {
+                return false;
+            }
+            s.n_windows++;
+        }
+    }
+    if (field < 3) {
+        return false;
+    }
+    *out = s;
+    return true;
+}
+
+int schedule_format(const schedule_t *s, char *buf, size_t len) {
+    int n = snprintf(buf, len, "%u+%u %02u:%02u-%02u:%02u", s->period_min, s->offset_min,
+                     s->day_start_min / 60, s->day_start_min % 60, s->day_end_min / 60, s->day_end_min % 60);
+    for (int i = 0; i < s->n_windows && n > 0 && (size_t)n < len; i++) {
+        const schedule_window_t *w = &s->windows[i];
+        n += snprintf(buf + n, len - n, " %02u:%02u-%02u:%02u=%s", w->start_min / 60, w->start_min % 60,
+                      w->end_min / 60, w->end_min % 60, record_turno_name(w->turno_id));
+    }
+    return n;
+}
+
+// Primeiro minuto da grade >= 'minute'
+static int grid_ceil(const schedule_t *s, int minute) {
+    if (minute <= s->offset_min) {
+        return s->offset_min;
+    }
+    int k = (minute - s->offset_min + s->period_min - 1) / s->period_min;
+    return s->offset_min + k * s->period_min;
+}
+
+// Primeiro slot do dia com minuto >= 'minute'; -1 se não há mais nenhum
+static int next_slot_in_day(const schedule_t *s, int minute, uint8_t *turno_id) {
+    for (int i = 0; i < s->n_windows; i++) {
+        const schedule_window_t *w = &s->windows[i];
+        // Janela limitada ao período do dia
+        int lo = w->start_min > s->day_start_min ? w->start_min : s->day_start_min;
+        int hi = w->end_min < s->day_end_min - 1 ? w->end_min : s->day_end_min - 1;
+        if (hi < minute || lo > hi) {
+            continue;
+        }
+        int slot = grid_ceil(s, minute > lo ? minute : lo);
+        if (slot <= hi && slot < MINUTES_PER_DAY) {
+            *turno_id = w->turno_id;
+            return slot;
+        }
+    }
+    return -1;
+}
+
+bool schedule_next_slot(const schedule_t *s, time_t from, time_t *slot, uint8_t *turno_id) {
+    struct tm day;
+    localtime_r(&from, &day);
+
+    // Slots caem em minutos cheios: segundos quebrados empurram para o próximo minuto
+    int minute = day.tm_hour * 60 + day.tm_min + (day.tm_sec > 0 ? 1 : 0);
+    int found = next_slot_in_day(s, minute, turno_id);
+    if (found < 0) {
+        // Nada mais hoje: primeiro slot de amanhã (se existir algum)
+        found = next_slot_in_day(s, 0, turno_id);
+        if (found < 0) {
+            return false;
+        }
+        day.tm_mday += 1;
+    }
+
+    // mktime normaliza virada de mês/ano e eventuais mudanças de fuso
+    day.tm_hour = 0;
+    day.tm_min = found;
+    day.tm_sec = 0;
+    day.tm_isdst = -1;
+    *slot = mktime(&day);
+    return true;
+}
+
+// Janela que contém 'minute' (limitada ao período do dia); -1 se nenhuma
+static int window_at(const schedule_t *s, int minute) {
+    for (int i = 0; i < s->n_windows; i++) {
+        const schedule_window_t *w = &s->windows[i];
+        if (minute >= w->start_min && minute <= w->end_min &&
+            minute >= s->day_start_min && minute < s->day_end_min) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool schedule_same_window(const schedule_t *s, time_t a, time_t b) {
+    struct tm ta, tb;
+    localtime_r(&a, &ta);
+    localtime_r(&b, &tb);
+    if (ta.tm_year != tb.tm_year || ta.tm_yday != tb.tm_yday) {
+        return false;
+    }
+    int wa = window_at(s, ta.tm_hour * 60 + ta.tm_min);
+    return wa >= 0 && wa == window_at(s, tb.tm_hour * 60 + tb.tm_min);
+}
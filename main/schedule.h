@@ -0,0 +1,53 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Agenda de medições descrita por uma tabela: período de operação do dia,
+// janelas de medição (cada uma com seu turno) e a grade de minutos
+// (período + deslocamento a partir da meia-noite). O próximo horário é
+// calculado diretamente, sem acordar a cada minuto para testar condições.
+// Este módulo não depende do ESP-IDF; horários são em hora local.
+//
+// Forma textual (guardada na NVS, ver schedule_parse):
+//   "30+0 06:30-22:30 07:00-09:00=Manha 11:00-13:00=Zenite 16:00-18:00=Entardecer"
+//   período+deslocamento, período do dia, janelas[=turno]
+// As janelas incluem o horário final (09:00 ainda mede); o período do dia
+// exclui o horário final (22:30 já não mede).
+
+#define SCHEDULE_MAX_WINDOWS    6
+#define SCHEDULE_DEFAULT_TEXT   "30+0 06:30-22:30 07:00-09:00=Manha 11:00-13:00=Zenite 16:00-18:00=Entardecer"
+
+typedef struct {
+    uint16_t start_min;      // Minuto do dia, inclusive
+    uint16_t end_min;        // Minuto do dia, inclusive
+    uint8_t turno_id;        // turno_id_t (record_store.h)
+} schedule_window_t;
+
+typedef struct {
+    uint16_t period_min;     // Intervalo da grade (1..1440)
+    uint16_t offset_min;     // Deslocamento da grade (< period_min)
+    uint16_t day_start_min;  // Inclusive
+    uint16_t day_end_min;    // Exclusive
+    uint8_t n_windows;
+    schedule_window_t windows[SCHEDULE_MAX_WINDOWS]; // Em ordem crescente
+} schedule_t;
+
+void schedule_default(schedule_t *s);
+
+// Retorna false (e não altera 's') se o texto for inválido.
+bool schedule_parse(const char *text, schedule_t *s);
+int schedule_format(const schedule_t *s, char *buf, size_t len);
+
+// Primeiro horário de medição >= 'from'. Retorna false se a agenda não
+// tem nenhum horário (ex.: janelas fora do período do dia).
+bool schedule_next_slot(const schedule_t *s, time_t from, time_t *slot, uint8_t *turno_id);
+
+// Os dois horários caem na mesma janela do mesmo dia (o sensor pode ficar
+// ligado entre eles).
+bool schedule_same_window(const schedule_t *s, time_t a, time_t b);
+
+#endif // SCHEDULE_H
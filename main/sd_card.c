@@ -5,67 +5,23 @@
 #include <sys/stat.h>
 #include "sd_card.h"
 #include "esp_log.h"
-#include "driver/sdspi_host.h"
-#include "driver/spi_common.h"
-#include "sdmmc_cmd.h"
-#include "esp_vfs_fat.h"
-#include "driver/gpio.h"
+#include "hal.h"
 #include "rtc.h"
+#include "data_logger.h"
+#include "record_store.h"
+#include "file_catalog.h"
 
 static const char *TAG = "SD_CARD";
 
-#define MOUNT_POINT     "/sdcard"
-#define SPI_DMA_CHAN    SDSPI_DEFAULT_DMA
+#define MOUNT_POINT     HAL_SD_MOUNT_POINT
 #define FILE_PATH_MAX   128
-#define PIN_NUM_MISO    GPIO_NUM_19
-#define PIN_NUM_MOSI    GPIO_NUM_21
-#define PIN_NUM_CLK     GPIO_NUM_18
-#define PIN_NUM_CS      GPIO_NUM_5
 
-static sdmmc_card_t *card;
 static FILE *csv_file = NULL;
-static time_t file_start_time = 0;
-
-bool init_sd_card(void) {
-    esp_err_t ret;
 
+bool mount_sd_card(void) {
     ESP_LOGI(TAG, "Initializing SD card");
 
-    // Configuração do host SPI
-    sdmmc_host_t host = SDSPI_HOST_DEFAULT();
-    //host.slot = SPI2_HOST; // ou SPI3_HOST dependendo do seu hardware
-
-    // Configuração do barramento SPI
-    spi_bus_config_t bus_cfg = {
-        .mosi_io_num = PIN_NUM_MOSI,
-        .miso_io_num = PIN_NUM_MISO,
-        .sclk_io_num = PIN_NUM_CLK,
-        .quadwp_io_num = -1, // Não utilizado
-        .quadhd_io_num = -1, // Não utilizado
-        .max_transfer_sz = 4000,
-    };
-
-    ret = spi_bus_initialize(host.slot, &bus_cfg, SDSPI_DEFAULT_DMA);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize SPI bus: %s", esp_err_to_name(ret));
-        return false;
-    }
-
-    // Configuração do dispositivo SD SPI
-    sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
-    slot_config.gpio_cs = PIN_NUM_CS;
-    slot_config.host_id = host.slot;
-
-    // Opções do sistema de arquivos FAT
-    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
-        .format_if_mount_failed = false,
-        .max_files = 5,
-        .allocation_unit_size = 16 * 1024
-    };
-
-    // Monta o sistema de arquivos FAT no cartão SD
-    ret = esp_vfs_fat_sdspi_mount(MOUNT_POINT, &host, &slot_config, &mount_config, &card);
-
+    esp_err_t ret = hal_sd_mount();
     if (ret != ESP_OK) {
         if (ret == ESP_FAIL) {
             ESP_LOGE(TAG, "Failed to mount filesystem. "
@@ -74,12 +30,19 @@ bool init_sd_card(void) {
             ESP_LOGE(TAG, "Failed to initialize the card (%s). "
                      "Make sure SD card lines have pull-up resistors in place.", esp_err_to_name(ret));
         }
-        spi_bus_free(host.slot);
         return false;
     }
 
     ESP_LOGI(TAG, "SD card mounted successfully");
-    sdmmc_card_print_info(stdout, card);
+    return true;
+}
+
+bool init_sd_card(void) {
+    if (!mount_sd_card()) {
+        return false;
+    }
+    // Única varredura do diretório: daqui em diante a listagem vem do índice
+    file_catalog_build(MOUNT_POINT);
     return true;
 }
 
@@ -88,39 +51,72 @@ void get_daily_filename(char *filename, size_t len, const char *estrato) {
     struct tm timeinfo;
     time(&now);
     localtime_r(&now, &timeinfo);
-    // Formato: /sdcard/2026-01-08-estrato.csv
-    snprintf(filename, len, MOUNT_POINT"/%04d-%02d-%02d-%s.csv", 
+    // Formato: /sdcard/2026-01-08-estrato.dat (binário, ver record_store.h)
+    snprintf(filename, len, MOUNT_POINT"/%04d-%02d-%02d-%s"RECORD_STORE_EXT, 
              timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday, estrato);
 }
 
-void write_data_to_csv(const char *data, const char *estrato) {
-    char filepath[128];
+// Arquivos do dia já conferidos neste boot (um por estrato basta)
+#define CHECKED_PATHS 4
+static char checked_paths[CHECKED_PATHS][DATA_LOGGER_PATH_MAX];
+static int checked_next = 0;
+
+// Um arquivo do dia gravado por um firmware com outro tamanho de registro
+// (ou com cabeçalho corrompido) não pode receber registros novos: o leitor
+// usaria o tamanho do cabeçalho. Ele é renomeado e o dia recomeça num
+// arquivo novo. A verificação roda uma vez por arquivo por boot, antes do
+// primeiro registro enfileirado para ele.
+static void retire_incompatible_file(const char *filepath) {
+    for (int i = 0; i < CHECKED_PATHS; i++) {
+        if (strcmp(checked_paths[i], filepath) == 0) {
+            return;
+        }
+    }
+    snprintf(checked_paths[checked_next], DATA_LOGGER_PATH_MAX, "%s", filepath);
+    checked_next = (checked_next + 1) % CHECKED_PATHS;
+
+    int size = record_store_file_record_size(filepath);
+    if (size == 0 || size == (int)sizeof(record_t)) {
+        return;
+    }
+    char retired[DATA_LOGGER_PATH_MAX];
+    if (!record_store_retire_path(filepath, size < 0 ? 0 : size, retired, sizeof(retired))) {
+        return;
+    }
+    if (rename(filepath, retired) != 0) {
+        ESP_LOGE(TAG, "Failed to rename %s (errno %d)", filepath, errno);
+        return;
+    }
+    file_catalog_rename(strrchr(filepath, '/') + 1, strrchr(retired, '/') + 1);
+    ESP_LOGW(TAG, "%s has %d-byte records; moved to %s", filepath, size, retired);
+}
+
+void write_data_record(const record_t *rec, const char *estrato, int stream) {
+    char filepath[DATA_LOGGER_PATH_MAX];
     get_daily_filename(filepath, sizeof(filepath), estrato);
+    retire_incompatible_file(filepath);
 
-    // Verifica se o arquivo existe para decidir se escreve o cabeçalho
-    struct stat st;
-    bool file_exists = (stat(filepath, &st) == 0);
+    record_t sealed = *rec;
+    record_seal(&sealed);
 
-    ESP_LOGI(TAG, "Appending data to file: %s", filepath);
-    
-    // Abre em modo "a" (append) - adiciona ao final
-    FILE *f = fopen(filepath, "a");
-    if (f == NULL) {
-        ESP_LOGE(TAG, "Failed to open file for appending");
+    // O registro entra na fila do data_logger, que grava em lote no SD
+    // (por tamanho, idade ou virada do dia) em vez de abrir o arquivo a cada registro.
+    if (data_logger_append(stream, filepath, &sealed, sizeof(sealed)) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to queue record for %s", filepath);
         return;
     }
+    file_catalog_add_record(strrchr(filepath, '/') + 1, &sealed);
+    ESP_LOGI(TAG, "Record queued for %s", filepath);
+}
 
-    // Se é um arquivo novo (primeira medição do dia), cria o cabeçalho
-    if (!file_exists) {
-        fprintf(f, "Date;Time;CO2_PPM;Temperatura;Umidade;Estrato;Turno_Medicao\n");
+void catalog_queued_record(const char *filepath, const void *data, size_t len) {
+    if (len != sizeof(record_t)) {
+        return;
     }
-
-    // Escreve os dados
-    fprintf(f, "%s", data);
-    
-    // Fecha imediatamente para garantir a gravação no cartão
-    fclose(f);
-    ESP_LOGI(TAG, "Data saved successfully.");
+    record_t rec;
+    memcpy(&rec, data, sizeof(rec));
+    const char *slash = strrchr(filepath, '/');
+    file_catalog_add_record(slash != NULL ? slash + 1 : filepath, &rec);
 }
 
 void close_current_file(void) {
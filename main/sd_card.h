@@ -2,10 +2,20 @@
 #define SD_CARD_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h" 
+#include "record_store.h"
 
 bool init_sd_card(void);
-void write_data_to_csv(const char *data, const char *estrato); 
+// Só monta o cartão, sem montar o índice de arquivos (file_catalog):
+// usado nos despertares do modo de baixo consumo, que não servem a página.
+bool mount_sd_card(void);
+// Enfileira o registro no fluxo 'stream' do data_logger (um por estrato:
+// os arquivos diários de cada estrato são gravados em lotes separados).
+void write_data_record(const record_t *rec, const char *estrato, int stream);
+// Contabiliza no índice de arquivos um registro que voltou à fila do
+// data_logger (recuperado da memória RTC): data_logger_init() a chama.
+void catalog_queued_record(const char *filepath, const void *data, size_t len);
 
 void close_current_file(void);
 
@@ -0,0 +1,133 @@
+#include "sensor_power.h"
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "co2_sensor_task.h"
+
+static const char *TAG = "SENSOR_POWER";
+
+static portMUX_TYPE power_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t warmup_s = CO2_WARMUP_TIME_S;
+static bool powered = false;
+static int64_t on_since_us;      // Início do aquecimento (esp_timer)
+static int64_t accounted_us;     // Até onde o tempo ligado já foi somado
+
+// Tempo ligado do dia; 'day' = AAAAMMDD local (0 = ainda sem dia)
+static uint32_t day;
+static uint32_t day_on_s;
+static int64_t day_on_us_frac;   // Resto em µs abaixo de um segundo
+
+static uint32_t local_day(void) {
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    return (uint32_t)((tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday);
+}
+
+// Soma o tempo ligado desde a última contabilização (ao ligar e desligar;
+// uma sessão que atravessa a meia-noite conta no dia em que termina). Na
+// virada do dia o total anterior vai para o log.
+static void account(void) {
+    int64_t now_us = esp_timer_get_time();
+    uint32_t today = local_day();
+    if (day != 0 && today != day) {
+        ESP_LOGI(TAG, "Sensor on-time on %04lu-%02lu-%02lu: %lu s (%.1f %%)",
+                 (unsigned long)(day / 10000), (unsigned long)(day / 100 % 100), (unsigned long)(day % 100),
+                 (unsigned long)day_on_s, day_on_s / 864.0);
+        day_on_s = 0;
+        day_on_us_frac = 0;
+    }
+    day = today;
+    if (powered) {
+        day_on_us_frac += now_us - accounted_us;
+        day_on_s += (uint32_t)(day_on_us_frac / 1000000);
+        day_on_us_frac %= 1000000;
+    }
+    accounted_us = now_us;
+}
+
+void sensor_power_init(void) {
+    nvs_handle_t nvs;
+    if (nvs_open("config", NVS_READONLY, &nvs) == ESP_OK) {
+        uint32_t value;
+        if (nvs_get_u32(nvs, "warmup_s", &value) == ESP_OK && value > 0) {
+            warmup_s = value;
+        }
+        nvs_close(nvs);
+    }
+#ifdef SENSOR_SEMPRE_LIGADO
+    ESP_LOGI(TAG, "Sensor power always on (warm-up %lu s)", (unsigned long)warmup_s);
+    sensor_power_on();
+#else
+    ESP_LOGI(TAG, "Sensor power gated by the schedule (warm-up %lu s)", (unsigned long)warmup_s);
+    co2_sensor_power_control(false);
+#endif
+}
+
+uint32_t sensor_power_warmup_s(void) {
+    return warmup_s;
+}
+
+// As trocas de energia tomam xSensorMutex: uma leitura rápida que já
+// conferiu sensor_power_ready() termina antes de o pino mudar
+void sensor_power_on(void) {
+    sensor_lock();
+    if (powered) {
+        sensor_unlock();
+        return;
+    }
+    account();
+    co2_sensor_power_control(true);
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&power_lock);
+    powered = true;
+    on_since_us = now_us;
+    portEXIT_CRITICAL(&power_lock);
+    accounted_us = now_us;
+    sensor_unlock();
+    ESP_LOGI(TAG, "Sensor warming up for %lu s", (unsigned long)warmup_s);
+}
+
+void sensor_power_off(void) {
+#ifdef SENSOR_SEMPRE_LIGADO
+    return;
+#endif
+    sensor_lock();
+    if (!powered) {
+        sensor_unlock();
+        return;
+    }
+    account();
+    int64_t on_us = esp_timer_get_time() - on_since_us;
+    portENTER_CRITICAL(&power_lock);
+    powered = false;
+    portEXIT_CRITICAL(&power_lock);
+    co2_sensor_power_control(false);
+    sensor_unlock();
+    ESP_LOGI(TAG, "Sensor off after %lld s (today: %lu s)", (long long)(on_us / 1000000), (unsigned long)day_on_s);
+}
+
+bool sensor_power_is_on(void) {
+    portENTER_CRITICAL(&power_lock);
+    bool on = powered;
+    portEXIT_CRITICAL(&power_lock);
+    return on;
+}
+
+uint32_t sensor_power_warmup_left_s(void) {
+    portENTER_CRITICAL(&power_lock);
+    bool on = powered;
+    int64_t since = on_since_us;
+    portEXIT_CRITICAL(&power_lock);
+    if (!on) {
+        return 0;
+    }
+    int64_t left_us = since + (int64_t)warmup_s * 1000000 - esp_timer_get_time();
+    return left_us > 0 ? (uint32_t)((left_us + 999999) / 1000000) : 0;
+}
+
+bool sensor_power_ready(void) {
+    return sensor_power_is_on() && sensor_power_warmup_left_s() == 0;
+}
@@ -0,0 +1,35 @@
+#ifndef SENSOR_POWER_H
+#define SENSOR_POWER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Energia dos MH-Z14A (CO2_POWER_PIN) controlada pela agenda. O agendador
+// liga o sensor 'warmup' segundos antes de cada horário, mantém ligado
+// entre horários da mesma janela e desliga fora das janelas. Leituras só
+// acontecem com o sensor aquecido: sensor_power_ready() é conferido antes
+// de qualquer leitura rápida e a medição espera o fim do aquecimento.
+//
+// Estados: desligado -> aquecendo (desde sensor_power_on) -> pronto.
+// O tempo ligado é somado por dia e registrado no log na virada do dia.
+
+// #define SENSOR_SEMPRE_LIGADO // Descomente para nunca cortar a energia (ex.: powerbank que desliga com pouca carga)
+
+// Lê o aquecimento da NVS ("config"/"warmup_s", padrão CO2_WARMUP_TIME_S).
+// Com SENSOR_SEMPRE_LIGADO já liga o sensor.
+void sensor_power_init(void);
+
+uint32_t sensor_power_warmup_s(void);
+
+// Liga (idempotente): o aquecimento conta a partir da primeira chamada.
+// Ligar e desligar tomam xSensorMutex; não chame com ele travado.
+void sensor_power_on(void);
+void sensor_power_off(void);
+
+bool sensor_power_is_on(void);
+bool sensor_power_ready(void);
+
+// Segundos que faltam para o fim do aquecimento (0 se pronto ou desligado)
+uint32_t sensor_power_warmup_left_s(void);
+
+#endif // SENSOR_POWER_H
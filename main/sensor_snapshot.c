@@ -0,0 +1,46 @@
+#include "sensor_snapshot.h"
+#include <string.h>
+
+// Contador de sequência: ímpar enquanto o escritor está copiando.
+static struct {
+    uint32_t seq;
+    sensor_reading_t slot;
+} channels[SENSOR_SNAPSHOT_CHANNELS];
+
+#define SNAPSHOT_MAX_RETRIES 100
+
+void sensor_snapshot_publish(int channel, const sensor_reading_t *reading) {
+    if (channel < 0 || channel >= SENSOR_SNAPSHOT_CHANNELS) {
+        return;
+    }
+    uint32_t *seq = &channels[channel].seq;
+    uint32_t s = __atomic_load_n(seq, __ATOMIC_RELAXED);
+    __atomic_store_n(seq, s + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(&channels[channel].slot, reading, sizeof(*reading));
+
+    __atomic_store_n(seq, s + 2, __ATOMIC_RELEASE);
+}
+
+bool sensor_snapshot_read(int channel, sensor_reading_t *out) {
+    if (channel < 0 || channel >= SENSOR_SNAPSHOT_CHANNELS) {
+        return false;
+    }
+    const uint32_t *seq = &channels[channel].seq;
+    // A cópia leva poucos ciclos; se o escritor estiver no meio dela,
+    // basta tentar de novo.
+    for (int i = 0; i < SNAPSHOT_MAX_RETRIES; i++) {
+        uint32_t before = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+        memcpy(out, &channels[channel].slot, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint32_t after = __atomic_load_n(seq, __ATOMIC_RELAXED);
+        if (before == after) {
+            return before != 0;
+        }
+    }
+    return false;
+}
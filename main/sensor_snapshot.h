@@ -0,0 +1,31 @@
+#ifndef SENSOR_SNAPSHOT_H
+#define SENSOR_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Última leitura validada dos sensores, publicada por um seqlock.
+// Há um único escritor por vez (quem detém xSensorMutex) e leitores sem
+// trava: a página web lê o snapshot sem tocar na UART nem no DHT.
+// Um snapshot por canal de medição (estrato).
+
+#define SENSOR_SNAPSHOT_CHANNELS 3
+
+typedef struct {
+    int co2_ppm;            // -1 se ainda não houve leitura válida de CO2
+    float temperature;
+    float humidity;
+    bool co2_valid;
+    bool dht_valid;
+    int64_t co2_time_us;    // esp_timer_get_time() da leitura de CO2
+    int64_t dht_time_us;    // esp_timer_get_time() da leitura do DHT
+} sensor_reading_t;
+
+// Publica uma nova leitura do canal. Chamar apenas com xSensorMutex.
+void sensor_snapshot_publish(int channel, const sensor_reading_t *reading);
+
+// Copia a leitura mais recente do canal. Retorna false se nada foi
+// publicado ainda (ou o canal não existe).
+bool sensor_snapshot_read(int channel, sensor_reading_t *out);
+
+#endif // SENSOR_SNAPSHOT_H
@@ -0,0 +1,352 @@
+#include "timekeeping.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "freertos/semphr.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "rtc.h"
+#include "metrics.h"
+
+static const char *TAG = "TIMEKEEPING";
+
+#define TK_MODEL_MAGIC      0x544B4D31  // "TKM1"
+#define TK_NVS_NAMESPACE    "rtc_config"
+#define TK_NVS_KEY          "model"
+#define TK_MAX_WEIGHT_S     (30 * 24 * 3600)  // Medidas antigas pesam no máximo um mês
+
+// Os tempos seguem a convenção do resto do firmware: o DS1302 guarda a hora
+// local e o "epoch" do sistema é essa hora local tratada como UTC.
+typedef struct {
+    uint32_t magic;
+    uint8_t source;          // timekeeping_source_t
+    uint8_t anchored;        // ref_true/ref_rtc válidos
+    uint16_t reserved;
+    int32_t drift_ppb;       // + = DS1302 adianta
+    uint32_t weight_s;       // Base de tempo acumulada na estimativa
+    int64_t ref_true_ms;     // Âncora: hora verdadeira...
+    int64_t ref_rtc_ms;      // ...e a leitura do DS1302 no mesmo instante
+    int64_t calibrated_at;
+    int64_t referenced_at;
+} tk_model_t;
+
+// Cópia da NVS na memória RTC: o despertar do deep sleep não abre a NVS
+static RTC_DATA_ATTR tk_model_t model;
+
+static SemaphoreHandle_t tk_mutex;      // Protege 'model', 'status' e o DS1302
+static TaskHandle_t notify_task = NULL;
+static bool synced = false;
+static int32_t last_offset_ms = 0;
+static uint32_t resyncs = 0;
+
+// Base para a estimativa contra o cristal do ESP32
+static int64_t crystal_rtc_ms = 0;
+static int64_t crystal_timer_us = 0;
+
+static void model_load(void) {
+    nvs_handle_t nvs;
+    size_t len = sizeof(model);
+    if (nvs_open(TK_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        if (nvs_get_blob(nvs, TK_NVS_KEY, &model, &len) != ESP_OK || len != sizeof(model)) {
+            model.magic = 0;
+        }
+        nvs_close(nvs);
+    } else {
+        model.magic = 0;
+    }
+    if (model.magic != TK_MODEL_MAGIC) {
+        memset(&model, 0, sizeof(model));
+        model.magic = TK_MODEL_MAGIC;
+    }
+}
+
+static void model_save(void) {
+    nvs_handle_t nvs;
+    if (nvs_open(TK_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS to save the drift model");
+        return;
+    }
+    if (nvs_set_blob(nvs, TK_NVS_KEY, &model, sizeof(model)) != ESP_OK || nvs_commit(nvs) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save the drift model");
+    }
+    nvs_close(nvs);
+}
+
+static int64_t rtc_to_true_ms(int64_t rtc_ms) {
+    if (!model.anchored) {
+        return rtc_ms;
+    }
+    double elapsed = (double)(rtc_ms - model.ref_rtc_ms);
+    return model.ref_true_ms + (int64_t)(elapsed / (1.0 + model.drift_ppb * 1e-9));
+}
+
+static void model_anchor(int64_t true_ms, int64_t rtc_ms) {
+    model.ref_true_ms = true_ms;
+    model.ref_rtc_ms = rtc_ms;
+    model.anchored = 1;
+}
+
+// Combina uma nova medida da deriva com a estimativa atual, ponderando pela
+// base de tempo de cada uma. Uma medida contra o celular substitui as
+// estimativas contra o cristal.
+static bool model_update_drift(double measured_ppb, uint32_t interval_s, timekeeping_source_t source, time_t now) {
+    if (measured_ppb > TIMEKEEPING_MAX_DRIFT_PPM * 1000.0 || measured_ppb < -TIMEKEEPING_MAX_DRIFT_PPM * 1000.0) {
+        ESP_LOGW(TAG, "Drift measurement of %.1f ppm rejected (limit %d ppm).",
+                 measured_ppb / 1000.0, TIMEKEEPING_MAX_DRIFT_PPM);
+        return false;
+    }
+    uint32_t prev_weight = model.weight_s;
+    if (source == TIMEKEEPING_SOURCE_PHONE_CAL && model.source != TIMEKEEPING_SOURCE_PHONE_CAL) {
+        prev_weight = 0;
+    }
+    if (prev_weight > TK_MAX_WEIGHT_S) {
+        prev_weight = TK_MAX_WEIGHT_S;
+    }
+    double drift = ((double)model.drift_ppb * prev_weight + measured_ppb * interval_s) / ((double)prev_weight + interval_s);
+
+    ESP_LOGI(TAG, "Drift measured over %lu s: %.2f ppm -> model %.2f ppm (was %.2f ppm).",
+             (unsigned long)interval_s, measured_ppb / 1000.0, drift / 1000.0, model.drift_ppb / 1000.0);
+    model.drift_ppb = (int32_t)drift;
+    model.weight_s = prev_weight + interval_s;
+    model.source = source;
+    model.calibrated_at = now;
+    return true;
+}
+
+// Acerta o relógio do sistema para 'true_ms'. Diferenças pequenas são
+// corrigidas aos poucos por adjtime(), sem saltos no tempo.
+static void set_system_ms(int64_t true_ms, bool allow_slew) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    int64_t delta = true_ms - ((int64_t)now.tv_sec * 1000 + now.tv_usec / 1000);
+    last_offset_ms = (int32_t)delta;
+
+    if (allow_slew && llabs(delta) < TIMEKEEPING_SLEW_MAX_MS) {
+        struct timeval adj = { .tv_sec = delta / 1000, .tv_usec = (delta % 1000) * 1000 };
+        adjtime(&adj, NULL);
+        return;
+    }
+    struct timeval tv = { .tv_sec = true_ms / 1000, .tv_usec = (true_ms % 1000) * 1000 };
+    settimeofday(&tv, NULL);
+    if (synced && notify_task != NULL) {
+        xTaskNotifyGive(notify_task);
+    }
+}
+
+// Leitura na virada do segundo: retorna a hora do DS1302 em ms e o instante
+// da leitura no esp_timer.
+static bool read_rtc_ms(int64_t *rtc_ms, int64_t *at_us) {
+    time_t t;
+    if (!rtc_read_epoch_aligned(&t)) {
+        return false;
+    }
+    *at_us = esp_timer_get_time();
+    *rtc_ms = (int64_t)t * 1000;
+    return true;
+}
+
+// Uma vez por hora: reaplica o modelo e, sem calibração pelo celular, mede
+// a deriva contra o cristal do ESP32.
+static void resync(void) {
+    int64_t rtc_ms, at_us;
+    xSemaphoreTake(tk_mutex, portMAX_DELAY);
+    if (!read_rtc_ms(&rtc_ms, &at_us)) {
+        xSemaphoreGive(tk_mutex);
+        ESP_LOGW(TAG, "DS1302 read failed; keeping the system clock.");
+        return;
+    }
+
+    bool save = false;
+    if (model.source != TIMEKEEPING_SOURCE_PHONE_CAL) {
+        int64_t timer_ms = (at_us - crystal_timer_us) / 1000;
+        if (crystal_timer_us == 0) {
+            crystal_rtc_ms = rtc_ms;
+            crystal_timer_us = at_us;
+        } else if (timer_ms >= (int64_t)TIMEKEEPING_MIN_CAL_S * 1000) {
+            double measured = (double)(rtc_ms - crystal_rtc_ms - timer_ms) / timer_ms * 1e9;
+            // A âncora do celular é mantida (é a base da calibração por ele);
+            // sem âncora, o DS1302 passa a valer como hora certa a partir daqui
+            if (!model.anchored) {
+                model_anchor(rtc_ms, rtc_ms);
+            }
+            save = model_update_drift(measured, (uint32_t)(timer_ms / 1000), TIMEKEEPING_SOURCE_CRYSTAL,
+                                      (time_t)(rtc_to_true_ms(rtc_ms) / 1000));
+            crystal_rtc_ms = rtc_ms;
+            crystal_timer_us = at_us;
+        }
+    }
+
+    set_system_ms(rtc_to_true_ms(rtc_ms) + (esp_timer_get_time() - at_us) / 1000, true);
+    resyncs++;
+    xSemaphoreGive(tk_mutex);
+
+    if (save) {
+        model_save();
+    }
+    if (llabs(last_offset_ms) > 100) {
+        ESP_LOGI(TAG, "System clock corrected by %ld ms.", (long)last_offset_ms);
+    }
+}
+
+static void timekeeping_task(void *arg) {
+    while (1) {
+        vTaskDelay((TickType_t)(TIMEKEEPING_RESYNC_S * configTICK_RATE_HZ));
+        resync();
+    }
+}
+
+static bool create_mutex(void) {
+    if (tk_mutex == NULL) {
+        tk_mutex = xSemaphoreCreateMutex();
+    }
+    return tk_mutex != NULL;
+}
+
+esp_err_t timekeeping_init(void) {
+    if (!create_mutex()) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(tk_mutex, portMAX_DELAY);
+    model_load();
+    if (rtc_was_reseeded() && model.anchored) {
+        // Hora de compilação no DS1302: a âncora não vale mais (a deriva sim)
+        ESP_LOGW(TAG, "RTC was reseeded; waiting for a time reference from the web page.");
+        model.anchored = 0;
+        model_save();
+    }
+
+    int64_t rtc_ms, at_us;
+    if (!read_rtc_ms(&rtc_ms, &at_us)) {
+        xSemaphoreGive(tk_mutex);
+        ESP_LOGE(TAG, "DS1302 is not running; system clock not set.");
+        return ESP_FAIL;
+    }
+    set_system_ms(rtc_to_true_ms(rtc_ms), false);
+    synced = true;
+    crystal_rtc_ms = rtc_ms;
+    crystal_timer_us = at_us;
+    xSemaphoreGive(tk_mutex);
+
+    time_t now = time(NULL);
+    ESP_LOGI(TAG, "System time set: %s", ctime(&now));
+    ESP_LOGI(TAG, "Drift model: %.2f ppm (%s, %lu s of calibration).", model.drift_ppb / 1000.0,
+             timekeeping_source_name(model.anchored ? model.source : TIMEKEEPING_SOURCE_NONE),
+             (unsigned long)model.weight_s);
+    return ESP_OK;
+}
+
+bool timekeeping_resync_fast(void) {
+    if (model.magic != TK_MODEL_MAGIC || !create_mutex()) {
+        return false;
+    }
+    rtc_bus_init();
+    time_t t;
+    if (!rtc_read_epoch(&t)) {
+        return false;
+    }
+    // Sem esperar a virada: o instante real está em algum ponto do segundo lido
+    set_system_ms(rtc_to_true_ms((int64_t)t * 1000 + 500), false);
+    synced = true;
+    return true;
+}
+
+esp_err_t timekeeping_start(TaskHandle_t notify) {
+    notify_task = notify;
+    TaskHandle_t handle = NULL;
+    if (xTaskCreate(timekeeping_task, "TimeSync", 3072, NULL, 3, &handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create TimeSync task");
+        return ESP_ERR_NO_MEM;
+    }
+    metrics_register_task(handle);
+    return ESP_OK;
+}
+
+esp_err_t timekeeping_set_reference(int64_t true_ms, int64_t received_us) {
+    if (tk_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // 1. Leitura do DS1302 na virada do segundo e a referência levada ao mesmo instante
+    int64_t rtc_ms, at_us;
+    xSemaphoreTake(tk_mutex, portMAX_DELAY);
+    if (!read_rtc_ms(&rtc_ms, &at_us)) {
+        xSemaphoreGive(tk_mutex);
+        return ESP_FAIL;
+    }
+    true_ms += (at_us - received_us) / 1000;
+    time_t now = (time_t)(true_ms / 1000);
+
+    // 2. Deriva: só com uma âncora antiga o bastante (o erro de leitura de
+    //    ~1 s some diante de um dia de intervalo)
+    bool anchored_now = false;
+    int64_t interval_ms = true_ms - model.ref_true_ms;
+    if (!model.anchored) {
+        model_anchor(true_ms, rtc_ms);
+        if (model.source == TIMEKEEPING_SOURCE_NONE) {
+            model.source = TIMEKEEPING_SOURCE_PHONE;
+        }
+        anchored_now = true;
+    } else if (interval_ms >= (int64_t)TIMEKEEPING_MIN_CAL_S * 1000) {
+        double measured = (double)((rtc_ms - model.ref_rtc_ms) - interval_ms) / interval_ms * 1e9;
+        model_update_drift(measured, (uint32_t)(interval_ms / 1000), TIMEKEEPING_SOURCE_PHONE_CAL, now);
+        model_anchor(true_ms, rtc_ms);
+        anchored_now = true;
+    }
+    model.referenced_at = now;
+
+    // 3. Regrava o DS1302 quando a âncora acabou de ser refeita (não perde
+    //    uma calibração em andamento) ou quando o erro é grosseiro
+    int64_t rtc_error_ms = rtc_ms - true_ms;
+    if ((anchored_now && llabs(rtc_error_ms) > TIMEKEEPING_RTC_REWRITE_MS) ||
+        llabs(rtc_error_ms) > TIMEKEEPING_RTC_RESET_MS) {
+        // Grava exatamente na virada do segundo verdadeiro
+        int64_t elapsed_ms = (esp_timer_get_time() - at_us) / 1000;
+        int64_t wait_ms = 1000 - (true_ms + elapsed_ms) % 1000;
+        vTaskDelay(pdMS_TO_TICKS(wait_ms));
+        int64_t write_ms = true_ms + (esp_timer_get_time() - at_us) / 1000;
+        write_ms -= write_ms % 1000;
+        rtc_write_epoch((time_t)(write_ms / 1000));
+        model_anchor(write_ms, write_ms);
+        ESP_LOGI(TAG, "DS1302 was off by %lld ms; rewritten.", (long long)rtc_error_ms);
+    }
+
+    // 4. Relógio do sistema direto da referência
+    set_system_ms(true_ms + (esp_timer_get_time() - at_us) / 1000, false);
+    crystal_rtc_ms = 0;
+    crystal_timer_us = 0;
+    xSemaphoreGive(tk_mutex);
+
+    model_save();
+    ESP_LOGI(TAG, "Time reference applied: system offset %ld ms, drift %.2f ppm.",
+             (long)last_offset_ms, model.drift_ppb / 1000.0);
+    return ESP_OK;
+}
+
+void timekeeping_get_status(timekeeping_status_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (tk_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(tk_mutex, portMAX_DELAY);
+    out->source = model.anchored ? (timekeeping_source_t)model.source : TIMEKEEPING_SOURCE_NONE;
+    out->synced = synced;
+    out->drift_ppm = model.drift_ppb / 1000.0f;
+    out->calibration_s = model.weight_s;
+    out->calibrated_at = (time_t)model.calibrated_at;
+    out->referenced_at = (time_t)model.referenced_at;
+    out->last_offset_ms = last_offset_ms;
+    out->resyncs = resyncs;
+    xSemaphoreGive(tk_mutex);
+}
+
+const char *timekeeping_source_name(timekeeping_source_t source) {
+    switch (source) {
+        case TIMEKEEPING_SOURCE_PHONE:     return "celular (deriva não medida)";
+        case TIMEKEEPING_SOURCE_CRYSTAL:   return "cristal do ESP32";
+        case TIMEKEEPING_SOURCE_PHONE_CAL: return "celular";
+        default:                           return "não acertado";
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef TIMEKEEPING_H
+#define TIMEKEEPING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Hora do sistema a partir do DS1302 com a deriva do cristal corrigida.
+// O cristal de 32 kHz do DS1302 erra dezenas de ppm (alguns segundos por
+// dia, conforme a temperatura). Em vez de um offset fixo, o módulo mantém
+// um modelo linear:
+//
+//   hora verdadeira = ref_true + (leitura do RTC - ref_rtc) / (1 + deriva)
+//
+// A deriva é medida comparando o DS1302 com uma referência ao longo de pelo
+// menos TIMEKEEPING_MIN_CAL_S:
+//   - o celular: a página web envia Date.now() em POST /time a cada acesso;
+//   - na falta dele, o cristal do ESP32 (esp_timer) durante um uptime longo.
+// O modelo fica na NVS (namespace "rtc_config") e a correção é aplicada
+// continuamente: a tarefa TimeSync reancora o relógio do sistema a cada
+// TIMEKEEPING_RESYNC_S, com adjtime() para diferenças pequenas.
+
+#define TIMEKEEPING_MIN_CAL_S       (24 * 3600)  // Intervalo mínimo para medir a deriva
+#define TIMEKEEPING_MAX_DRIFT_PPM   200          // Acima disso a medida é descartada
+#define TIMEKEEPING_RESYNC_S        3600
+#define TIMEKEEPING_SLEW_MAX_MS     1000         // Diferenças menores: adjtime (sem saltos)
+#define TIMEKEEPING_RTC_REWRITE_MS  2000         // Erro do DS1302 que justifica regravá-lo
+#define TIMEKEEPING_RTC_RESET_MS    60000        // Erro grosseiro: regrava mesmo sem calibrar
+
+typedef enum {
+    TIMEKEEPING_SOURCE_NONE = 0,   // Hora de compilação / desconhecida
+    TIMEKEEPING_SOURCE_PHONE,      // Acertado pelo celular, deriva ainda não medida
+    TIMEKEEPING_SOURCE_CRYSTAL,    // Deriva estimada contra o cristal do ESP32
+    TIMEKEEPING_SOURCE_PHONE_CAL,  // Deriva medida contra o celular
+} timekeeping_source_t;
+
+typedef struct {
+    timekeeping_source_t source;
+    bool synced;                 // Relógio do sistema já acertado pelo DS1302
+    float drift_ppm;             // + = DS1302 adianta
+    uint32_t calibration_s;      // Base de tempo acumulada na estimativa da deriva
+    time_t calibrated_at;        // Última medida da deriva (0 = nunca)
+    time_t referenced_at;        // Última referência externa (0 = nunca)
+    int32_t last_offset_ms;      // Diferença referência - sistema no último acerto
+    uint32_t resyncs;
+} timekeeping_status_t;
+
+// Carrega o modelo da NVS e acerta o relógio do sistema (espera a virada do
+// segundo do DS1302, até ~1 s). Chamar depois de initialize_rtc().
+esp_err_t timekeeping_init(void);
+
+// Ao acordar do deep sleep: lê o DS1302 sem esperar a virada e aplica o
+// modelo guardado na memória RTC. Retorna false se não há modelo válido
+// (use initialize_rtc() + timekeeping_init()).
+bool timekeeping_resync_fast(void);
+
+// Inicia a tarefa TimeSync. 'notify' (opcional) é notificada quando o
+// relógio do sistema dá um salto, para refazer esperas já calculadas.
+esp_err_t timekeeping_start(TaskHandle_t notify);
+
+// Referência externa: 'true_ms' é a hora verdadeira (epoch em ms) no
+// instante 'received_us' (esp_timer_get_time()). Acerta o sistema, mede a
+// deriva se a âncora anterior tem idade suficiente e regrava o DS1302.
+esp_err_t timekeeping_set_reference(int64_t true_ms, int64_t received_us);
+
+void timekeeping_get_status(timekeeping_status_t *out);
+const char *timekeeping_source_name(timekeeping_source_t source);
+
+#endif // TIMEKEEPING_H
@@ -0,0 +1,174 @@
+#include "trace.h"
+
+#if TRACE_ENABLED
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define TRACE_PID 1
+
+typedef struct {
+    int64_t ts_us;
+    const char *name;
+    uint32_t seq;            // Índice + 1 quando o slot está completo; 0 durante a escrita
+    char phase;              // 'B', 'E' ou 'i'
+    uint8_t core;
+    uint8_t tid;             // 1..TRACE_MAX_TASKS; 0 = tarefas sem slot
+} trace_event_t;
+
+static trace_event_t ring[TRACE_RING_SIZE];
+static uint32_t head;                        // Total de eventos já reservados
+
+static TaskHandle_t task_handles[TRACE_MAX_TASKS];
+static char task_names[TRACE_MAX_TASKS][TRACE_TASK_NAME_LEN];
+static uint32_t task_count;
+
+// Slot da tarefa atual. A primeira vez que uma tarefa aparece ela reserva
+// um slot (incremento atômico) e copia o nome; o handle é publicado por
+// último, então quem lê a tabela nunca vê um nome pela metade.
+static uint8_t task_slot(TaskHandle_t self) {
+    uint32_t n = __atomic_load_n(&task_count, __ATOMIC_ACQUIRE);
+    if (n > TRACE_MAX_TASKS) n = TRACE_MAX_TASKS;
+    for (uint32_t i = 0; i < n; i++) {
+        if (__atomic_load_n(&task_handles[i], __ATOMIC_ACQUIRE) == self) {
+            return (uint8_t)(i + 1);
+        }
+    }
+    if (n >= TRACE_MAX_TASKS) {
+        return 0;
+    }
+    uint32_t i = __atomic_fetch_add(&task_count, 1, __ATOMIC_ACQ_REL);
+    if (i >= TRACE_MAX_TASKS) {
+        return 0;
+    }
+    snprintf(task_names[i], TRACE_TASK_NAME_LEN, "%s", pcTaskGetName(self));
+    __atomic_store_n(&task_handles[i], self, __ATOMIC_RELEASE);
+    return (uint8_t)(i + 1);
+}
+
+void trace_event(const char *name, char phase) {
+    int64_t ts = esp_timer_get_time();
+    uint8_t tid = task_slot(xTaskGetCurrentTaskHandle());
+    uint32_t idx = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    trace_event_t *ev = &ring[idx & (TRACE_RING_SIZE - 1)];
+
+    __atomic_store_n(&ev->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    ev->ts_us = ts;
+    ev->name = name;
+    ev->phase = phase;
+    ev->core = (uint8_t)xPortGetCoreID();
+    ev->tid = tid;
+    __atomic_store_n(&ev->seq, idx + 1, __ATOMIC_RELEASE);
+}
+
+// Cópia do evento 'idx'; falso se o slot foi sobrescrito ou está em escrita
+static bool read_event(uint32_t idx, trace_event_t *out) {
+    const trace_event_t *ev = &ring[idx & (TRACE_RING_SIZE - 1)];
+    if (__atomic_load_n(&ev->seq, __ATOMIC_ACQUIRE) != idx + 1) {
+        return false;
+    }
+    *out = *ev;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&ev->seq, __ATOMIC_RELAXED) == idx + 1;
+}
+
+// --- JSON de trace-event do Chrome ---
+
+enum {
+    STAGE_HEADER = 0,
+    STAGE_PROCESS,
+    STAGE_THREADS,
+    STAGE_EVENTS,
+    STAGE_FOOTER,
+    STAGE_COUNT
+};
+
+void trace_render_begin(trace_cursor_t *cur) {
+    cur->stage = 0;
+    cur->next = 0;
+    cur->end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    cur->first = true;
+}
+
+// Escreve o item 'cur->next' da etapa atual (sem a vírgula separadora).
+// Retorna -1 se a etapa acabou e -2 se o item deve ser pulado.
+static int render_item(const trace_cursor_t *cur, char *buf, size_t len) {
+    switch (cur->stage) {
+        case STAGE_PROCESS:
+            if (cur->next > 0) return -1;
+            return snprintf(buf, len, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"co2meter\"}}",
+                            TRACE_PID);
+
+        case STAGE_THREADS: {
+            uint32_t n = __atomic_load_n(&task_count, __ATOMIC_ACQUIRE);
+            if (cur->next == TRACE_MAX_TASKS && n > TRACE_MAX_TASKS) {
+                return snprintf(buf, len, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"other\"}}",
+                                TRACE_PID);
+            }
+            if (cur->next >= n || cur->next >= TRACE_MAX_TASKS) return -1;
+            if (__atomic_load_n(&task_handles[cur->next], __ATOMIC_ACQUIRE) == NULL) return -2;
+            return snprintf(buf, len, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                            TRACE_PID, (unsigned)(cur->next + 1), task_names[cur->next]);
+        }
+
+        case STAGE_EVENTS: {
+            uint32_t start = (cur->end > TRACE_RING_SIZE) ? cur->end - TRACE_RING_SIZE : 0;
+            uint32_t idx = start + cur->next;
+            if (idx >= cur->end) return -1;
+            trace_event_t ev;
+            if (!read_event(idx, &ev)) return -2;
+            return snprintf(buf, len, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":%d,\"tid\":%u%s,\"args\":{\"core\":%u}}",
+                            ev.name, ev.phase, (long long)ev.ts_us, TRACE_PID, (unsigned)ev.tid,
+                            ev.phase == 'i' ? ",\"s\":\"t\"" : "", (unsigned)ev.core);
+        }
+
+        default:
+            return -1;
+    }
+}
+
+size_t trace_render(trace_cursor_t *cur, char *buf, size_t len) {
+    size_t used = 0;
+    while (cur->stage < STAGE_COUNT) {
+        if (cur->stage == STAGE_HEADER || cur->stage == STAGE_FOOTER) {
+            const char *text = (cur->stage == STAGE_HEADER) ? "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" : "\n]}\n";
+            size_t n = strlen(text);
+            if (n >= len - used) break;
+            memcpy(buf + used, text, n);
+            used += n;
+            cur->stage++;
+            continue;
+        }
+
+        // Vírgula antes de todo objeto menos o primeiro
+        size_t sep = cur->first ? 0 : 2;
+        if (sep >= len - used) break;
+        int n = render_item(cur, buf + used + sep, len - used - sep);
+        if (n == -1) {
+            cur->stage++;
+            cur->next = 0;
+            continue;
+        }
+        if (n == -2) {
+            cur->next++;
+            continue;
+        }
+        if ((size_t)n >= len - used - sep) {
+            break;   // Não coube: fica para a próxima chamada
+        }
+        if (sep) {
+            memcpy(buf + used, ",\n", sep);
+        }
+        used += sep + n;
+        cur->first = false;
+        cur->next++;
+    }
+    buf[used] = '\0';
+    return used;
+}
+
+#endif // TRACE_ENABLED
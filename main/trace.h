@@ -0,0 +1,56 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Rastro de eventos para ver a intercalação entre as tarefas (agendador,
+// serviço do sensor, httpd, logger do SD). Cada evento de início/fim guarda
+// o instante em µs, o núcleo e a tarefa num anel de tamanho fixo; a posição
+// é reservada com um incremento atômico, sem mutex nem seção crítica. O
+// endpoint /trace exporta o anel em JSON de trace-event do Chrome, que abre
+// direto no Perfetto (ui.perfetto.dev) ou em chrome://tracing.
+//
+// Com TRACE_ENABLED 0 as macros somem e trace.c fica vazio (custo zero).
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED       1
+#endif
+
+#define TRACE_RING_SIZE     512     // Eventos guardados (potência de 2)
+#define TRACE_MAX_TASKS     12      // Tarefas com nome próprio no rastro
+#define TRACE_TASK_NAME_LEN 16
+
+#if TRACE_ENABLED
+
+// 'name' precisa ser uma string estática (literal ou metrics_name()):
+// só o ponteiro vai para o anel.
+void trace_event(const char *name, char phase);
+
+#define TRACE_BEGIN(name)   trace_event((name), 'B')
+#define TRACE_END(name)     trace_event((name), 'E')
+#define TRACE_INSTANT(name) trace_event((name), 'i')
+
+typedef struct {
+    int stage;
+    uint32_t next;           // Próximo evento (ou tarefa) a escrever
+    uint32_t end;            // Fim do anel no início da exportação
+    bool first;              // Ainda não escreveu nenhum objeto (vírgulas)
+} trace_cursor_t;
+
+void trace_render_begin(trace_cursor_t *cur);
+
+// Preenche 'buf' com quantos objetos JSON inteiros couberem. Retorna o
+// número de bytes escritos; 0 indica o fim (mesmo contrato de metrics_render).
+size_t trace_render(trace_cursor_t *cur, char *buf, size_t len);
+
+#else
+
+#define TRACE_BEGIN(name)   ((void)0)
+#define TRACE_END(name)     ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+
+#endif // TRACE_ENABLED
+
+#endif // TRACE_H
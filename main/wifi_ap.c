@@ -0,0 +1,312 @@
+#include "wifi_ap.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_attr.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+#include "http_server.h"
+
+static const char *TAG = "WIFI_AP";
+
+#define WIFI_AP_SSID        "ESP32_CO2_MEDIO"
+#define WIFI_AP_PASSWORD    "12345678"
+#define BUTTON_DEBOUNCE_US  300000
+
+static bool initialized = false;
+static bool active = false;
+static httpd_handle_t server_handle = NULL;
+static TaskHandle_t manager_task = NULL;
+static volatile uint8_t stations = 0;
+static volatile int64_t last_station_us = 0;
+static int64_t started_us = 0;
+static uint32_t idle_s = WIFI_AP_IDLE_S;
+
+// Janela diária configurada (minutos do dia; -1 = sem janela)
+static int window_start = -1, window_end = -1;
+
+// Tempo de rádio por dia: atravessa o deep sleep do modo de baixo consumo
+typedef struct {
+    int yday;
+    uint32_t today_s;
+    uint32_t yesterday_s;
+    uint32_t sessions;
+} radio_time_t;
+static RTC_DATA_ATTR radio_time_t radio;
+static SemaphoreHandle_t radio_mutex;     // 'radio' é lido também pela página
+
+static void wifi_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    if (id == WIFI_EVENT_AP_STACONNECTED) {
+        stations++;
+        ESP_LOGI(TAG, "Station connected (%u)", stations);
+    } else if (id == WIFI_EVENT_AP_STADISCONNECTED && stations > 0) {
+        stations--;
+        ESP_LOGI(TAG, "Station disconnected (%u)", stations);
+    }
+    last_station_us = esp_timer_get_time();
+}
+
+static void IRAM_ATTR button_isr(void *arg) {
+    static int64_t last_us = 0;
+    int64_t now = esp_timer_get_time();
+    if (now - last_us < BUTTON_DEBOUNCE_US || manager_task == NULL) {
+        return;
+    }
+    last_us = now;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(manager_task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+// Soma 'seconds' ao dia corrente, virando o contador à meia-noite
+static void radio_account(uint32_t seconds) {
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    xSemaphoreTake(radio_mutex, portMAX_DELAY);
+    if (tm.tm_yday != radio.yday) {
+        radio.yesterday_s = (tm.tm_yday == radio.yday + 1 || (tm.tm_yday == 0 && radio.yday >= 364)) ? radio.today_s : 0;
+        radio.today_s = 0;
+        radio.yday = tm.tm_yday;
+    }
+    radio.today_s += seconds;
+    xSemaphoreGive(radio_mutex);
+}
+
+static void load_config(void) {
+    nvs_handle_t nvs;
+    if (nvs_open("config", NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    uint32_t value;
+    if (nvs_get_u32(nvs, "ap_idle_s", &value) == ESP_OK && value > 0) {
+        idle_s = value;
+    }
+    char text[16];
+    size_t len = sizeof(text);
+    int h1, m1, h2, m2;
+    if (nvs_get_str(nvs, "ap_window", text, &len) == ESP_OK) {
+        if (sscanf(text, "%d:%d-%d:%d", &h1, &m1, &h2, &m2) == 4) {
+            window_start = h1 * 60 + m1;
+            window_end = h2 * 60 + m2;
+        } else {
+            ESP_LOGE(TAG, "Invalid ap_window in NVS: %s", text);
+        }
+    }
+    nvs_close(nvs);
+}
+
+static bool in_window(void) {
+    if (window_start < 0) {
+        return false;
+    }
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    int minute = tm.tm_hour * 60 + tm.tm_min;
+    return minute >= window_start && minute < window_end;
+}
+
+esp_err_t wifi_ap_init(void) {
+    if (initialized) {
+        return ESP_OK;
+    }
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    esp_netif_create_default_wifi_ap();
+
+    radio_mutex = xSemaphoreCreateMutex();
+    if (radio_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event_handler, NULL);
+
+    load_config();
+    initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t wifi_ap_start(const char *reason) {
+    if (active) {
+        return ESP_OK;
+    }
+    wifi_ap_init();
+
+    wifi_config_t wifi_config = {
+        .ap = {
+            .ssid = WIFI_AP_SSID,
+            .ssid_len = strlen(WIFI_AP_SSID),
+            .password = WIFI_AP_PASSWORD,
+            .max_connection = 4,
+            .authmode = WIFI_AUTH_WPA_WPA2_PSK},
+    };
+
+    if (strlen((const char *)wifi_config.ap.password) == 0)
+    {
+        wifi_config.ap.authmode = WIFI_AUTH_OPEN;
+    }
+
+    //sleep 2 segundos para garantir estabilidade
+    vTaskDelay(pdMS_TO_TICKS(2000));
+
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    //sleep 1 segundo para garantir estabilidade
+    vTaskDelay(pdMS_TO_TICKS(1000));
+
+    // Configurações para estabilidade e para MANTER O POWERBANK LIGADO
+    esp_wifi_set_ps(WIFI_PS_NONE); // Desativa economia de energia
+    esp_wifi_set_max_tx_power(78); // Potência máxima (19.5dBm)
+
+    start_http_server(&server_handle);
+
+    active = true;
+    stations = 0;
+    started_us = esp_timer_get_time();
+    last_station_us = started_us;
+    radio_account(0);
+    xSemaphoreTake(radio_mutex, portMAX_DELAY);
+    radio.sessions++;
+    xSemaphoreGive(radio_mutex);
+    ESP_LOGI(TAG, "Access point ON (%s). Idle shutdown after %lu s.", reason, (unsigned long)idle_s);
+    return ESP_OK;
+}
+
+void wifi_ap_stop(void) {
+    if (!active) {
+        return;
+    }
+    stop_http_server(server_handle);
+    server_handle = NULL;
+    esp_wifi_stop();
+    active = false;
+    stations = 0;
+
+    uint32_t on_s = (uint32_t)((esp_timer_get_time() - started_us) / 1000000);
+    radio_account(on_s);
+    wifi_ap_stats_t st;
+    wifi_ap_get_stats(&st);
+    ESP_LOGI(TAG, "Access point OFF after %lu s (radio on today: %lu s).",
+             (unsigned long)on_s, (unsigned long)st.on_today_s);
+}
+
+bool wifi_ap_is_idle(void) {
+    if (!active) {
+        return true;
+    }
+    int open_sockets;
+    int64_t last_http_us;
+    http_server_get_activity(&open_sockets, &last_http_us);
+    if (open_sockets > 0) {
+        return false; // Download em andamento
+    }
+
+    int64_t now = esp_timer_get_time();
+    int64_t last_http = last_http_us > started_us ? last_http_us : started_us;
+    int64_t last_any = last_http > last_station_us ? last_http : last_station_us;
+    if (stations == 0 && now - last_any > (int64_t)idle_s * 1000000) {
+        return true;
+    }
+    return now - last_http > (int64_t)WIFI_AP_MAX_SILENT_S * 1000000;
+}
+
+static void button_init(void) {
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << WIFI_AP_BUTTON_PIN,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    gpio_config(&io_conf);
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) { // INVALID_STATE: já instalado
+        ESP_LOGE(TAG, "Failed to install GPIO ISR service: %s", esp_err_to_name(err));
+        return;
+    }
+    gpio_isr_handler_add(WIFI_AP_BUTTON_PIN, button_isr, NULL);
+}
+
+void wifi_ap_manager(bool on_demand) {
+    manager_task = xTaskGetCurrentTaskHandle();
+    wifi_ap_init();
+    button_init();
+
+    // Sob demanda, a sessão da partida permite conferir a instalação em
+    // campo e se desliga sozinha por ociosidade.
+    wifi_ap_start(on_demand ? "boot" : "always on");
+
+    bool window_served = false;
+    while (1) {
+        bool pressed = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WIFI_AP_CHECK_MS)) > 0;
+        bool window = in_window();
+
+        if (pressed && !active) {
+            wifi_ap_start("button");
+        } else if (window && !window_served && !active) {
+            wifi_ap_start("scheduled window");
+        }
+        window_served = window && (window_served || active);
+
+        // Dentro da janela o AP fica ligado mesmo ocioso
+        if (on_demand && active && !window && wifi_ap_is_idle()) {
+            wifi_ap_stop();
+        }
+    }
+}
+
+bool wifi_ap_session(const char *reason, time_t until) {
+    if (until != 0 && time(NULL) >= until) {
+        ESP_LOGI(TAG, "AP session (%s) deferred: a measurement is due.", reason);
+        return false;
+    }
+    wifi_ap_start(reason);
+    bool done;
+    while (!(done = wifi_ap_is_idle() && !in_window())) {
+        uint32_t wait_ms = WIFI_AP_CHECK_MS;
+        if (until != 0) {
+            // O prazo vale mesmo com clientes conectados ou dentro da janela
+            time_t left = until - time(NULL);
+            if (left <= 0) {
+                ESP_LOGI(TAG, "AP session (%s) cut short: a measurement is due.", reason);
+                break;
+            }
+            if (left < WIFI_AP_CHECK_MS / 1000) {
+                wait_ms = (uint32_t)left * 1000;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(wait_ms));
+    }
+    wifi_ap_stop();
+    return done;
+}
+
+void wifi_ap_get_stats(wifi_ap_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (!initialized) {
+        return;
+    }
+    radio_account(0);
+    xSemaphoreTake(radio_mutex, portMAX_DELAY);
+    out->active = active;
+    out->stations = stations;
+    out->sessions = radio.sessions;
+    out->on_today_s = radio.today_s;
+    out->on_yesterday_s = radio.yesterday_s;
+    xSemaphoreGive(radio_mutex);
+    if (active) {
+        out->on_today_s += (uint32_t)((esp_timer_get_time() - started_us) / 1000000);
+    }
+}
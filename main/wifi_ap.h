@@ -0,0 +1,52 @@
+#ifndef WIFI_AP_H
+#define WIFI_AP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+// Ponto de acesso Wi-Fi + servidor HTTP sob demanda. O AP pode ficar
+// sempre ligado (modo padrão: mantém o power bank acordado) ou ser ligado
+// apenas pelo botão ou por uma janela diária, e desligado sozinho quando
+// fica ocioso: nenhuma estação associada e nenhuma conexão HTTP por
+// 'idle_s' segundos (ou nenhuma requisição por WIFI_AP_MAX_SILENT_S, mesmo
+// com um celular esquecido associado).
+//
+// Configuração na NVS (namespace "config"):
+//   ap_idle_s  (u32)  ociosidade antes de desligar, padrão WIFI_AP_IDLE_S
+//   ap_window  (str)  janela diária "HH:MM-HH:MM" com o AP ligado (opcional)
+
+#define WIFI_AP_BUTTON_PIN      GPIO_NUM_14     // Ativo em nível baixo (pull-up)
+#define WIFI_AP_IDLE_S          300
+#define WIFI_AP_MAX_SILENT_S    1800
+#define WIFI_AP_CHECK_MS        5000
+
+typedef struct {
+    bool active;
+    uint8_t stations;
+    uint32_t sessions;           // Vezes que o AP foi ligado desde a partida
+    uint32_t on_today_s;         // Rádio ligado hoje (inclui a sessão atual)
+    uint32_t on_yesterday_s;
+} wifi_ap_stats_t;
+
+// Netif, loop de eventos e driver Wi-Fi (uma vez; o rádio continua desligado).
+esp_err_t wifi_ap_init(void);
+
+esp_err_t wifi_ap_start(const char *reason);
+void wifi_ap_stop(void);
+bool wifi_ap_is_idle(void);
+
+// Laço de gerenciamento (não retorna). Com 'on_demand' falso o AP fica
+// sempre ligado; caso contrário obedece ao botão, à janela e à ociosidade.
+void wifi_ap_manager(bool on_demand);
+
+// Liga o AP e bloqueia até ele ser desligado por ociosidade (modo de
+// baixo consumo, após despertar pelo botão) ou até 'until' (0 = sem
+// prazo). Retorna false se o prazo cortou a sessão ou não a deixou começar.
+bool wifi_ap_session(const char *reason, time_t until);
+
+void wifi_ap_get_stats(wifi_ap_stats_t *out);
+
+#endif // WIFI_AP_H
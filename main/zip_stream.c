@@ -0,0 +1,174 @@
+#include "zip_stream.h"
+#include <stdlib.h>
+#include <string.h>
+#include "record_store.h"   // record_crc32
+
+#define ZIP_LOCAL_SIG       0x04034b50
+#define ZIP_DESCRIPTOR_SIG  0x08074b50
+#define ZIP_CENTRAL_SIG     0x02014b50
+#define ZIP_END_SIG         0x06054b50
+#define ZIP_VERSION         20          // 2.0: suficiente para "store"
+#define ZIP_FLAG_DESCRIPTOR 0x0008
+#define ZIP_FLAG_UTF8       0x0800
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, v & 0xFFFF);
+    put16(p + 2, v >> 16);
+}
+
+static bool emit(zip_stream_t *zs, const void *data, size_t len) {
+    if (zs->failed) {
+        return false;
+    }
+    if (len > 0 && zs->write(zs->ctx, data, len) != 0) {
+        zs->failed = true;
+        return false;
+    }
+    zs->offset += len;
+    return true;
+}
+
+static void dos_datetime(time_t t, uint16_t *dos_time, uint16_t *dos_date) {
+    struct tm tm;
+    localtime_r(&t, &tm);
+    if (tm.tm_year < 80) {
+        tm.tm_year = 80; // O formato DOS começa em 1980
+    }
+    *dos_time = (tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2);
+    *dos_date = ((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday;
+}
+
+void zip_stream_init(zip_stream_t *zs, zip_write_fn_t write, void *ctx) {
+    memset(zs, 0, sizeof(*zs));
+    zs->write = write;
+    zs->ctx = ctx;
+}
+
+bool zip_stream_begin_file(zip_stream_t *zs, const char *name, time_t mtime) {
+    if (zs->failed || zs->in_file) {
+        return false;
+    }
+
+    // 1. Guarda o nome para o diretório central
+    size_t name_len = strlen(name);
+    if (zs->names_len + name_len > zs->names_cap) {
+        uint32_t cap = zs->names_cap ? zs->names_cap * 2 : 512;
+        while (cap < zs->names_len + name_len) cap *= 2;
+        char *names = realloc(zs->names, cap);
+        if (names == NULL) {
+            zs->failed = true;
+            return false;
+        }
+        zs->names = names;
+        zs->names_cap = cap;
+    }
+    memcpy(zs->names + zs->names_len, name, name_len);
+
+    memset(&zs->current, 0, sizeof(zs->current));
+    zs->current.offset = zs->offset;
+    zs->current.name_len = name_len;
+    zs->current.name_pos = zs->names_len;
+    zs->names_len += name_len;
+    dos_datetime(mtime, &zs->current.dos_time, &zs->current.dos_date);
+
+    // 2. Cabeçalho local com CRC e tamanhos zerados (vêm no descriptor)
+    uint8_t hdr[30] = {0};
+    put32(hdr, ZIP_LOCAL_SIG);
+    put16(hdr + 4, ZIP_VERSION);
+    put16(hdr + 6, ZIP_FLAG_DESCRIPTOR | ZIP_FLAG_UTF8);
+    put16(hdr + 8, 0); // store
+    put16(hdr + 10, zs->current.dos_time);
+    put16(hdr + 12, zs->current.dos_date);
+    put16(hdr + 26, name_len);
+
+    zs->in_file = true;
+    return emit(zs, hdr, sizeof(hdr)) && emit(zs, name, name_len);
+}
+
+bool zip_stream_write(zip_stream_t *zs, const void *data, size_t len) {
+    if (!zs->in_file) {
+        return false;
+    }
+    zs->current.crc = record_crc32(zs->current.crc, data, len);
+    zs->current.size += len;
+    return emit(zs, data, len);
+}
+
+bool zip_stream_end_file(zip_stream_t *zs) {
+    if (!zs->in_file || zs->failed) {
+        return false;
+    }
+    zs->in_file = false;
+
+    uint8_t desc[16];
+    put32(desc, ZIP_DESCRIPTOR_SIG);
+    put32(desc + 4, zs->current.crc);
+    put32(desc + 8, zs->current.size);   // Comprimido == original (store)
+    put32(desc + 12, zs->current.size);
+    if (!emit(zs, desc, sizeof(desc))) {
+        return false;
+    }
+
+    if (zs->count == zs->capacity) {
+        uint16_t cap = zs->capacity ? zs->capacity * 2 : 32;
+        zip_entry_t *entries = realloc(zs->entries, cap * sizeof(zip_entry_t));
+        if (entries == NULL) {
+            zs->failed = true;
+            return false;
+        }
+        zs->entries = entries;
+        zs->capacity = cap;
+    }
+    zs->entries[zs->count++] = zs->current;
+    return true;
+}
+
+bool zip_stream_finish(zip_stream_t *zs) {
+    bool ok = !zs->failed && !zs->in_file;
+    uint32_t central_start = zs->offset;
+
+    for (uint16_t i = 0; ok && i < zs->count; i++) {
+        const zip_entry_t *e = &zs->entries[i];
+        uint8_t hdr[46] = {0};
+        put32(hdr, ZIP_CENTRAL_SIG);
+        put16(hdr + 4, ZIP_VERSION);
+        put16(hdr + 6, ZIP_VERSION);
+        put16(hdr + 8, ZIP_FLAG_DESCRIPTOR | ZIP_FLAG_UTF8);
+        put16(hdr + 10, 0);
+        put16(hdr + 12, e->dos_time);
+        put16(hdr + 14, e->dos_date);
+        put32(hdr + 16, e->crc);
+        put32(hdr + 20, e->size);
+        put32(hdr + 24, e->size);
+        put16(hdr + 28, e->name_len);
+        put32(hdr + 42, e->offset);
+        ok = emit(zs, hdr, sizeof(hdr)) && emit(zs, zs->names + e->name_pos, e->name_len);
+    }
+
+    if (ok) {
+        uint8_t end[22] = {0};
+        put32(end, ZIP_END_SIG);
+        put16(end + 8, zs->count);
+        put16(end + 10, zs->count);
+        put32(end + 12, zs->offset - central_start);
+        put32(end + 16, central_start);
+        ok = emit(zs, end, sizeof(end));
+    }
+
+    zip_stream_free(zs);
+    return ok;
+}
+
+void zip_stream_free(zip_stream_t *zs) {
+    free(zs->entries);
+    free(zs->names);
+    zs->entries = NULL;
+    zs->names = NULL;
+    zs->count = zs->capacity = 0;
+    zs->names_len = zs->names_cap = 0;
+}
@@ -0,0 +1,59 @@
+#ifndef ZIP_STREAM_H
+#define ZIP_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Gerador de arquivo ZIP em fluxo, sem compressão (método "store").
+// Cada entrada é escrita com "data descriptor" (bit 3): o CRC-32 e o
+// tamanho são calculados enquanto os dados passam e enviados depois deles,
+// então nada precisa ser lido duas vezes nem gravado em arquivo temporário.
+// Apenas o diretório central (nomes, CRCs e offsets) fica em RAM.
+// Este módulo não depende do ESP-IDF.
+
+typedef int (*zip_write_fn_t)(void *ctx, const void *data, size_t len);
+
+typedef struct {
+    uint32_t crc;
+    uint32_t size;
+    uint32_t offset;         // Posição do cabeçalho local no arquivo
+    uint16_t dos_time;
+    uint16_t dos_date;
+    uint16_t name_len;
+    uint32_t name_pos;       // Posição do nome em 'names'
+} zip_entry_t;
+
+typedef struct {
+    zip_write_fn_t write;
+    void *ctx;
+    uint32_t offset;         // Bytes já emitidos
+    bool failed;
+
+    zip_entry_t *entries;
+    uint16_t count;
+    uint16_t capacity;
+    char *names;
+    uint32_t names_len;
+    uint32_t names_cap;
+
+    bool in_file;
+    zip_entry_t current;
+} zip_stream_t;
+
+void zip_stream_init(zip_stream_t *zs, zip_write_fn_t write, void *ctx);
+
+// Retornam false em erro de escrita ou falta de memória; depois disso
+// todas as chamadas seguintes também falham.
+bool zip_stream_begin_file(zip_stream_t *zs, const char *name, time_t mtime);
+bool zip_stream_write(zip_stream_t *zs, const void *data, size_t len);
+bool zip_stream_end_file(zip_stream_t *zs);
+
+// Emite o diretório central e libera a memória.
+bool zip_stream_finish(zip_stream_t *zs);
+
+// Libera a memória sem finalizar (transferência abortada).
+void zip_stream_free(zip_stream_t *zs);
+
+#endif // ZIP_STREAM_H
@@ -0,0 +1,584 @@
+// Benchmarks dos caminhos quentes do firmware, rodando o próprio código de
+// main/ sobre o simulador (sem main.c):
+//
+//   - estatística de um ciclo de medição (co2_stats, 31, 61 e 1001 amostras),
+//     ao lado do caminho antigo (qsort + elemento do meio) nos mesmos tamanhos;
+//   - selagem (CRC) e formatação CSV de um registro;
+//   - gravação de um registro pelo caminho do firmware (write_data_record
+//     -> data_logger -> arquivo .dat), com os flushes incluídos;
+//   - página de arquivos (GET /) em função do número de arquivos;
+//   - vazão dos downloads (GET /<arquivo>.dat, convertido em CSV, e /archive),
+//     inclusive a de um arquivo com 365 dias da agenda padrão, em bytes/s;
+//   - leitura da hora do DS1302 simulado (rtc_benchmark), pelo caminho
+//     antigo de 7 transações e em burst, em tempo virtual do barramento.
+//
+//   ./build-sim/co2bench [--output out.json] [--baseline sim/bench_baseline.json]
+//                        [--tolerance 0.3] [--port 18089] [--dir /tmp/co2bench]
+//
+// O resultado é um JSON plano ("métrica": valor). Cada caminho é medido uma
+// vez por rodada e vale o melhor tempo; ele aparece duas vezes: na sua
+// unidade (ns, ms, MB/s), só para leitura, e relativo (_rel), em passes de
+// um laço de calibração fixo medido ao longo da mesma execução (vazões
+// viram custo por MB). Com --baseline, apenas os relativos e os tempos
+// virtuais do DS1302 são comparados: eles não mudam com a máquina, ao
+// contrário dos tempos absolutos. O processo retorna 1 se algum piorou
+// além da tolerância.
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+#include "co2_stats.h"
+#include "data_logger.h"
+#include "file_catalog.h"
+#include "freertos/semphr.h"
+#include "hal.h"
+#include "http_server.h"
+#include "record_store.h"
+#include "rtc.h"
+#include "sd_card.h"
+
+#define BENCH_ROUNDS        9       // Cada rodada mede uma vez todos os caminhos
+#define MAX_SERIES          32
+#define LIST_REQUESTS       8       // Requisições por rodada: páginas de 1-20 ms
+#define TRANSFER_REQUESTS   3       // e transferências de 20-60 ms
+#define DAY_RECORDS         15      // Registros por dia na agenda padrão
+#define RTC_ITERATIONS      100
+#define MAX_METRICS         (2 * MAX_SERIES + 3)
+
+// Definido em main.c no firmware
+SemaphoreHandle_t xSensorMutex = NULL;
+
+typedef struct {
+    char name[48];
+    double value;
+    bool compared;         // Comparada com a referência (relativas e tempos virtuais)
+} metric_t;
+
+// Melhor custo de um caminho entre as rodadas
+typedef struct {
+    char name[48];
+    double best_ns;        // Tempo, ou ns por MB (ns por byte) nas vazões
+    double unit_ns;        // Conversão para a unidade do nome; UNIT_MBPS ou UNIT_BPS nas vazões
+} series_t;
+
+#define UNIT_MBPS   0.0
+#define UNIT_BPS    -1.0
+
+static metric_t metrics[MAX_METRICS];
+static int metric_count;
+static series_t series[MAX_SERIES];
+static int series_count;
+
+static struct {
+    const char *dir;
+    const char *output;
+    const char *baseline;
+    double tolerance;
+    int port;
+} opt = { .dir = "/tmp/co2bench", .tolerance = 0.30, .port = 18089 };
+
+static volatile int sink;   // Impede que o compilador descarte os laços medidos
+
+static void metric_add(const char *name, double value, bool compared) {
+    if (metric_count >= MAX_METRICS) return;
+    metric_t *m = &metrics[metric_count++];
+    snprintf(m->name, sizeof(m->name), "%s", name);
+    m->value = value;
+    m->compared = compared;
+}
+
+// Registra uma medição; a ordem da primeira rodada é a ordem do JSON
+static void series_add(const char *name, double unit_ns, double cost_ns) {
+    series_t *s = NULL;
+    for (int i = 0; i < series_count && s == NULL; i++) {
+        if (strcmp(series[i].name, name) == 0) s = &series[i];
+    }
+    if (s == NULL) {
+        if (series_count >= MAX_SERIES) return;
+        s = &series[series_count++];
+        snprintf(s->name, sizeof(s->name), "%s", name);
+        s->best_ns = INFINITY;
+        s->unit_ns = unit_ns;
+    }
+    s->best_ns = fmin(s->best_ns, cost_ns);
+}
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// --- Calibração ---
+
+#define CALIBRATION_WORDS   4096
+#define CALIBRATION_KEYS    512
+#define CALIBRATION_LINES   256
+
+static double calibration_best_ns = INFINITY;
+
+static int compare_ints(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Trabalho fixo parecido com o dos caminhos medidos: acessos à memória,
+// qsort com comparador (chamadas indiretas, desvios imprevisíveis) e
+// snprintf. Só usa a libc: o seu tempo muda com a máquina e com as fases
+// de lentidão do host, nunca com o firmware. Roda antes de cada medição.
+static void calibrate(void) {
+    static uint32_t words[CALIBRATION_WORDS];
+    static int keys[CALIBRATION_KEYS];
+    char text[64];
+    uint32_t x = 2463534242u;
+    int64_t t0 = now_ns();
+    for (int i = 0; i < CALIBRATION_WORDS; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        uint32_t *w = &words[x % CALIBRATION_WORDS];
+        *w = (*w > x) ? *w - x : *w + (x >> 3);
+        if (i < CALIBRATION_KEYS) keys[i] = (int)(*w % 10000);
+    }
+    qsort(keys, CALIBRATION_KEYS, sizeof(int), compare_ints);
+    for (int i = 0; i < CALIBRATION_LINES; i++) {
+        sink += snprintf(text, sizeof(text), "%d;%08lx;%.1f", keys[i * 2], (unsigned long)words[i], keys[i] / 10.0);
+    }
+    sink += (int)x;
+    calibration_best_ns = fmin(calibration_best_ns, (double)(now_ns() - t0));
+}
+
+// Cada série vira duas métricas: na sua unidade ("x_ms") e relativa
+// ("x_rel", o melhor custo em passes de calibração)
+static void metrics_from_series(void) {
+    for (int i = 0; i < series_count; i++) {
+        const series_t *s = &series[i];
+        const char *unit = strrchr(s->name, '_');
+        int stem = unit != NULL ? (int)(unit - s->name) : (int)strlen(s->name);
+        char rel_name[48];
+        snprintf(rel_name, sizeof(rel_name), "%.*s_rel", stem, s->name);
+
+        bool rate = s->unit_ns == UNIT_MBPS || s->unit_ns == UNIT_BPS;
+        metric_add(s->name, rate ? 1e9 / s->best_ns : s->best_ns / s->unit_ns, false);
+        metric_add(rel_name, s->best_ns / calibration_best_ns, true);
+    }
+    metric_add("calibration_ns", calibration_best_ns, false);
+}
+
+// --- Medição e estatística ---
+
+#define STATS_MAX_SAMPLES   1001
+#define STATS_WORK          600000  // Amostras processadas por medição (iterações = WORK / n)
+
+static int stats_source[STATS_MAX_SAMPLES];
+
+// Série com o ruído do sensor simulado; a mesma para os dois caminhos
+static void stats_fill_source(int n) {
+    for (int i = 0; i < n; i++) {
+        stats_source[i] = 420 + (int)(sim_rand_gauss() * 6.0);
+    }
+}
+
+static void bench_co2_stats(int n) {
+    const int iterations = STATS_WORK / n;
+    const int *source = stats_source;
+    stats_fill_source(n);
+    calibrate();
+    int64_t t0 = now_ns();
+    for (int it = 0; it < iterations; it++) {
+        static int samples[STATS_MAX_SAMPLES];
+        co2_stats_acc_t acc;
+        co2_stats_init(&acc);
+        for (int i = 0; i < n; i++) {
+            samples[i] = source[(i + it) % n];
+            co2_stats_add(&acc, samples[i]);
+        }
+        co2_stats_t out;
+        co2_stats_finalize(&acc, samples, n, 0.1f, &out);
+        sink += out.median;
+    }
+    char name[48];
+    snprintf(name, sizeof(name), "stats_cycle_%d_ns", n);
+    series_add(name, 1.0, (double)(now_ns() - t0) / iterations);
+}
+
+// Caminho anterior a co2_stats: ordena as amostras com qsort e toma o
+// elemento do meio (só a mediana, sem MAD nem média aparada)
+static void bench_qsort_median(int n) {
+    const int iterations = STATS_WORK / n;
+    const int *source = stats_source;
+    stats_fill_source(n);
+    calibrate();
+    int64_t t0 = now_ns();
+    for (int it = 0; it < iterations; it++) {
+        static int samples[STATS_MAX_SAMPLES];
+        for (int i = 0; i < n; i++) {
+            samples[i] = source[(i + it) % n];
+        }
+        qsort(samples, n, sizeof(int), compare_ints);
+        sink += samples[n / 2];
+    }
+    char name[48];
+    snprintf(name, sizeof(name), "qsort_median_%d_ns", n);
+    series_add(name, 1.0, (double)(now_ns() - t0) / iterations);
+}
+
+static void make_record(record_t *rec, uint32_t timestamp, int i) {
+    memset(rec, 0, sizeof(*rec));
+    rec->estrato_id = ESTRATO_MEDIO;
+    rec->turno_id = TURNO_MANHA + i % 3;
+    rec->timestamp = timestamp;
+    rec->co2_ppm = 410 + i % 50;
+    rec->temperature_c10 = 241 + i % 80;
+    rec->humidity_c10 = 858 - i % 300;
+    rec->co2_mad_c10 = 20;
+    rec->co2_trimmed_c10 = 4153 + i % 500;
+    rec->co2_min = 400;
+    rec->co2_max = 470;
+    rec->co2_stddev_c10 = 31;
+    rec->n_valid = 31;
+}
+
+static void bench_record_format(void) {
+    enum { ITERATIONS = 100000 };
+    record_t rec;
+    char line[192];
+
+    calibrate();
+    int64_t t0 = now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        make_record(&rec, 1768892400u + i, i);
+        record_seal(&rec);
+        sink += rec.crc;
+    }
+    series_add("record_seal_ns", 1.0, (double)(now_ns() - t0) / ITERATIONS);
+
+    calibrate();
+    t0 = now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        rec.timestamp = 1768892400u + i;
+        sink += record_csv_line(&rec, line, sizeof(line));
+    }
+    series_add("record_csv_line_ns", 1.0, (double)(now_ns() - t0) / ITERATIONS);
+}
+
+// --- Gravação (data_logger sobre um diretório POSIX) ---
+
+// Esvazia o cartão e o índice: file_catalog_build só acrescenta entradas,
+// e cada rodada monta conjuntos de arquivos diferentes
+static void clear_sd(void) {
+    file_catalog_entry_t e;
+    while (file_catalog_get(0, &e)) {
+        file_catalog_remove(e.name);
+    }
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "rm -f %s/*", HAL_SD_MOUNT_POINT);
+    if (system(cmd) != 0) {
+        fprintf(stderr, "Failed to clear %s\n", HAL_SD_MOUNT_POINT);
+    }
+}
+
+static void bench_logger(void) {
+    enum { RECORDS = 2000 };
+    clear_sd();
+    file_catalog_build(HAL_SD_MOUNT_POINT);
+    record_t rec;
+    calibrate();
+    int64_t t0 = now_ns();
+    for (int i = 0; i < RECORDS; i++) {
+        make_record(&rec, (uint32_t)time(NULL), i);
+        write_data_record(&rec, "Medio", 0);
+    }
+    data_logger_flush();
+    series_add("logger_record_us", 1e3, (double)(now_ns() - t0) / RECORDS);
+}
+
+// --- Servidor HTTP ---
+
+// Arquivos diários com 'records' registros cada, a partir de 2026-01-01.
+// Os registros seguem a agenda padrão (DAY_RECORDS por dia, a cada 30 min
+// desde as 07:00); além disso continuam nos dias seguintes.
+static void make_files(int files, int records) {
+    clear_sd();
+    for (int f = 0; f < files; f++) {
+        time_t day = 1767225600 + (time_t)f * 86400;
+        struct tm tm;
+        gmtime_r(&day, &tm);
+        char path[96];
+        snprintf(path, sizeof(path), "%s/%04d-%02d-%02d-Medio%s", HAL_SD_MOUNT_POINT,
+                 tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, RECORD_STORE_EXT);
+        FILE *fp = fopen(path, "wb");
+        if (fp == NULL) continue;
+        record_file_header_t hdr;
+        record_file_header_init(&hdr, ESTRATO_MEDIO, day);
+        fwrite(&hdr, sizeof(hdr), 1, fp);
+        for (int i = 0; i < records; i++) {
+            record_t rec;
+            make_record(&rec, (uint32_t)(day + (i / DAY_RECORDS) * 86400 + 25200 + (i % DAY_RECORDS) * 1800), i);
+            record_seal(&rec);
+            fwrite(&rec, sizeof(rec), 1, fp);
+        }
+        fclose(fp);
+    }
+    file_catalog_build(HAL_SD_MOUNT_POINT);
+}
+
+// GET completo (conexão fechada pelo servidor); retorna os bytes recebidos
+static long http_get(const char *path) {
+    sim_io_begin();
+    long total = -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons((uint16_t)opt.port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        char req[256];
+        int n = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: bench\r\nConnection: close\r\n\r\n", path);
+        if (send(fd, req, (size_t)n, MSG_NOSIGNAL) == n) {
+            static char buf[16384];
+            ssize_t got;
+            total = 0;
+            while ((got = recv(fd, buf, sizeof(buf), 0)) > 0) {
+                total += got;
+            }
+        }
+    }
+    if (fd >= 0) close(fd);
+    sim_io_end();
+    return total;
+}
+
+// 'requests' requisições medidas uma a uma. Nas vazões o custo é por MB
+// (UNIT_MBPS) ou por byte (UNIT_BPS) recebido.
+static void time_get(const char *name, const char *path, double unit_ns, int requests) {
+    for (int r = 0; r < requests; r++) {
+        calibrate();
+        int64_t t0 = now_ns();
+        long got = http_get(path);
+        double ns = (double)(now_ns() - t0);
+        if (got <= 0) {
+            fprintf(stderr, "GET %s failed\n", path);
+            return;
+        }
+        series_add(name, unit_ns, unit_ns == UNIT_MBPS ? ns / ((double)got / 1e6) : unit_ns == UNIT_BPS ? ns / (double)got : ns);
+    }
+}
+
+static void bench_http(void) {
+    static const int file_counts[] = { 10, 100, 365 };
+    char name[48];
+
+    for (size_t i = 0; i < sizeof(file_counts) / sizeof(file_counts[0]); i++) {
+        make_files(file_counts[i], DAY_RECORDS);
+        snprintf(name, sizeof(name), "list_render_%d_files_ms", file_counts[i]);
+        time_get(name, "/", 1e6, LIST_REQUESTS);
+        if (file_counts[i] == 365) {
+            time_get("archive_365_files_mbps", "/archive", UNIT_MBPS, TRANSFER_REQUESTS);
+        }
+    }
+
+    // Um arquivo grande: vazão do download (.dat convertido para CSV na hora)
+    make_files(1, 20000);
+    time_get("download_csv_mbps", "/2026-01-01-Medio.dat", UNIT_MBPS, TRANSFER_REQUESTS);
+
+    // Um ano da agenda padrão num só arquivo, pelo bulk_sender, em bytes/s
+    make_files(1, 365 * DAY_RECORDS);
+    time_get("download_365_days_bps", "/2026-01-01-Medio.dat", UNIT_BPS, TRANSFER_REQUESTS);
+}
+
+// --- DS1302 ---
+
+// O bit-bang só anda o relógio virtual (hal_delay_us): o resultado é o
+// tempo do barramento com as esperas do firmware, igual em qualquer máquina
+static void bench_rtc(void) {
+    int64_t legacy_us, burst_us;
+    rtc_benchmark(RTC_ITERATIONS, &legacy_us, &burst_us);
+    metric_add("rtc_read_legacy_us", (double)legacy_us, true);
+    metric_add("rtc_read_burst_us", (double)burst_us, true);
+}
+
+static void bench_task(void *arg) {
+    (void)arg;
+    xSensorMutex = xSemaphoreCreateMutex();
+    if (!mount_sd_card() || data_logger_init(record_store_file_header, sizeof(record_t), catalog_queued_record) != ESP_OK) {
+        fprintf(stderr, "Failed to start the SD card / data logger\n");
+        sim_kernel_stop();
+        vTaskSuspend(NULL);
+    }
+    httpd_handle_t server = NULL;
+    start_http_server(&server);
+    rtc_bus_init();
+
+    // Rodadas em vez de repetições seguidas: as medições de cada caminho se
+    // espalham pela execução inteira e o melhor tempo não depende de uma
+    // fase lenta do host coincidir com aquele caminho.
+    static const int stats_sizes[] = { 31, 61, STATS_MAX_SAMPLES };
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (size_t i = 0; i < sizeof(stats_sizes) / sizeof(stats_sizes[0]); i++) {
+            bench_co2_stats(stats_sizes[i]);
+            bench_qsort_median(stats_sizes[i]);
+        }
+        bench_record_format();
+        bench_logger();
+        bench_http();
+    }
+
+    stop_http_server(server);
+    metrics_from_series();
+    bench_rtc();
+    sim_kernel_stop();
+    vTaskSuspend(NULL);
+}
+
+// --- Saída e comparação com a referência ---
+
+static void write_json(FILE *fp) {
+    fprintf(fp, "{\n");
+    for (int i = 0; i < metric_count; i++) {
+        fprintf(fp, "  \"%s\": %.6g%s\n", metrics[i].name, metrics[i].value, i + 1 < metric_count ? "," : "");
+    }
+    fprintf(fp, "}\n");
+}
+
+static bool baseline_value(const char *json, const char *name, double *out) {
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\"", name);
+    const char *p = strstr(json, key);
+    if (p == NULL) return false;
+    p = strchr(p + strlen(key), ':');
+    if (p == NULL) return false;
+    char *end;
+    *out = strtod(p + 1, &end);
+    return end != p + 1;
+}
+
+// Retorna o número de métricas relativas que pioraram além da tolerância
+static int compare_baseline(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot read baseline %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    static char json[16384];
+    size_t len = fread(json, 1, sizeof(json) - 1, fp);
+    json[len] = '\0';
+    fclose(fp);
+
+    int regressions = 0;
+    fprintf(stderr, "%-28s %12s %12s %8s\n", "metric", "baseline", "current", "change");
+    for (int i = 0; i < metric_count; i++) {
+        const metric_t *m = &metrics[i];
+        double base;
+        if (!m->compared) continue;
+        if (!baseline_value(json, m->name, &base) || base <= 0) {
+            fprintf(stderr, "%-28s %12s %12.4g %8s\n", m->name, "-", m->value, "new");
+            continue;
+        }
+        // Todas são custos: piora é aumento
+        double change = (m->value - base) / base;
+        bool regressed = change > opt.tolerance;
+        regressions += regressed;
+        fprintf(stderr, "%-28s %12.4g %12.4g %+7.1f%%%s\n", m->name, base, m->value, change * 100.0,
+                regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+static const char *absolute_path(const char *path, char *buf, size_t len) {
+    char cwd[2048];
+    if (path == NULL || path[0] == '/' || getcwd(cwd, sizeof(cwd)) == NULL) return path;
+    snprintf(buf, len, "%s/%s", cwd, path);
+    return buf;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s [--output ARQ] [--baseline ARQ] [--tolerance F] [--port N] [--dir DIR]\n", prog);
+}
+
+// Chamado pelo deep sleep do simulador; não ocorre nos benchmarks
+void sim_finish(bool asleep) {
+    (void)asleep;
+    _exit(1);
+}
+
+int main(int argc, char **argv) {
+    static const struct option longopts[] = {
+        { "output", required_argument, NULL, 'o' },
+        { "baseline", required_argument, NULL, 'b' },
+        { "tolerance", required_argument, NULL, 't' },
+        { "port", required_argument, NULL, 'p' },
+        { "dir", required_argument, NULL, 'd' },
+        { NULL, 0, NULL, 0 },
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+            case 'o': opt.output = optarg; break;
+            case 'b': opt.baseline = optarg; break;
+            case 't': opt.tolerance = strtod(optarg, NULL); break;
+            case 'p': opt.port = atoi(optarg); break;
+            case 'd': opt.dir = optarg; break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    // Caminhos relativos continuam válidos depois do chdir
+    static char output[4096], baseline[4096];
+    opt.output = absolute_path(opt.output, output, sizeof(output));
+    opt.baseline = absolute_path(opt.baseline, baseline, sizeof(baseline));
+
+    signal(SIGPIPE, SIG_IGN);
+    if ((mkdir(opt.dir, 0755) != 0 && errno != EEXIST) || chdir(opt.dir) != 0) {
+        perror(opt.dir);
+        return 1;
+    }
+    setenv("TZ", "UTC0", 1);
+    tzset();
+
+    sim_devices_config_t devices = { .start_epoch_s = 1768892400, .seed = 1 };
+    sim_devices_init(&devices);
+    sim_httpd_set_port(opt.port);
+    sim_platform_config_t platform = { .start_epoch_s = devices.start_epoch_s, .quiet = true };
+    sim_platform_init(&platform);
+    sim_nvs_reset();
+
+    // Tempo virtual no ritmo do real: as esperas por rede não adiantam o relógio
+    sim_kernel_config_t kernel = { .start_clock_us = 0, .end_clock_us = 86400LL * 1000000, .speed = 1.0 };
+    sim_kernel_init(&kernel);
+    sim_task_create(bench_task, "Bench", NULL, 5);
+    sim_kernel_run();
+
+    write_json(stdout);
+    fflush(stdout);
+    if (opt.output != NULL) {
+        FILE *fp = fopen(opt.output, "w");
+        if (fp == NULL) {
+            perror(opt.output);
+            return 1;
+        }
+        write_json(fp);
+        fclose(fp);
+    }
+    int rc = 0;
+    if (opt.baseline != NULL && compare_baseline(opt.baseline) > 0) {
+        rc = 1;
+    }
+    fflush(stdout);
+    _exit(rc);
+}
@@ -0,0 +1,778 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "driver/gpio.h"
+#include "driver/rtc_io.h"
+#include "esp_log.h"
+#include "hal.h"
+#include "mhz14a_protocol.h"
+#include "sim.h"
+
+// Modelos dos periféricos da placa, ligados às chamadas da hal.h.
+// Pinos conforme o firmware: MH-Z14A na UART1 com energia no GPIO23,
+// fan no GPIO13, DHT22 no GPIO4, DS1302 em CLK 27 / IO 26 / CE 25 e o
+// botão do Wi-Fi no GPIO14. Cada par (UART, pino de RX) usado pelo
+// firmware é um MH-Z14A próprio, então os canais de MULTI_ESTRATO
+// (inclusive os que dividem a UART2) respondem independentemente.
+
+static const char *TAG = "SIM_DEV";
+
+#define PIN_COUNT           40
+#define PIN_CO2_POWER       23
+#define PIN_FAN             13
+#define PIN_BUTTON          14
+
+#define UART_FIFO_SIZE      256
+#define UART_PORTS          3
+#define MAX_CO2_SENSORS     4
+#define UART_BYTE_US        1042        // 9600 8N1
+#define CO2_RESPONSE_US     20000       // Processamento do comando no sensor
+#define CO2_WARMUP_US       (180 * 1000000LL)
+#define CO2_NOISE_PPM       6.0
+#define DHT_READ_US         4000
+#define BUTTON_PRESS_US     200000
+#define MAX_BUTTON_PRESSES  32
+#define MAX_CO2_POINTS      48
+
+static sim_devices_config_t cfg;
+static sim_device_stats_t stats;
+static bool radio_on;
+static int64_t radio_on_at;
+
+// --- Números aleatórios (xorshift64*, estado salvo no deep sleep) ---
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+uint64_t sim_rand_u64(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+double sim_rand_uniform(void) {
+    return (sim_rand_u64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double sim_rand_gauss(void) {
+    double u1 = sim_rand_uniform(), u2 = sim_rand_uniform();
+    if (u1 < 1e-12) u1 = 1e-12;
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+// --- GPIO ---
+static uint8_t pin_level[PIN_COUNT];
+static uint8_t pin_enable[PIN_COUNT];
+static gpio_isr_t isr_handler[PIN_COUNT];
+static void *isr_arg[PIN_COUNT];
+static gpio_int_type_t isr_type[PIN_COUNT];
+static bool isr_service;
+static int64_t button_presses[MAX_BUTTON_PRESSES];
+static int button_count;
+
+// --- DS1302 ---
+typedef struct {
+    int64_t base_epoch_us;       // Hora do chip em base_clock_us
+    int64_t base_clock_us;
+    bool halted;
+    uint8_t wp;
+    uint8_t tcs;
+    uint8_t ram[31];
+} ds1302_regs_t;
+
+static ds1302_regs_t rtc;
+static int rtc_clk_pin = -1, rtc_ce_pin = -1, rtc_io_pin = -1;
+static int rtc_forced[7] = { -1, -1, -1, -1, -1, -1, -1 };   // sim_rtc_force_reg()
+
+// Estado do barramento (só existe dentro de uma transação)
+static struct {
+    bool active;
+    bool cmd_done;
+    uint8_t cmd;
+    uint8_t shift;
+    int bit;
+    int index;
+    int out;                     // Nível dirigido no IO (-1 = alta impedância)
+    uint8_t out_byte;
+    uint8_t latched[8];
+    uint8_t burst[8];
+    bool write_enabled;
+} bus;
+
+// --- MH-Z14A ---
+typedef struct {
+    int port;
+    int rx_pin;
+    double offset_ppm;           // Deslocamento da curva (outro estrato)
+    struct {
+        uint8_t data;
+        int64_t ready_at;
+    } fifo[UART_FIFO_SIZE];
+    int count;
+    uint8_t cmd[MHZ14A_FRAME_LEN];
+    int cmd_len;
+} co2_sensor_t;
+
+static co2_sensor_t co2_sensors[MAX_CO2_SENSORS];
+static int co2_sensor_count;
+static int uart_rx_pin[UART_PORTS] = { -1, -1, -1 };   // RX ligado a cada UART
+
+// O primeiro sensor segue a curva; os seguintes (estratos mais baixos na
+// ordem do firmware) acumulam mais CO2
+static const double CO2_SENSOR_OFFSET_PPM[MAX_CO2_SENSORS] = { 0.0, 25.0, 50.0, 75.0 };
+
+static bool co2_powered;
+static int64_t co2_powered_at;
+static struct { int minute; double ppm; } co2_points[MAX_CO2_POINTS];
+static int co2_point_count;
+
+// Curva diária padrão: respiração noturna acumula CO2 no sub-bosque, a
+// fotossíntese e a turbulência do dia o dissipam
+static const char *CO2_DEFAULT_SCRIPT =
+    "00:00 520\n05:00 560\n07:00 540\n09:00 470\n12:00 420\n16:00 430\n18:00 470\n21:00 510\n";
+
+static void co2_script_parse(const char *text) {
+    co2_point_count = 0;
+    const char *p = text;
+    while (*p != '\0' && co2_point_count < MAX_CO2_POINTS) {
+        int h, m;
+        double ppm;
+        if (*p != '#' && sscanf(p, "%d:%d %lf", &h, &m, &ppm) == 3) {
+            co2_points[co2_point_count].minute = h * 60 + m;
+            co2_points[co2_point_count].ppm = ppm;
+            co2_point_count++;
+        }
+        p = strchr(p, '\n');
+        if (p == NULL) break;
+        p++;
+    }
+}
+
+static double co2_true_ppm(int64_t clock_us) {
+    int64_t epoch_s = sim_true_epoch_us(clock_us) / 1000000;
+    double minute = (double)(((epoch_s % 86400) + 86400) % 86400) / 60.0;
+    if (co2_point_count == 0) return 420.0;
+    if (co2_point_count == 1) return co2_points[0].ppm;
+
+    // Interpolação linear circular (o último ponto liga ao primeiro do dia seguinte)
+    for (int i = 0; i < co2_point_count; i++) {
+        int j = (i + 1) % co2_point_count;
+        double a = co2_points[i].minute;
+        double b = co2_points[j].minute + (j == 0 ? 1440 : 0);
+        double x = (minute < a) ? minute + 1440 : minute;
+        if (x >= a && x < b) {
+            return co2_points[i].ppm + (co2_points[j].ppm - co2_points[i].ppm) * (x - a) / (b - a);
+        }
+    }
+    return co2_points[0].ppm;
+}
+
+static double co2_reading(const co2_sensor_t *sensor, int64_t clock_us) {
+    double ppm = co2_true_ppm(clock_us) + sensor->offset_ppm + CO2_NOISE_PPM * sim_rand_gauss();
+    // Durante o pré-aquecimento a leitura começa alta e converge
+    int64_t on_us = clock_us - co2_powered_at;
+    if (on_us < CO2_WARMUP_US) {
+        double left = 1.0 - (double)on_us / CO2_WARMUP_US;
+        ppm += 300.0 * left * left;
+    }
+    return ppm < 0 ? 0 : ppm;
+}
+
+static void co2_set_power(bool on) {
+    int64_t now = sim_clock_us();
+    if (on && !co2_powered) {
+        co2_powered_at = now;
+    } else if (!on && co2_powered) {
+        stats.co2_on_us += now - co2_powered_at;
+        for (int i = 0; i < co2_sensor_count; i++) {
+            co2_sensors[i].count = 0;   // Sem energia o sensor não termina nenhuma resposta
+        }
+    }
+    co2_powered = on;
+}
+
+// A curva de CO2 vem da linha de comando; não faz parte do estado salvo
+static void devices_load_script(void) {
+    co2_script_parse(CO2_DEFAULT_SCRIPT);
+    if (cfg.co2_script == NULL) return;
+
+    FILE *f = fopen(cfg.co2_script, "r");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Cannot open CO2 script %s; using the default curve", cfg.co2_script);
+        return;
+    }
+    char text[4096];
+    size_t n = fread(text, 1, sizeof(text) - 1, f);
+    fclose(f);
+    text[n] = '\0';
+    co2_script_parse(text);
+    if (co2_point_count == 0) {
+        ESP_LOGE(TAG, "No \"HH:MM ppm\" points in %s; using the default curve", cfg.co2_script);
+        co2_script_parse(CO2_DEFAULT_SCRIPT);
+    }
+}
+
+void sim_devices_init(const sim_devices_config_t *config) {
+    cfg = *config;
+    rng_state ^= cfg.seed * 0xD1B54A32D192ED03ULL;
+    if (rng_state == 0) rng_state = 1;
+
+    // Chip novo (--fresh) parte parado em 2000-01-01, como após perder a bateria
+    rtc.base_clock_us = 0;
+    rtc.base_epoch_us = cfg.rtc_halted ? 946684800LL * 1000000 :
+                        (cfg.start_epoch_s + cfg.rtc_offset_s) * 1000000;
+    rtc.halted = cfg.rtc_halted;
+    rtc.wp = 0x80;
+    for (int i = 0; i < PIN_COUNT; i++) pin_level[i] = (i == PIN_BUTTON);
+    devices_load_script();
+}
+
+typedef struct {
+    ds1302_regs_t rtc;
+    sim_device_stats_t stats;
+    uint64_t rng_state;
+} devices_saved_t;
+
+size_t sim_devices_state_size(void) {
+    return sizeof(devices_saved_t);
+}
+
+void sim_devices_save(void *buf) {
+    devices_saved_t *s = buf;
+    s->rtc = rtc;
+    s->stats = stats;
+    s->rng_state = rng_state;
+}
+
+void sim_devices_restore(const void *buf) {
+    const devices_saved_t *s = buf;
+    rtc = s->rtc;
+    stats = s->stats;
+    rng_state = s->rng_state;
+}
+
+void sim_devices_get_stats(sim_device_stats_t *out) {
+    *out = stats;
+    if (co2_powered) {
+        out->co2_on_us += sim_clock_us() - co2_powered_at;
+    }
+    if (radio_on) {
+        out->radio_on_us += sim_clock_us() - radio_on_at;
+    }
+}
+
+void sim_radio_set(bool on) {
+    int64_t now = sim_clock_us();
+    if (on && !radio_on) {
+        radio_on_at = now;
+    } else if (!on && radio_on) {
+        stats.radio_on_us += now - radio_on_at;
+    }
+    radio_on = on;
+}
+
+void sim_devices_sleep(void) {
+    // No deep sleep os GPIOs ficam em alta impedância: sensor e fan desligam
+    co2_set_power(false);
+    sim_radio_set(false);
+}
+
+// --- DS1302: hora e registradores ---
+
+static int64_t rtc_now_us(void) {
+    if (rtc.halted) {
+        return rtc.base_epoch_us;
+    }
+    double elapsed = (double)(sim_clock_us() - rtc.base_clock_us);
+    return rtc.base_epoch_us + (int64_t)(elapsed * (1.0 + cfg.rtc_drift_ppm * 1e-6));
+}
+
+int64_t sim_rtc_epoch_us(void) {
+    return rtc_now_us();
+}
+
+static uint8_t to_bcd(int v) { return (uint8_t)(((v / 10) << 4) | (v % 10)); }
+static int from_bcd(uint8_t v) { return (v >> 4) * 10 + (v & 0x0F); }
+
+static void rtc_latch(uint8_t regs[8]) {
+    time_t t = (time_t)(rtc_now_us() / 1000000);
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    regs[0] = to_bcd(tm.tm_sec) | (rtc.halted ? 0x80 : 0);
+    regs[1] = to_bcd(tm.tm_min);
+    regs[2] = to_bcd(tm.tm_hour);
+    regs[3] = to_bcd(tm.tm_mday);
+    regs[4] = to_bcd(tm.tm_mon + 1);
+    regs[5] = to_bcd(tm.tm_wday + 1);
+    regs[6] = to_bcd(tm.tm_year % 100);
+    regs[7] = rtc.wp;
+    for (int i = 0; i < 7; i++) {
+        if (rtc_forced[i] >= 0) regs[i] = (uint8_t)rtc_forced[i];
+    }
+}
+
+void sim_rtc_force_reg(int reg, int value) {
+    if (reg >= 0 && reg < 7) rtc_forced[reg] = value;
+}
+
+// Grava os 7 registradores de hora; o divisor recomeça no segundo cheio
+static void rtc_store(const uint8_t regs[7]) {
+    struct tm tm = {
+        .tm_sec = from_bcd(regs[0] & 0x7F),
+        .tm_min = from_bcd(regs[1] & 0x7F),
+        .tm_hour = from_bcd(regs[2] & 0x3F),
+        .tm_mday = from_bcd(regs[3] & 0x3F),
+        .tm_mon = from_bcd(regs[4] & 0x1F) - 1,
+        .tm_year = from_bcd(regs[6]) + 100,
+    };
+    rtc.base_epoch_us = (int64_t)timegm(&tm) * 1000000;
+    rtc.base_clock_us = sim_clock_us();
+    rtc.halted = (regs[0] & 0x80) != 0;
+    stats.rtc_writes++;
+}
+
+static uint8_t rtc_read_byte(void) {
+    bool ram = (bus.cmd & 0x40) != 0;
+    int addr = (bus.cmd >> 1) & 0x1F;
+    if (addr == 31) {
+        // Burst: endereços consecutivos a partir do zero
+        if (ram) return bus.index < 31 ? rtc.ram[bus.index] : 0;
+        return bus.index < 8 ? bus.latched[bus.index] : 0;
+    }
+    if (ram) return addr < 31 ? rtc.ram[addr] : 0;
+    if (addr < 8) return bus.latched[addr];
+    if (addr == 8) return rtc.tcs;
+    return 0;
+}
+
+static void rtc_write_byte(uint8_t value) {
+    bool ram = (bus.cmd & 0x40) != 0;
+    int addr = (bus.cmd >> 1) & 0x1F;
+    if (addr == 31) {
+        if (ram) {
+            if (bus.write_enabled && bus.index < 31) rtc.ram[bus.index] = value;
+        } else if (bus.index < 8) {
+            bus.burst[bus.index] = value;
+            // O burst de relógio só vale com os 8 bytes
+            if (bus.index == 7 && bus.write_enabled) {
+                rtc_store(bus.burst);
+                rtc.wp = value & 0x80;
+            }
+        }
+        return;
+    }
+    if (!ram && addr == 7) {
+        rtc.wp = value & 0x80;   // WP é o único registrador sempre gravável
+        return;
+    }
+    if (!bus.write_enabled) return;
+    if (ram) {
+        if (addr < 31) rtc.ram[addr] = value;
+    } else if (addr < 7) {
+        uint8_t regs[8];
+        rtc_latch(regs);
+        regs[addr] = value;
+        rtc_store(regs);
+    } else if (addr == 8) {
+        rtc.tcs = value;
+    }
+}
+
+static void rtc_ce_edge(bool high) {
+    memset(&bus, 0, sizeof(bus));
+    bus.out = -1;
+    if (high) {
+        bus.active = true;
+        rtc_latch(bus.latched);
+        bus.write_enabled = (rtc.wp & 0x80) == 0;
+        stats.rtc_transactions++;
+    }
+}
+
+static int rtc_io_level(void) {
+    if (pin_enable[rtc_io_pin]) return pin_level[rtc_io_pin];
+    if (bus.out >= 0) return bus.out;
+    return 0;   // Pull-down interno do DS1302
+}
+
+static void rtc_clk_edge(bool rising) {
+    if (!bus.active) return;
+    if (rising) {
+        bool reading = bus.cmd_done && (bus.cmd & 1);
+        if (reading) return;
+        bus.shift |= (uint8_t)(rtc_io_level() << bus.bit);
+        if (++bus.bit < 8) return;
+        bus.bit = 0;
+        if (!bus.cmd_done) {
+            bus.cmd = bus.shift;
+            bus.cmd_done = true;
+            bus.index = 0;
+            // Bit 7 = 0: comando inválido, o chip ignora a transação
+            if (!(bus.cmd & 0x80)) bus.active = false;
+        } else {
+            rtc_write_byte(bus.shift);
+            bus.index++;
+        }
+        bus.shift = 0;
+        return;
+    }
+
+    // Borda de descida: em leitura, o próximo bit aparece no IO. A
+    // primeira é a do 8º clock do comando.
+    if (!bus.cmd_done || !(bus.cmd & 1)) return;
+    if (bus.bit == 0) {
+        bus.out_byte = rtc_read_byte();
+    }
+    bus.out = (bus.out_byte >> bus.bit) & 1;
+    if (++bus.bit == 8) {
+        bus.bit = 0;
+        bus.index++;
+    }
+}
+
+// --- HAL: GPIO ---
+
+static void pin_write(int pin, int level) {
+    if (pin < 0 || pin >= PIN_COUNT) return;
+    int old = pin_level[pin];
+    pin_level[pin] = level ? 1 : 0;
+    if (old == pin_level[pin]) return;
+    if (pin == rtc_ce_pin) rtc_ce_edge(level);
+    else if (pin == rtc_clk_pin) rtc_clk_edge(level);
+    else if (pin == PIN_CO2_POWER) co2_set_power(level);
+}
+
+void hal_delay_us(uint32_t us) { sim_busy_us(us); }
+void hal_pin_high(int pin) { pin_write(pin, 1); }
+void hal_pin_low(int pin) { pin_write(pin, 0); }
+void hal_pin_output_enable(int pin) { if (pin >= 0 && pin < PIN_COUNT) pin_enable[pin] = 1; }
+void hal_pin_output_disable(int pin) { if (pin >= 0 && pin < PIN_COUNT) pin_enable[pin] = 0; }
+
+uint32_t hal_pin_read(int pin) {
+    if (pin == rtc_io_pin) return rtc_io_level();
+    return (uint32_t)sim_gpio_input_level(pin);
+}
+
+void hal_gpio_output(int pin, int level) {
+    hal_pin_output_enable(pin);
+    pin_write(pin, level);
+}
+
+void hal_gpio_set(int pin, int level) {
+    pin_write(pin, level);
+}
+
+void hal_bitbang_init(int clk_pin, int ce_pin, int io_pin) {
+    rtc_clk_pin = clk_pin;
+    rtc_ce_pin = ce_pin;
+    rtc_io_pin = io_pin;
+    hal_gpio_output(clk_pin, 0);
+    hal_gpio_output(ce_pin, 0);
+    hal_pin_output_enable(io_pin);
+}
+
+esp_err_t gpio_config(const gpio_config_t *c) {
+    for (int pin = 0; pin < PIN_COUNT; pin++) {
+        if (!(c->pin_bit_mask & (1ULL << pin))) continue;
+        pin_enable[pin] = (c->mode & GPIO_MODE_OUTPUT) ? 1 : 0;
+        isr_type[pin] = c->intr_type;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t pin) {
+    if (pin >= 0 && pin < PIN_COUNT) pin_enable[pin] = 0;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode) {
+    if (pin < 0 || pin >= PIN_COUNT) return ESP_ERR_INVALID_ARG;
+    pin_enable[pin] = (mode & GPIO_MODE_OUTPUT) ? 1 : 0;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+    pin_write(pin, level);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin) {
+    return (int)hal_pin_read(pin);
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t pin, gpio_pull_mode_t pull) {
+    (void)pin;
+    (void)pull;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags) {
+    (void)intr_alloc_flags;
+    if (isr_service) return ESP_ERR_INVALID_STATE;
+    isr_service = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t handler, void *arg) {
+    if (!isr_service) return ESP_ERR_INVALID_STATE;
+    if (pin < 0 || pin >= PIN_COUNT) return ESP_ERR_INVALID_ARG;
+    isr_handler[pin] = handler;
+    isr_arg[pin] = arg;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t pin) {
+    if (pin < 0 || pin >= PIN_COUNT) return ESP_ERR_INVALID_ARG;
+    isr_handler[pin] = NULL;
+    return ESP_OK;
+}
+
+esp_err_t rtc_gpio_pullup_en(gpio_num_t pin) { (void)pin; return ESP_OK; }
+esp_err_t rtc_gpio_pulldown_dis(gpio_num_t pin) { (void)pin; return ESP_OK; }
+
+int sim_gpio_input_level(int pin) {
+    if (pin < 0 || pin >= PIN_COUNT) return 0;
+    return pin_level[pin];
+}
+
+void sim_gpio_fire_isr(int pin) {
+    if (isr_handler[pin] != NULL) {
+        isr_handler[pin](isr_arg[pin]);
+    }
+}
+
+// --- Botão ---
+
+void sim_button_schedule(const int64_t *clock_us, int count) {
+    button_count = count < MAX_BUTTON_PRESSES ? count : MAX_BUTTON_PRESSES;
+    memcpy(button_presses, clock_us, button_count * sizeof(int64_t));
+}
+
+int64_t sim_button_next_press(int64_t after_clock_us) {
+    int64_t next = SIM_FOREVER;
+    for (int i = 0; i < button_count; i++) {
+        if (button_presses[i] >= after_clock_us && button_presses[i] < next) {
+            next = button_presses[i];
+        }
+    }
+    return next;
+}
+
+static void button_task(void *arg) {
+    int64_t from = *(int64_t *)arg;
+    for (;;) {
+        int64_t press = sim_button_next_press(from);
+        if (press == SIM_FOREVER) {
+            vTaskDelete(NULL);
+        }
+        sim_sleep_until(press);
+        ESP_LOGI(TAG, "Button pressed (GPIO%d)", PIN_BUTTON);
+        pin_level[PIN_BUTTON] = 0;
+        if (isr_type[PIN_BUTTON] == GPIO_INTR_NEGEDGE || isr_type[PIN_BUTTON] == GPIO_INTR_ANYEDGE) {
+            sim_gpio_fire_isr(PIN_BUTTON);
+        }
+        sim_sleep_until(sim_clock_us() + BUTTON_PRESS_US);
+        pin_level[PIN_BUTTON] = 1;
+        from = sim_clock_us();
+    }
+}
+
+// 'from_clock_us' pula o pressionamento que acordou a placa do deep sleep
+void sim_button_start(int64_t from_clock_us) {
+    static int64_t from;
+    from = from_clock_us;
+    if (sim_button_next_press(from) != SIM_FOREVER) {
+        sim_task_create(button_task, "SimButton", &from, configMAX_PRIORITIES - 1);
+    }
+}
+
+// --- HAL: UART (MH-Z14A) ---
+
+// Sensor ligado hoje à UART (pinos atuais); criado no primeiro uso
+static co2_sensor_t *uart_sensor(int port) {
+    if (port < 0 || port >= UART_PORTS || uart_rx_pin[port] < 0) {
+        return NULL;
+    }
+    for (int i = 0; i < co2_sensor_count; i++) {
+        if (co2_sensors[i].port == port && co2_sensors[i].rx_pin == uart_rx_pin[port]) {
+            return &co2_sensors[i];
+        }
+    }
+    if (co2_sensor_count == MAX_CO2_SENSORS) {
+        return NULL;
+    }
+    co2_sensor_t *sensor = &co2_sensors[co2_sensor_count];
+    memset(sensor, 0, sizeof(*sensor));
+    sensor->port = port;
+    sensor->rx_pin = uart_rx_pin[port];
+    sensor->offset_ppm = CO2_SENSOR_OFFSET_PPM[co2_sensor_count];
+    co2_sensor_count++;
+    return sensor;
+}
+
+static void uart_push(co2_sensor_t *sensor, uint8_t byte, int64_t ready_at) {
+    if (sensor->count < UART_FIFO_SIZE) {
+        sensor->fifo[sensor->count].data = byte;
+        sensor->fifo[sensor->count].ready_at = ready_at;
+        sensor->count++;
+    }
+}
+
+static void co2_respond(co2_sensor_t *sensor) {
+    stats.co2_requests++;
+    if (!co2_powered) {
+        stats.co2_unpowered++;
+        return;
+    }
+
+    int ppm = (int)lround(co2_reading(sensor, sim_clock_us()));
+    uint8_t frame[MHZ14A_FRAME_LEN] = { 0xFF, MHZ14A_CMD_READ_CO2, (uint8_t)(ppm >> 8), (uint8_t)ppm, 0, 0, 0, 0, 0 };
+    frame[8] = mhz14a_checksum(frame);
+
+    int64_t t = sim_clock_us() + CO2_RESPONSE_US;
+    if (sim_rand_uniform() < cfg.co2_error_rate) {
+        stats.co2_corrupted++;
+        switch (sim_rand_u64() % 3) {
+        case 0:
+            frame[2 + sim_rand_u64() % 6] ^= 0x10;    // Bit trocado: checksum não bate
+            break;
+        case 1:
+            return;                                   // Quadro perdido
+        default:
+            uart_push(sensor, 0x00, t);               // Lixo antes do quadro
+            t += UART_BYTE_US;
+            break;
+        }
+    }
+    for (int i = 0; i < MHZ14A_FRAME_LEN; i++) {
+        uart_push(sensor, frame[i], t + i * UART_BYTE_US);
+    }
+    stats.co2_responses++;
+}
+
+esp_err_t hal_uart_open(int port, int tx_pin, int rx_pin, size_t rx_buf_size) {
+    (void)tx_pin;
+    (void)rx_buf_size;
+    if (port < 0 || port >= UART_PORTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uart_rx_pin[port] = rx_pin;
+    co2_sensor_t *sensor = uart_sensor(port);
+    if (sensor != NULL) {
+        sensor->count = 0;
+        sensor->cmd_len = 0;
+    }
+    return ESP_OK;
+}
+
+void hal_uart_close(int port) {
+    for (int i = 0; i < co2_sensor_count; i++) {
+        if (co2_sensors[i].port == port) co2_sensors[i].count = 0;
+    }
+    if (port >= 0 && port < UART_PORTS) uart_rx_pin[port] = -1;
+}
+
+esp_err_t hal_uart_set_pins(int port, int tx_pin, int rx_pin) {
+    (void)tx_pin;
+    if (port < 0 || port >= UART_PORTS || uart_rx_pin[port] < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uart_rx_pin[port] = rx_pin;
+    return ESP_OK;
+}
+
+int hal_uart_write(int port, const uint8_t *data, size_t len) {
+    co2_sensor_t *sensor = uart_sensor(port);
+    if (sensor == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (sensor->cmd_len == 0 && data[i] != 0xFF) continue;
+        sensor->cmd[sensor->cmd_len++] = data[i];
+        if (sensor->cmd_len == MHZ14A_FRAME_LEN) {
+            sensor->cmd_len = 0;
+            if (sensor->cmd[2] == MHZ14A_CMD_READ_CO2 && sensor->cmd[8] == mhz14a_checksum(sensor->cmd)) {
+                co2_respond(sensor);
+            }
+        }
+    }
+    sim_busy_us((int64_t)len * UART_BYTE_US / 8);   // Cópia para a FIFO de TX
+    return (int)len;
+}
+
+static int uart_take(co2_sensor_t *sensor, uint8_t *buf, size_t len) {
+    int64_t now = sim_clock_us();
+    int n = 0;
+    while ((size_t)n < len && n < sensor->count && sensor->fifo[n].ready_at <= now) {
+        buf[n] = sensor->fifo[n].data;
+        n++;
+    }
+    memmove(sensor->fifo, sensor->fifo + n, (sensor->count - n) * sizeof(sensor->fifo[0]));
+    sensor->count -= n;
+    return n;
+}
+
+int hal_uart_read(int port, uint8_t *buf, size_t len, TickType_t wait) {
+    co2_sensor_t *sensor = uart_sensor(port);
+    if (sensor == NULL) {
+        return -1;
+    }
+    int64_t deadline = sim_clock_us() + (int64_t)wait * SIM_TICK_US;
+    int got = uart_take(sensor, buf, len);
+    while ((size_t)got < len) {
+        // Próximo byte em trânsito, se chegar dentro do prazo
+        int64_t next = sensor->count > 0 ? sensor->fifo[0].ready_at : SIM_FOREVER;
+        if (next > deadline) {
+            sim_sleep_until(deadline);
+            got += uart_take(sensor, buf + got, len - got);
+            break;
+        }
+        sim_sleep_until(next);
+        got += uart_take(sensor, buf + got, len - got);
+    }
+    return got;
+}
+
+void hal_uart_flush_input(int port) {
+    co2_sensor_t *sensor = uart_sensor(port);
+    if (sensor == NULL) {
+        return;
+    }
+    uint8_t discard[UART_FIFO_SIZE];
+    uart_take(sensor, discard, sizeof(discard));
+}
+
+// --- HAL: DHT22 ---
+
+esp_err_t hal_dht_read(int pin, float *humidity, float *temperature) {
+    (void)pin;
+    stats.dht_reads++;
+    sim_busy_us(DHT_READ_US);   // O protocolo de 1 fio é lido com espera ativa
+    if (sim_rand_uniform() < cfg.dht_error_rate) {
+        stats.dht_failures++;
+        return ESP_ERR_TIMEOUT;
+    }
+    // Ciclo diário com máximo de temperatura às 15 h e umidade oposta
+    int64_t epoch_s = sim_true_epoch_us(sim_clock_us()) / 1000000;
+    double hour = (double)(((epoch_s % 86400) + 86400) % 86400) / 3600.0;
+    double phase = sin(2.0 * M_PI * (hour - 9.0) / 24.0);
+    double t = 24.0 + 5.0 * phase + 0.1 * sim_rand_gauss();
+    double h = 78.0 - 15.0 * phase + 0.5 * sim_rand_gauss();
+    *temperature = (float)(round(t * 10) / 10);
+    *humidity = (float)(round((h > 100 ? 100 : h) * 10) / 10);
+    return ESP_OK;
+}
+
+// --- HAL: cartão SD ---
+
+esp_err_t hal_sd_mount(void) {
+    if (cfg.no_sd) {
+        return ESP_ERR_TIMEOUT;   // Cartão não responde
+    }
+    if (mkdir(HAL_SD_MOUNT_POINT, 0755) != 0 && errno != EEXIST) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
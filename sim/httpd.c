@@ -0,0 +1,509 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sim.h"
+
+// esp_http_server do simulador: uma tarefa por servidor atende uma
+// conexão por vez em 127.0.0.1:<--http>. Cada conexão leva uma única
+// requisição e é fechada em seguida (a página do firmware já pede
+// Connection: close). As esperas por rede rodam em sim_io_begin/end,
+// então o relógio virtual continua andando para as outras tarefas.
+// Sem --http o servidor "sobe" normalmente, mas não abre socket.
+
+static const char *TAG = "SIM_HTTPD";
+
+#define ACCEPT_POLL_MS      200
+#define MAX_EXTRA_HEADERS   8
+
+static int listen_port;
+
+typedef struct {
+    httpd_config_t config;
+    httpd_uri_t *handlers;
+    int handler_count;
+    int listen_fd;
+    TaskHandle_t task;
+    volatile bool stop;
+    volatile bool exited;
+} server_t;
+
+typedef struct {
+    int fd;
+    char hdr[CONFIG_HTTPD_MAX_REQ_HDR_LEN + 1];
+    size_t hdr_len;              // Cabeçalhos (linha da requisição incluída)
+    char extra[CONFIG_HTTPD_MAX_REQ_HDR_LEN];
+    size_t extra_len;            // Bytes do corpo lidos junto com os cabeçalhos
+    size_t extra_pos;
+    size_t body_left;
+    const char *status;
+    const char *type;
+    const char *resp_hdr_field[MAX_EXTRA_HEADERS];
+    const char *resp_hdr_value[MAX_EXTRA_HEADERS];
+    int resp_hdr_count;
+    bool headers_sent;
+    bool failed;
+} req_ctx_t;
+
+void sim_httpd_set_port(int port) {
+    listen_port = port;
+}
+
+// --- E/S no socket ---
+
+static bool wait_fd(int fd, short events, int timeout_s) {
+    struct pollfd p = { .fd = fd, .events = events };
+    sim_io_begin();
+    int rc = poll(&p, 1, timeout_s * 1000);
+    sim_io_end();
+    return rc > 0;
+}
+
+static int send_all(req_ctx_t *ctx, httpd_req_t *r, const char *data, size_t len) {
+    server_t *srv = r->handle;
+    while (len > 0 && !ctx->failed) {
+        if (!wait_fd(ctx->fd, POLLOUT, srv->config.send_wait_timeout)) {
+            ctx->failed = true;
+            break;
+        }
+        ssize_t n = send(ctx->fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ctx->failed = true;
+            break;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return ctx->failed ? HTTPD_SOCK_ERR_FAIL : 0;
+}
+
+// --- Cabeçalhos da requisição ---
+
+static const char *find_header(req_ctx_t *ctx, const char *field, size_t *value_len) {
+    size_t flen = strlen(field);
+    const char *line = strstr(ctx->hdr, "\r\n");
+    while (line != NULL) {
+        line += 2;
+        const char *end = strstr(line, "\r\n");
+        if (end == NULL || end == line) break;
+        if ((size_t)(end - line) > flen && strncasecmp(line, field, flen) == 0 && line[flen] == ':') {
+            const char *v = line + flen + 1;
+            while (v < end && (*v == ' ' || *v == '\t')) v++;
+            const char *e = end;
+            while (e > v && (e[-1] == ' ' || e[-1] == '\t')) e--;
+            *value_len = (size_t)(e - v);
+            return v;
+        }
+        line = end;
+    }
+    return NULL;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field) {
+    size_t len = 0;
+    return find_header(r->aux, field, &len) != NULL ? len : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size) {
+    size_t len = 0;
+    const char *v = find_header(r->aux, field, &len);
+    if (v == NULL) return ESP_ERR_NOT_FOUND;
+    if (val_size == 0) return ESP_ERR_INVALID_SIZE;
+    size_t n = len < val_size - 1 ? len : val_size - 1;
+    memcpy(val, v, n);
+    val[n] = '\0';
+    return n == len ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *r) {
+    const char *q = strchr(r->uri, '?');
+    return q != NULL ? strlen(q + 1) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len) {
+    const char *q = strchr(r->uri, '?');
+    if (q == NULL) return ESP_ERR_NOT_FOUND;
+    if (buf_len == 0) return ESP_ERR_INVALID_SIZE;
+    snprintf(buf, buf_len, "%s", q + 1);
+    return strlen(q + 1) < buf_len ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+// Como no IDF, o valor não é decodificado (%XX continua no texto)
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size) {
+    size_t klen = strlen(key);
+    const char *p = qry;
+    while (p != NULL && *p != '\0') {
+        const char *end = strchr(p, '&');
+        size_t plen = end != NULL ? (size_t)(end - p) : strlen(p);
+        if (plen > klen && strncmp(p, key, klen) == 0 && p[klen] == '=') {
+            size_t vlen = plen - klen - 1;
+            if (val_size == 0) return ESP_ERR_INVALID_SIZE;
+            size_t n = vlen < val_size - 1 ? vlen : val_size - 1;
+            memcpy(val, p + klen + 1, n);
+            val[n] = '\0';
+            return n == vlen ? ESP_OK : ESP_ERR_INVALID_SIZE;
+        }
+        p = end != NULL ? end + 1 : NULL;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r) {
+    return ((req_ctx_t *)r->aux)->fd;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd) {
+    (void)handle;
+    (void)sockfd;
+    return ESP_OK;   // Toda conexão já é fechada depois da requisição
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len) {
+    req_ctx_t *ctx = r->aux;
+    server_t *srv = r->handle;
+    if (ctx->body_left == 0 || buf_len == 0) return 0;
+    if (buf_len > ctx->body_left) buf_len = ctx->body_left;
+
+    size_t n = 0;
+    if (ctx->extra_pos < ctx->extra_len) {
+        n = ctx->extra_len - ctx->extra_pos;
+        if (n > buf_len) n = buf_len;
+        memcpy(buf, ctx->extra + ctx->extra_pos, n);
+        ctx->extra_pos += n;
+    } else {
+        if (!wait_fd(ctx->fd, POLLIN, srv->config.recv_wait_timeout)) return HTTPD_SOCK_ERR_TIMEOUT;
+        ssize_t got = recv(ctx->fd, buf, buf_len, 0);
+        if (got <= 0) return HTTPD_SOCK_ERR_FAIL;
+        n = (size_t)got;
+    }
+    ctx->body_left -= n;
+    return (int)n;
+}
+
+// --- Respostas ---
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status) {
+    ((req_ctx_t *)r->aux)->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type) {
+    ((req_ctx_t *)r->aux)->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value) {
+    req_ctx_t *ctx = r->aux;
+    server_t *srv = r->handle;
+    if (ctx->resp_hdr_count >= MAX_EXTRA_HEADERS || ctx->resp_hdr_count >= srv->config.max_resp_headers) {
+        return ESP_ERR_NO_MEM;
+    }
+    ctx->resp_hdr_field[ctx->resp_hdr_count] = field;
+    ctx->resp_hdr_value[ctx->resp_hdr_count] = value;
+    ctx->resp_hdr_count++;
+    return ESP_OK;
+}
+
+static esp_err_t send_headers(httpd_req_t *r, const char *length_hdr) {
+    req_ctx_t *ctx = r->aux;
+    char buf[1024];
+    int n = snprintf(buf, sizeof(buf), "HTTP/1.1 %s\r\nContent-Type: %s\r\n%s",
+                     ctx->status, ctx->type, length_hdr);
+    bool has_connection = false;
+    for (int i = 0; i < ctx->resp_hdr_count && n < (int)sizeof(buf); i++) {
+        n += snprintf(buf + n, sizeof(buf) - n, "%s: %s\r\n", ctx->resp_hdr_field[i], ctx->resp_hdr_value[i]);
+        has_connection |= strcasecmp(ctx->resp_hdr_field[i], "Connection") == 0;
+    }
+    if (!has_connection && n < (int)sizeof(buf)) {
+        n += snprintf(buf + n, sizeof(buf) - n, "Connection: close\r\n");
+    }
+    if (n >= (int)sizeof(buf) - 2) return ESP_ERR_INVALID_SIZE;
+    n += snprintf(buf + n, sizeof(buf) - n, "\r\n");
+    ctx->headers_sent = true;
+    return send_all(ctx, r, buf, (size_t)n) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len) {
+    req_ctx_t *ctx = r->aux;
+    if (ctx->headers_sent) return ESP_ERR_INVALID_STATE;
+    size_t len = buf == NULL ? 0 : (buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)buf_len);
+    char length_hdr[48];
+    snprintf(length_hdr, sizeof(length_hdr), "Content-Length: %zu\r\n", len);
+    esp_err_t err = send_headers(r, length_hdr);
+    if (err == ESP_OK && len > 0 && send_all(ctx, r, buf, len) != 0) err = ESP_FAIL;
+    return err;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len) {
+    req_ctx_t *ctx = r->aux;
+    if (!ctx->headers_sent && send_headers(r, "Transfer-Encoding: chunked\r\n") != ESP_OK) {
+        return ESP_FAIL;
+    }
+    size_t len = buf == NULL ? 0 : (buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)buf_len);
+    char size_line[16];
+    int n = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+    if (send_all(ctx, r, size_line, (size_t)n) != 0 ||
+        (len > 0 && send_all(ctx, r, buf, len) != 0) ||
+        send_all(ctx, r, "\r\n", 2) != 0) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg) {
+    static const char *const status[] = {
+        [HTTPD_500_INTERNAL_SERVER_ERROR] = "500 Internal Server Error",
+        [HTTPD_501_METHOD_NOT_IMPLEMENTED] = "501 Method Not Implemented",
+        [HTTPD_505_VERSION_NOT_SUPPORTED] = "505 Version Not Supported",
+        [HTTPD_400_BAD_REQUEST] = "400 Bad Request",
+        [HTTPD_401_UNAUTHORIZED] = "401 Unauthorized",
+        [HTTPD_403_FORBIDDEN] = "403 Forbidden",
+        [HTTPD_404_NOT_FOUND] = "404 Not Found",
+        [HTTPD_405_METHOD_NOT_ALLOWED] = "405 Method Not Allowed",
+        [HTTPD_408_REQ_TIMEOUT] = "408 Request Timeout",
+        [HTTPD_411_LENGTH_REQUIRED] = "411 Length Required",
+        [HTTPD_414_URI_TOO_LONG] = "414 URI Too Long",
+        [HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE] = "431 Request Header Fields Too Large",
+    };
+    req_ctx_t *ctx = req->aux;
+    ctx->status = status[error];
+    ctx->type = "text/html";
+    ESP_LOGW(TAG, "%s - %s", status[error], msg);
+    return httpd_resp_send(req, msg, HTTPD_RESP_USE_STRLEN);
+}
+
+// --- Roteamento ---
+
+bool httpd_uri_match_wildcard(const char *tpl, const char *uri, size_t match_upto) {
+    size_t tpl_len = strlen(tpl);
+    if (tpl_len == 0) return false;
+    bool asterisk = tpl[tpl_len - 1] == '*';
+    size_t exact = asterisk ? tpl_len - 1 : tpl_len;
+    bool quest = exact > 0 && tpl[exact - 1] == '?';
+    if (quest) exact--;
+
+    if (!asterisk && !quest) {
+        return tpl_len == match_upto && strncmp(tpl, uri, match_upto) == 0;
+    }
+    // '?': o último caractere antes dele é opcional; '*': qualquer sufixo
+    if (match_upto < exact) {
+        return quest && match_upto == exact - 1 && strncmp(tpl, uri, match_upto) == 0;
+    }
+    if (strncmp(tpl, uri, exact) != 0) return false;
+    return asterisk || match_upto == exact;
+}
+
+static bool match_exact(const char *tpl, const char *uri, size_t match_upto) {
+    return strlen(tpl) == match_upto && strncmp(tpl, uri, match_upto) == 0;
+}
+
+static int parse_method(const char *text, size_t len) {
+    static const struct { const char *name; int method; } methods[] = {
+        { "GET", HTTP_GET }, { "POST", HTTP_POST }, { "HEAD", HTTP_HEAD },
+        { "PUT", HTTP_PUT }, { "DELETE", HTTP_DELETE },
+    };
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        if (strlen(methods[i].name) == len && strncmp(methods[i].name, text, len) == 0) return methods[i].method;
+    }
+    return -1;
+}
+
+// Lê os cabeçalhos; o que vier do corpo junto fica em ctx->extra
+static httpd_err_code_t read_request(server_t *srv, req_ctx_t *ctx) {
+    char buf[CONFIG_HTTPD_MAX_REQ_HDR_LEN];
+    size_t len = 0;
+    for (;;) {
+        if (len == sizeof(buf)) return HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE;
+        if (!wait_fd(ctx->fd, POLLIN, srv->config.recv_wait_timeout)) return HTTPD_408_REQ_TIMEOUT;
+        ssize_t n = recv(ctx->fd, buf + len, sizeof(buf) - len, 0);
+        if (n <= 0) return HTTPD_408_REQ_TIMEOUT;
+        len += (size_t)n;
+        char *end = memmem(buf, len, "\r\n\r\n", 4);
+        if (end != NULL) {
+            ctx->hdr_len = (size_t)(end - buf) + 2;   // Mantém o último "\r\n"
+            memcpy(ctx->hdr, buf, ctx->hdr_len);
+            ctx->hdr[ctx->hdr_len] = '\0';
+            ctx->extra_len = len - ctx->hdr_len - 2;
+            memcpy(ctx->extra, end + 4, ctx->extra_len);
+            return HTTPD_500_INTERNAL_SERVER_ERROR;   // Sem erro
+        }
+    }
+}
+
+static void handle_connection(server_t *srv, int fd) {
+    req_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    httpd_req_t *req = calloc(1, sizeof(*req));
+    if (ctx == NULL || req == NULL) {
+        free(ctx);
+        free(req);
+        return;
+    }
+    ctx->fd = fd;
+    ctx->status = "200 OK";
+    ctx->type = "text/html";
+    req->handle = srv;
+    req->aux = ctx;
+
+    httpd_err_code_t err = read_request(srv, ctx);
+    if (err == HTTPD_408_REQ_TIMEOUT) {
+        goto done;   // Cliente fechou ou não mandou nada: nada a responder
+    }
+    if (err != HTTPD_500_INTERNAL_SERVER_ERROR) {
+        httpd_resp_send_err(req, err, "Header fields are too long");
+        goto done;
+    }
+
+    // Linha da requisição: MÉTODO URI VERSÃO
+    char *sp1 = strchr(ctx->hdr, ' ');
+    char *sp2 = sp1 != NULL ? strchr(sp1 + 1, ' ') : NULL;
+    char *eol = strstr(ctx->hdr, "\r\n");
+    if (sp1 == NULL || sp2 == NULL || sp2 > eol) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad request line");
+        goto done;
+    }
+    req->method = parse_method(ctx->hdr, (size_t)(sp1 - ctx->hdr));
+    size_t uri_len = (size_t)(sp2 - sp1 - 1);
+    if (uri_len > CONFIG_HTTPD_MAX_URI_LEN) {
+        httpd_resp_send_err(req, HTTPD_414_URI_TOO_LONG, "URI is too long");
+        goto done;
+    }
+    memcpy((char *)req->uri, sp1 + 1, uri_len);
+    ((char *)req->uri)[uri_len] = '\0';
+
+    char cl[24];
+    if (httpd_req_get_hdr_value_str(req, "Content-Length", cl, sizeof(cl)) == ESP_OK) {
+        req->content_len = strtoul(cl, NULL, 10);
+    }
+    ctx->body_left = req->content_len;
+
+    const char *q = strchr(req->uri, '?');
+    size_t match_upto = q != NULL ? (size_t)(q - req->uri) : uri_len;
+    httpd_uri_match_func_t match = srv->config.uri_match_fn != NULL ? srv->config.uri_match_fn : match_exact;
+    const httpd_uri_t *found = NULL;
+    bool uri_known = false;
+    for (int i = 0; i < srv->handler_count && found == NULL; i++) {
+        if (match(srv->handlers[i].uri, req->uri, match_upto)) {
+            uri_known = true;
+            if ((int)srv->handlers[i].method == req->method) found = &srv->handlers[i];
+        }
+    }
+    if (found == NULL) {
+        if (uri_known) {
+            httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, "Request method for this URI is not handled by server");
+        } else {
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Nothing matches the given URI");
+        }
+        goto done;
+    }
+    req->user_ctx = found->user_ctx;
+    if (found->handler(req) != ESP_OK) {
+        ESP_LOGD(TAG, "Handler for %s failed; closing connection", found->uri);
+    }
+
+done:
+    free(ctx);
+    free(req);
+}
+
+static void server_task(void *arg) {
+    server_t *srv = arg;
+    while (!srv->stop) {
+        struct pollfd p = { .fd = srv->listen_fd, .events = POLLIN };
+        sim_io_begin();
+        int rc = poll(&p, 1, ACCEPT_POLL_MS);
+        int fd = rc > 0 ? accept(srv->listen_fd, NULL, NULL) : -1;
+        sim_io_end();
+        if (fd < 0) continue;
+
+        if (srv->config.open_fn != NULL && srv->config.open_fn(srv, fd) != ESP_OK) {
+            close(fd);
+            continue;
+        }
+        handle_connection(srv, fd);
+        if (srv->config.close_fn != NULL) {
+            srv->config.close_fn(srv, fd);
+        } else {
+            close(fd);
+        }
+    }
+    srv->exited = true;
+    vTaskDelete(NULL);
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config) {
+    server_t *srv = calloc(1, sizeof(*srv));
+    if (srv == NULL) return ESP_ERR_NO_MEM;
+    srv->config = *config;
+    srv->listen_fd = -1;
+    srv->handlers = calloc(config->max_uri_handlers, sizeof(httpd_uri_t));
+    if (srv->handlers == NULL) {
+        free(srv);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (listen_port > 0) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in addr = {
+            .sin_family = AF_INET,
+            .sin_port = htons((uint16_t)listen_port),
+            .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        };
+        if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, config->backlog_conn) != 0) {
+            ESP_LOGE(TAG, "Cannot listen on 127.0.0.1:%d: %s", listen_port, strerror(errno));
+            if (fd >= 0) close(fd);
+            free(srv->handlers);
+            free(srv);
+            return ESP_FAIL;
+        }
+        srv->listen_fd = fd;
+        srv->task = sim_task_create(server_task, "httpd", srv, config->task_priority);
+        ESP_LOGI(TAG, "Serving on http://127.0.0.1:%d/", listen_port);
+    }
+    *handle = srv;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle) {
+    server_t *srv = handle;
+    if (srv == NULL) return ESP_ERR_INVALID_ARG;
+    if (srv->task != NULL) {
+        srv->stop = true;
+        while (!srv->exited) {
+            vTaskDelay(1);
+        }
+    }
+    if (srv->listen_fd >= 0) close(srv->listen_fd);
+    free(srv->handlers);
+    free(srv);
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler) {
+    server_t *srv = handle;
+    for (int i = 0; i < srv->handler_count; i++) {
+        if (srv->handlers[i].method == uri_handler->method && strcmp(srv->handlers[i].uri, uri_handler->uri) == 0) {
+            return ESP_ERR_INVALID_STATE;   // ESP_ERR_HTTPD_HANDLER_EXISTS
+        }
+    }
+    if (srv->handler_count >= srv->config.max_uri_handlers) {
+        ESP_LOGE(TAG, "No slots left for registering handler (max_uri_handlers = %u)", srv->config.max_uri_handlers);
+        return ESP_ERR_NO_MEM;   // ESP_ERR_HTTPD_HANDLERS_FULL
+    }
+    srv->handlers[srv->handler_count++] = *uri_handler;
+    return ESP_OK;
+}
@@ -0,0 +1,5 @@
+#pragma once
+#include "driver/gpio.h"
+
+esp_err_t rtc_gpio_pullup_en(gpio_num_t pin);
+esp_err_t rtc_gpio_pulldown_dis(gpio_num_t pin);
@@ -0,0 +1,9 @@
+#pragma once
+// A memória RTC vira duas seções do executável; o deep sleep simulado as
+// salva e restaura ao "reiniciar" o processo (ver sim/platform.c).
+#define RTC_DATA_ATTR       __attribute__((section("sim_rtc_data")))
+#define RTC_NOINIT_ATTR     __attribute__((section("sim_rtc_noinit")))
+#define RTC_SLOW_ATTR       RTC_DATA_ATTR
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define EXT_RAM_BSS_ATTR
@@ -0,0 +1,8 @@
+#pragma once
+#include "esp_err.h"
+
+typedef struct esp_netif_obj esp_netif_t;
+
+esp_err_t esp_netif_init(void);
+esp_netif_t *esp_netif_create_default_wifi_ap(void);
+void esp_netif_destroy_default_wifi(void *esp_netif);
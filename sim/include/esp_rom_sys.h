@@ -0,0 +1,5 @@
+#pragma once
+#include <stdint.h>
+
+// Espera ativa: avança o relógio virtual sem ceder a CPU
+void esp_rom_delay_us(uint32_t us);
@@ -0,0 +1,6 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+// Microssegundos desde a partida, no relógio virtual do simulador
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,42 @@
+#pragma once
+// FreeRTOS do simulador: as tarefas são threads POSIX, mas só uma executa
+// por vez (núcleo único, sem preempção) e o tempo é virtual. Ver sim/kernel.c.
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sdkconfig.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define configTICK_RATE_HZ          CONFIG_FREERTOS_HZ
+#define configMAX_PRIORITIES        25
+#define configMAX_TASK_NAME_LEN     16
+#define portTICK_PERIOD_MS          (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY               ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)           ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTICKS_TO_MS(ticks)        ((TickType_t)(((uint64_t)(ticks) * 1000) / configTICK_RATE_HZ))
+
+#define pdFALSE         ((BaseType_t)0)
+#define pdTRUE          ((BaseType_t)1)
+#define pdFAIL          pdFALSE
+#define pdPASS          pdTRUE
+#define errQUEUE_EMPTY  ((BaseType_t)0)
+#define errQUEUE_FULL   ((BaseType_t)0)
+
+#define tskIDLE_PRIORITY    ((UBaseType_t)0)
+#define tskNO_AFFINITY      ((BaseType_t)0x7FFFFFFF)
+
+// Sem preempção, as seções críticas não precisam travar nada
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+#define portENTER_CRITICAL(mux)         (void)(mux)
+#define portEXIT_CRITICAL(mux)          (void)(mux)
+#define portENTER_CRITICAL_ISR(mux)     (void)(mux)
+#define portEXIT_CRITICAL_ISR(mux)      (void)(mux)
+#define portYIELD_FROM_ISR(woken)       (void)(woken)
+
+BaseType_t xPortGetCoreID(void);
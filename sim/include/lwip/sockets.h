@@ -0,0 +1,10 @@
+#pragma once
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// select() bloqueia em E/S real: devolve a CPU virtual enquanto espera
+int sim_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
+#define select(nfds, r, w, e, t) sim_select(nfds, r, w, e, t)
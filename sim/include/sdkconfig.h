@@ -0,0 +1,6 @@
+#pragma once
+// Configuração do build do simulador (equivalente ao sdkconfig do IDF)
+#define CONFIG_IDF_TARGET_LINUX         1
+#define CONFIG_FREERTOS_HZ              100
+#define CONFIG_HTTPD_MAX_URI_LEN        512
+#define CONFIG_HTTPD_MAX_REQ_HDR_LEN    1024
@@ -0,0 +1,15 @@
+#pragma once
+// Incluído à força (-include) em todos os fontes do firmware no build do
+// simulador: o relógio de parede passa a ser o virtual.
+#include <sys/time.h>
+#include <time.h>
+
+time_t sim_time(time_t *out);
+int sim_gettimeofday(struct timeval *tv, void *tz);
+int sim_settimeofday(const struct timeval *tv, const struct timezone *tz);
+int sim_adjtime(const struct timeval *delta, struct timeval *old_delta);
+
+#define time(out)               sim_time(out)
+#define gettimeofday(tv, tz)    sim_gettimeofday(tv, tz)
+#define settimeofday(tv, tz)    sim_settimeofday(tv, tz)
+#define adjtime(delta, old)     sim_adjtime(delta, old)
@@ -0,0 +1,3 @@
+#pragma once
+// No ESP-IDF o dirent vem de <sys/dirent.h>; no Linux, de <dirent.h>
+#include <dirent.h>
@@ -0,0 +1,793 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "sim.h"
+
+// FreeRTOS em tempo virtual.
+//
+// Cada tarefa é uma thread POSIX, mas só a dona do "token" (current)
+// executa: é um núcleo único sem fatiamento de tempo, com preempção apenas
+// nos pontos em que o FreeRTOS também trocaria de tarefa (uma tarefa de
+// prioridade maior fica pronta). O relógio virtual só anda em dois casos:
+//   - espera ativa (esp_rom_delay_us, bit-bang do DS1302), somada na hora;
+//   - todas as tarefas bloqueadas: o escalonador salta até o próximo prazo.
+// Uma simulação de dias roda em segundos e é determinística para a mesma
+// semente. Com --speed > 0 os saltos são cadenciados pelo relógio real,
+// para interagir com o servidor HTTP.
+
+static const char *TAG = "SIM_KERNEL";
+
+typedef enum {
+    TASK_READY,
+    TASK_RUNNING,
+    TASK_BLOCKED,
+    TASK_SUSPENDED,
+    TASK_IO,          // Fora da CPU virtual, em E/S real
+    TASK_DEAD,
+} task_state_t;
+
+struct sim_task {
+    pthread_t thread;
+    pthread_cond_t cv;
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t priority;
+    task_state_t state;
+    uint64_t ready_seq;          // Ordem FIFO entre tarefas de mesma prioridade
+    int64_t wake_at;             // SIM_FOREVER = sem prazo
+    const void *wait_obj;        // Objeto cuja mudança acorda a tarefa
+    uint32_t notify_value;
+    bool notify_pending;
+    TaskFunction_t fn;
+    void *arg;
+    struct sim_task *next;
+};
+
+typedef enum {
+    QUEUE_KIND_QUEUE,
+    QUEUE_KIND_SEMAPHORE,
+    QUEUE_KIND_MUTEX,
+    QUEUE_KIND_RECURSIVE_MUTEX,
+} queue_kind_t;
+
+struct QueueDefinition {
+    queue_kind_t kind;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t *storage;
+    TaskHandle_t holder;
+    UBaseType_t recursion;
+};
+
+static pthread_mutex_t K = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sched_cv;
+static __thread struct sim_task *self_task;
+
+static struct sim_task *tasks;
+static struct sim_task *current;
+static uint64_t ready_counter;
+static int io_tasks;
+static bool stop_requested;
+
+static int64_t clock_us;
+static int64_t boot_at_us;
+static int64_t end_us;
+static double speed;
+
+int64_t sim_clock_us(void) { return clock_us; }
+int64_t sim_boot_at_us(void) { return boot_at_us; }
+int64_t sim_end_us(void) { return end_us; }
+bool sim_in_task(void) { return self_task != NULL; }
+
+int64_t esp_timer_get_time(void) {
+    return clock_us - boot_at_us;
+}
+
+void esp_rom_delay_us(uint32_t us) {
+    sim_busy_us(us);
+}
+
+void sim_busy_us(int64_t us) {
+    clock_us += us;
+}
+
+BaseType_t xPortGetCoreID(void) {
+    return 0;
+}
+
+// --- Escalonamento (sempre com K travado) ---
+
+static void make_ready(struct sim_task *t) {
+    t->state = TASK_READY;
+    t->wait_obj = NULL;
+    t->wake_at = SIM_FOREVER;
+    t->ready_seq = ++ready_counter;
+}
+
+static void wake_waiters(const void *obj) {
+    for (struct sim_task *t = tasks; t != NULL; t = t->next) {
+        if (t->state == TASK_BLOCKED && t->wait_obj == obj) {
+            make_ready(t);
+        }
+    }
+}
+
+// Entrega a CPU ao escalonador e espera ser escolhida de novo
+static void give_up_cpu(struct sim_task *self) {
+    current = NULL;
+    pthread_cond_signal(&sched_cv);
+    if (self->state == TASK_DEAD || self->state == TASK_IO) {
+        return;
+    }
+    while (current != self) {
+        pthread_cond_wait(&self->cv, &K);
+    }
+    self->state = TASK_RUNNING;
+}
+
+// Preempção: uma tarefa de prioridade maior ficou pronta
+static void preempt_check(void) {
+    struct sim_task *self = self_task;
+    if (self == NULL || current != self) {
+        return;
+    }
+    for (struct sim_task *t = tasks; t != NULL; t = t->next) {
+        if (t->state == TASK_READY && t->priority > self->priority) {
+            make_ready(self);
+            give_up_cpu(self);
+            return;
+        }
+    }
+}
+
+static int64_t tick_deadline(TickType_t ticks) {
+    if (ticks == portMAX_DELAY) {
+        return SIM_FOREVER;
+    }
+    int64_t tick = (clock_us - boot_at_us) / SIM_TICK_US;
+    return boot_at_us + (tick + (int64_t)ticks) * SIM_TICK_US;
+}
+
+static void block_until(const void *obj, int64_t deadline) {
+    struct sim_task *self = self_task;
+    self->state = TASK_BLOCKED;
+    self->wait_obj = obj;
+    self->wake_at = deadline;
+    give_up_cpu(self);
+}
+
+// Fora de uma tarefa (thread principal no fim da simulação) nada bloqueia
+static bool can_wait(int64_t deadline) {
+    return self_task != NULL && deadline > clock_us;
+}
+
+static struct sim_task *pick_ready(void) {
+    struct sim_task *best = NULL;
+    for (struct sim_task *t = tasks; t != NULL; t = t->next) {
+        if (t->state != TASK_READY) continue;
+        if (best == NULL || t->priority > best->priority ||
+            (t->priority == best->priority && t->ready_seq < best->ready_seq)) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+// Acorda, em ordem de prazo, as tarefas cujo prazo já passou
+static void expire_timers(void) {
+    for (;;) {
+        struct sim_task *first = NULL;
+        for (struct sim_task *t = tasks; t != NULL; t = t->next) {
+            if (t->state == TASK_BLOCKED && t->wake_at <= clock_us &&
+                (first == NULL || t->wake_at < first->wake_at)) {
+                first = t;
+            }
+        }
+        if (first == NULL) return;
+        make_ready(first);
+    }
+}
+
+static int64_t next_deadline(void) {
+    int64_t next = SIM_FOREVER;
+    for (struct sim_task *t = tasks; t != NULL; t = t->next) {
+        if (t->state == TASK_BLOCKED && t->wake_at < next) {
+            next = t->wake_at;
+        }
+    }
+    return next;
+}
+
+static int64_t real_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Avança o relógio até 'target'. Com --speed, espera o tempo real
+// correspondente; uma tarefa que volta da E/S interrompe a espera.
+static void advance_to(int64_t target) {
+    if (speed <= 0) {
+        clock_us = target;
+        return;
+    }
+    int64_t start_ns = real_now_ns();
+    int64_t wait_ns = (int64_t)((target - clock_us) * 1000.0 / speed);
+    int64_t until_ns = start_ns + wait_ns;
+    struct timespec ts = { .tv_sec = until_ns / 1000000000LL, .tv_nsec = until_ns % 1000000000LL };
+    int rc = pthread_cond_timedwait(&sched_cv, &K, &ts);
+    if (rc == ETIMEDOUT) {
+        clock_us = target;
+        return;
+    }
+    int64_t elapsed_us = (int64_t)((real_now_ns() - start_ns) / 1000.0 * speed);
+    clock_us += (elapsed_us < target - clock_us) ? elapsed_us : target - clock_us;
+}
+
+void sim_kernel_init(const sim_kernel_config_t *cfg) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sched_cv, &attr);
+    pthread_condattr_destroy(&attr);
+
+    clock_us = cfg->start_clock_us;
+    boot_at_us = cfg->start_clock_us;
+    end_us = cfg->end_clock_us;
+    speed = cfg->speed;
+}
+
+int64_t sim_kernel_run(void) {
+    pthread_mutex_lock(&K);
+    while (!stop_requested) {
+        if (current != NULL) {
+            pthread_cond_wait(&sched_cv, &K);
+            continue;
+        }
+        expire_timers();
+        struct sim_task *next = pick_ready();
+        if (next != NULL) {
+            current = next;
+            pthread_cond_signal(&next->cv);
+            continue;
+        }
+
+        int64_t deadline = next_deadline();
+        if (deadline > end_us) {
+            if (clock_us >= end_us) break;
+            deadline = end_us;
+        }
+        if (deadline == SIM_FOREVER && io_tasks == 0) {
+            break;
+        }
+        if (deadline > clock_us) {
+            advance_to(deadline);
+        }
+    }
+    int64_t final = clock_us;
+    pthread_mutex_unlock(&K);
+    return final;
+}
+
+void sim_kernel_stop(void) {
+    pthread_mutex_lock(&K);
+    stop_requested = true;
+    pthread_cond_signal(&sched_cv);
+    pthread_mutex_unlock(&K);
+}
+
+void sim_sleep_until(int64_t when) {
+    pthread_mutex_lock(&K);
+    if (can_wait(when)) {
+        block_until(NULL, when);
+    }
+    pthread_mutex_unlock(&K);
+}
+
+void sim_io_begin(void) {
+    struct sim_task *self = self_task;
+    if (self == NULL) return;
+    pthread_mutex_lock(&K);
+    self->state = TASK_IO;
+    io_tasks++;
+    give_up_cpu(self);
+    pthread_mutex_unlock(&K);
+}
+
+void sim_io_end(void) {
+    struct sim_task *self = self_task;
+    if (self == NULL) return;
+    pthread_mutex_lock(&K);
+    io_tasks--;
+    make_ready(self);
+    pthread_cond_signal(&sched_cv);
+    while (current != self) {
+        pthread_cond_wait(&self->cv, &K);
+    }
+    self->state = TASK_RUNNING;
+    pthread_mutex_unlock(&K);
+}
+
+// --- Tarefas ---
+
+static void *task_entry(void *arg) {
+    struct sim_task *t = arg;
+    pthread_mutex_lock(&K);
+    self_task = t;
+    while (current != t) {
+        pthread_cond_wait(&t->cv, &K);
+    }
+    t->state = TASK_RUNNING;
+    pthread_mutex_unlock(&K);
+
+    t->fn(t->arg);
+
+    // No FreeRTOS retornar de uma tarefa é erro; aqui apenas encerra
+    esp_log_write(ESP_LOG_WARN, TAG, "Task %s returned without vTaskDelete", t->name);
+    vTaskDelete(NULL);
+    return NULL;
+}
+
+static struct sim_task *task_create(TaskFunction_t fn, const char *name, void *arg, UBaseType_t priority) {
+    struct sim_task *t = calloc(1, sizeof(*t));
+    if (t == NULL) return NULL;
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    t->priority = priority;
+    t->fn = fn;
+    t->arg = arg;
+    t->wake_at = SIM_FOREVER;
+    pthread_cond_init(&t->cv, NULL);
+
+    pthread_mutex_lock(&K);
+    make_ready(t);
+    struct sim_task **tail = &tasks;
+    while (*tail != NULL) tail = &(*tail)->next;
+    *tail = t;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 512 * 1024);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&t->thread, &attr, task_entry, t);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        t->state = TASK_DEAD;
+        pthread_mutex_unlock(&K);
+        return NULL;
+    }
+    preempt_check();
+    pthread_mutex_unlock(&K);
+    return t;
+}
+
+TaskHandle_t sim_task_create(void (*fn)(void *), const char *name, void *arg, UBaseType_t priority) {
+    return task_create(fn, name, arg, priority);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core_id) {
+    (void)stack_depth;
+    (void)core_id;
+    struct sim_task *t = task_create(fn, name, arg, priority);
+    if (created != NULL) *created = t;
+    return t != NULL ? pdPASS : pdFAIL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *created) {
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, priority, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    pthread_mutex_lock(&K);
+    struct sim_task *t = task != NULL ? task : self_task;
+    if (t == NULL) {
+        pthread_mutex_unlock(&K);
+        return;
+    }
+    t->state = TASK_DEAD;
+    if (t == self_task) {
+        give_up_cpu(t);
+        pthread_mutex_unlock(&K);
+        pthread_exit(NULL);
+    }
+    // A thread de outra tarefa fica parada para sempre esperando o token
+    pthread_mutex_unlock(&K);
+}
+
+void vTaskSuspend(TaskHandle_t task) {
+    pthread_mutex_lock(&K);
+    struct sim_task *t = task != NULL ? task : self_task;
+    if (t != NULL && t->state != TASK_DEAD) {
+        t->state = TASK_SUSPENDED;
+        t->wait_obj = NULL;
+        if (t == self_task) {
+            give_up_cpu(t);
+        }
+    }
+    pthread_mutex_unlock(&K);
+}
+
+void vTaskResume(TaskHandle_t task) {
+    pthread_mutex_lock(&K);
+    if (task != NULL && task->state == TASK_SUSPENDED) {
+        make_ready(task);
+        preempt_check();
+    }
+    pthread_mutex_unlock(&K);
+}
+
+void taskYIELD(void) {
+    pthread_mutex_lock(&K);
+    if (self_task != NULL) {
+        make_ready(self_task);
+        give_up_cpu(self_task);
+    }
+    pthread_mutex_unlock(&K);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        taskYIELD();
+        return;
+    }
+    pthread_mutex_lock(&K);
+    int64_t deadline = tick_deadline(ticks);
+    if (can_wait(deadline)) {
+        block_until(NULL, deadline);
+    }
+    pthread_mutex_unlock(&K);
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment) {
+    pthread_mutex_lock(&K);
+    TickType_t now = (TickType_t)((clock_us - boot_at_us) / SIM_TICK_US);
+    TickType_t wake = *previous_wake + increment;
+    *previous_wake = wake;
+    BaseType_t delayed = pdFALSE;
+    // Comparação com sinal: o próximo despertar ainda está no futuro
+    if ((int32_t)(wake - now) > 0) {
+        int64_t deadline = boot_at_us + (int64_t)wake * SIM_TICK_US;
+        if (can_wait(deadline)) {
+            block_until(NULL, deadline);
+            delayed = pdTRUE;
+        }
+    }
+    pthread_mutex_unlock(&K);
+    return delayed;
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t increment) {
+    xTaskDelayUntil(previous_wake, increment);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)((clock_us - boot_at_us) / SIM_TICK_US);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return self_task;
+}
+
+char *pcTaskGetName(TaskHandle_t task) {
+    struct sim_task *t = task != NULL ? task : self_task;
+    return t != NULL ? t->name : "main";
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 1024;   // Pilhas das threads são grandes; não há o que medir
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    struct sim_task *t = task != NULL ? task : self_task;
+    return t != NULL ? t->priority : 0;
+}
+
+// --- Notificações ---
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    if (task == NULL) return pdFAIL;
+    pthread_mutex_lock(&K);
+    BaseType_t ret = pdPASS;
+    switch (action) {
+    case eSetBits: task->notify_value |= value; break;
+    case eIncrement: task->notify_value++; break;
+    case eSetValueWithOverwrite: task->notify_value = value; break;
+    case eSetValueWithoutOverwrite:
+        if (task->notify_pending) ret = pdFAIL; else task->notify_value = value;
+        break;
+    case eNoAction: break;
+    }
+    task->notify_pending = true;
+    wake_waiters(&task->notify_value);
+    preempt_check();
+    pthread_mutex_unlock(&K);
+    return ret;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_woken) {
+    xTaskNotify(task, 0, eIncrement);
+    if (higher_priority_woken != NULL) *higher_priority_woken = pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    struct sim_task *self = self_task;
+    if (self == NULL) return 0;
+    pthread_mutex_lock(&K);
+    int64_t deadline = tick_deadline(ticks);
+    uint32_t value = 0;
+    for (;;) {
+        if (self->notify_value > 0) {
+            value = self->notify_value;
+            self->notify_value = clear_on_exit ? 0 : value - 1;
+            self->notify_pending = false;
+            break;
+        }
+        if (!can_wait(deadline)) break;
+        block_until(&self->notify_value, deadline);
+    }
+    pthread_mutex_unlock(&K);
+    return value;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks) {
+    struct sim_task *self = self_task;
+    if (self == NULL) return pdFALSE;
+    pthread_mutex_lock(&K);
+    int64_t deadline = tick_deadline(ticks);
+    if (!self->notify_pending) {
+        self->notify_value &= ~clear_on_entry;
+    }
+    BaseType_t ret = pdFALSE;
+    for (;;) {
+        if (self->notify_pending) {
+            if (value != NULL) *value = self->notify_value;
+            self->notify_value &= ~clear_on_exit;
+            self->notify_pending = false;
+            ret = pdTRUE;
+            break;
+        }
+        if (!can_wait(deadline)) {
+            if (value != NULL) *value = self->notify_value;
+            break;
+        }
+        block_until(&self->notify_value, deadline);
+    }
+    pthread_mutex_unlock(&K);
+    return ret;
+}
+
+// --- Filas ---
+
+static QueueHandle_t queue_alloc(queue_kind_t kind, UBaseType_t length, UBaseType_t item_size, UBaseType_t count) {
+    QueueHandle_t q = calloc(1, sizeof(*q));
+    if (q == NULL) return NULL;
+    q->kind = kind;
+    q->length = length;
+    q->item_size = item_size;
+    q->count = count;
+    if (item_size > 0) {
+        q->storage = calloc(length, item_size);
+        if (q->storage == NULL) {
+            free(q);
+            return NULL;
+        }
+    }
+    return q;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    return queue_alloc(QUEUE_KIND_QUEUE, length, item_size, 0);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if (queue == NULL) return;
+    free(queue->storage);
+    free(queue);
+}
+
+static BaseType_t queue_send(QueueHandle_t q, const void *item, TickType_t ticks, bool front, bool overwrite) {
+    pthread_mutex_lock(&K);
+    int64_t deadline = tick_deadline(ticks);
+    BaseType_t ret = errQUEUE_FULL;
+    for (;;) {
+        if (q->count < q->length || overwrite) {
+            if (overwrite && q->count == q->length) {
+                q->count = 0;
+                q->head = 0;
+            }
+            UBaseType_t slot;
+            if (front) {
+                q->head = (q->head + q->length - 1) % q->length;
+                slot = q->head;
+            } else {
+                slot = (q->head + q->count) % q->length;
+            }
+            if (q->item_size > 0) {
+                memcpy(q->storage + slot * q->item_size, item, q->item_size);
+            }
+            q->count++;
+            wake_waiters(q);
+            preempt_check();
+            ret = pdPASS;
+            break;
+        }
+        if (!can_wait(deadline)) break;
+        block_until(q, deadline);
+    }
+    pthread_mutex_unlock(&K);
+    return ret;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return queue_send(queue, item, ticks, false, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return queue_send(queue, item, ticks, false, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return queue_send(queue, item, ticks, true, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item) {
+    return queue_send(queue, item, 0, false, true);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken) {
+    if (woken != NULL) *woken = pdFALSE;
+    return queue_send(queue, item, 0, false, false);
+}
+
+static BaseType_t queue_receive(QueueHandle_t q, void *item, TickType_t ticks, bool peek) {
+    pthread_mutex_lock(&K);
+    int64_t deadline = tick_deadline(ticks);
+    BaseType_t ret = errQUEUE_EMPTY;
+    for (;;) {
+        if (q->count > 0) {
+            if (q->item_size > 0) {
+                memcpy(item, q->storage + q->head * q->item_size, q->item_size);
+            }
+            if (!peek) {
+                q->head = (q->head + 1) % q->length;
+                q->count--;
+                wake_waiters(q);
+                preempt_check();
+            }
+            ret = pdPASS;
+            break;
+        }
+        if (!can_wait(deadline)) break;
+        block_until(q, deadline);
+    }
+    pthread_mutex_unlock(&K);
+    return ret;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    return queue_receive(queue, item, ticks, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks) {
+    return queue_receive(queue, item, ticks, true);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    return queue->length - queue->count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    pthread_mutex_lock(&K);
+    queue->count = 0;
+    queue->head = 0;
+    wake_waiters(queue);
+    pthread_mutex_unlock(&K);
+    return pdPASS;
+}
+
+// --- Semáforos ---
+// Sem herança de prioridade: o firmware não depende dela.
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return queue_alloc(QUEUE_KIND_MUTEX, 1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) {
+    return queue_alloc(QUEUE_KIND_RECURSIVE_MUTEX, 1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return queue_alloc(QUEUE_KIND_SEMAPHORE, 1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    return queue_alloc(QUEUE_KIND_SEMAPHORE, max_count, 0, initial_count);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    vQueueDelete(sem);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    pthread_mutex_lock(&K);
+    int64_t deadline = tick_deadline(ticks);
+    BaseType_t ret = pdFALSE;
+    for (;;) {
+        if (sem->kind == QUEUE_KIND_RECURSIVE_MUTEX && sem->count == 0 && sem->holder == self_task) {
+            sem->recursion++;
+            ret = pdTRUE;
+            break;
+        }
+        if (sem->count > 0) {
+            sem->count--;
+            sem->holder = self_task;
+            sem->recursion = 1;
+            ret = pdTRUE;
+            break;
+        }
+        if (!can_wait(deadline)) break;
+        block_until(sem, deadline);
+    }
+    pthread_mutex_unlock(&K);
+    return ret;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    pthread_mutex_lock(&K);
+    BaseType_t ret = pdFALSE;
+    bool is_mutex = sem->kind == QUEUE_KIND_MUTEX || sem->kind == QUEUE_KIND_RECURSIVE_MUTEX;
+    if (is_mutex && (sem->count > 0 || sem->holder != self_task)) {
+        // Só quem segura o mutex pode devolvê-lo
+    } else if (sem->kind == QUEUE_KIND_RECURSIVE_MUTEX && --sem->recursion > 0) {
+        ret = pdTRUE;
+    } else if (sem->count < sem->length) {
+        sem->count++;
+        sem->holder = NULL;
+        wake_waiters(sem);
+        preempt_check();
+        ret = pdTRUE;
+    }
+    pthread_mutex_unlock(&K);
+    return ret;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks) {
+    return xSemaphoreTake(sem, ticks);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) {
+    return xSemaphoreGive(sem);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken) {
+    if (woken != NULL) *woken = pdFALSE;
+    return xSemaphoreGive(sem);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem) {
+    return sem->count;
+}
+
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t sem) {
+    return sem->count == 0 ? sem->holder : NULL;
+}
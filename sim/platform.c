@@ -0,0 +1,637 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_rom_crc.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "nvs_flash.h"
+#include "sim.h"
+
+// Serviços do ESP-IDF que o firmware usa além dos drivers da hal.h:
+// log, hora do sistema, NVS, deep sleep/restart, heap e o Wi-Fi (que só
+// liga e desliga o rádio na contabilidade de energia).
+//
+// Deep sleep e esp_restart() reiniciam o próprio processo (execv com
+// --resume). Antes, a memória RTC (seções sim_rtc_data/sim_rtc_noinit),
+// a hora do sistema e o estado dos dispositivos vão para deepsleep.bin no
+// diretório de estado, como a memória RTC e o DS1302 da placa atravessam
+// o sono; todo o resto do firmware parte do zero, como no ESP32.
+
+static const char *TAG = "SIM_PLATFORM";
+
+#define STATE_FILE          "deepsleep.bin"
+#define STATE_MAGIC         0x53494D31   // "SIM1"
+#define NVS_FILE            "nvs.txt"
+#define ADJTIME_RATE_SHIFT  6            // Correção de 1/64 do tempo decorrido, como no IDF
+
+static sim_platform_config_t cfg;
+static sim_boot_state_t boot;
+static int sim_argc;
+static char **sim_argv;
+
+extern char __start_sim_rtc_data[] __attribute__((weak));
+extern char __stop_sim_rtc_data[] __attribute__((weak));
+extern char __start_sim_rtc_noinit[] __attribute__((weak));
+extern char __stop_sim_rtc_noinit[] __attribute__((weak));
+
+int64_t sim_true_epoch_us(int64_t clock_us) {
+    return cfg.start_epoch_s * 1000000 + clock_us;
+}
+
+const sim_boot_state_t *sim_boot_state(void) {
+    return &boot;
+}
+
+void sim_set_argv(int argc, char **argv) {
+    sim_argc = argc;
+    sim_argv = argv;
+}
+
+// --- Log ---
+
+static esp_log_level_t log_level = ESP_LOG_INFO;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    if (strcmp(tag, "*") == 0 && !cfg.quiet) {
+        log_level = level;
+    }
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    if (level > log_level) {
+        return;
+    }
+    // Mesmo formato do IDF, com a hora verdadeira da simulação
+    time_t t = (time_t)(sim_true_epoch_us(sim_clock_us()) / 1000000);
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char when[24];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+
+    flockfile(stdout);
+    printf("%c (%lld) %s %s: ", "NEWIDV"[level], (long long)(esp_timer_get_time() / 1000), when, tag);
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    putchar('\n');
+    funlockfile(stdout);
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_NOT_FINISHED: return "ESP_ERR_NOT_FINISHED";
+    case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+    case ESP_ERR_NVS_INVALID_HANDLE: return "ESP_ERR_NVS_INVALID_HANDLE";
+    case ESP_ERR_NVS_READ_ONLY: return "ESP_ERR_NVS_READ_ONLY";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+// --- Hora do sistema ---
+// Hora do sistema = relógio virtual + offset. Na partida a frio começa em
+// 0 (1970), como no ESP32; atravessa o deep sleep (timer RTC).
+
+static int64_t adj_from_us;
+
+static void adjtime_fold(void) {
+    int64_t now = sim_clock_us();
+    int64_t max = (now - adj_from_us) >> ADJTIME_RATE_SHIFT;
+    int64_t step = boot.adj_remaining_us;
+    if (step > max) step = max;
+    if (step < -max) step = -max;
+    boot.sys_offset_us += step;
+    boot.adj_remaining_us -= step;
+    adj_from_us = now;
+}
+
+static int64_t system_time_us(void) {
+    adjtime_fold();
+    return sim_clock_us() + boot.sys_offset_us;
+}
+
+time_t sim_time(time_t *out) {
+    int64_t us = system_time_us();
+    time_t t = (time_t)(us >= 0 ? us / 1000000 : (us - 999999) / 1000000);
+    if (out != NULL) *out = t;
+    return t;
+}
+
+int sim_gettimeofday(struct timeval *tv, void *tz) {
+    (void)tz;
+    int64_t us = system_time_us();
+    tv->tv_sec = (time_t)(us / 1000000);
+    tv->tv_usec = (suseconds_t)(us % 1000000);
+    return 0;
+}
+
+int sim_settimeofday(const struct timeval *tv, const struct timezone *tz) {
+    (void)tz;
+    adjtime_fold();
+    boot.sys_offset_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec - sim_clock_us();
+    boot.adj_remaining_us = 0;
+    return 0;
+}
+
+int sim_adjtime(const struct timeval *delta, struct timeval *old_delta) {
+    adjtime_fold();
+    if (old_delta != NULL) {
+        old_delta->tv_sec = (time_t)(boot.adj_remaining_us / 1000000);
+        old_delta->tv_usec = (suseconds_t)(boot.adj_remaining_us % 1000000);
+    }
+    if (delta != NULL) {
+        boot.adj_remaining_us = (int64_t)delta->tv_sec * 1000000 + delta->tv_usec;
+    }
+    return 0;
+}
+
+// --- Sistema ---
+
+esp_reset_reason_t esp_reset_reason(void) {
+    return (esp_reset_reason_t)boot.reset_reason;
+}
+
+void esp_restart(void) {
+    ESP_LOGW(TAG, "esp_restart()");
+    sim_reboot(ESP_SLEEP_WAKEUP_UNDEFINED, sim_clock_us(), false);
+}
+
+// O ESP32 tem ~300 KB livres após o boot; o simulador não mede a heap
+uint32_t esp_get_free_heap_size(void) { return 300 * 1024; }
+uint32_t esp_get_minimum_free_heap_size(void) { return 300 * 1024; }
+
+void *heap_caps_malloc(size_t size, uint32_t caps) { (void)caps; return malloc(size); }
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) { (void)caps; return calloc(n, size); }
+void heap_caps_free(void *ptr) { free(ptr); }
+size_t heap_caps_get_free_size(uint32_t caps) { (void)caps; return 300 * 1024; }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { (void)caps; return 300 * 1024; }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { (void)caps; return 110 * 1024; }
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// --- Deep sleep ---
+
+static bool timer_wakeup;
+static uint64_t timer_wakeup_us;
+static int ext0_pin = -1;
+static int ext0_level;
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void) {
+    return (esp_sleep_wakeup_cause_t)boot.wake_cause;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+    timer_wakeup = true;
+    timer_wakeup_us = time_in_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t gpio_num, int level) {
+    ext0_pin = gpio_num;
+    ext0_level = level;
+    return ESP_OK;
+}
+
+void esp_deep_sleep_start(void) {
+    int64_t now = sim_clock_us();
+    int64_t wake = timer_wakeup ? now + (int64_t)timer_wakeup_us : SIM_FOREVER;
+    int cause = ESP_SLEEP_WAKEUP_TIMER;
+    // Só o botão do Wi-Fi é modelado como fonte ext0 (ativo em nível baixo)
+    if (ext0_pin >= 0 && ext0_level == 0) {
+        int64_t press = sim_button_next_press(now);
+        if (press < wake) {
+            wake = press;
+            cause = ESP_SLEEP_WAKEUP_EXT0;
+        }
+    }
+
+    sim_devices_sleep();
+    boot.deep_sleeps++;
+    if (wake >= sim_end_us()) {
+        boot.asleep_us += sim_end_us() - now;
+        sim_busy_us(sim_end_us() - now);
+        sim_finish(true);
+    }
+    boot.asleep_us += wake - now;
+    sim_reboot(cause, wake, true);
+}
+
+typedef struct {
+    uint32_t magic;
+    uint32_t rtc_data_len;
+    uint32_t rtc_noinit_len;
+    uint32_t devices_len;
+    sim_boot_state_t boot;
+} saved_header_t;
+
+static size_t section_len(const char *start, const char *stop) {
+    return (start != NULL && stop != NULL) ? (size_t)(stop - start) : 0;
+}
+
+void sim_reboot(int wake_cause, int64_t wake_clock_us, bool keep_rtc_data) {
+    adjtime_fold();
+    boot.clock_us = wake_clock_us;
+    boot.wake_cause = wake_cause;
+    boot.reset_reason = wake_cause == ESP_SLEEP_WAKEUP_UNDEFINED ? ESP_RST_SW : ESP_RST_DEEPSLEEP;
+    boot.boots++;
+
+    // Depois de esp_restart() a seção .rtc.data volta aos valores iniciais
+    saved_header_t hdr = {
+        .magic = STATE_MAGIC,
+        .rtc_data_len = keep_rtc_data ? section_len(__start_sim_rtc_data, __stop_sim_rtc_data) : 0,
+        .rtc_noinit_len = section_len(__start_sim_rtc_noinit, __stop_sim_rtc_noinit),
+        .devices_len = sim_devices_state_size(),
+        .boot = boot,
+    };
+    char *devices = malloc(hdr.devices_len);
+    sim_devices_save(devices);
+
+    FILE *f = fopen(STATE_FILE, "wb");
+    bool ok = f != NULL &&
+              fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+              fwrite(__start_sim_rtc_data, 1, hdr.rtc_data_len, f) == hdr.rtc_data_len &&
+              fwrite(__start_sim_rtc_noinit, 1, hdr.rtc_noinit_len, f) == hdr.rtc_noinit_len &&
+              fwrite(devices, 1, hdr.devices_len, f) == hdr.devices_len;
+    if (f != NULL && fclose(f) != 0) ok = false;
+    free(devices);
+    if (!ok) {
+        fprintf(stderr, "sim: cannot write %s: %s\n", STATE_FILE, strerror(errno));
+        abort();
+    }
+
+    // Mesmos argumentos, mais --resume
+    char **argv = calloc(sim_argc + 2, sizeof(char *));
+    int argc = 0;
+    for (int i = 0; i < sim_argc; i++) {
+        if (strcmp(sim_argv[i], "--resume") != 0) argv[argc++] = sim_argv[i];
+    }
+    argv[argc++] = "--resume";
+    fflush(stdout);
+    fflush(stderr);
+    execv("/proc/self/exe", argv);
+    fprintf(stderr, "sim: execv failed: %s\n", strerror(errno));
+    abort();
+}
+
+static bool restore_state(void) {
+    FILE *f = fopen(STATE_FILE, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "sim: --resume without %s\n", STATE_FILE);
+        return false;
+    }
+    saved_header_t hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 && hdr.magic == STATE_MAGIC &&
+              hdr.devices_len == sim_devices_state_size() &&
+              (hdr.rtc_data_len == 0 || hdr.rtc_data_len == section_len(__start_sim_rtc_data, __stop_sim_rtc_data)) &&
+              hdr.rtc_noinit_len == section_len(__start_sim_rtc_noinit, __stop_sim_rtc_noinit);
+    char *devices = ok ? malloc(hdr.devices_len) : NULL;
+    ok = ok &&
+         fread(__start_sim_rtc_data, 1, hdr.rtc_data_len, f) == hdr.rtc_data_len &&
+         fread(__start_sim_rtc_noinit, 1, hdr.rtc_noinit_len, f) == hdr.rtc_noinit_len &&
+         fread(devices, 1, hdr.devices_len, f) == hdr.devices_len;
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "sim: %s does not match this build\n", STATE_FILE);
+        free(devices);
+        return false;
+    }
+    sim_devices_restore(devices);
+    free(devices);
+    boot = hdr.boot;
+    unlink(STATE_FILE);
+    return true;
+}
+
+bool sim_platform_init(const sim_platform_config_t *config) {
+    cfg = *config;
+    if (cfg.quiet) {
+        log_level = ESP_LOG_WARN;
+    }
+    if (cfg.resume) {
+        if (!restore_state()) return false;
+    } else {
+        memset(&boot, 0, sizeof(boot));
+        boot.reset_reason = ESP_RST_POWERON;
+        boot.boots = 1;
+    }
+    adj_from_us = boot.clock_us;
+    return true;
+}
+
+// --- select() da lwIP: a espera por E/S libera a CPU virtual ---
+
+int sim_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout) {
+    sim_io_begin();
+    int rc = select(nfds, readfds, writefds, exceptfds, timeout);
+    int saved = errno;
+    sim_io_end();
+    errno = saved;
+    return rc;
+}
+
+// --- Wi-Fi, netif e eventos ---
+
+const esp_event_base_t WIFI_EVENT = "WIFI_EVENT";
+const esp_event_base_t IP_EVENT = "IP_EVENT";
+
+static struct esp_netif_obj { int unused; } ap_netif;
+
+esp_err_t esp_event_loop_create_default(void) { return ESP_OK; }
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler, void *arg) {
+    (void)base; (void)id; (void)handler; (void)arg;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t base, int32_t id, esp_event_handler_t handler) {
+    (void)base; (void)id; (void)handler;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_init(void) { return ESP_OK; }
+esp_netif_t *esp_netif_create_default_wifi_ap(void) { return &ap_netif; }
+void esp_netif_destroy_default_wifi(void *esp_netif) { (void)esp_netif; }
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config) { (void)config; return ESP_OK; }
+esp_err_t esp_wifi_deinit(void) { return ESP_OK; }
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode) { (void)mode; return ESP_OK; }
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf) { (void)interface; (void)conf; return ESP_OK; }
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) { (void)type; return ESP_OK; }
+esp_err_t esp_wifi_set_max_tx_power(int8_t power) { (void)power; return ESP_OK; }
+
+esp_err_t esp_wifi_start(void) {
+    sim_radio_set(true);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void) {
+    sim_radio_set(false);
+    return ESP_OK;
+}
+
+// --- NVS ---
+// Chave/valor em memória, regravado em nvs.txt a cada alteração (uma linha
+// "namespace chave tipo hex" por entrada).
+
+#define NVS_MAX_ENTRIES     64
+#define NVS_MAX_HANDLES     16
+#define NVS_NAME_MAX        16
+
+typedef enum { NVS_TYPE_U8, NVS_TYPE_I32, NVS_TYPE_U32, NVS_TYPE_I64, NVS_TYPE_STR, NVS_TYPE_BLOB } nvs_type_t;
+static const char *const nvs_type_names[] = { "u8", "i32", "u32", "i64", "str", "blob" };
+
+typedef struct {
+    char ns[NVS_NAME_MAX];
+    char key[NVS_NAME_MAX];
+    nvs_type_t type;
+    size_t len;
+    uint8_t *data;
+} nvs_entry_t;
+
+typedef struct {
+    bool open;
+    bool readonly;
+    char ns[NVS_NAME_MAX];
+} nvs_open_t;
+
+static nvs_entry_t nvs_entries[NVS_MAX_ENTRIES];
+static int nvs_count;
+static nvs_open_t nvs_handles[NVS_MAX_HANDLES];
+static bool nvs_loaded;
+
+static nvs_entry_t *nvs_find(const char *ns, const char *key) {
+    for (int i = 0; i < nvs_count; i++) {
+        if (strcmp(nvs_entries[i].ns, ns) == 0 && strcmp(nvs_entries[i].key, key) == 0) {
+            return &nvs_entries[i];
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t nvs_put(const char *ns, const char *key, nvs_type_t type, const void *data, size_t len) {
+    if (strlen(ns) >= NVS_NAME_MAX || strlen(key) >= NVS_NAME_MAX) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+    nvs_entry_t *e = nvs_find(ns, key);
+    if (e == NULL) {
+        if (nvs_count == NVS_MAX_ENTRIES) return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        e = &nvs_entries[nvs_count++];
+        snprintf(e->ns, sizeof(e->ns), "%s", ns);
+        snprintf(e->key, sizeof(e->key), "%s", key);
+    }
+    free(e->data);
+    e->type = type;
+    e->len = len;
+    e->data = malloc(len > 0 ? len : 1);
+    memcpy(e->data, data, len);
+    return ESP_OK;
+}
+
+void sim_nvs_save(void) {
+    FILE *f = fopen(NVS_FILE ".tmp", "w");
+    if (f == NULL) return;
+    for (int i = 0; i < nvs_count; i++) {
+        const nvs_entry_t *e = &nvs_entries[i];
+        fprintf(f, "%s %s %s ", e->ns, e->key, nvs_type_names[e->type]);
+        for (size_t j = 0; j < e->len; j++) fprintf(f, "%02x", e->data[j]);
+        fputc('\n', f);
+    }
+    fclose(f);
+    rename(NVS_FILE ".tmp", NVS_FILE);
+}
+
+static void nvs_load(void) {
+    nvs_loaded = true;
+    FILE *f = fopen(NVS_FILE, "r");
+    if (f == NULL) return;
+    char line[1024];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char ns[NVS_NAME_MAX], key[NVS_NAME_MAX], type[8], hex[900] = "";
+        if (sscanf(line, "%15s %15s %7s %899s", ns, key, type, hex) < 3) continue;
+        uint8_t data[450];
+        size_t len = strlen(hex) / 2;
+        for (size_t j = 0; j < len; j++) {
+            unsigned v;
+            sscanf(hex + 2 * j, "%2x", &v);
+            data[j] = (uint8_t)v;
+        }
+        for (int t = 0; t <= NVS_TYPE_BLOB; t++) {
+            if (strcmp(type, nvs_type_names[t]) == 0) nvs_put(ns, key, (nvs_type_t)t, data, len);
+        }
+    }
+    fclose(f);
+}
+
+void sim_nvs_reset(void) {
+    for (int i = 0; i < nvs_count; i++) free(nvs_entries[i].data);
+    nvs_count = 0;
+    nvs_loaded = true;
+    sim_nvs_save();
+}
+
+void sim_nvs_seed_str(const char *ns, const char *key, const char *value) {
+    nvs_put(ns, key, NVS_TYPE_STR, value, strlen(value) + 1);
+    sim_nvs_save();
+}
+
+void sim_nvs_seed_u32(const char *ns, const char *key, uint32_t value) {
+    nvs_put(ns, key, NVS_TYPE_U32, &value, sizeof(value));
+    sim_nvs_save();
+}
+
+void sim_nvs_seed_blob(const char *ns, const char *key, const void *data, size_t len) {
+    nvs_put(ns, key, NVS_TYPE_BLOB, data, len);
+    sim_nvs_save();
+}
+
+esp_err_t nvs_flash_init(void) {
+    if (!nvs_loaded) nvs_load();
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    sim_nvs_reset();
+    return ESP_OK;
+}
+
+static nvs_open_t *handle_get(nvs_handle_t handle) {
+    if (handle == 0 || handle > NVS_MAX_HANDLES || !nvs_handles[handle - 1].open) return NULL;
+    return &nvs_handles[handle - 1];
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *out) {
+    if (!nvs_loaded) return ESP_ERR_NVS_NOT_INITIALIZED;
+    if (strlen(name) >= NVS_NAME_MAX) return ESP_ERR_NVS_INVALID_NAME;
+    // Só leitura num namespace que não existe: como no IDF, NOT_FOUND
+    if (mode == NVS_READONLY) {
+        bool exists = false;
+        for (int i = 0; i < nvs_count && !exists; i++) exists = strcmp(nvs_entries[i].ns, name) == 0;
+        if (!exists) return ESP_ERR_NVS_NOT_FOUND;
+    }
+    for (int i = 0; i < NVS_MAX_HANDLES; i++) {
+        if (!nvs_handles[i].open) {
+            nvs_handles[i].open = true;
+            nvs_handles[i].readonly = mode == NVS_READONLY;
+            snprintf(nvs_handles[i].ns, sizeof(nvs_handles[i].ns), "%s", name);
+            *out = (nvs_handle_t)(i + 1);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    nvs_open_t *h = handle_get(handle);
+    if (h != NULL) h->open = false;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return handle_get(handle) != NULL ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    nvs_open_t *h = handle_get(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (h->readonly) return ESP_ERR_NVS_READ_ONLY;
+    nvs_entry_t *e = nvs_find(h->ns, key);
+    if (e == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    free(e->data);
+    *e = nvs_entries[--nvs_count];
+    sim_nvs_save();
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    nvs_open_t *h = handle_get(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (h->readonly) return ESP_ERR_NVS_READ_ONLY;
+    for (int i = nvs_count - 1; i >= 0; i--) {
+        if (strcmp(nvs_entries[i].ns, h->ns) == 0) {
+            free(nvs_entries[i].data);
+            nvs_entries[i] = nvs_entries[--nvs_count];
+        }
+    }
+    sim_nvs_save();
+    return ESP_OK;
+}
+
+static esp_err_t nvs_set(nvs_handle_t handle, const char *key, nvs_type_t type, const void *data, size_t len) {
+    nvs_open_t *h = handle_get(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (h->readonly) return ESP_ERR_NVS_READ_ONLY;
+    esp_err_t err = nvs_put(h->ns, key, type, data, len);
+    if (err == ESP_OK) sim_nvs_save();
+    return err;
+}
+
+static esp_err_t nvs_get_fixed(nvs_handle_t handle, const char *key, nvs_type_t type, void *out, size_t len) {
+    nvs_open_t *h = handle_get(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    nvs_entry_t *e = nvs_find(h->ns, key);
+    if (e == NULL || e->type != type || e->len != len) return ESP_ERR_NVS_NOT_FOUND;
+    memcpy(out, e->data, len);
+    return ESP_OK;
+}
+
+static esp_err_t nvs_get_var(nvs_handle_t handle, const char *key, nvs_type_t type, void *out, size_t *length) {
+    nvs_open_t *h = handle_get(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    nvs_entry_t *e = nvs_find(h->ns, key);
+    if (e == NULL || e->type != type) return ESP_ERR_NVS_NOT_FOUND;
+    if (out == NULL) {
+        *length = e->len;
+        return ESP_OK;
+    }
+    if (*length < e->len) return ESP_ERR_NVS_INVALID_LENGTH;
+    memcpy(out, e->data, e->len);
+    *length = e->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t h, const char *key, uint8_t v) { return nvs_set(h, key, NVS_TYPE_U8, &v, sizeof(v)); }
+esp_err_t nvs_set_i32(nvs_handle_t h, const char *key, int32_t v) { return nvs_set(h, key, NVS_TYPE_I32, &v, sizeof(v)); }
+esp_err_t nvs_set_u32(nvs_handle_t h, const char *key, uint32_t v) { return nvs_set(h, key, NVS_TYPE_U32, &v, sizeof(v)); }
+esp_err_t nvs_set_i64(nvs_handle_t h, const char *key, int64_t v) { return nvs_set(h, key, NVS_TYPE_I64, &v, sizeof(v)); }
+esp_err_t nvs_set_str(nvs_handle_t h, const char *key, const char *v) { return nvs_set(h, key, NVS_TYPE_STR, v, strlen(v) + 1); }
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *v, size_t len) { return nvs_set(h, key, NVS_TYPE_BLOB, v, len); }
+
+esp_err_t nvs_get_u8(nvs_handle_t h, const char *key, uint8_t *out) { return nvs_get_fixed(h, key, NVS_TYPE_U8, out, sizeof(*out)); }
+esp_err_t nvs_get_i32(nvs_handle_t h, const char *key, int32_t *out) { return nvs_get_fixed(h, key, NVS_TYPE_I32, out, sizeof(*out)); }
+esp_err_t nvs_get_u32(nvs_handle_t h, const char *key, uint32_t *out) { return nvs_get_fixed(h, key, NVS_TYPE_U32, out, sizeof(*out)); }
+esp_err_t nvs_get_i64(nvs_handle_t h, const char *key, int64_t *out) { return nvs_get_fixed(h, key, NVS_TYPE_I64, out, sizeof(*out)); }
+esp_err_t nvs_get_str(nvs_handle_t h, const char *key, char *out, size_t *length) { return nvs_get_var(h, key, NVS_TYPE_STR, out, length); }
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *length) { return nvs_get_var(h, key, NVS_TYPE_BLOB, out, length); }
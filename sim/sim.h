@@ -0,0 +1,143 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Simulador da placa no PC: o firmware de main/ roda sem alterações sobre
+// um FreeRTOS cooperativo em tempo virtual (kernel.c), os serviços do
+// ESP-IDF que ele usa (platform.c, httpd.c) e modelos dos dispositivos
+// ligados à hal.h (devices.c). Este cabeçalho é interno ao simulador.
+
+// --- Relógio virtual ---
+// 'sim_clock_us' conta desde o início da simulação (sobrevive ao deep
+// sleep); esp_timer_get_time() conta desde o último boot.
+#define SIM_TICK_US     (1000000LL / configTICK_RATE_HZ)
+#define SIM_FOREVER     INT64_MAX
+
+int64_t sim_clock_us(void);
+int64_t sim_boot_at_us(void);
+int64_t sim_end_us(void);
+
+// Hora "verdadeira" (local, em epoch) no instante do relógio virtual
+int64_t sim_true_epoch_us(int64_t clock_us);
+
+// --- Kernel ---
+typedef struct {
+    int64_t start_clock_us;      // Relógio virtual no boot
+    int64_t end_clock_us;        // Fim da simulação
+    double speed;                // Segundos virtuais por segundo real (0 = sem limite)
+} sim_kernel_config_t;
+
+void sim_kernel_init(const sim_kernel_config_t *cfg);
+// Roda o escalonador na thread principal até o fim da simulação ou até
+// todas as tarefas ficarem bloqueadas para sempre. Retorna o relógio final.
+int64_t sim_kernel_run(void);
+// Chamado de dentro de uma tarefa: encerra o laço do escalonador.
+void sim_kernel_stop(void);
+
+bool sim_in_task(void);
+// Espera ativa (esp_rom_delay_us, bit-bang): o relógio anda, a CPU não é cedida
+void sim_busy_us(int64_t us);
+// Bloqueia a tarefa atual até o instante dado do relógio virtual
+void sim_sleep_until(int64_t clock_us);
+// Trechos de E/S real (sockets): a CPU virtual fica livre para as demais tarefas
+void sim_io_begin(void);
+void sim_io_end(void);
+// Tarefas internas do simulador (botão, sincronização pelo celular, httpd)
+TaskHandle_t sim_task_create(void (*fn)(void *), const char *name, void *arg, UBaseType_t priority);
+
+// --- Plataforma (deep sleep, NVS, hora do sistema) ---
+typedef struct {
+    int64_t start_epoch_s;       // Hora verdadeira no relógio virtual zero
+    bool resume;                 // Processo reiniciado por deep sleep/restart
+    bool quiet;                  // Só avisos e erros no log
+} sim_platform_config_t;
+
+// Com 'resume', restaura a memória RTC, os dispositivos e a hora do
+// sistema salvos por sim_reboot(). O diretório atual é o de estado.
+bool sim_platform_init(const sim_platform_config_t *cfg);
+void sim_nvs_reset(void);
+void sim_nvs_seed_str(const char *ns, const char *key, const char *value);
+void sim_nvs_seed_u32(const char *ns, const char *key, uint32_t value);
+void sim_nvs_seed_blob(const char *ns, const char *key, const void *data, size_t len);
+void sim_nvs_save(void);
+
+typedef struct {
+    int64_t clock_us;
+    int64_t sys_offset_us;       // Hora do sistema = relógio + offset
+    int64_t adj_remaining_us;
+    int wake_cause;              // esp_sleep_wakeup_cause_t
+    int reset_reason;            // esp_reset_reason_t
+    uint32_t boots;
+    uint32_t deep_sleeps;
+    int64_t asleep_us;
+} sim_boot_state_t;
+
+const sim_boot_state_t *sim_boot_state(void);
+// Reinicia o processo (execv) levando a memória RTC e os dispositivos
+void sim_reboot(int wake_cause, int64_t wake_clock_us, bool keep_rtc_data) __attribute__((noreturn));
+void sim_set_argv(int argc, char **argv);
+// Fim da simulação (sim_main.c): grava o resumo e encerra o processo.
+// 'asleep': o fim chegou durante o deep sleep (nada é gravado no SD).
+void sim_finish(bool asleep) __attribute__((noreturn));
+
+// --- Dispositivos ---
+typedef struct {
+    int64_t start_epoch_s;       // Hora verdadeira no início da simulação
+    double rtc_drift_ppm;        // + = DS1302 adianta
+    int64_t rtc_offset_s;        // Erro inicial do DS1302
+    bool rtc_halted;             // DS1302 sem bateria (CH = 1)
+    const char *co2_script;      // Arquivo "HH:MM ppm" (NULL = curva padrão)
+    double co2_error_rate;       // Quadros corrompidos/perdidos por leitura
+    double dht_error_rate;
+    bool no_sd;
+    uint64_t seed;
+} sim_devices_config_t;
+
+typedef struct {
+    uint32_t co2_requests;
+    uint32_t co2_responses;
+    uint32_t co2_corrupted;
+    uint32_t co2_unpowered;
+    uint32_t dht_reads;
+    uint32_t dht_failures;
+    uint32_t rtc_transactions;
+    uint32_t rtc_writes;
+    int64_t co2_on_us;           // Sensor energizado (contabilidade de energia)
+    int64_t radio_on_us;
+} sim_device_stats_t;
+
+void sim_devices_init(const sim_devices_config_t *cfg);
+// Estado que atravessa o reinício do processo (deep sleep)
+size_t sim_devices_state_size(void);
+void sim_devices_save(void *buf);
+void sim_devices_restore(const void *buf);
+void sim_devices_get_stats(sim_device_stats_t *out);
+void sim_devices_sleep(void);          // Periféricos sem energia no deep sleep
+int64_t sim_rtc_epoch_us(void);        // Hora do DS1302 agora (para o resumo)
+// Registrador de hora 0-6 do DS1302 lido com um valor cru (chip sem
+// bateria, ruído no barramento); -1 volta à hora do chip
+void sim_rtc_force_reg(int reg, int value);
+void sim_radio_set(bool on);
+
+// Botão (GPIO14): pressionamentos agendados em relógio virtual
+void sim_button_schedule(const int64_t *clock_us, int count);
+int64_t sim_button_next_press(int64_t after_clock_us);
+void sim_button_start(int64_t from_clock_us);
+int sim_gpio_input_level(int pin);
+void sim_gpio_fire_isr(int pin);
+
+// --- Servidor HTTP ---
+void sim_httpd_set_port(int port);
+
+// --- Utilidades ---
+uint64_t sim_rand_u64(void);
+double sim_rand_uniform(void);
+double sim_rand_gauss(void);
+bool sim_parse_duration(const char *text, int64_t *out_us);
+
+#endif // SIM_H
@@ -0,0 +1,365 @@
+// Simulador da estação no PC: roda o firmware de main/ em tempo virtual,
+// com os sensores, o DS1302, o cartão SD (diretório sdcard/) e o servidor
+// HTTP (socket local) simulados. Dias de agenda rodam em segundos.
+//
+//   cmake -S sim -B build-sim && cmake --build build-sim
+//   ./build-sim/co2sim --dir /tmp/estacao --days 3 --rtc-drift 25 --phone-sync 26h
+//   ./build-sim/co2sim --dir /tmp/estacao --days 1 --speed 60 --http 8080
+//
+// O diretório de estado guarda sdcard/, nvs.txt e, entre um deep sleep e o
+// despertar, deepsleep.bin. Sem --fresh a NVS é recriada a cada execução;
+// os arquivos .dat de execuções anteriores permanecem em sdcard/.
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+#include "data_logger.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "record_store.h"
+#include "timekeeping.h"
+
+#define MAX_NVS_SEEDS   16
+
+void app_main(void);
+
+typedef struct {
+    const char *dir;
+    double days;
+    int64_t start_epoch_s;
+    double speed;
+    int http_port;
+    bool fresh;
+    bool quiet;
+    bool resume;
+    int64_t phone_sync_us;
+    int64_t button_us[32];
+    int button_count;
+    const char *nvs_seed[MAX_NVS_SEEDS];
+    bool nvs_seed_u32[MAX_NVS_SEEDS];
+    int nvs_seed_count;
+    sim_devices_config_t devices;
+} options_t;
+
+static options_t opt;
+
+bool sim_parse_duration(const char *text, int64_t *out_us) {
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || value < 0) return false;
+    double unit = 1.0;
+    if (strcmp(end, "ms") == 0) unit = 1e-3;
+    else if (*end == '\0' || strcmp(end, "s") == 0) unit = 1.0;
+    else if (strcmp(end, "m") == 0) unit = 60.0;
+    else if (strcmp(end, "h") == 0) unit = 3600.0;
+    else if (strcmp(end, "d") == 0) unit = 86400.0;
+    else return false;
+    *out_us = (int64_t)llround(value * unit * 1e6);
+    return true;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s [opções]\n"
+            "  --dir DIR            Diretório de estado (padrão: sim-state)\n"
+            "  --days N             Duração da simulação em dias (padrão: 1)\n"
+            "  --start 'AAAA-MM-DD HH:MM'  Hora verdadeira inicial (padrão: 2026-01-20 06:00)\n"
+            "  --speed X            Segundos virtuais por segundo real (padrão: sem limite)\n"
+            "  --http PORTA         Servidor HTTP em 127.0.0.1:PORTA\n"
+            "  --rtc-drift PPM      Deriva do cristal do DS1302 (+ = adianta)\n"
+            "  --rtc-offset S       Erro inicial do DS1302\n"
+            "  --fresh              DS1302 parado e NVS vazia (primeira partida)\n"
+            "  --co2-script ARQ     Curva de CO2 com linhas 'HH:MM ppm'\n"
+            "  --co2-errors P       Fração de quadros da UART corrompidos/perdidos\n"
+            "  --dht-errors P       Fração de leituras do DHT22 com falha\n"
+            "  --no-sd              Cartão SD ausente\n"
+            "  --seed N             Semente do gerador aleatório\n"
+            "  --button T1,T2,...   Pressiona o botão nesses instantes (ex.: 3h,26h)\n"
+            "  --phone-sync T       O celular envia a hora a cada T (ex.: 26h)\n"
+            "  --nvs ns/chave=texto Grava uma string na NVS antes do boot\n"
+            "  --nvs-u32 ns/chave=N Grava um u32 na NVS antes do boot\n"
+            "  --quiet              Só avisos e erros no log\n",
+            prog);
+}
+
+static bool parse_start(const char *text, int64_t *out) {
+    struct tm tm = { 0 };
+    const char *end = strptime(text, "%Y-%m-%d %H:%M", &tm);
+    if (end == NULL || *end != '\0') return false;
+    *out = (int64_t)timegm(&tm);
+    return true;
+}
+
+static bool parse_buttons(char *text) {
+    for (char *tok = strtok(text, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        if (opt.button_count >= (int)(sizeof(opt.button_us) / sizeof(opt.button_us[0]))) return false;
+        if (!sim_parse_duration(tok, &opt.button_us[opt.button_count++])) return false;
+    }
+    return true;
+}
+
+static bool parse_options(int argc, char **argv) {
+    enum {
+        OPT_DIR = 1, OPT_DAYS, OPT_START, OPT_SPEED, OPT_HTTP, OPT_RTC_DRIFT, OPT_RTC_OFFSET, OPT_FRESH,
+        OPT_CO2_SCRIPT, OPT_CO2_ERRORS, OPT_DHT_ERRORS, OPT_NO_SD, OPT_SEED, OPT_BUTTON, OPT_PHONE_SYNC,
+        OPT_NVS, OPT_NVS_U32, OPT_QUIET, OPT_RESUME, OPT_HELP,
+    };
+    static const struct option longopts[] = {
+        { "dir", required_argument, NULL, OPT_DIR },
+        { "days", required_argument, NULL, OPT_DAYS },
+        { "start", required_argument, NULL, OPT_START },
+        { "speed", required_argument, NULL, OPT_SPEED },
+        { "http", required_argument, NULL, OPT_HTTP },
+        { "rtc-drift", required_argument, NULL, OPT_RTC_DRIFT },
+        { "rtc-offset", required_argument, NULL, OPT_RTC_OFFSET },
+        { "fresh", no_argument, NULL, OPT_FRESH },
+        { "co2-script", required_argument, NULL, OPT_CO2_SCRIPT },
+        { "co2-errors", required_argument, NULL, OPT_CO2_ERRORS },
+        { "dht-errors", required_argument, NULL, OPT_DHT_ERRORS },
+        { "no-sd", no_argument, NULL, OPT_NO_SD },
+        { "seed", required_argument, NULL, OPT_SEED },
+        { "button", required_argument, NULL, OPT_BUTTON },
+        { "phone-sync", required_argument, NULL, OPT_PHONE_SYNC },
+        { "nvs", required_argument, NULL, OPT_NVS },
+        { "nvs-u32", required_argument, NULL, OPT_NVS_U32 },
+        { "quiet", no_argument, NULL, OPT_QUIET },
+        { "resume", no_argument, NULL, OPT_RESUME },   // Uso interno (deep sleep)
+        { "help", no_argument, NULL, OPT_HELP },
+        { NULL, 0, NULL, 0 },
+    };
+
+    opt.dir = "sim-state";
+    opt.days = 1.0;
+    parse_start("2026-01-20 06:00", &opt.start_epoch_s);
+    opt.devices.seed = 1;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+            case OPT_DIR: opt.dir = optarg; break;
+            case OPT_DAYS: opt.days = strtod(optarg, NULL); break;
+            case OPT_START:
+                if (!parse_start(optarg, &opt.start_epoch_s)) return false;
+                break;
+            case OPT_SPEED: opt.speed = strtod(optarg, NULL); break;
+            case OPT_HTTP: opt.http_port = atoi(optarg); break;
+            case OPT_RTC_DRIFT: opt.devices.rtc_drift_ppm = strtod(optarg, NULL); break;
+            case OPT_RTC_OFFSET: opt.devices.rtc_offset_s = strtoll(optarg, NULL, 10); break;
+            case OPT_FRESH: opt.fresh = true; break;
+            case OPT_CO2_SCRIPT: opt.devices.co2_script = optarg; break;
+            case OPT_CO2_ERRORS: opt.devices.co2_error_rate = strtod(optarg, NULL); break;
+            case OPT_DHT_ERRORS: opt.devices.dht_error_rate = strtod(optarg, NULL); break;
+            case OPT_NO_SD: opt.devices.no_sd = true; break;
+            case OPT_SEED: opt.devices.seed = strtoull(optarg, NULL, 10); break;
+            case OPT_BUTTON:
+                if (!parse_buttons(optarg)) return false;
+                break;
+            case OPT_PHONE_SYNC:
+                if (!sim_parse_duration(optarg, &opt.phone_sync_us) || opt.phone_sync_us == 0) return false;
+                break;
+            case OPT_NVS:
+            case OPT_NVS_U32:
+                if (opt.nvs_seed_count >= MAX_NVS_SEEDS || strchr(optarg, '/') == NULL || strchr(optarg, '=') == NULL) {
+                    return false;
+                }
+                opt.nvs_seed_u32[opt.nvs_seed_count] = (c == OPT_NVS_U32);
+                opt.nvs_seed[opt.nvs_seed_count++] = optarg;
+                break;
+            case OPT_QUIET: opt.quiet = true; break;
+            case OPT_RESUME: opt.resume = true; break;
+            default: return false;
+        }
+    }
+    if (optind != argc || opt.days <= 0) return false;
+    opt.devices.start_epoch_s = opt.start_epoch_s;
+    opt.devices.rtc_halted = opt.fresh;
+    return true;
+}
+
+// NVS de uma partida nova: o DS1302 já foi acertado antes (a menos de
+// --fresh), então rtc.c não o regrava com a hora de compilação.
+static void seed_nvs(void) {
+    sim_nvs_reset();
+    if (!opt.fresh) {
+        uint8_t initialized = 1;
+        sim_nvs_seed_blob("rtc_config", "rtc_init", &initialized, sizeof(initialized));
+    }
+    for (int i = 0; i < opt.nvs_seed_count; i++) {
+        char spec[256];
+        snprintf(spec, sizeof(spec), "%s", opt.nvs_seed[i]);
+        char *slash = strchr(spec, '/');
+        char *eq = strchr(slash, '=');
+        *slash = '\0';
+        *eq = '\0';
+        if (opt.nvs_seed_u32[i]) {
+            sim_nvs_seed_u32(spec, slash + 1, (uint32_t)strtoul(eq + 1, NULL, 10));
+        } else {
+            sim_nvs_seed_str(spec, slash + 1, eq + 1);
+        }
+    }
+    sim_nvs_save();
+}
+
+// Celular abrindo o Dashboard: POST /time com a hora verdadeira
+static void phone_sync_task(void *arg) {
+    (void)arg;
+    for (;;) {
+        int64_t next = (sim_clock_us() / opt.phone_sync_us + 1) * opt.phone_sync_us;
+        sim_sleep_until(next);
+        timekeeping_set_reference(sim_true_epoch_us(sim_clock_us()) / 1000, esp_timer_get_time());
+    }
+}
+
+// app_main retorna normalmente, como no IDF
+static void main_task(void *arg) {
+    (void)arg;
+    app_main();
+    vTaskDelete(NULL);
+}
+
+static void format_epoch(int64_t epoch_us, char *buf, size_t len) {
+    time_t t = (time_t)(epoch_us / 1000000);
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(buf, len, "%Y-%m-%d %H:%M:%S", &tm);
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void summarize_files(void) {
+    DIR *dir = opendir("sdcard");
+    if (dir == NULL) {
+        printf("Cartão SD:      (vazio)\n");
+        return;
+    }
+    char *names[256];
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < 256) {
+        if (record_store_is_binary(entry->d_name)) names[count++] = strdup(entry->d_name);
+    }
+    closedir(dir);
+    qsort(names, count, sizeof(names[0]), compare_names);
+
+    printf("Cartão SD:      %d arquivo(s)\n", count);
+    uint32_t total = 0;
+    for (int i = 0; i < count; i++) {
+        char path[300];
+        snprintf(path, sizeof(path), "sdcard/%s", names[i]);
+        record_reader_t rd;
+        if (!record_reader_open(&rd, path)) {
+            printf("  %-28s  cabeçalho inválido\n", names[i]);
+            free(names[i]);
+            continue;
+        }
+        record_t rec;
+        uint32_t records = 0, no_co2 = 0;
+        int rc;
+        while ((rc = record_reader_next(&rd, &rec)) != 0) {
+            if (rc < 0) continue;
+            records++;
+            if (rec.co2_ppm < 0) no_co2++;
+        }
+        printf("  %-28s  %4u registros, %u sem CO2, %u com CRC inválido\n",
+               names[i], (unsigned)records, (unsigned)no_co2, (unsigned)rd.crc_errors);
+        total += records;
+        record_reader_close(&rd);
+        free(names[i]);
+    }
+    printf("  Total:         %u registros\n", (unsigned)total);
+}
+
+void sim_finish(bool asleep) {
+    if (!asleep) {
+        data_logger_flush();   // O que ainda está na fila (fim da simulação, não queda de energia)
+    }
+    const sim_boot_state_t *boot = sim_boot_state();
+    int64_t clock = sim_clock_us();
+    sim_device_stats_t stats;
+    sim_devices_get_stats(&stats);
+
+    char true_text[32], rtc_text[32];
+    int64_t true_us = sim_true_epoch_us(clock);
+    int64_t rtc_us = sim_rtc_epoch_us();
+    format_epoch(true_us, true_text, sizeof(true_text));
+    format_epoch(rtc_us, rtc_text, sizeof(rtc_text));
+
+    printf("\n=== Fim da simulação ===\n");
+    printf("Tempo simulado: %.2f h (%s)\n", clock / 3.6e9, true_text);
+    printf("Boots:          %u (%u deep sleeps, %.1f h dormindo)\n",
+           (unsigned)boot->boots, (unsigned)boot->deep_sleeps, boot->asleep_us / 3.6e9);
+    printf("DS1302:         %s (erro %+.1f s)\n", rtc_text, (rtc_us - true_us) / 1e6);
+    printf("MH-Z14A:        %u pedidos, %u respostas, %u corrompidas, %u sem energia; ligado %.1f h\n",
+           (unsigned)stats.co2_requests, (unsigned)stats.co2_responses, (unsigned)stats.co2_corrupted,
+           (unsigned)stats.co2_unpowered, stats.co2_on_us / 3.6e9);
+    printf("DHT22:          %u leituras, %u falhas\n", (unsigned)stats.dht_reads, (unsigned)stats.dht_failures);
+    printf("Rádio:          ligado %.1f h\n", stats.radio_on_us / 3.6e9);
+    summarize_files();
+    fflush(stdout);
+    _exit(0);   // As threads das tarefas continuam paradas nos seus pontos de espera
+}
+
+int main(int argc, char **argv) {
+    if (!parse_options(argc, argv)) {
+        usage(argv[0]);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    if (mkdir(opt.dir, 0755) != 0 && errno != EEXIST) {
+        perror(opt.dir);
+        return 1;
+    }
+    if (chdir(opt.dir) != 0) {
+        perror(opt.dir);
+        return 1;
+    }
+    // O DS1302 guarda hora local e o firmware a trata como UTC
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    sim_set_argv(argc, argv);
+
+    sim_devices_init(&opt.devices);
+    sim_button_schedule(opt.button_us, opt.button_count);
+    sim_httpd_set_port(opt.http_port);
+    sim_platform_config_t platform = {
+        .start_epoch_s = opt.start_epoch_s,
+        .resume = opt.resume,
+        .quiet = opt.quiet,
+    };
+    if (!sim_platform_init(&platform)) {
+        fprintf(stderr, "Estado de deep sleep ausente ou inválido em %s\n", opt.dir);
+        return 1;
+    }
+    if (!opt.resume) {
+        seed_nvs();
+    }
+
+    const sim_boot_state_t *boot = sim_boot_state();
+    sim_kernel_config_t kernel = {
+        .start_clock_us = boot->clock_us,
+        .end_clock_us = (int64_t)llround(opt.days * 86400e6),
+        .speed = opt.speed,
+    };
+    sim_kernel_init(&kernel);
+    sim_task_create(main_task, "main", NULL, 1);
+    // O pressionamento que acordou a placa (EXT0) já foi consumido
+    sim_button_start(boot->wake_cause == ESP_SLEEP_WAKEUP_EXT0 ? boot->clock_us + 1 : boot->clock_us);
+    if (opt.phone_sync_us > 0) {
+        sim_task_create(phone_sync_task, "PhoneSync", NULL, 3);
+    }
+
+    sim_kernel_run();
+    sim_finish(false);
+}
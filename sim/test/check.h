@@ -0,0 +1,46 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Asserções mínimas dos testes do simulador (ctest). Uma falha não para o
+// teste: todas as verificações rodam e o processo sai com 1 se alguma falhou.
+
+static int check_failures;
+static int check_count;
+
+#define CHECK(cond) do { \
+    check_count++; \
+    if (!(cond)) { \
+        check_failures++; \
+        fprintf(stderr, "%s:%d: CHECK falhou: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    long long check_a_ = (long long)(a), check_b_ = (long long)(b); \
+    check_count++; \
+    if (check_a_ != check_b_) { \
+        check_failures++; \
+        fprintf(stderr, "%s:%d: CHECK_EQ falhou: %s == %s (%lld != %lld)\n", \
+                __FILE__, __LINE__, #a, #b, check_a_, check_b_); \
+    } \
+} while (0)
+
+#define CHECK_NEAR(a, b, tol) do { \
+    double check_a_ = (double)(a), check_b_ = (double)(b); \
+    check_count++; \
+    if (!(check_a_ >= check_b_ - (tol) && check_a_ <= check_b_ + (tol))) { \
+        check_failures++; \
+        fprintf(stderr, "%s:%d: CHECK_NEAR falhou: %s ~ %s (%g vs %g, tol %g)\n", \
+                __FILE__, __LINE__, #a, #b, check_a_, check_b_, (double)(tol)); \
+    } \
+} while (0)
+
+static inline int check_report(const char *name) {
+    printf("%s: %d verificações, %d falhas\n", name, check_count, check_failures);
+    return check_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif // CHECK_H
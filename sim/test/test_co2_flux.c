@@ -0,0 +1,150 @@
+// Ajuste linear e fluxo da câmara (main/co2_flux.c)
+
+#include <math.h>
+#include "check.h"
+#include "co2_flux.h"
+
+// Câmara padrão do firmware: 8000 cm³, 400 cm², nível do mar
+static const co2_flux_chamber_t CHAMBER = { .volume_m3 = 0.008f, .area_m2 = 0.04f, .pressure_pa = 101325.0f };
+
+// F = (dC/dt) · P · V / (R · T · A), calculado aqui à parte do módulo
+static double expected_flux(double slope, double temp_c, const co2_flux_chamber_t *c) {
+    return slope * c->pressure_pa * c->volume_m3 / (8.314462618 * (temp_c + 273.15)) / c->area_m2;
+}
+
+// 'n' amostras a cada 2 s: 400 ppm + slope·t + ruído[i % noise_len]
+static void add_series(co2_flux_acc_t *acc, int n, double slope, const double *noise, int noise_len) {
+    co2_flux_init(acc);
+    for (int i = 0; i < n; i++) {
+        double t = 2.0 * i;
+        co2_flux_add(acc, t, 400.0 + slope * t + (noise_len > 0 ? noise[i % noise_len] : 0.0));
+    }
+}
+
+static void test_exact_line(void) {
+    co2_flux_acc_t acc;
+    add_series(&acc, 31, 0.5, NULL, 0);
+    co2_flux_t out;
+    CHECK(co2_flux_finalize(&acc, &CHAMBER, true, 25.0f, &out));
+    CHECK_NEAR(out.slope_ppm_s, 0.5, 1e-6);
+    CHECK_NEAR(out.intercept_ppm, 400.0, 1e-4);
+    CHECK_NEAR(out.r2, 1.0, 1e-6);
+    CHECK_NEAR(out.flux, expected_flux(0.5, 25.0, &CHAMBER), 1e-5);
+    CHECK_EQ(out.flags, CO2_FLUX_COMPUTED);
+}
+
+// O acumulador incremental deve dar o mesmo ajuste que as somas em lote
+static void test_matches_batch_fit(void) {
+    static const double noise[] = { 3.0, -1.5, 0.5, -4.0, 2.5, -0.5, 1.0 };
+    enum { N = 61 };
+    co2_flux_acc_t acc;
+    add_series(&acc, N, -0.2, noise, 7);
+
+    double st = 0, sc = 0;
+    for (int i = 0; i < N; i++) {
+        st += 2.0 * i;
+        sc += 400.0 - 0.2 * 2.0 * i + noise[i % 7];
+    }
+    double tm = st / N, cm = sc / N, stt = 0, scc = 0, stc = 0;
+    for (int i = 0; i < N; i++) {
+        double dt = 2.0 * i - tm, dc = 400.0 - 0.2 * 2.0 * i + noise[i % 7] - cm;
+        stt += dt * dt;
+        scc += dc * dc;
+        stc += dt * dc;
+    }
+
+    co2_flux_t out;
+    CHECK(co2_flux_finalize(&acc, &CHAMBER, true, 25.0f, &out));
+    CHECK_NEAR(out.slope_ppm_s, stc / stt, 1e-6);
+    CHECK_NEAR(out.intercept_ppm, cm - stc / stt * tm, 1e-3);
+    CHECK_NEAR(out.r2, stc * stc / (stt * scc), 1e-6);
+    CHECK(out.r2 > CO2_FLUX_MIN_R2 && out.r2 < 1.0f);
+    CHECK_EQ(out.flags, CO2_FLUX_COMPUTED);
+}
+
+// Lei dos gases: o fluxo cai com a temperatura e sobe com a pressão
+static void test_temperature_pressure(void) {
+    co2_flux_acc_t acc;
+    add_series(&acc, 31, 0.5, NULL, 0);
+    co2_flux_t warm, cold, no_temp, low_p;
+
+    CHECK(co2_flux_finalize(&acc, &CHAMBER, true, 25.0f, &warm));
+    CHECK(co2_flux_finalize(&acc, &CHAMBER, true, 0.0f, &cold));
+    CHECK_NEAR(cold.flux, expected_flux(0.5, 0.0, &CHAMBER), 1e-5);
+    CHECK_NEAR(cold.flux / warm.flux, 298.15 / 273.15, 1e-5);
+
+    // Serra (~900 m): pressão menor, menos moles na câmara
+    co2_flux_chamber_t high = CHAMBER;
+    high.pressure_pa = 91000.0f;
+    CHECK(co2_flux_finalize(&acc, &high, true, 25.0f, &low_p));
+    CHECK_NEAR(low_p.flux / warm.flux, 91000.0 / 101325.0, 1e-5);
+
+    // DHT falhou: usa CO2_FLUX_DEFAULT_TEMP_C e sinaliza
+    CHECK(co2_flux_finalize(&acc, &CHAMBER, false, -40.0f, &no_temp));
+    CHECK_NEAR(no_temp.flux, expected_flux(0.5, CO2_FLUX_DEFAULT_TEMP_C, &CHAMBER), 1e-5);
+    CHECK_EQ(no_temp.flags, CO2_FLUX_COMPUTED | CO2_FLUX_NO_TEMP);
+}
+
+// Sem tendência e com oscilação: ajuste ruim, sinalizado mas gravado
+static void test_low_r2(void) {
+    static const double zigzag[] = { 6.0, -6.0 };
+    co2_flux_acc_t acc;
+    add_series(&acc, 31, 0.01, zigzag, 2);
+    co2_flux_t out;
+    CHECK(co2_flux_finalize(&acc, &CHAMBER, true, 25.0f, &out));
+    CHECK(out.r2 < CO2_FLUX_MIN_R2);
+    CHECK_EQ(out.flags, CO2_FLUX_COMPUTED | CO2_FLUX_LOW_R2);
+}
+
+// Série constante: fluxo zero com R² indefinido, não um ajuste perfeito
+static void test_flat(void) {
+    co2_flux_acc_t acc;
+    add_series(&acc, 31, 0.0, NULL, 0);
+    co2_flux_t out;
+    CHECK(co2_flux_finalize(&acc, &CHAMBER, true, 25.0f, &out));
+    CHECK_NEAR(out.slope_ppm_s, 0.0, 1e-9);
+    CHECK_NEAR(out.flux, 0.0, 1e-9);
+    CHECK_NEAR(out.intercept_ppm, 400.0, 1e-6);
+    CHECK_NEAR(out.r2, 0.0, 1e-9);
+    CHECK_EQ(out.flags, CO2_FLUX_COMPUTED | CO2_FLUX_FLAT);
+}
+
+static void test_few_samples(void) {
+    co2_flux_acc_t acc;
+    co2_flux_t out;
+
+    add_series(&acc, CO2_FLUX_MIN_SAMPLES - 1, 0.5, NULL, 0);
+    CHECK(co2_flux_finalize(&acc, &CHAMBER, true, 25.0f, &out));
+    CHECK_NEAR(out.slope_ppm_s, 0.5, 1e-6);
+    CHECK_EQ(out.flags, CO2_FLUX_COMPUTED | CO2_FLUX_FEW_SAMPLES);
+
+    add_series(&acc, CO2_FLUX_MIN_SAMPLES, 0.5, NULL, 0);
+    CHECK(co2_flux_finalize(&acc, &CHAMBER, true, 25.0f, &out));
+    CHECK_EQ(out.flags, CO2_FLUX_COMPUTED);
+
+    // Uma amostra, ou todas no mesmo instante: não há reta
+    add_series(&acc, 1, 0.5, NULL, 0);
+    CHECK(!co2_flux_finalize(&acc, &CHAMBER, true, 25.0f, &out));
+    CHECK_EQ(out.flags, 0);
+    CHECK_NEAR(out.flux, 0.0, 1e-9);
+
+    co2_flux_init(&acc);
+    co2_flux_add(&acc, 10.0, 410.0);
+    co2_flux_add(&acc, 10.0, 430.0);
+    CHECK(!co2_flux_finalize(&acc, &CHAMBER, true, 25.0f, &out));
+    CHECK_EQ(out.flags, 0);
+    CHECK_NEAR(out.intercept_ppm, 420.0, 1e-6);
+
+    co2_flux_init(&acc);
+    CHECK(!co2_flux_finalize(&acc, &CHAMBER, true, 25.0f, &out));
+}
+
+int main(void) {
+    test_exact_line();
+    test_matches_batch_fit();
+    test_temperature_pressure();
+    test_low_r2();
+    test_flat();
+    test_few_samples();
+    return check_report("test_co2_flux");
+}
@@ -0,0 +1,84 @@
+// Critério de parada da amostragem adaptativa (co2_stats_converged)
+
+#include "check.h"
+#include "co2_stats.h"
+
+// Padrões do firmware: AMOSTRAS_MIN e TOLERANCIA_MEDIANA_PPM em
+// co2_sensor_task.c, PIPELINE_MAX_SAMPLES em measurement_pipeline.h
+#define SAMPLES_MIN     15
+#define SAMPLES_MAX     61
+#define HALF_WIDTH_PPM  2.0f
+
+// Regra de parada de take_sample para um canal: retorna quantas amostras
+// foram tomadas. 'pattern' se repete ao redor de 420 ppm.
+static int sample_until_done(const int *pattern, int pattern_len, float half_width_ppm) {
+    co2_stats_acc_t acc;
+    co2_stats_init(&acc);
+    for (int n = 1;; n++) {
+        co2_stats_add(&acc, 420 + pattern[(n - 1) % pattern_len]);
+        if (n >= SAMPLES_MAX || (n >= SAMPLES_MIN && co2_stats_converged(&acc, half_width_ppm))) {
+            return n;
+        }
+    }
+}
+
+// Ar parado: variância zero, para assim que o mínimo é atingido
+static void test_constant_stops_at_min(void) {
+    static const int flat[] = { 0 };
+    CHECK_EQ(sample_until_done(flat, 1, HALF_WIDTH_PPM), SAMPLES_MIN);
+
+    co2_stats_acc_t acc;
+    co2_stats_init(&acc);
+    co2_stats_add(&acc, 420);
+    CHECK(!co2_stats_converged(&acc, HALF_WIDTH_PPM));   // Uma amostra não tem variância
+    co2_stats_add(&acc, 420);
+    CHECK(co2_stats_converged(&acc, HALF_WIDTH_PPM));
+}
+
+// Ar turbulento (±20 ppm): precisaria de ~600 amostras, vai até o máximo
+static void test_noisy_runs_to_max(void) {
+    static const int noisy[] = { 20, -20 };
+    CHECK_EQ(sample_until_done(noisy, 2, HALF_WIDTH_PPM), SAMPLES_MAX);
+}
+
+// Ruído do sensor (±6 ppm): 1,96 · 1,2533 · 6 / √n ≤ 2 a partir de n ≈ 55
+static void test_sensor_noise_converges_between(void) {
+    static const int sensor[] = { 6, -6 };
+    co2_stats_acc_t acc;
+    co2_stats_init(&acc);
+    for (int n = 1; n <= 60; n++) {
+        co2_stats_add(&acc, 420 + sensor[(n - 1) % 2]);
+        if (n == 50) CHECK(!co2_stats_converged(&acc, HALF_WIDTH_PPM));
+    }
+    CHECK(co2_stats_converged(&acc, HALF_WIDTH_PPM));
+    CHECK(!co2_stats_converged(&acc, HALF_WIDTH_PPM / 2));   // Tolerância menor, mais amostras
+
+    int n = sample_until_done(sensor, 2, HALF_WIDTH_PPM);
+    CHECK(n > 50 && n <= 60);
+}
+
+// A mediana final não depende de quando a coleta parou
+static void test_finalize_after_stop(void) {
+    static const int sensor[] = { 6, -6, 2, -2, 0 };
+    int samples[SAMPLES_MAX];
+    co2_stats_acc_t acc;
+    co2_stats_init(&acc);
+    for (int i = 0; i < SAMPLES_MIN; i++) {
+        samples[i] = 420 + sensor[i % 5];
+        co2_stats_add(&acc, samples[i]);
+    }
+    co2_stats_t out;
+    CHECK(co2_stats_finalize(&acc, samples, SAMPLES_MIN, 0.1f, &out));
+    CHECK_EQ(out.n_valid, SAMPLES_MIN);
+    CHECK_EQ(out.median, 420);
+    CHECK_EQ(out.min, 414);
+    CHECK_EQ(out.max, 426);
+}
+
+int main(void) {
+    test_constant_stops_at_min();
+    test_noisy_runs_to_max();
+    test_sensor_noise_converges_between();
+    test_finalize_after_stop();
+    return check_report("test_co2_stats");
+}
@@ -0,0 +1,118 @@
+// Lote por tamanho do data_logger (main/data_logger.c) sobre o SD
+// simulado: o que fica no cartão termina sempre num registro inteiro. A
+// fila na memória RTC se perde numa queda de energia, e o arquivo tem de
+// continuar legível quando o próximo registro chega.
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "check.h"
+#include "sim.h"
+#include "data_logger.h"
+#include "freertos/semphr.h"
+#include "record_store.h"
+#include "sd_card.h"
+
+#define START_EPOCH 1768892400   // 2026-01-20 07:00:00
+#define DAY_FILE    "sdcard/2026-01-20-Medio" RECORD_STORE_EXT
+#define SECTOR_RECORDS ((DATA_LOGGER_FLUSH_BYTES + sizeof(record_t) - 1) / sizeof(record_t))
+
+// Memória RTC sem inicialização do simulador (esp_attr.h): onde fica a fila
+extern char __start_sim_rtc_noinit[];
+extern char __stop_sim_rtc_noinit[];
+
+// Definido em main.c no firmware
+SemaphoreHandle_t xSensorMutex = NULL;
+
+// Chamado pelo deep sleep do simulador; não ocorre aqui
+void sim_finish(bool asleep) {
+    (void)asleep;
+    _exit(1);
+}
+
+static void append(int i) {
+    record_t rec = {
+        .estrato_id = ESTRATO_MEDIO,
+        .turno_id = TURNO_MANHA,
+        .timestamp = (uint32_t)(START_EPOCH + i * 1800),
+        .co2_ppm = 400 + i,
+    };
+    record_seal(&rec);
+    CHECK_EQ(data_logger_append(0, DAY_FILE, &rec, sizeof(rec)), ESP_OK);
+}
+
+static long file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static void test_task(void *arg) {
+    (void)arg;
+    xSensorMutex = xSemaphoreCreateMutex();
+    CHECK(mount_sd_card());
+    CHECK_EQ(data_logger_init(record_store_file_header, sizeof(record_t), NULL), ESP_OK);
+
+    // 1. Um lote por tamanho: grava até o limite do setor, o resto fica na fila
+    int queued = (int)SECTOR_RECORDS;
+    for (int i = 0; i < queued; i++) {
+        append(i);
+    }
+    vTaskDelay(pdMS_TO_TICKS(100));
+    data_logger_stats_t st;
+    data_logger_get_stats(&st);
+    CHECK_EQ(st.flushes, 1);
+    CHECK(st.records_flushed > 0 && st.records_flushed < (uint32_t)queued);
+    long size = file_size(DAY_FILE);
+    CHECK(size > 0 && size <= DATA_LOGGER_SECTOR_SIZE);
+    CHECK_EQ((size - (long)sizeof(record_file_header_t)) % (long)sizeof(record_t), 0);
+
+    // 2. Queda de energia: a fila some, o cartão fica como está
+    int on_card = (int)st.records_flushed;
+    memset(__start_sim_rtc_noinit, 0, (size_t)(__stop_sim_rtc_noinit - __start_sim_rtc_noinit));
+
+    // 3. O próximo registro continua o arquivo alinhado
+    append(queued);
+    CHECK_EQ(data_logger_flush(), ESP_OK);
+
+    record_reader_t rd;
+    CHECK(record_reader_open(&rd, DAY_FILE));
+    CHECK_EQ(rd.count, on_card + 1);
+    record_t rec;
+    int i = 0, rc;
+    while ((rc = record_reader_next(&rd, &rec)) != 0) {
+        CHECK_EQ(rc, 1);
+        CHECK_EQ(rec.co2_ppm, 400 + (i < on_card ? i : queued));
+        i++;
+    }
+    CHECK_EQ(i, on_card + 1);
+    CHECK_EQ(rd.crc_errors, 0);
+    record_reader_close(&rd);
+
+    sim_kernel_stop();
+    vTaskSuspend(NULL);
+}
+
+int main(void) {
+    // Estado próprio no diretório de trabalho; o arquivo de uma execução
+    // anterior não pode sobrar
+    if ((mkdir("data-logger", 0755) != 0 && errno != EEXIST) || chdir("data-logger") != 0) {
+        perror("data-logger");
+        return 1;
+    }
+    unlink(DAY_FILE);
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    sim_devices_config_t devices = { .start_epoch_s = START_EPOCH, .seed = 1 };
+    sim_devices_init(&devices);
+    sim_platform_config_t platform = { .start_epoch_s = devices.start_epoch_s, .quiet = true };
+    sim_platform_init(&platform);
+    sim_nvs_reset();
+
+    sim_kernel_config_t kernel = { .start_clock_us = 0, .end_clock_us = 3600LL * 1000000 };
+    sim_kernel_init(&kernel);
+    sim_task_create(test_task, "Test", NULL, 5);
+    sim_kernel_run();
+    return check_report("test_data_logger");
+}
@@ -0,0 +1,142 @@
+// Enquadramento e checksum do MH-Z14A (main/mhz14a_protocol.c)
+
+#include <string.h>
+#include "check.h"
+#include "mhz14a_protocol.h"
+
+// Resposta de leitura válida com a concentração dada
+static void make_frame(uint8_t frame[MHZ14A_FRAME_LEN], int ppm) {
+    memset(frame, 0, MHZ14A_FRAME_LEN);
+    frame[0] = MHZ14A_START_BYTE;
+    frame[1] = MHZ14A_CMD_READ_CO2;
+    frame[2] = (uint8_t)(ppm >> 8);
+    frame[3] = (uint8_t)ppm;
+    frame[4] = 0x47;                    // Temperatura + 40 (não usada)
+    frame[MHZ14A_FRAME_LEN - 1] = mhz14a_checksum(frame);
+}
+
+// Alimenta os bytes; retorna quantos quadros foram completados (último ppm em *ppm)
+static int feed(mhz14a_parser_t *p, const uint8_t *bytes, size_t len, int *ppm) {
+    int frames = 0;
+    for (size_t i = 0; i < len; i++) {
+        frames += mhz14a_parser_push(p, bytes[i], ppm);
+    }
+    return frames;
+}
+
+static void test_read_cmd(void) {
+    static const uint8_t expected[MHZ14A_FRAME_LEN] = { 0xFF, 0x01, 0x86, 0, 0, 0, 0, 0, 0x79 };
+    uint8_t cmd[MHZ14A_FRAME_LEN];
+    mhz14a_build_read_cmd(cmd);
+    CHECK(memcmp(cmd, expected, sizeof(cmd)) == 0);
+}
+
+static void test_valid_frame(void) {
+    mhz14a_parser_t p;
+    mhz14a_parser_init(&p);
+    uint8_t frame[MHZ14A_FRAME_LEN];
+    make_frame(frame, 612);
+    int ppm = -1;
+    CHECK_EQ(feed(&p, frame, sizeof(frame), &ppm), 1);
+    CHECK_EQ(ppm, 612);
+    CHECK_EQ(p.frames_ok, 1);
+    CHECK_EQ(p.checksum_errors, 0);
+    CHECK_EQ(p.bytes_discarded, 0);
+    CHECK_EQ(p.len, 0);
+}
+
+static void test_bad_checksum(void) {
+    mhz14a_parser_t p;
+    mhz14a_parser_init(&p);
+    uint8_t frame[MHZ14A_FRAME_LEN];
+    make_frame(frame, 612);
+    frame[MHZ14A_FRAME_LEN - 1] ^= 0x01;
+    int ppm = -1;
+    CHECK_EQ(feed(&p, frame, sizeof(frame), &ppm), 0);
+    CHECK_EQ(ppm, -1);
+    CHECK_EQ(p.frames_ok, 0);
+    CHECK_EQ(p.checksum_errors, 1);
+
+    // O parser continua utilizável: o próximo quadro bom é aceito
+    make_frame(frame, 433);
+    CHECK_EQ(feed(&p, frame, sizeof(frame), &ppm), 1);
+    CHECK_EQ(ppm, 433);
+    CHECK_EQ(p.checksum_errors, 1);
+}
+
+static void test_missing_header(void) {
+    mhz14a_parser_t p;
+    mhz14a_parser_init(&p);
+    uint8_t frame[MHZ14A_FRAME_LEN];
+    make_frame(frame, 612);
+    // Sem o 0xFF inicial nada vira quadro e tudo é descartado
+    int ppm = -1;
+    CHECK_EQ(feed(&p, frame + 1, sizeof(frame) - 1, &ppm), 0);
+    CHECK_EQ(ppm, -1);
+    CHECK_EQ(p.frames_ok, 0);
+    CHECK_EQ(p.checksum_errors, 0);
+    CHECK_EQ(p.bytes_discarded, sizeof(frame) - 1);
+    CHECK_EQ(p.len, 0);
+
+    // 0xFF seguido de outro comando que não a leitura também é descartado
+    const uint8_t other[] = { 0xFF, 0x99, 0x00 };
+    CHECK_EQ(feed(&p, other, sizeof(other), &ppm), 0);
+    CHECK_EQ(p.len, 0);
+}
+
+static void test_split_frame(void) {
+    mhz14a_parser_t p;
+    mhz14a_parser_init(&p);
+    uint8_t frame[MHZ14A_FRAME_LEN];
+    make_frame(frame, 1999);
+    int ppm = -1;
+    // Duas leituras da UART: o quadro chega em pedaços
+    CHECK_EQ(feed(&p, frame, 4, &ppm), 0);
+    CHECK_EQ(p.len, 4);
+    CHECK_EQ(feed(&p, frame + 4, sizeof(frame) - 4, &ppm), 1);
+    CHECK_EQ(ppm, 1999);
+    CHECK_EQ(p.checksum_errors, 0);
+
+    // mhz14a_parser_reset descarta o pedaço pendente
+    CHECK_EQ(feed(&p, frame, 5, &ppm), 0);
+    mhz14a_parser_reset(&p);
+    CHECK_EQ(p.len, 0);
+    CHECK_EQ(feed(&p, frame + 5, sizeof(frame) - 5, &ppm), 0);
+    CHECK_EQ(p.frames_ok, 1);
+}
+
+static void test_garbage_resync(void) {
+    mhz14a_parser_t p;
+    mhz14a_parser_init(&p);
+    uint8_t frame[MHZ14A_FRAME_LEN];
+    make_frame(frame, 745);
+    int ppm = -1;
+
+    // Lixo antes do cabeçalho, incluindo um 0xFF repetido
+    const uint8_t garbage[] = { 0x00, 0x13, 0xFF, 0xFF };
+    CHECK_EQ(feed(&p, garbage, sizeof(garbage), &ppm), 0);
+    CHECK_EQ(feed(&p, frame + 1, sizeof(frame) - 1, &ppm), 1);   // O último 0xFF inicia o quadro
+    CHECK_EQ(ppm, 745);
+    CHECK_EQ(p.checksum_errors, 0);
+
+    // Um "FF 86" falso logo antes do quadro real: os nove primeiros bytes
+    // falham no checksum e o parser reencontra o quadro dentro deles
+    uint8_t stream[2 + MHZ14A_FRAME_LEN] = { 0xFF, MHZ14A_CMD_READ_CO2 };
+    memcpy(stream + 2, frame, sizeof(frame));
+    CHECK(mhz14a_checksum(stream) != stream[MHZ14A_FRAME_LEN - 1]);
+    ppm = -1;
+    CHECK_EQ(feed(&p, stream, sizeof(stream), &ppm), 1);
+    CHECK_EQ(ppm, 745);
+    CHECK_EQ(p.checksum_errors, 1);
+    CHECK_EQ(p.frames_ok, 2);
+}
+
+int main(void) {
+    test_read_cmd();
+    test_valid_frame();
+    test_bad_checksum();
+    test_missing_header();
+    test_split_frame();
+    test_garbage_resync();
+    return check_report("mhz14a_protocol");
+}
@@ -0,0 +1,110 @@
+// Transporte do DS1302 (main/rtc.c) sobre o modelo do chip em sim/devices.c:
+// leitura e escrita em burst e a recusa de registradores fora da faixa.
+// Roda sem o kernel: o bit-bang só anda o relógio virtual.
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "check.h"
+#include "sim.h"
+#include "rtc.h"
+#include "freertos/semphr.h"
+
+#define START_EPOCH 1768892400   // 2026-01-20 07:00:00
+
+// Definido em main.c no firmware
+SemaphoreHandle_t xSensorMutex = NULL;
+
+// Chamado pelo deep sleep do simulador; não ocorre aqui
+void sim_finish(bool asleep) {
+    (void)asleep;
+    _exit(1);
+}
+
+static uint32_t rtc_transactions(void) {
+    sim_device_stats_t stats;
+    sim_devices_get_stats(&stats);
+    return stats.rtc_transactions;
+}
+
+// Escrita: uma transação para liberar o WP e um burst com os 8 bytes.
+// Leitura: um burst, com todos os campos de volta.
+static void test_burst_round_trip(void) {
+    struct tm set = { .tm_year = 126, .tm_mon = 2, .tm_mday = 15, .tm_hour = 13, .tm_min = 45, .tm_sec = 30 };
+    time_t epoch = timegm(&set);
+    gmtime_r(&epoch, &set);   // Preenche o dia da semana
+
+    uint32_t before = rtc_transactions();
+    set_time_on_ds1302(&set);
+    CHECK_EQ(rtc_transactions() - before, 2);
+    CHECK_EQ(sim_rtc_epoch_us() / 1000000, epoch);
+
+    struct tm got;
+    before = rtc_transactions();
+    CHECK(read_time_from_ds1302(&got));
+    CHECK_EQ(rtc_transactions() - before, 1);
+    CHECK_EQ(got.tm_year, set.tm_year);
+    CHECK_EQ(got.tm_mon, set.tm_mon);
+    CHECK_EQ(got.tm_mday, set.tm_mday);
+    CHECK_EQ(got.tm_hour, set.tm_hour);
+    CHECK_EQ(got.tm_min, set.tm_min);
+    CHECK_EQ(got.tm_sec, set.tm_sec);
+    CHECK_EQ(got.tm_wday, set.tm_wday);
+
+    time_t read_back;
+    CHECK(rtc_read_epoch(&read_back));
+    CHECK_EQ(read_back, epoch);
+
+    // O burst de escrita volta a proteger o chip: a hora continua correndo
+    rtc_write_epoch(epoch + 3600);
+    CHECK(rtc_read_epoch(&read_back));
+    CHECK_EQ(read_back, epoch + 3600);
+}
+
+typedef struct {
+    int reg;
+    int value;                   // Valor cru (BCD) no registrador
+    bool valid;
+} range_case_t;
+
+static const range_case_t RANGE_CASES[] = {
+    { 0, 0x59, true },  { 0, 0x60, false }, { 0, 0x80, false },   // Segundos; CH = relógio parado
+    { 1, 0x59, true },  { 1, 0x5A, false },                       // Minutos
+    { 2, 0x23, true },  { 2, 0x24, false },                       // Horas (modo 24 h)
+    { 3, 0x01, true },  { 3, 0x31, true },  { 3, 0x00, false }, { 3, 0x32, false },  // Dia
+    { 4, 0x01, true },  { 4, 0x12, true },  { 4, 0x00, false }, { 4, 0x13, false },  // Mês
+};
+
+static void test_register_ranges(void) {
+    struct tm tm;
+    for (size_t i = 0; i < sizeof(RANGE_CASES) / sizeof(RANGE_CASES[0]); i++) {
+        const range_case_t *c = &RANGE_CASES[i];
+        sim_rtc_force_reg(c->reg, c->value);
+        bool ok = read_time_from_ds1302(&tm);
+        sim_rtc_force_reg(c->reg, -1);
+        if (ok != c->valid) {
+            fprintf(stderr, "registrador %d = 0x%02x: esperado %s\n", c->reg, c->value, c->valid ? "válido" : "recusado");
+        }
+        CHECK_EQ(ok, c->valid);
+    }
+
+    // Ano 2000 (chip zerado): os campos passam, mas a hora não vale
+    time_t epoch;
+    sim_rtc_force_reg(6, 0x00);
+    CHECK(read_time_from_ds1302(&tm));
+    CHECK(!rtc_read_epoch(&epoch));
+    sim_rtc_force_reg(6, -1);
+    CHECK(rtc_read_epoch(&epoch));
+}
+
+int main(void) {
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    sim_devices_config_t devices = { .start_epoch_s = START_EPOCH, .seed = 1 };
+    sim_devices_init(&devices);
+    rtc_bus_init();
+
+    test_burst_round_trip();
+    test_register_ranges();
+    return check_report("test_rtc");
+}
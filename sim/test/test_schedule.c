@@ -0,0 +1,153 @@
+// Próximo horário e janelas da agenda (main/schedule.c)
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "check.h"
+#include "record_store.h"
+#include "schedule.h"
+
+static time_t utc(int year, int mon, int day, int hour, int min, int sec) {
+    struct tm tm = { .tm_year = year - 1900, .tm_mon = mon - 1, .tm_mday = day,
+                     .tm_hour = hour, .tm_min = min, .tm_sec = sec };
+    return timegm(&tm);
+}
+
+static void set_tz(const char *tz) {
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+typedef struct {
+    const char *what;
+    const char *schedule;        // NULL = SCHEDULE_DEFAULT_TEXT
+    time_t from;
+    bool found;
+    time_t slot;
+    uint8_t turno;
+} next_case_t;
+
+static void test_next_slot(void) {
+    static const char *late = "30+0 06:30-22:30 21:00-23:59=Entardecer";
+    const next_case_t cases[] = {
+        { "antes do primeiro horário", NULL, utc(2026, 1, 20, 0, 0, 0), true, utc(2026, 1, 20, 7, 0, 0), TURNO_MANHA },
+        { "em cima do horário", NULL, utc(2026, 1, 20, 7, 0, 0), true, utc(2026, 1, 20, 7, 0, 0), TURNO_MANHA },
+        { "um segundo depois", NULL, utc(2026, 1, 20, 7, 0, 1), true, utc(2026, 1, 20, 7, 30, 0), TURNO_MANHA },
+        { "entre horários da janela", NULL, utc(2026, 1, 20, 12, 15, 0), true, utc(2026, 1, 20, 12, 30, 0), TURNO_ZENITE },
+        { "entre janelas", NULL, utc(2026, 1, 20, 9, 10, 0), true, utc(2026, 1, 20, 11, 0, 0), TURNO_ZENITE },
+        { "fim da janela é incluso", NULL, utc(2026, 1, 20, 18, 0, 0), true, utc(2026, 1, 20, 18, 0, 0), TURNO_ENTARDECER },
+        { "depois do último: dia seguinte", NULL, utc(2026, 1, 20, 18, 0, 30), true, utc(2026, 1, 21, 7, 0, 0), TURNO_MANHA },
+        { "fim do dia", NULL, utc(2026, 1, 20, 23, 59, 59), true, utc(2026, 1, 21, 7, 0, 0), TURNO_MANHA },
+        { "virada de mês", NULL, utc(2026, 1, 31, 19, 0, 0), true, utc(2026, 2, 1, 7, 0, 0), TURNO_MANHA },
+        { "virada de ano", NULL, utc(2026, 12, 31, 18, 30, 0), true, utc(2027, 1, 1, 7, 0, 0), TURNO_MANHA },
+        { "29 de fevereiro", NULL, utc(2028, 2, 28, 20, 0, 0), true, utc(2028, 2, 29, 7, 0, 0), TURNO_MANHA },
+        { "época zero", NULL, 0, true, 7 * 3600, TURNO_MANHA },
+        { "depois de 2038 (time_t de 64 bits)", NULL, utc(2038, 1, 19, 3, 14, 8), true, utc(2038, 1, 19, 7, 0, 0), TURNO_MANHA },
+        { "grade com deslocamento", "60+15 00:00-24:00 07:00-09:00=Manha", utc(2026, 1, 20, 7, 16, 0), true, utc(2026, 1, 20, 8, 15, 0), TURNO_MANHA },
+        { "fim do período do dia é excluso", late, utc(2026, 1, 20, 22, 0, 1), true, utc(2026, 1, 21, 21, 0, 0), TURNO_ENTARDECER },
+        { "último horário antes do fim do período", late, utc(2026, 1, 20, 21, 45, 0), true, utc(2026, 1, 20, 22, 0, 0), TURNO_ENTARDECER },
+        { "janela fora do período do dia", "30+0 06:30-22:30 23:00-23:30=Manha", utc(2026, 1, 20, 0, 0, 0), false, 0, 0 },
+    };
+    set_tz("UTC0");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const next_case_t *c = &cases[i];
+        schedule_t s;
+        CHECK(schedule_parse(c->schedule ? c->schedule : SCHEDULE_DEFAULT_TEXT, &s));
+        time_t slot = 0;
+        uint8_t turno = 0xFF;
+        bool found = schedule_next_slot(&s, c->from, &slot, &turno);
+        if (found != c->found || (found && (slot != c->slot || turno != c->turno))) {
+            fprintf(stderr, "caso \"%s\": found %d slot %lld turno %u\n", c->what, found, (long long)slot, turno);
+        }
+        CHECK_EQ(found, c->found);
+        if (c->found) {
+            CHECK_EQ(slot, c->slot);
+            CHECK_EQ(turno, c->turno);
+        }
+    }
+}
+
+static void test_empty_schedule(void) {
+    schedule_t s;
+    // Sem janelas o texto é rejeitado e a agenda fica como estava
+    schedule_default(&s);
+    CHECK(!schedule_parse("30+0 06:30-22:30", &s));
+    CHECK_EQ(s.n_windows, 3);
+
+    memset(&s, 0, sizeof(s));
+    s.period_min = 30;
+    s.day_end_min = 1440;
+    time_t slot = 123;
+    uint8_t turno = 0;
+    CHECK(!schedule_next_slot(&s, utc(2026, 1, 20, 12, 0, 0), &slot, &turno));
+    CHECK_EQ(slot, 123);
+}
+
+// Horário de verão (regra POSIX, sem depender da base de fusos do sistema):
+// na Europa Central 02:00 de 29/03/2026 vira 03:00 e 03:00 de 25/10 volta a 02:00.
+static void test_dst(void) {
+    set_tz("CET-1CEST,M3.5.0,M10.5.0/3");
+    schedule_t s;
+    CHECK(schedule_parse("60+0 00:00-24:00 00:00-23:59=Manha", &s));
+    time_t slot;
+    uint8_t turno;
+
+    // 01:30 CET: o horário das 02:00 não existe; o próximo é 03:00 CEST (01:00 UTC)
+    CHECK(schedule_next_slot(&s, utc(2026, 3, 29, 0, 30, 0), &slot, &turno));
+    CHECK_EQ(slot, utc(2026, 3, 29, 1, 0, 0));
+    // Depois do salto a grade segue em hora local: 04:00 CEST
+    CHECK(schedule_next_slot(&s, utc(2026, 3, 29, 1, 0, 1), &slot, &turno));
+    CHECK_EQ(slot, utc(2026, 3, 29, 2, 0, 0));
+
+    // Outono: de 02:30 CEST o próximo é 03:00 CET (02:00 UTC). A hora
+    // repetida (02:xx CET) não mede de novo o que já foi medido.
+    CHECK(schedule_next_slot(&s, utc(2026, 10, 25, 0, 30, 0), &slot, &turno));
+    CHECK_EQ(slot, utc(2026, 10, 25, 2, 0, 0));
+    // E a sequência nunca volta para antes de 'from'
+    time_t from = utc(2026, 10, 24, 22, 0, 1);
+    for (int i = 0; i < 8; i++) {
+        CHECK(schedule_next_slot(&s, from, &slot, &turno));
+        CHECK(slot >= from);
+        CHECK(slot - from <= 2 * 3600);
+        from = slot + 1;
+    }
+
+    // Mesma janela continua valendo entre horários vizinhos no dia do salto
+    CHECK(schedule_same_window(&s, utc(2026, 3, 29, 0, 0, 0), utc(2026, 3, 29, 1, 0, 0)));
+    set_tz("UTC0");
+}
+
+typedef struct {
+    const char *what;
+    time_t a, b;
+    bool same;
+} window_case_t;
+
+static void test_same_window(void) {
+    const window_case_t cases[] = {
+        { "mesma janela", utc(2026, 1, 20, 7, 0, 0), utc(2026, 1, 20, 8, 30, 0), true },
+        { "fim incluso", utc(2026, 1, 20, 16, 0, 0), utc(2026, 1, 20, 18, 0, 0), true },
+        { "janelas diferentes", utc(2026, 1, 20, 9, 0, 0), utc(2026, 1, 20, 11, 0, 0), false },
+        { "mesmo horário, outro dia", utc(2026, 1, 20, 7, 0, 0), utc(2026, 1, 21, 7, 0, 0), false },
+        { "mesmo dia do ano, outro ano", utc(2026, 1, 20, 7, 0, 0), utc(2027, 1, 20, 7, 30, 0), false },
+        { "fora de qualquer janela", utc(2026, 1, 20, 10, 0, 0), utc(2026, 1, 20, 10, 0, 0), false },
+    };
+    set_tz("UTC0");
+    schedule_t s;
+    schedule_default(&s);
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        bool same = schedule_same_window(&s, cases[i].a, cases[i].b);
+        if (same != cases[i].same) {
+            fprintf(stderr, "caso \"%s\"\n", cases[i].what);
+        }
+        CHECK_EQ(same, cases[i].same);
+    }
+}
+
+int main(void) {
+    test_next_slot();
+    test_empty_schedule();
+    test_dst();
+    test_same_window();
+    return check_report("schedule");
+}
@@ -0,0 +1,124 @@
+// Teste de regressão do firmware inteiro (ctest "sim_day"): roda depois de
+// co2sim ter simulado um dia com a agenda padrão e a curva day_co2.txt, e
+// confere o que ficou no cartão SD simulado.
+//
+//   test_sim_day DIR    (o diretório de estado passado a co2sim --dir)
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "check.h"
+#include "co2_flux.h"
+#include "record_store.h"
+
+#define DAY_FILE        "2026-01-20-Medio.dat"
+#define SLOT_MAX_LAG_S  180     // Amostragem (até 61 x 2 s) depois do horário
+#define MEDIAN_TOL_PPM  10      // Ruído do sensor simulado: 6 ppm por leitura
+
+typedef struct {
+    int hour, minute;
+    turno_id_t turno;
+    int co2_ppm;                // Patamar de day_co2.txt na janela
+} expected_slot_t;
+
+// Agenda padrão (schedule.h): a cada 30 min nas três janelas, fim incluso
+static const expected_slot_t EXPECTED[] = {
+    { 7, 0, TURNO_MANHA, 600 },  { 7, 30, TURNO_MANHA, 600 },  { 8, 0, TURNO_MANHA, 600 },
+    { 8, 30, TURNO_MANHA, 600 }, { 9, 0, TURNO_MANHA, 600 },
+    { 11, 0, TURNO_ZENITE, 400 },  { 11, 30, TURNO_ZENITE, 400 },  { 12, 0, TURNO_ZENITE, 400 },
+    { 12, 30, TURNO_ZENITE, 400 }, { 13, 0, TURNO_ZENITE, 400 },
+    { 16, 0, TURNO_ENTARDECER, 500 },  { 16, 30, TURNO_ENTARDECER, 500 },  { 17, 0, TURNO_ENTARDECER, 500 },
+    { 17, 30, TURNO_ENTARDECER, 500 }, { 18, 0, TURNO_ENTARDECER, 500 },
+};
+#define N_EXPECTED ((int)(sizeof(EXPECTED) / sizeof(EXPECTED[0])))
+
+static void check_records(const char *path) {
+    record_reader_t rd;
+    if (!record_reader_open(&rd, path)) {
+        CHECK(!"arquivo do dia ausente ou com cabeçalho inválido");
+        return;
+    }
+    CHECK(record_file_header_valid(&rd.header));
+    CHECK_EQ(rd.header.estrato_id, ESTRATO_MEDIO);
+    CHECK_EQ(rd.header.record_size, sizeof(record_t));
+    CHECK_EQ(rd.count, N_EXPECTED);
+
+    record_t rec;
+    int i = 0, rc;
+    while ((rc = record_reader_next(&rd, &rec)) != 0) {
+        CHECK_EQ(rc, 1);
+        if (rc < 0 || i >= N_EXPECTED) {
+            i++;
+            continue;
+        }
+        const expected_slot_t *e = &EXPECTED[i++];
+        struct tm slot_tm = { .tm_year = 126, .tm_mon = 0, .tm_mday = 20, .tm_hour = e->hour, .tm_min = e->minute };
+        time_t slot = timegm(&slot_tm);
+
+        CHECK_EQ(rec.estrato_id, ESTRATO_MEDIO);
+        CHECK_EQ(rec.turno_id, e->turno);
+        CHECK(rec.timestamp >= (uint32_t)slot && rec.timestamp <= (uint32_t)(slot + SLOT_MAX_LAG_S));
+        CHECK_NEAR(rec.co2_ppm, e->co2_ppm, MEDIAN_TOL_PPM);
+        CHECK(rec.co2_min <= rec.co2_ppm && rec.co2_ppm <= rec.co2_max);
+        CHECK(rec.n_valid >= 15 && rec.n_valid <= rec.n_taken && rec.n_taken <= 61);
+        CHECK(rec.temperature_c10 > 0 && rec.temperature_c10 < 450);
+        CHECK(rec.flux_flags & CO2_FLUX_COMPUTED);
+    }
+    CHECK_EQ(i, N_EXPECTED);
+    CHECK_EQ(rd.crc_errors, 0);
+
+    // CSV do download: cabeçalho + uma linha por registro, com estrato e turno
+    record_csv_rewind(&rd);
+    char buf[512], line[256];
+    size_t line_len = 0;
+    int lines = 0;
+    size_t n;
+    while ((n = record_csv_render(&rd, buf, sizeof(buf))) > 0) {
+        for (size_t k = 0; k < n; k++) {
+            if (buf[k] != '\n') {
+                if (line_len + 1 < sizeof(line)) line[line_len++] = buf[k];
+                continue;
+            }
+            line[line_len] = '\0';
+            if (lines == 0) {
+                CHECK(strncmp(line, "Date;Time;CO2_PPM;", 18) == 0);
+            } else if (lines <= N_EXPECTED) {
+                CHECK(strstr(line, ";Medio;") != NULL);
+                CHECK(strstr(line, record_turno_name(EXPECTED[lines - 1].turno)) != NULL);
+            }
+            lines++;
+            line_len = 0;
+        }
+    }
+    CHECK_EQ(lines, N_EXPECTED + 1);
+    record_reader_close(&rd);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Uso: %s DIR\n", argv[0]);
+        return 2;
+    }
+    // Mesma base de co2sim: o DS1302 guarda hora local e o firmware a trata como UTC
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    char path[512];
+    snprintf(path, sizeof(path), "%s/sdcard/%s", argv[1], DAY_FILE);
+    check_records(path);
+
+    // Só o arquivo do dia: nenhum registro fora da agenda nem arquivo renomeado
+    snprintf(path, sizeof(path), "%s/sdcard", argv[1]);
+    DIR *dir = opendir(path);
+    CHECK(dir != NULL);
+    if (dir != NULL) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (record_store_is_binary(entry->d_name)) {
+                CHECK(strcmp(entry->d_name, DAY_FILE) == 0);
+            }
+        }
+        closedir(dir);
+    }
+    return check_report("sim_day");
+}
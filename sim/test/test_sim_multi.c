@@ -0,0 +1,96 @@
+// Teste do firmware com MULTI_ESTRATO (ctest "sim_multi"): roda depois de
+// co2sim_multi ter simulado um dia com a agenda padrão e confere que cada
+// estrato tem o seu arquivo completo e que o data_logger gravou cada um
+// em lotes, pelo log da simulação.
+//
+//   test_sim_multi DIR LOG    (diretório de estado e saída de co2sim_multi)
+
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "record_store.h"
+
+#define DAY                 "2026-01-20"
+#define RECORDS_PER_DAY     15      // Agenda padrão (schedule.h)
+#define MIN_MEAN_BATCH      2       // Um fluxo por estrato: lotes pelo prazo (3600 s) ou pelo tamanho
+
+static const struct {
+    const char *name;
+    estrato_id_t id;
+} STRATA[] = {
+    { "Superior", ESTRATO_SUPERIOR },
+    { "Medio", ESTRATO_MEDIO },
+    { "Inferior", ESTRATO_INFERIOR },
+};
+#define N_STRATA ((int)(sizeof(STRATA) / sizeof(STRATA[0])))
+
+static void check_file(const char *dir, int s) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/sdcard/" DAY "-%s" RECORD_STORE_EXT, dir, STRATA[s].name);
+    record_reader_t rd;
+    if (!record_reader_open(&rd, path)) {
+        fprintf(stderr, "%s ausente ou com cabeçalho inválido\n", path);
+        CHECK(false);
+        return;
+    }
+    CHECK_EQ(rd.header.estrato_id, STRATA[s].id);
+    CHECK_EQ(rd.count, RECORDS_PER_DAY);
+
+    record_t rec;
+    int rc;
+    while ((rc = record_reader_next(&rd, &rec)) != 0) {
+        CHECK_EQ(rc, 1);
+        CHECK_EQ(rec.estrato_id, STRATA[s].id);
+    }
+    CHECK_EQ(rd.crc_errors, 0);
+    record_reader_close(&rd);
+}
+
+// "Flushed N records (B bytes) to sdcard/AAAA-MM-DD-Estrato.dat ..."
+static void check_batches(const char *log_path) {
+    FILE *log = fopen(log_path, "r");
+    CHECK(log != NULL);
+    if (log == NULL) {
+        return;
+    }
+    unsigned flushes[N_STRATA] = { 0 }, records[N_STRATA] = { 0 };
+    char line[512];
+    while (fgets(line, sizeof(line), log) != NULL) {
+        const char *msg = strstr(line, "Flushed ");
+        unsigned n, bytes;
+        char file[128];
+        if (msg == NULL || sscanf(msg, "Flushed %u records (%u bytes) to %127s", &n, &bytes, file) != 3) {
+            continue;
+        }
+        for (int s = 0; s < N_STRATA; s++) {
+            char expected[64];
+            snprintf(expected, sizeof(expected), "/" DAY "-%s" RECORD_STORE_EXT, STRATA[s].name);
+            const char *tail = file + strlen(file) - strlen(expected);
+            if (tail >= file && strcmp(tail, expected) == 0) {
+                flushes[s]++;
+                records[s] += n;
+            }
+        }
+    }
+    fclose(log);
+
+    for (int s = 0; s < N_STRATA; s++) {
+        fprintf(stderr, "%s: %u registros em %u lotes\n", STRATA[s].name, records[s], flushes[s]);
+        CHECK_EQ(records[s], RECORDS_PER_DAY);
+        CHECK(flushes[s] > 0 && records[s] >= flushes[s] * MIN_MEAN_BATCH);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Uso: %s DIR LOG\n", argv[0]);
+        return 2;
+    }
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    for (int s = 0; s < N_STRATA; s++) {
+        check_file(argv[1], s);
+    }
+    check_batches(argv[2]);
+    return check_report("sim_multi");
+}